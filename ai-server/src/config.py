@@ -22,6 +22,8 @@ class ServerConfig:
     port: int = 8080
     debug: bool = False
     log_level: str = "info"
+    # Dialogue requests a protocol v2 connection may have in generation at once
+    max_in_flight: int = 8
 
 @dataclass
 class LLMConfig:
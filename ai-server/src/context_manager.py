@@ -7,10 +7,19 @@ import os
 import time
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Dict, List, Optional, Any, Union
+from typing import Dict, List, Optional, Any, Set, Tuple, Union
 
 logger = logging.getLogger(__name__)
 
+# Field that identifies what an event is about; consecutive events of the
+# same type about the same subject are merged
+EVENT_SUBJECT_KEYS = {
+    "PLAYER_PROMOTION": "faction",
+    "PLAYER_DEMOTION": "faction",
+    "PLAYER_GAVE_ITEM": "itemId",
+    "PLAYER_TOOK_ITEM": "itemId",
+}
+
 @dataclass
 class NPCContext:
     """NPC context including personality, memory, and conversation history."""
@@ -21,6 +30,7 @@ class NPCContext:
     gender: str = "Unknown"
     class_type: str = "Unknown"
     faction: str = "None"
+    location: str = ""
     personality: str = ""
     background: str = ""
     goals: str = ""
@@ -49,26 +59,72 @@ class NPCContext:
         if len(self.conversations) > 10:
             self.conversations.pop(0)
     
-    def add_event(self, event_type: str, description: Any):
+    def add_event(self, event_type: str, description: Any = None, data: Optional[Dict[str, Any]] = None):
         """
         Add an event to the NPC's memory.
         
+        Structured events (with data) are merged with the latest event of the
+        same type about the same subject, so repeated promotions or item
+        exchanges do not crowd out the rest of the history.
+        
         Args:
             event_type: Type of event
-            description: Event description
+            description: Event description (legacy, prose)
+            data: Structured event fields (faction, rank, questId, itemId, count, actorId)
         """
         timestamp = int(time.time())
-        self.events.append({
-            "timestamp": timestamp,
-            "type": event_type,
-            "description": description
-        })
         self.last_interaction = timestamp
         
+        if data is not None:
+            previous = self._find_mergeable_event(event_type, data)
+            if previous is not None:
+                if event_type in ("PLAYER_GAVE_ITEM", "PLAYER_TOOK_ITEM"):
+                    count = previous["data"].get("count", 1) + data.get("count", 1)
+                    previous["data"] = dict(data, count=count)
+                else:
+                    previous["data"] = data
+                previous["timestamp"] = timestamp
+                return
+            
+            self.events.append({
+                "timestamp": timestamp,
+                "type": event_type,
+                "data": data
+            })
+        else:
+            self.events.append({
+                "timestamp": timestamp,
+                "type": event_type,
+                "description": description
+            })
+        
         # Limit event history
         if len(self.events) > 20:
             self.events.pop(0)
     
+    def _find_mergeable_event(self, event_type: str, data: Dict[str, Any]) -> Optional[Dict[str, Any]]:
+        """
+        Find the latest event that a new structured event can be merged into.
+        
+        Args:
+            event_type: Type of the new event
+            data: Fields of the new event
+            
+        Returns:
+            Event to merge into, or None
+        """
+        subject_key = EVENT_SUBJECT_KEYS.get(event_type)
+        if not subject_key or not self.events:
+            return None
+        
+        # Only merge with the most recent event so ordering stays meaningful
+        previous = self.events[-1]
+        if previous.get("type") != event_type or "data" not in previous:
+            return None
+        if previous["data"].get(subject_key) != data.get(subject_key):
+            return None
+        return previous
+    
     def update_memory(self, memory: Dict[str, Any]):
         """
         Update the NPC's memory from a dictionary.
@@ -99,6 +155,7 @@ class NPCContext:
             "gender": self.gender,
             "class": self.class_type,
             "faction": self.faction,
+            "location": self.location,
             "personality": self.personality,
             "background": self.background,
             "goals": self.goals,
@@ -126,6 +183,7 @@ class NPCContext:
             gender=data.get("gender", "Unknown"),
             class_type=data.get("class", "Unknown"),
             faction=data.get("faction", "None"),
+            location=data.get("location", ""),
             personality=data.get("personality", ""),
             background=data.get("background", ""),
             goals=data.get("goals", ""),
@@ -150,6 +208,12 @@ class ContextManager:
         self.memories_path = config.paths.memories
         self.npc_contexts: Dict[str, NPCContext] = {}
         
+        # Faction and cell members for broadcast events, by lower case name;
+        # built on first use, then kept up to date as contexts change
+        self.faction_members: Optional[Dict[str, Set[str]]] = None
+        self.cell_members: Dict[str, Set[str]] = {}
+        self.member_keys: Dict[str, Tuple[str, str]] = {}
+        
         # Create directories if they don't exist
         os.makedirs(self.npc_profiles_path, exist_ok=True)
         os.makedirs(self.memories_path, exist_ok=True)
@@ -177,6 +241,7 @@ class ContextManager:
                     memory_data = json.load(f)
                 context = NPCContext.from_dict(memory_data)
                 self.npc_contexts[npc_id] = context
+                self._index_member(npc_id, context.faction, context.location)
                 logger.info(f"Loaded memory for NPC {npc_id}")
                 return context
             except (json.JSONDecodeError, KeyError) as e:
@@ -190,6 +255,7 @@ class ContextManager:
                     profile_data = json.load(f)
                 context = NPCContext.from_dict(profile_data)
                 self.npc_contexts[npc_id] = context
+                self._index_member(npc_id, context.faction, context.location)
                 logger.info(f"Loaded profile for NPC {npc_id}")
                 return context
             except (json.JSONDecodeError, KeyError) as e:
@@ -206,6 +272,7 @@ class ContextManager:
                 faction=npc_data.get("faction", "None")
             )
             self.npc_contexts[npc_id] = context
+            self._index_member(npc_id, context.faction, context.location)
             logger.info(f"Created new context for NPC {npc_id}")
             return context
         
@@ -223,6 +290,9 @@ class ContextManager:
             npc_id: NPC ID
             context: NPC context
         """
+        # The NPC may have moved to another cell
+        self._index_member(npc_id, context.faction, context.location)
+        
         if not self.config.features.memory_persistence:
             return
         
@@ -233,3 +303,81 @@ class ContextManager:
             logger.info(f"Saved memory for NPC {npc_id}")
         except Exception as e:
             logger.error(f"Error saving memory for NPC {npc_id}: {e}")
+    
+    def find_npc_ids(self, faction: Optional[str] = None, cell: Optional[str] = None) -> List[str]:
+        """
+        Find the NPCs of a faction or in a cell, for broadcast events.
+        
+        Only NPCs the server knows are found: those with a profile or memory
+        file, and those seen in requests since it started. Names are compared
+        without regard to case.
+        
+        Args:
+            faction: Faction name
+            cell: Cell name, as last reported for each NPC
+            
+        Returns:
+            Sorted NPC IDs
+        """
+        self._build_member_index()
+        if faction is not None:
+            members = self.faction_members.get(faction.lower(), set())
+        elif cell is not None:
+            members = self.cell_members.get(cell.lower(), set())
+        else:
+            members = set()
+        return sorted(members)
+    
+    def _build_member_index(self):
+        """Index the factions and cells of all NPCs on disk, once."""
+        if self.faction_members is not None:
+            return
+        
+        self.faction_members = {}
+        
+        # Memories are newer than profiles, so they are read last and win
+        for directory in (self.npc_profiles_path, self.memories_path):
+            for path in Path(directory).glob("*.json"):
+                try:
+                    with open(path, "r") as f:
+                        data = json.load(f)
+                except (OSError, json.JSONDecodeError) as e:
+                    logger.error(f"Error indexing NPC file {path}: {e}")
+                    continue
+                if isinstance(data, dict):
+                    npc_id = data.get("id") or path.stem
+                    self._index_member(npc_id, data.get("faction", "None"), data.get("location", ""))
+        
+        # Loaded contexts may not be saved yet
+        for npc_id, context in self.npc_contexts.items():
+            self._index_member(npc_id, context.faction, context.location)
+    
+    def _index_member(self, npc_id: str, faction: str, location: str):
+        """
+        Record the faction and cell of an NPC, replacing what was recorded before.
+        
+        Args:
+            npc_id: NPC ID
+            faction: Faction name, "None" for none
+            location: Cell name, empty if unknown
+        """
+        if self.faction_members is None:
+            return
+        
+        keys = ((faction or "").lower(), (location or "").lower())
+        previous = self.member_keys.get(npc_id)
+        if previous == keys:
+            return
+        
+        for members, key in zip((self.faction_members, self.cell_members), previous or ("", "")):
+            if key in members:
+                members[key].discard(npc_id)
+                if not members[key]:
+                    del members[key]
+        
+        self.member_keys[npc_id] = keys
+        faction_key, cell_key = keys
+        if faction_key and faction_key != "none":
+            self.faction_members.setdefault(faction_key, set()).add(npc_id)
+        if cell_key:
+            self.cell_members.setdefault(cell_key, set()).add(npc_id)
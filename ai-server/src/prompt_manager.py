@@ -10,6 +10,39 @@ from typing import Dict, List, Optional, Any, Union
 
 logger = logging.getLogger(__name__)
 
+# Prose for structured events, only rendered when a prompt is built
+EVENT_DESCRIPTIONS = {
+    "PLAYER_JOINED_FACTION": "The player has joined {faction} and is now a {rank}.",
+    "PLAYER_LEFT_FACTION": "The player has left {faction}.",
+    "PLAYER_COMPLETED_QUEST": "The player has completed the quest: {questId}.",
+    "PLAYER_FAILED_QUEST": "The player has failed the quest: {questId}.",
+    "PLAYER_PROMOTION": "The player has been promoted to {rank} in {faction}.",
+    "PLAYER_DEMOTION": "The player has been demoted to {rank} in {faction}.",
+    "PLAYER_GAVE_ITEM": "The player has given {count} {itemId} to the NPC.",
+    "PLAYER_TOOK_ITEM": "The player has taken {count} {itemId} from the NPC.",
+    "NPC_ATTACKED": "The NPC has been attacked by {actorId}.",
+    "NPC_KILLED": "The NPC has been killed by {actorId}.",
+}
+
+def format_event_description(event_type: str, data: Dict[str, Any]) -> str:
+    """
+    Format a structured event as prose.
+    
+    Args:
+        event_type: Type of event
+        data: Structured event fields
+        
+    Returns:
+        Event description
+    """
+    template = EVENT_DESCRIPTIONS.get(event_type)
+    if not template:
+        return ", ".join(f"{key}: {value}" for key, value in data.items())
+    
+    fields = {"faction": "", "rank": "", "questId": "", "itemId": "", "count": 1, "actorId": "someone"}
+    fields.update(data)
+    return template.format(**fields)
+
 class PromptManager:
     """Manager for prompt templates and generation."""
     
@@ -125,7 +158,10 @@ class PromptManager:
         for event in context.events:
             timestamp = event.get("timestamp", "")
             event_type = event.get("type", "")
-            description = event.get("description", "")
+            if "data" in event:
+                description = format_event_description(event_type, event["data"])
+            else:
+                description = event.get("description", "")
             
             events.append(f"Event: {event_type}")
             events.append(f"Description: {description}")
@@ -20,6 +20,13 @@ from voice_system import VoiceSystem
 
 logger = logging.getLogger(__name__)
 
+# Protocol version 2 adds a hello/welcome handshake, requestId echo and
+# concurrent handling of the requests of a connection
+PROTOCOL_VERSION = 2
+
+# Optional protocol features this server implements; streaming also needs voice generation
+SUPPORTED_FEATURES: List[str] = ["streaming"]
+
 class AIServer:
     """
     WebSocket server for the Morrowind AI Framework.
@@ -95,6 +102,12 @@ class AIServer:
         """
         Handle a new WebSocket connection.
         
+        Clients that open with a hello message speak protocol version 2: their
+        requests are handled concurrently and replies may come out of order.
+        Dialogue generations are bounded by the negotiated window, while events
+        are always handled at once so their acks never wait behind the LLM.
+        Other clients get one reply per message, in order.
+        
         Args:
             websocket: WebSocket connection
             path: Connection path (optional, defaults to "/")
@@ -105,28 +118,20 @@ class AIServer:
         # Add connection to set
         self.connections.add(websocket)
         
+        # Set by the handshake
+        dialogue_slots: Optional[asyncio.Semaphore] = None
+        stream_voice = False
+        
+        # Tasks streaming voice audio, by request ID, so clients can cancel them
+        voice_streams: Dict[str, asyncio.Task] = {}
+        tasks: Set[asyncio.Task] = set()
+        
         try:
             async for message in websocket:
                 try:
                     # Parse message
                     data = json.loads(message)
                     logger.debug(f"Received message: {data}")
-                    
-                    # Process message based on type
-                    if data.get("type") == "dialogue":
-                        response = await self._handle_dialogue(data)
-                    elif data.get("type") == "event":
-                        response = await self._handle_event(data)
-                    else:
-                        response = {
-                            "type": "error",
-                            "error": f"Unknown message type: {data.get('type')}",
-                            "code": 400
-                        }
-                    
-                    # Send response
-                    await websocket.send(json.dumps(response))
-                    
                 except json.JSONDecodeError:
                     logger.error(f"Invalid JSON: {message}")
                     await websocket.send(json.dumps({
@@ -134,25 +139,144 @@ class AIServer:
                         "error": "Invalid JSON",
                         "code": 400
                     }))
-                except Exception as e:
-                    logger.error(f"Error processing message: {e}", exc_info=True)
-                    await websocket.send(json.dumps({
-                        "type": "error",
-                        "error": str(e),
-                        "code": 500
-                    }))
+                    continue
+                
+                if data.get("type") == "hello":
+                    welcome = self._handle_hello(data)
+                    dialogue_slots = asyncio.Semaphore(welcome["maxInFlight"])
+                    stream_voice = "streaming" in welcome["features"]
+                    await websocket.send(json.dumps(welcome))
+                    continue
+                
+                # The client had the line cached; stop synthesizing it
+                if data.get("type") == "voice_cancel":
+                    voice_task = voice_streams.get(data.get("requestId"))
+                    if voice_task:
+                        voice_task.cancel()
+                    continue
+                
+                if dialogue_slots is None:
+                    await self._process_message(websocket, data)
+                    continue
+                
+                # Stop reading while the window is full; the client never overfills it
+                if data.get("type") == "dialogue":
+                    await dialogue_slots.acquire()
+                    task = asyncio.create_task(
+                        self._process_message(websocket, data, dialogue_slots, stream_voice, voice_streams))
+                else:
+                    task = asyncio.create_task(self._process_message(websocket, data))
+                tasks.add(task)
+                task.add_done_callback(tasks.discard)
         except websockets.exceptions.ConnectionClosed:
             logger.info(f"Connection closed from {client_info}")
         finally:
+            # Nobody is left to read the replies
+            for task in tasks:
+                task.cancel()
+            
             # Remove connection from set
             self.connections.remove(websocket)
     
-    async def _handle_dialogue(self, data: Dict[str, Any]) -> Dict[str, Any]:
+    def _handle_hello(self, data: Dict[str, Any]) -> Dict[str, Any]:
+        """
+        Answer the handshake of a protocol version 2 client.
+        
+        Args:
+            data: Hello message with the client's window and features
+            
+        Returns:
+            Welcome message with the agreed window and features
+        """
+        max_in_flight = max(1, self.config.server.max_in_flight)
+        requested = data.get("maxInFlight", 0)
+        if isinstance(requested, int) and requested > 0:
+            max_in_flight = min(max_in_flight, requested)
+        
+        features = [f for f in data.get("features", []) if f in SUPPORTED_FEATURES]
+        if not self.voice_system:
+            features = [f for f in features if f != "streaming"]
+        logger.info(f"Protocol {PROTOCOL_VERSION} client, window {max_in_flight}, features {features}")
+        return {
+            "type": "welcome",
+            "protocol": PROTOCOL_VERSION,
+            "maxInFlight": max_in_flight,
+            "features": features
+        }
+    
+    async def _process_message(self, websocket: WebSocketServerProtocol, data: Dict[str, Any],
+                               slots: Optional[asyncio.Semaphore] = None, stream_voice: bool = False,
+                               voice_streams: Optional[Dict[str, asyncio.Task]] = None):
+        """
+        Handle one request and send its reply, which echoes the request ID.
+        
+        With voice streaming, the voice audio of a dialogue reply follows the
+        reply in binary frames while it is synthesized.
+        
+        Args:
+            websocket: WebSocket connection
+            data: Request data
+            slots: Window slot to give back once the reply is sent
+            stream_voice: Whether the client agreed to voice streaming
+            voice_streams: Streaming tasks of the connection, by request ID
+        """
+        try:
+            # Process message based on type
+            try:
+                if data.get("type") == "dialogue":
+                    response = await self._handle_dialogue(data, stream_voice and "requestId" in data)
+                elif data.get("type") == "event":
+                    response = await self._handle_event(data)
+                else:
+                    response = {
+                        "type": "error",
+                        "error": f"Unknown message type: {data.get('type')}",
+                        "code": 400
+                    }
+            except Exception as e:
+                logger.error(f"Error processing message: {e}", exc_info=True)
+                response = {
+                    "type": "error",
+                    "error": str(e),
+                    "code": 500
+                }
+            
+            if "requestId" in data:
+                response["requestId"] = data["requestId"]
+            
+            # Send response
+            await websocket.send(json.dumps(response))
+            
+            # The client counts the request as answered once the text is sent
+            if slots is not None:
+                slots.release()
+                slots = None
+            
+            if "voiceFormat" in response:
+                request_id = data["requestId"]
+                if voice_streams is not None:
+                    voice_streams[request_id] = asyncio.current_task()
+                try:
+                    await self._stream_voice(websocket, request_id, response["text"], response["npc"]["id"])
+                finally:
+                    if voice_streams is not None:
+                        voice_streams.pop(request_id, None)
+        except websockets.exceptions.ConnectionClosed:
+            pass
+        except asyncio.CancelledError:
+            # Cancelled voice streams end quietly; the client drops any chunk still on its way
+            pass
+        finally:
+            if slots is not None:
+                slots.release()
+    
+    async def _handle_dialogue(self, data: Dict[str, Any], stream_voice: bool = False) -> Dict[str, Any]:
         """
         Handle a dialogue request.
         
         Args:
             data: Dialogue request data
+            stream_voice: Announce voice audio to be streamed after the reply instead of writing a file
             
         Returns:
             Dialogue response
@@ -177,6 +301,10 @@ class AIServer:
         # Get or create NPC context
         context = self.context_manager.get_npc_context(npc_id, npc)
         
+        # Remember where the NPC was met, for cell-wide broadcast events
+        if game_state.get("location"):
+            context.location = game_state["location"]
+        
         # Update context with memory from request
         if "memory" in data:
             context.update_memory(data["memory"])
@@ -195,9 +323,10 @@ class AIServer:
         # Parse actions from response
         text, actions = self.action_parser.parse_dialogue_response(llm_response)
         
-        # Generate voice if enabled
+        # Generate voice if enabled; streamed voice is synthesized after the reply is sent
         voice_path = None
-        if self.voice_system and self.config.features.voice_generation:
+        voice_enabled = self.voice_system and self.config.features.voice_generation
+        if voice_enabled and not stream_voice:
             voice_path = await self.voice_system.generate_voice(text, npc_id)
         
         # Update NPC memory
@@ -218,9 +347,43 @@ class AIServer:
         # Add voice path if available
         if voice_path:
             response["voice"] = voice_path
+        elif voice_enabled and stream_voice and text:
+            response["voiceFormat"] = self.voice_system.audio_format
+            response["voiceId"] = self.voice_system.get_voice_id(npc_id)
         
         return response
     
+    async def _stream_voice(self, websocket: WebSocketServerProtocol, request_id: str, text: str, npc_id: str):
+        """
+        Synthesize the voice of a dialogue reply and send it in binary frames.
+        
+        Each frame holds one byte with the length of the request ID, the
+        request ID, one flags byte (bit 0: last chunk) and the audio. A chunk
+        is held back until the next one arrives, so the last frame can carry
+        the flag; a failed synthesis still ends the stream.
+        
+        Args:
+            websocket: WebSocket connection
+            request_id: Request ID of the dialogue reply
+            text: Text to speak
+            npc_id: NPC ID
+        """
+        encoded_id = request_id.encode("utf-8")[:255]
+        header = bytes([len(encoded_id)]) + encoded_id
+        
+        pending = b""
+        try:
+            async for chunk in self.voice_system.stream_voice(text, npc_id):
+                if pending:
+                    await websocket.send(header + b"\x00" + pending)
+                pending = chunk
+        except websockets.exceptions.ConnectionClosed:
+            raise
+        except Exception as e:
+            logger.error(f"Error streaming voice: {e}")
+        
+        await websocket.send(header + b"\x01" + pending)
+    
     async def _handle_event(self, data: Dict[str, Any]) -> Dict[str, Any]:
         """
         Handle an event request.
@@ -231,9 +394,14 @@ class AIServer:
         Returns:
             Event response
         """
+        # Events for a group of NPCs name a target instead of an NPC
+        if "target" in data:
+            return await self._handle_broadcast(data)
+        
         # Extract event information
         npc_id = data.get("npcId")
         event_type = data.get("eventType")
+        event_data = data.get("data")
         description = data.get("description")
         
         if not npc_id:
@@ -253,8 +421,9 @@ class AIServer:
         # Get NPC context
         context = self.context_manager.get_npc_context(npc_id)
         
-        # Add event to context
-        context.add_event(event_type, description)
+        # Add event to context; structured fields are kept as-is and only
+        # turned into prose when a prompt is built
+        context.add_event(event_type, description, event_data)
         
         # Save context
         self.context_manager.save_npc_context(npc_id, context)
@@ -266,3 +435,67 @@ class AIServer:
             "eventType": event_type,
             "status": "success"
         }
+    
+    async def _handle_broadcast(self, data: Dict[str, Any]) -> Dict[str, Any]:
+        """
+        Handle an event request for a group of NPCs.
+        
+        The target names the NPCs, a faction or a cell; factions and cells are
+        resolved to the NPCs the server knows. Every NPC gets the event, and
+        the client gets one ack for all of them.
+        
+        Args:
+            data: Event request data with a target of npcIds, faction or cell
+            
+        Returns:
+            Event response with the number of NPCs reached
+        """
+        target = data.get("target")
+        event_type = data.get("eventType")
+        event_data = data.get("data")
+        description = data.get("description")
+        
+        if not isinstance(target, dict):
+            return {
+                "type": "error",
+                "error": "Invalid event target",
+                "code": 400
+            }
+        
+        if not event_type:
+            return {
+                "type": "error",
+                "error": "Missing event type",
+                "code": 400
+            }
+        
+        # Resolve the target to NPC IDs
+        if isinstance(target.get("npcIds"), list):
+            npc_ids = [npc_id for npc_id in target["npcIds"] if isinstance(npc_id, str) and npc_id]
+        elif target.get("faction"):
+            npc_ids = self.context_manager.find_npc_ids(faction=target["faction"])
+        elif target.get("cell"):
+            npc_ids = self.context_manager.find_npc_ids(cell=target["cell"])
+        else:
+            return {
+                "type": "error",
+                "error": "Event target needs npcIds, faction or cell",
+                "code": 400
+            }
+        
+        # Add event to each context, once per NPC
+        npc_ids = list(dict.fromkeys(npc_ids))
+        for npc_id in npc_ids:
+            context = self.context_manager.get_npc_context(npc_id)
+            context.add_event(event_type, description, event_data)
+            self.context_manager.save_npc_context(npc_id, context)
+        
+        logger.info(f"Broadcast {event_type} to {len(npc_ids)} NPCs")
+        
+        # Create response
+        return {
+            "type": "event_ack",
+            "eventType": event_type,
+            "status": "success",
+            "targets": len(npc_ids)
+        }
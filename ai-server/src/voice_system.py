@@ -4,17 +4,24 @@
 import asyncio
 import logging
 import os
+import threading
 import time
 import uuid
 from abc import ABC, abstractmethod
 from pathlib import Path
-from typing import Dict, List, Optional, Any, Union
+from typing import AsyncIterator, Dict, List, Optional, Any, Union
 
 logger = logging.getLogger(__name__)
 
+# Size of the audio chunks streamed from a finished voice file
+STREAM_CHUNK_SIZE = 16 * 1024
+
 class VoiceProvider(ABC):
     """Abstract base class for voice providers."""
     
+    # Encoding of the generated audio
+    audio_format = "mp3"
+    
     def __init__(self, config):
         """
         Initialize the voice provider.
@@ -24,6 +31,18 @@ class VoiceProvider(ABC):
         """
         self.config = config
     
+    def resolve_voice_id(self, voice_id: str = None) -> str:
+        """
+        Name the voice a line is spoken with, which keys client voice caches.
+        
+        Args:
+            voice_id: Voice ID (optional)
+            
+        Returns:
+            Voice ID the provider actually uses
+        """
+        return voice_id or self.config.voice.voice_id
+    
     @abstractmethod
     async def generate_voice(self, text: str, voice_id: str = None) -> str:
         """
@@ -37,6 +56,28 @@ class VoiceProvider(ABC):
             Path to the generated audio file
         """
         pass
+    
+    async def stream_voice(self, text: str, voice_id: str = None) -> AsyncIterator[bytes]:
+        """
+        Generate voice from text, yielding encoded audio as it becomes available.
+        
+        Providers that cannot stream generate the whole file first and then
+        yield it in chunks.
+        
+        Args:
+            text: Text to convert to speech
+            voice_id: Voice ID (optional)
+            
+        Yields:
+            Chunks of encoded audio
+        """
+        output_path = await self.generate_voice(text, voice_id)
+        with open(output_path, "rb") as audio_file:
+            while True:
+                chunk = audio_file.read(STREAM_CHUNK_SIZE)
+                if not chunk:
+                    break
+                yield chunk
 
 class ElevenLabsProvider(VoiceProvider):
     """ElevenLabs API provider."""
@@ -105,6 +146,57 @@ class ElevenLabsProvider(VoiceProvider):
         except Exception as e:
             logger.error(f"Error generating voice with ElevenLabs: {e}")
             raise
+    
+    async def stream_voice(self, text: str, voice_id: str = None) -> AsyncIterator[bytes]:
+        """
+        Generate voice from text using the ElevenLabs streaming API.
+        
+        The API is read on a worker thread, which hands each chunk to the
+        event loop as soon as it arrives.
+        
+        Args:
+            text: Text to convert to speech
+            voice_id: Voice ID (optional)
+            
+        Yields:
+            Chunks of MP3 audio
+        """
+        voice_id = voice_id or self.voice_id
+        loop = asyncio.get_event_loop()
+        queue: asyncio.Queue = asyncio.Queue()
+        
+        # Set when the consumer goes away, e.g. because the client had the line cached
+        stopped = threading.Event()
+        
+        def produce():
+            try:
+                for chunk in self.elevenlabs.generate(
+                    text=text,
+                    voice=voice_id,
+                    model="eleven_monolingual_v1",
+                    stream=True
+                ):
+                    if stopped.is_set():
+                        break
+                    loop.call_soon_threadsafe(queue.put_nowait, chunk)
+                loop.call_soon_threadsafe(queue.put_nowait, None)
+            except Exception as e:
+                loop.call_soon_threadsafe(queue.put_nowait, e)
+        
+        producer = loop.run_in_executor(None, produce)
+        try:
+            while True:
+                item = await queue.get()
+                if item is None:
+                    break
+                if isinstance(item, Exception):
+                    logger.error(f"Error streaming voice with ElevenLabs: {item}")
+                    raise item
+                if item:
+                    yield item
+            await producer
+        finally:
+            stopped.set()
 
 class LocalTTSProvider(VoiceProvider):
     """Local text-to-speech provider."""
@@ -131,6 +223,18 @@ class LocalTTSProvider(VoiceProvider):
             logger.error("pyttsx3 package not installed. Please install it with 'pip install pyttsx3'")
             raise
     
+    def resolve_voice_id(self, voice_id: str = None) -> str:
+        """
+        Name the voice a line is spoken with; the local engine has only one.
+        
+        Args:
+            voice_id: Voice ID (ignored)
+            
+        Returns:
+            Voice ID the provider actually uses
+        """
+        return f"local:{self.voice}"
+    
     async def generate_voice(self, text: str, voice_id: str = None) -> str:
         """
         Generate voice from text using a local TTS engine.
@@ -237,3 +341,37 @@ class VoiceSystem:
         except Exception as e:
             logger.error(f"Error generating voice: {e}")
             return None
+    
+    def get_voice_id(self, npc_id: str = None) -> str:
+        """
+        Name the voice an NPC's lines are spoken with.
+        
+        Args:
+            npc_id: NPC ID (optional)
+            
+        Returns:
+            Voice ID
+        """
+        return self.provider.resolve_voice_id(npc_id)
+    
+    @property
+    def audio_format(self) -> str:
+        """Encoding of the audio the provider generates."""
+        return self.provider.audio_format
+    
+    async def stream_voice(self, text: str, npc_id: str = None) -> AsyncIterator[bytes]:
+        """
+        Generate voice from text, yielding encoded audio as it is synthesized.
+        
+        Args:
+            text: Text to convert to speech
+            npc_id: NPC ID (optional)
+            
+        Yields:
+            Chunks of encoded audio; nothing if voice generation is disabled
+        """
+        if not self.enabled:
+            return
+        
+        async for chunk in self.provider.stream_voice(text, npc_id):
+            yield chunk
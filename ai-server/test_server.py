@@ -82,7 +82,10 @@ async def test_event():
         "type": "event",
         "npcId": "example_npc",
         "eventType": "PLAYER_JOINED_FACTION",
-        "description": "The player has joined House Hlaalu and is now a Retainer."
+        "data": {
+            "faction": "House Hlaalu",
+            "rank": "Retainer"
+        }
     }
     
     # Process event request
@@ -91,7 +94,37 @@ async def test_event():
     # Print response
     print("\n=== Event Test ===")
     print(f"Event: {event_request['eventType']}")
-    print(f"Description: {event_request['description']}")
+    print(f"Data: {event_request['data']}")
+    print(f"Response: {response}")
+    
+    return response
+
+async def test_broadcast():
+    """Test faction-wide event handling."""
+    # Load configuration
+    config = load_config()
+    
+    # Create server
+    server = AIServer(config)
+    
+    # Test broadcast to every member of a faction
+    broadcast_request = {
+        "type": "event",
+        "target": {"faction": "House Hlaalu"},
+        "eventType": "PLAYER_JOINED_FACTION",
+        "data": {
+            "faction": "House Hlaalu",
+            "rank": "Hireling"
+        }
+    }
+    
+    # Process broadcast request
+    response = await server._handle_event(broadcast_request)
+    
+    # Print response
+    print("\n=== Broadcast Test ===")
+    print(f"Target: {broadcast_request['target']}")
+    print(f"Event: {broadcast_request['eventType']}")
     print(f"Response: {response}")
     
     return response
@@ -105,6 +138,9 @@ async def main():
         # Test event
         await test_event()
         
+        # Test broadcast
+        await test_broadcast()
+        
         print("\nAll tests completed successfully!")
     except Exception as e:
         logger.error(f"Error during tests: {e}", exc_info=True)
@@ -0,0 +1,73 @@
+#include "action.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace AI
+{
+    std::optional<ItemId> ItemId::fromString(std::string_view id)
+    {
+        if (id.empty() || id.size() > sMaxLength)
+            return std::nullopt;
+
+        ItemId result;
+        std::memcpy(result.mData.data(), id.data(), id.size());
+        result.mLength = static_cast<std::uint8_t>(id.size());
+        return result;
+    }
+
+    ParamValue ActionParams::parseValue(Key key, std::string_view text)
+    {
+        switch (key)
+        {
+            case Key::ItemId:
+                if (auto itemId = ItemId::fromString(text))
+                    return *itemId;
+                break;
+            case Key::Quantity:
+            {
+                std::int32_t value = 0;
+                const char* end = text.data() + text.size();
+                auto [ptr, ec] = std::from_chars(text.data(), end, value);
+                if (ec == std::errc() && ptr == end)
+                    return value;
+                break;
+            }
+            default:
+                break;
+        }
+        return std::string(text);
+    }
+
+    std::int32_t ActionParams::getInt(Key key, std::int32_t fallback) const
+    {
+        const ParamValue& value = get(key);
+        if (const auto* intValue = std::get_if<std::int32_t>(&value))
+            return *intValue;
+        if (const auto* floatValue = std::get_if<float>(&value))
+        {
+            // Models may send any number; out of range values would make lround and the cast undefined
+            const double number = *floatValue;
+            if (std::isnan(number))
+                return fallback;
+            if (number >= static_cast<double>(std::numeric_limits<std::int32_t>::max()))
+                return std::numeric_limits<std::int32_t>::max();
+            if (number <= static_cast<double>(std::numeric_limits<std::int32_t>::min()))
+                return std::numeric_limits<std::int32_t>::min();
+            return static_cast<std::int32_t>(std::lround(number));
+        }
+        return fallback;
+    }
+
+    std::string_view ActionParams::getString(Key key) const
+    {
+        const ParamValue& value = get(key);
+        if (const auto* stringValue = std::get_if<std::string>(&value))
+            return *stringValue;
+        if (const auto* itemId = std::get_if<ItemId>(&value))
+            return itemId->view();
+        return {};
+    }
+}
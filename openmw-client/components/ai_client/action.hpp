@@ -0,0 +1,234 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_ACTION_H
+#define OPENMW_COMPONENTS_AI_CLIENT_ACTION_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include <boost/container/small_vector.hpp>
+
+namespace AI
+{
+    /**
+     * @brief Enum for action types that can be performed by NPCs
+     */
+    enum class ActionType
+    {
+        None,
+        Emote,
+        GiveItem,
+        TakeItem,
+        StartBarter,
+        Attack,
+        EndConversation
+    };
+
+    /**
+     * @brief Wire name of an action type
+     */
+    struct ActionTypeName
+    {
+        std::string_view name;
+        ActionType type;
+    };
+
+    /**
+     * @brief Compile-time table mapping wire names to action types
+     */
+    inline constexpr std::array<ActionTypeName, 6> sActionTypeNames{{
+        { "EMOTE", ActionType::Emote },
+        { "GIVE_ITEM", ActionType::GiveItem },
+        { "TAKE_ITEM", ActionType::TakeItem },
+        { "START_BARTER", ActionType::StartBarter },
+        { "ATTACK", ActionType::Attack },
+        { "END_CONVERSATION", ActionType::EndConversation },
+    }};
+
+    /**
+     * @brief Look up an action type by its wire name
+     *
+     * @param name Wire name, e.g. "GIVE_ITEM"
+     * @return Matching action type, or ActionType::None if unknown
+     */
+    constexpr ActionType actionTypeFromString(std::string_view name)
+    {
+        for (const auto& entry : sActionTypeNames)
+        {
+            if (entry.name == name)
+                return entry.type;
+        }
+        return ActionType::None;
+    }
+
+    /**
+     * @brief Get the wire name of an action type
+     *
+     * @param type Action type
+     * @return Wire name, or "UNKNOWN" for ActionType::None
+     */
+    constexpr std::string_view actionTypeToString(ActionType type)
+    {
+        for (const auto& entry : sActionTypeNames)
+        {
+            if (entry.type == type)
+                return entry.name;
+        }
+        return "UNKNOWN";
+    }
+
+    /**
+     * @brief Item record id stored inline, without heap allocation
+     */
+    class ItemId
+    {
+    public:
+        /**
+         * @brief Longest record id the engine accepts
+         */
+        static constexpr std::size_t sMaxLength = 32;
+
+        ItemId() = default;
+
+        /**
+         * @brief Create an item id from a string
+         *
+         * @param id Record id
+         * @return Item id, or std::nullopt if the id is empty or too long
+         */
+        static std::optional<ItemId> fromString(std::string_view id);
+
+        std::string_view view() const { return std::string_view(mData.data(), mLength); }
+        bool empty() const { return mLength == 0; }
+
+        bool operator==(const ItemId& other) const { return view() == other.view(); }
+        bool operator!=(const ItemId& other) const { return !(*this == other); }
+
+    private:
+        std::array<char, sMaxLength> mData{};
+        std::uint8_t mLength = 0;
+    };
+
+    /**
+     * @brief Typed value of an action parameter
+     */
+    using ParamValue = std::variant<std::monostate, std::int32_t, float, std::string, ItemId>;
+
+    /**
+     * @brief Flat container for action parameters
+     *
+     * Known parameters live in fixed slots with typed values. Parameters the
+     * client does not know about go to an overflow map, which only allocates
+     * when it is actually used.
+     */
+    class ActionParams
+    {
+    public:
+        /**
+         * @brief Known parameter keys
+         */
+        enum class Key : std::uint8_t
+        {
+            ItemId,
+            Quantity,
+            Description,
+            Reason
+        };
+
+        static constexpr std::size_t sKeyCount = 4;
+
+        /**
+         * @brief Wire names of the known parameter keys, indexed by Key
+         */
+        static constexpr std::array<std::string_view, sKeyCount> sKeyNames{
+            "item_id",
+            "quantity",
+            "description",
+            "reason",
+        };
+
+        /**
+         * @brief Look up a known parameter key by its wire name
+         *
+         * @param name Wire name, e.g. "item_id"
+         * @return Matching key, or std::nullopt for unknown parameters
+         */
+        static constexpr std::optional<Key> keyFromString(std::string_view name)
+        {
+            for (std::size_t i = 0; i < sKeyCount; ++i)
+            {
+                if (sKeyNames[i] == name)
+                    return static_cast<Key>(i);
+            }
+            return std::nullopt;
+        }
+
+        static constexpr std::string_view keyToString(Key key) { return sKeyNames[static_cast<std::size_t>(key)]; }
+
+        /**
+         * @brief Convert a textual wire value to the type expected for a key
+         *
+         * @param key Parameter key
+         * @param text Value as sent by the server
+         * @return Integer for quantities, item id for item ids, string otherwise
+         */
+        static ParamValue parseValue(Key key, std::string_view text);
+
+        void set(Key key, ParamValue value) { mValues[static_cast<std::size_t>(key)] = std::move(value); }
+        const ParamValue& get(Key key) const { return mValues[static_cast<std::size_t>(key)]; }
+        bool has(Key key) const { return !std::holds_alternative<std::monostate>(get(key)); }
+
+        /**
+         * @brief Get a parameter as an integer
+         *
+         * @param key Parameter key
+         * @param fallback Value returned if the parameter is missing, not numeric or NaN
+         * @return Parameter value; floats are rounded and clamped to the int32 range
+         */
+        std::int32_t getInt(Key key, std::int32_t fallback = 0) const;
+
+        /**
+         * @brief Get a parameter as a string
+         *
+         * @param key Parameter key
+         * @return View of the string or item id value, or an empty view for other types
+         */
+        std::string_view getString(Key key) const;
+
+        /**
+         * @brief Store a parameter the client does not know about
+         *
+         * @param key Wire name
+         * @param value Value as a string
+         */
+        void setExtra(std::string key, std::string value) { mExtra.insert_or_assign(std::move(key), std::move(value)); }
+
+        /**
+         * @brief Parameters the client does not know about
+         */
+        const std::map<std::string, std::string>& getExtras() const { return mExtra; }
+
+    private:
+        std::array<ParamValue, sKeyCount> mValues;
+        std::map<std::string, std::string> mExtra;
+    };
+
+    /**
+     * @brief Struct for an NPC action
+     */
+    struct Action
+    {
+        ActionType type = ActionType::None;
+        ActionParams params;
+    };
+
+    /**
+     * @brief List of NPC actions; typical responses fit in the inline storage
+     */
+    using ActionList = boost::container::small_vector<Action, 4>;
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_ACTION_H
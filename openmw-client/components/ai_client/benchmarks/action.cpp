@@ -0,0 +1,50 @@
+#include "fixtures.hpp"
+
+#include <components/ai_client/action.hpp>
+#include <components/ai_client/responsedecoder.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    AI::DialogueResult loadDialogue(std::string_view fixture)
+    {
+        AI::DecodedResponse decoded;
+        AI::ResponseDecoder decoder;
+        if (!decoder.decode(AIBenchmarks::loadFixture(fixture), decoded) || !decoded.dialogue)
+            throw std::runtime_error("Fixture is not a dialogue response: " + std::string(fixture));
+        return *decoded.dialogue;
+    }
+
+    // What a script does with each action: read its type and typed parameters
+    void readActions(benchmark::State& state, std::string_view fixture)
+    {
+        const AI::DialogueResult dialogue = loadDialogue(fixture);
+        for (auto _ : state)
+        {
+            for (const AI::Action& action : dialogue.actions)
+            {
+                benchmark::DoNotOptimize(AI::actionTypeToString(action.type));
+                benchmark::DoNotOptimize(action.params.getInt(AI::ActionParams::Key::Quantity, 1));
+                benchmark::DoNotOptimize(action.params.get(AI::ActionParams::Key::ItemId));
+                benchmark::DoNotOptimize(action.params.getString(AI::ActionParams::Key::Description));
+            }
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * dialogue.actions.size()));
+    }
+
+    // Conversion of server strings into typed actions, as done while decoding
+    void parseActionFields(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(AI::actionTypeFromString("GIVE_ITEM"));
+            benchmark::DoNotOptimize(AI::ActionParams::keyFromString("quantity"));
+            benchmark::DoNotOptimize(AI::ActionParams::parseValue(AI::ActionParams::Key::ItemId, "potion_restore_health_01"));
+            benchmark::DoNotOptimize(AI::ActionParams::parseValue(AI::ActionParams::Key::Quantity, "250"));
+        }
+    }
+}
+
+BENCHMARK_CAPTURE(readActions, dialogue_actions, "dialogue_actions.json");
+BENCHMARK(parseActionFields);
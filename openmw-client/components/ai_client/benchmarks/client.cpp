@@ -0,0 +1,50 @@
+#include <components/ai_client/client.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void generateRequestId(benchmark::State& state)
+    {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(AI::Client::generateRequestId());
+    }
+
+    // Same container and key type as the client's table of pending dialogue callbacks.
+    // Each iteration registers one request and completes the oldest, with state.range(0)
+    // requests outstanding.
+    void pendingTable(benchmark::State& state)
+    {
+        const auto outstanding = static_cast<std::size_t>(state.range(0));
+
+        std::vector<std::string> ids;
+        for (std::size_t i = 0; i < outstanding + 1024; ++i)
+            ids.push_back(AI::Client::generateRequestId());
+
+        std::map<std::string, AI::DialogueCallback> pending;
+        for (std::size_t i = 0; i < outstanding; ++i)
+            pending[ids[i]] = [](const AI::DialogueResultPtr&) {};
+
+        std::size_t next = outstanding;
+        std::size_t oldest = 0;
+        for (auto _ : state)
+        {
+            pending[ids[next % ids.size()]] = [](const AI::DialogueResultPtr&) {};
+
+            auto it = pending.find(ids[oldest % ids.size()]);
+            AI::DialogueCallback callback = std::move(it->second);
+            pending.erase(it);
+            benchmark::DoNotOptimize(callback);
+
+            ++next;
+            ++oldest;
+        }
+    }
+}
+
+BENCHMARK(generateRequestId);
+BENCHMARK(pendingTable)->Arg(1)->Arg(16)->Arg(256);
@@ -0,0 +1,31 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_BENCHMARKS_FIXTURES_H
+#define OPENMW_COMPONENTS_AI_CLIENT_BENCHMARKS_FIXTURES_H
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace AIBenchmarks
+{
+    /**
+     * @brief Load a recorded server message from the fixtures directory
+     *
+     * @param name File name, e.g. "dialogue_actions.json"
+     * @return File contents
+     */
+    inline std::string loadFixture(std::string_view name)
+    {
+        std::string path = std::string(AI_CLIENT_FIXTURES_DIR) + "/" + std::string(name);
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Failed to open fixture: " + path);
+
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_BENCHMARKS_FIXTURES_H
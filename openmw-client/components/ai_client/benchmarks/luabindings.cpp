@@ -0,0 +1,86 @@
+#include "fixtures.hpp"
+
+#include <components/ai_client/responsedecoder.hpp>
+#include <components/lua/ai.hpp>
+#include <components/openmw-mp/mwbase/aimanagerimpl.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    /**
+     * @brief AI manager answering every dialogue request at once with a recorded response
+     */
+    class FixtureAIManager : public MWBase::AIManagerImpl
+    {
+    public:
+        explicit FixtureAIManager(std::string_view fixture)
+        {
+            AI::DecodedResponse decoded;
+            AI::ResponseDecoder decoder;
+            if (!decoder.decode(AIBenchmarks::loadFixture(fixture), decoded) || !decoded.dialogue)
+                throw std::runtime_error("Fixture is not a dialogue response: " + std::string(fixture));
+            mResult = std::move(decoded.dialogue);
+        }
+
+        void sendDialogueRequest(const std::string&, const AI::NpcProfilePtr&, const std::string&,
+            const std::map<std::string, std::string>&, DialogueCallback callback) override
+        {
+            callback(mResult);
+        }
+
+    private:
+        AI::DialogueResultPtr mResult;
+    };
+
+    // A dialogue round trip through the bindings: request from Lua, result read back by the script
+    void luaDialogueRoundTrip(benchmark::State& state, std::string_view fixture)
+    {
+        FixtureAIManager aiManager(fixture);
+        sol::state lua;
+        lua.open_libraries(sol::lib::base);
+        LuaUtil::registerAIFunctions(lua, &aiManager);
+
+        lua.script(R"(
+            function talk()
+                local total = 0
+                AI.sendDialogue("sedura_ienth", "Is there more work for me?", nil, function(response)
+                    total = #response.text
+                    for i = 1, response.actionCount do
+                        local action = response:getAction(i)
+                        if action.type == AI.Action.GiveItem then
+                            total = total + (action.params.quantity or 1)
+                        end
+                    end
+                end)
+                return total
+            end
+        )");
+        sol::protected_function talk = lua["talk"];
+
+        for (auto _ : state)
+        {
+            sol::protected_function_result result = talk();
+            benchmark::DoNotOptimize(result.get<int>());
+        }
+    }
+
+    void luaGetStats(benchmark::State& state)
+    {
+        FixtureAIManager aiManager("dialogue_simple.json");
+        sol::state lua;
+        lua.open_libraries(sol::lib::base);
+        LuaUtil::registerAIFunctions(lua, &aiManager);
+
+        sol::protected_function getStats = lua["AI"]["getStats"];
+        for (auto _ : state)
+        {
+            sol::table stats = getStats();
+            benchmark::DoNotOptimize(stats);
+        }
+    }
+}
+
+BENCHMARK_CAPTURE(luaDialogueRoundTrip, dialogue_simple, "dialogue_simple.json");
+BENCHMARK_CAPTURE(luaDialogueRoundTrip, dialogue_actions, "dialogue_actions.json");
+BENCHMARK(luaGetStats);
@@ -0,0 +1,145 @@
+#include "fixtures.hpp"
+
+#include <components/ai_client/requestwriter.hpp>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+namespace
+{
+    using json = nlohmann::json;
+
+    constexpr std::string_view sRequestId = "9b2e4f6a8c0d4e1f3a5b7c9d1e3f5a7b";
+
+    AI::DialogueRequest loadDialogueRequest(std::string_view fixture)
+    {
+        const json recorded = json::parse(AIBenchmarks::loadFixture(fixture));
+        const json& npc = recorded.at("npc");
+        const json& gameState = recorded.at("gameState");
+
+        AI::DialogueRequest request;
+        request.npcId = npc.at("id").get<std::string>();
+        AI::NpcRecord record;
+        record.name = npc.at("name").get<std::string>();
+        record.race = npc.at("race").get<std::string>();
+        record.gender = npc.at("gender").get<std::string>();
+        record.npcClass = npc.at("class").get<std::string>();
+        record.faction = npc.at("faction").get<std::string>();
+        request.npc = AI::makeNpcProfile(std::move(record));
+        request.playerMessage = recorded.at("playerMessage").get<std::string>();
+
+        auto snapshot = std::make_shared<AI::GameState>();
+        snapshot->playerName = gameState.at("player_name").get<std::string>();
+        snapshot->playerRace = gameState.at("player_race").get<std::string>();
+        snapshot->playerGender = gameState.at("player_gender").get<std::string>();
+        snapshot->playerClass = gameState.at("player_class").get<std::string>();
+        snapshot->playerLevel = gameState.at("player_level").get<int>();
+        snapshot->location = gameState.at("location").get<std::string>();
+        snapshot->timeOfDay = AI::GameStateProvider::getTimeOfDay(19.f);
+        snapshot->weather = gameState.at("weather").get<std::string>();
+        for (const auto& faction : gameState.at("player_factions"))
+            snapshot->playerFactions.emplace_back(faction.at(0).get<std::string>(), faction.at(1).get<int>());
+        request.gameState = std::move(snapshot);
+
+        for (const auto& [key, value] : recorded.at("gameStateOverrides").items())
+            request.gameStateOverrides[key] = value.get<std::string>();
+
+        return request;
+    }
+
+    AI::EventRequest makeEventRequest()
+    {
+        AI::EventRequest request;
+        request.npcId = "sedura_ienth";
+        request.event.type = AI::EventType::PlayerPromotion;
+        request.event.faction = "House Hlaalu";
+        request.event.rank = "Kinsman";
+        return request;
+    }
+
+    // Reference: JSON DOM built and dumped per request, as the game thread used to do
+    std::string encodeDom(const AI::DialogueRequest& request)
+    {
+        json message;
+        message["type"] = "dialogue";
+        message["requestId"] = sRequestId;
+        const AI::NpcProfile& npc = *request.npc;
+        message["npc"] = { { "id", request.npcId }, { "name", npc.name }, { "race", npc.race },
+            { "gender", npc.gender }, { "class", npc.npcClass }, { "faction", npc.faction } };
+        message["playerMessage"] = request.playerMessage;
+
+        json gameState = json::object();
+        const AI::GameState& snapshot = *request.gameState;
+        gameState["player_name"] = snapshot.playerName;
+        gameState["player_race"] = snapshot.playerRace;
+        gameState["player_gender"] = snapshot.playerGender;
+        gameState["player_class"] = snapshot.playerClass;
+        gameState["player_level"] = std::to_string(snapshot.playerLevel);
+        gameState["location"] = snapshot.location;
+        gameState["time_of_day"] = snapshot.timeOfDay;
+        gameState["weather"] = snapshot.weather;
+
+        std::string factions;
+        for (const auto& [faction, rank] : snapshot.playerFactions)
+        {
+            if (!factions.empty())
+                factions += ',';
+            factions += faction;
+            factions += ':';
+            factions += std::to_string(rank);
+        }
+        gameState["player_factions"] = factions;
+        for (const auto& [key, value] : request.gameStateOverrides)
+            gameState[key] = value;
+        message["gameState"] = std::move(gameState);
+
+        return message.dump();
+    }
+
+    void encodeDialogueDom(benchmark::State& state, std::string_view fixture)
+    {
+        const AI::DialogueRequest request = loadDialogueRequest(fixture);
+        std::size_t bytes = 0;
+        for (auto _ : state)
+        {
+            std::string message = encodeDom(request);
+            bytes += message.size();
+            benchmark::DoNotOptimize(message);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    }
+
+    // Streaming writer into a pooled buffer, as the IO thread does
+    void encodeDialogueWriter(benchmark::State& state, std::string_view fixture)
+    {
+        const AI::DialogueRequest request = loadDialogueRequest(fixture);
+        AI::BufferPool pool;
+        std::size_t bytes = 0;
+        for (auto _ : state)
+        {
+            std::string message = pool.acquire();
+            AI::writeDialogueRequest(message, sRequestId, request);
+            bytes += message.size();
+            benchmark::DoNotOptimize(message);
+            pool.release(std::move(message));
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    }
+
+    void encodeEventWriter(benchmark::State& state)
+    {
+        const AI::EventRequest request = makeEventRequest();
+        AI::BufferPool pool;
+        for (auto _ : state)
+        {
+            std::string message = pool.acquire();
+            AI::writeEventRequest(message, sRequestId, request);
+            benchmark::DoNotOptimize(message);
+            pool.release(std::move(message));
+        }
+    }
+}
+
+BENCHMARK_CAPTURE(encodeDialogueDom, dialogue_request, "dialogue_request.json");
+BENCHMARK_CAPTURE(encodeDialogueWriter, dialogue_request, "dialogue_request.json");
+BENCHMARK(encodeEventWriter);
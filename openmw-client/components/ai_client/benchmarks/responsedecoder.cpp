@@ -0,0 +1,44 @@
+#include "fixtures.hpp"
+
+#include <components/ai_client/responsedecoder.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    // Current path: full JSON DOM for every frame
+    void decodeDom(benchmark::State& state, std::string_view fixture)
+    {
+        const std::string message = AIBenchmarks::loadFixture(fixture);
+        for (auto _ : state)
+        {
+            AI::DecodedResponse result;
+            benchmark::DoNotOptimize(AI::ResponseDecoder::decodeDom(message, result));
+            benchmark::DoNotOptimize(result);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * message.size()));
+    }
+
+    // Streaming decoder writing straight into the result structs
+    void decodeSax(benchmark::State& state, std::string_view fixture)
+    {
+        const std::string message = AIBenchmarks::loadFixture(fixture);
+        AI::ResponseDecoder decoder;
+        for (auto _ : state)
+        {
+            AI::DecodedResponse result;
+            benchmark::DoNotOptimize(decoder.decode(message, result));
+            benchmark::DoNotOptimize(result);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * message.size()));
+    }
+}
+
+BENCHMARK_CAPTURE(decodeDom, dialogue_simple, "dialogue_simple.json");
+BENCHMARK_CAPTURE(decodeSax, dialogue_simple, "dialogue_simple.json");
+BENCHMARK_CAPTURE(decodeDom, dialogue_actions, "dialogue_actions.json");
+BENCHMARK_CAPTURE(decodeSax, dialogue_actions, "dialogue_actions.json");
+BENCHMARK_CAPTURE(decodeDom, event_ack, "event_ack.json");
+BENCHMARK_CAPTURE(decodeSax, event_ack, "event_ack.json");
+BENCHMARK_CAPTURE(decodeDom, error, "error.json");
+BENCHMARK_CAPTURE(decodeSax, error, "error.json");
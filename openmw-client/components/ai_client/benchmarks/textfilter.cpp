@@ -0,0 +1,83 @@
+#include "fixtures.hpp"
+
+#include <components/ai_client/responsedecoder.hpp>
+#include <components/ai_client/textfilter.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    std::string loadText(std::string_view fixture)
+    {
+        AI::DecodedResponse decoded;
+        AI::ResponseDecoder decoder;
+        if (!decoder.decode(AIBenchmarks::loadFixture(fixture), decoded) || !decoded.dialogue)
+            throw std::runtime_error("Fixture is not a dialogue response: " + std::string(fixture));
+        return decoded.dialogue->text;
+    }
+
+    // A reply the way models write them: curly quotes, dashes, an ellipsis and a stray control character
+    std::string typographicText()
+    {
+        std::string text;
+        for (int i = 0; i < 8; ++i)
+        {
+            text += "\xE2\x80\x9C" "Ah, an outlander\xE2\x80\xA6 You\xE2\x80\x99re looking for work, then? "
+                    "The Fighters Guild in Balmora \xE2\x80\x94 ask for Eydis Fire-Eye.\xE2\x80\x9D\x01\n";
+        }
+        return text;
+    }
+
+    // Clean-up of a reply as done on the connection thread; the copy reuses its buffer
+    void sanitize(benchmark::State& state, const std::string& original, AI::TextEncoding encoding)
+    {
+        std::string text;
+        text.reserve(original.size());
+        for (auto _ : state)
+        {
+            text.assign(original);
+            AI::sanitizeText(text, encoding);
+            benchmark::DoNotOptimize(text.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * original.size()));
+    }
+
+    void sanitizeFixture(benchmark::State& state, std::string_view fixture)
+    {
+        sanitize(state, loadText(fixture), AI::TextEncoding::Utf8);
+    }
+
+    void sanitizeTypographic(benchmark::State& state, AI::TextEncoding encoding)
+    {
+        sanitize(state, typographicText(), encoding);
+    }
+
+    // The scan that skips plain runs, against a byte-by-byte loop
+    void scanVectorized(benchmark::State& state)
+    {
+        const std::string text(static_cast<std::size_t>(state.range(0)), 'a');
+        for (auto _ : state)
+            benchmark::DoNotOptimize(AI::findNonPlainByte(text));
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+    }
+
+    void scanBytewise(benchmark::State& state)
+    {
+        const std::string text(static_cast<std::size_t>(state.range(0)), 'a');
+        for (auto _ : state)
+        {
+            std::size_t i = 0;
+            while (i < text.size() && ((text[i] >= 0x20 && text[i] < 0x7F) || text[i] == '\n' || text[i] == '\t'))
+                ++i;
+            benchmark::DoNotOptimize(i);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+    }
+}
+
+BENCHMARK_CAPTURE(sanitizeFixture, dialogue_simple, "dialogue_simple.json");
+BENCHMARK_CAPTURE(sanitizeFixture, dialogue_actions, "dialogue_actions.json");
+BENCHMARK_CAPTURE(sanitizeTypographic, utf8, AI::TextEncoding::Utf8);
+BENCHMARK_CAPTURE(sanitizeTypographic, windows1252, AI::TextEncoding::Windows1252);
+BENCHMARK(scanVectorized)->Arg(64)->Arg(1024);
+BENCHMARK(scanBytewise)->Arg(64)->Arg(1024);
@@ -0,0 +1,94 @@
+#include <components/ai_client/topicmatcher.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+
+namespace
+{
+    // Topics of the size of the full game's list: a few real ones among generated names
+    std::vector<std::string> makeTopics(std::size_t count)
+    {
+        std::vector<std::string> topics = { "Balmora", "Caius Cosades", "Vivec", "latest rumors", "little advice",
+            "Fighters Guild", "Mages Guild", "Ald'ruhn", "Ashlanders", "Nerevarine", "Sixth House", "Dagoth Ur" };
+
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> letter('a', 'z');
+        std::uniform_int_distribution<int> wordLength(3, 9);
+        std::uniform_int_distribution<int> wordCount(1, 3);
+        while (topics.size() < count)
+        {
+            std::string topic;
+            for (int words = wordCount(random); words > 0; --words)
+            {
+                if (!topic.empty())
+                    topic += ' ';
+                for (int i = wordLength(random); i > 0; --i)
+                    topic += static_cast<char>(letter(random));
+            }
+            topics.push_back(std::move(topic));
+        }
+        return topics;
+    }
+
+    // A long reply, about 2 KB
+    std::string makeReply()
+    {
+        std::string text;
+        for (int i = 0; i < 8; ++i)
+        {
+            text += "You will want to speak with Caius Cosades in Balmora. He may have a little advice for an "
+                    "outlander. The Ashlanders speak of the Nerevarine, and the Sixth House stirs under Dagoth Ur. ";
+        }
+        return text;
+    }
+
+    // Annotation as done on the connection thread; the span list is reused, as pooled results do
+    void matchAutomaton(benchmark::State& state)
+    {
+        const AI::TopicMatcher matcher(makeTopics(static_cast<std::size_t>(state.range(0))));
+        const std::string text = makeReply();
+        std::vector<AI::TopicSpan> spans;
+        for (auto _ : state)
+        {
+            matcher.match(text, spans);
+            benchmark::DoNotOptimize(spans.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+    }
+
+    // What the dialogue window would do without it: search the text for every topic
+    void matchEachTopic(benchmark::State& state)
+    {
+        const std::vector<std::string> topics = makeTopics(static_cast<std::size_t>(state.range(0)));
+        const std::string text = makeReply();
+        for (auto _ : state)
+        {
+            std::size_t found = 0;
+            for (const std::string& topic : topics)
+            {
+                auto it = std::search(text.begin(), text.end(), topic.begin(), topic.end(),
+                    [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+                found += it != text.end();
+            }
+            benchmark::DoNotOptimize(found);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+    }
+
+    void buildAutomaton(benchmark::State& state)
+    {
+        const std::vector<std::string> topics = makeTopics(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            AI::TopicMatcher matcher(topics);
+            benchmark::DoNotOptimize(matcher.getStateCount());
+        }
+    }
+}
+
+BENCHMARK(matchAutomaton)->Arg(100)->Arg(3000);
+BENCHMARK(matchEachTopic)->Arg(100)->Arg(3000);
+BENCHMARK(buildAutomaton)->Arg(3000)->Unit(benchmark::kMillisecond);
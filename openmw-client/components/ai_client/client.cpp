@@ -2,25 +2,66 @@
 
 #include <iostream>
 #include <chrono>
+#include <cstdint>
 #include <random>
-#include <sstream>
-#include <iomanip>
-#include <nlohmann/json.hpp>
 
 namespace AI
 {
-    using json = nlohmann::json;
-    namespace beast = boost::beast;
-    namespace websocket = beast::websocket;
-    namespace net = boost::asio;
-    using tcp = net::ip::tcp;
+    namespace
+    {
+        // Spare nodes kept per pending table; enough for a busy server's window
+        constexpr std::size_t sSparePendingNodes = 256;
+
+        // Span names must be literals; the tracer keeps the pointers
+        const char* traceSpanName(RequestKind kind, LatencyStage stage)
+        {
+            const bool dialogue = kind == RequestKind::Dialogue;
+            switch (stage)
+            {
+                case LatencyStage::Queue: return dialogue ? "dialogue.queue" : "event.queue";
+                case LatencyStage::Send: return dialogue ? "dialogue.send" : "event.send";
+                case LatencyStage::Server: return dialogue ? "dialogue.server" : "event.server";
+                case LatencyStage::Callback: return dialogue ? "dialogue.callback" : "event.callback";
+                default: return dialogue ? "dialogue" : "event";
+            }
+        }
+    }
 
-    Client::Client(const std::string& host, unsigned short port)
-        : mHost(host)
-        , mPort(port)
-        , mConnected(false)
-        , mRunning(false)
+    Client::Client(const std::string& host, unsigned short port, const ClientOptions& options)
+        : mDialogueNodes(sSparePendingNodes)
+        , mEventNodes(sSparePendingNodes)
+        , mRateLimiter(options.rateLimit)
+        , mBalancer(1 + options.endpoints.size(), options.balance)
+        , mHealthInterval(options.balance.healthInterval)
+        , mHedge(options.hedge)
+        , mText(options.text)
     {
+        // Voice streaming is a protocol feature; servers without it keep sending text only
+        ProtocolOptions protocol = options.protocol;
+        if (options.voice.stream)
+        {
+            protocol.features.set(static_cast<std::size_t>(ProtocolFeature::Streaming));
+
+            // Without its cache the client still streams every line
+            if (!options.voice.cacheFile.empty())
+            {
+                mVoiceCache = std::make_unique<VoiceCache>(options.voice.cacheFile, options.voice.cacheCapacity);
+                if (!mVoiceCache->open())
+                    mVoiceCache.reset();
+            }
+        }
+
+        mConnections.push_back(makeConnection(host, port, 0, protocol, options.voice));
+        for (const Endpoint& endpoint : options.endpoints)
+        {
+            mConnections.push_back(
+                makeConnection(endpoint.host, endpoint.port, mConnections.size(), protocol, options.voice));
+        }
+        if (mHedge.isEnabled())
+        {
+            mHedgeConnection
+                = makeConnection(options.hedge.host, options.hedge.port, sHedgeEndpoint, protocol, options.voice);
+        }
     }
 
     Client::~Client()
@@ -28,592 +69,815 @@ namespace AI
         disconnect();
     }
 
-    bool Client::connect()
+    std::unique_ptr<Connection> Client::makeConnection(const std::string& host, unsigned short port,
+        std::size_t endpoint, const ProtocolOptions& protocol, const VoiceOptions& voice)
     {
-        if (mConnected)
-            return true;
-
-        try
+        Connection::Handlers handlers;
+        if (endpoint == sHedgeEndpoint)
         {
-            // Create resolver and websocket
-            mResolver = std::make_unique<tcp::resolver>(mIoContext);
-            mWebSocket = std::make_unique<websocket::stream<tcp::socket>>(mIoContext);
-
-            // Look up the domain name
-            auto const results = mResolver->resolve(mHost, std::to_string(mPort));
-
-            // Connect to the server
-            net::connect(mWebSocket->next_layer(), results.begin(), results.end());
+            // Duplicates are not timed; a lost one fails the original request only if its primary is gone too
+            handlers.written = [](const OutgoingRequest&, Clock::time_point, Clock::time_point) {};
+            handlers.failed = [this](const OutgoingRequest& request, const std::string& error) {
+                loseHedge(request.requestId, error);
+            };
+            handlers.closed = [this] { handleHedgeConnectionLost(); };
+        }
+        else
+        {
+            handlers.written = [this](const OutgoingRequest& request, Clock::time_point dequeued,
+                                   Clock::time_point written) { markWritten(request, dequeued, written); };
+            handlers.failed = [this, endpoint](const OutgoingRequest& request, const std::string& error) {
+                failRequest(request, error, endpoint);
+            };
+            handlers.closed = [this, endpoint] { handleConnectionLost(endpoint); };
+        }
+        handlers.response = [this, endpoint](DecodedResponse& decoded, Clock::time_point received) {
+            handleResponse(decoded, received, endpoint);
+        };
+        return std::make_unique<Connection>(
+            host, port, mStats, std::move(handlers), protocol, voice, mVoiceCache.get());
+    }
 
-            // Perform the websocket handshake
-            mWebSocket->handshake(mHost, "/");
+    bool Client::connect()
+    {
+        bool connected = false;
+        {
+            std::lock_guard<std::mutex> lock(mConnectMutex);
+            for (std::size_t i = 0; i < mConnections.size(); ++i)
+            {
+                // Draining endpoints come back through the health checks
+                if (mBalancer.getState(i) == EndpointState::Draining)
+                    continue;
 
-            // Set connected flag
-            mConnected = true;
-            mRunning = true;
+                const bool up = mConnections[i]->isConnected() || mConnections[i]->connect();
+                mBalancer.setState(i, up ? EndpointState::Up : EndpointState::Down, Clock::now());
+                connected = connected || up;
+            }
+        }
+        if (!connected)
+            return false;
 
-            // Start IO thread
-            mIoThread = std::thread(&Client::runIoContext, this);
+        std::lock_guard<std::mutex> lock(mMutex);
 
-            return true;
+        // The hedge thread owns the hedge connection and connects it on its own
+        if (mHedgeConnection && !mHedgeRunning)
+        {
+            if (mHedgeThread.joinable())
+                mHedgeThread.join();
+            mHedgeRunning = true;
+            mHedgeThread = std::thread(&Client::runHedger, this);
         }
-        catch (const std::exception& e)
+
+        // Also needed for a single server, which is reconnected by the next request but whose
+        // lost requests are failed here
+        if (!mHealthRunning)
         {
-            std::cerr << "Error connecting to AI server: " << e.what() << std::endl;
-            return false;
+            if (mHealthThread.joinable())
+                mHealthThread.join();
+            mHealthRunning = true;
+            mHealthThread = std::thread(&Client::runHealthChecks, this);
         }
+        return true;
     }
 
     void Client::disconnect()
     {
-        if (!mConnected)
-            return;
+        // Stop the background threads first so they do not reconnect behind our back
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mHedgeRunning = false;
+            mHealthRunning = false;
+        }
+        mHedgeCondition.notify_all();
+        mHealthCondition.notify_all();
+        if (mHedgeThread.joinable())
+            mHedgeThread.join();
+        if (mHealthThread.joinable())
+            mHealthThread.join();
 
-        try
         {
-            // Set running flag to false
-            mRunning = false;
+            std::lock_guard<std::mutex> lock(mConnectMutex);
+            for (std::size_t i = 0; i < mConnections.size(); ++i)
+            {
+                mConnections[i]->disconnect();
+                mBalancer.setState(i, EndpointState::Down, Clock::now());
+            }
+        }
+        if (mHedgeConnection)
+            mHedgeConnection->disconnect();
+    }
 
-            // Close the websocket connection
-            mWebSocket->close(websocket::close_code::normal);
+    bool Client::isConnected() const
+    {
+        for (const std::unique_ptr<Connection>& connection : mConnections)
+        {
+            if (connection->isConnected())
+                return true;
+        }
+        return false;
+    }
 
-            // Wait for IO thread to finish
-            if (mIoThread.joinable())
-                mIoThread.join();
+    std::size_t Client::acquireEndpoint(const std::string& npcId)
+    {
+        while (true)
+        {
+            const std::size_t endpoint = mBalancer.acquire(npcId);
+            if (endpoint == LoadBalancer::sNone || mConnections[endpoint]->isConnected())
+                return endpoint;
+
+            // The connection dropped since the last health check
+            mBalancer.cancel(endpoint);
+            mBalancer.setState(endpoint, EndpointState::Down, Clock::now());
+            mHealthCondition.notify_one();
+        }
+    }
 
-            // Reset websocket and resolver
-            mWebSocket.reset();
-            mResolver.reset();
+    void Client::sendDialogueRequest(DialogueRequest request, DialogueCallback callback)
+    {
+        const Clock::time_point submitted = Clock::now();
 
-            // Set connected flag to false
-            mConnected = false;
+        // Rate limits apply before connecting, so a flood cannot cause reconnect storms either
+        const RateLimiter::Admission admission = mRateLimiter.acquire(RequestKind::Dialogue, request.npcId, submitted);
+        if (admission.action == RateLimitAction::Drop)
+        {
+            // Still completed, so callers such as the shared dialogue fan-out do not wait for it
+            if (callback)
+                callback(makeDialogueDropped());
+            return;
         }
-        catch (const std::exception& e)
+        if (admission.action == RateLimitAction::Reject)
         {
-            std::cerr << "Error disconnecting from AI server: " << e.what() << std::endl;
+            if (callback)
+                callback(makeDialogueError("Error: AI request rate limit exceeded"));
+            return;
         }
-    }
 
-    bool Client::isConnected() const
-    {
-        return mConnected;
+        const std::size_t endpoint = isConnected() || connect() ? acquireEndpoint(request.npcId) : LoadBalancer::sNone;
+        if (endpoint == LoadBalancer::sNone)
+        {
+            if (callback)
+                callback(makeDialogueError("Error: Not connected to AI server"));
+            return;
+        }
+
+        // Generate request ID
+        std::string requestId = generateRequestId();
+
+        // Store callback and queue the request; serialization happens on the IO thread
+        const std::uint64_t traceFlowId = traceSubmit(RequestKind::Dialogue, submitted);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            Pending<DialogueCallback>& pending = mDialogueNodes.emplace(mDialogueCallbacks, requestId);
+            pending.callback = std::move(callback);
+            pending.submitted = submitted;
+            pending.traceFlowId = traceFlowId;
+            pending.endpoint = endpoint;
+            if (mHedge.isEnabled())
+                pending.hedgeRequest = std::make_shared<const DialogueRequest>(request);
+            mStats.mInFlight.fetch_add(1, std::memory_order_relaxed);
+        }
+        mConnections[endpoint]->send(
+            {std::move(requestId), std::move(request), submitted, traceFlowId, admission.notBefore});
     }
 
-    void Client::sendDialogueRequest(
-        const std::string& npcId,
-        const std::string& npcName,
-        const std::string& npcRace,
-        const std::string& npcGender,
-        const std::string& npcClass,
-        const std::string& npcFaction,
-        const std::string& playerMessage,
-        const std::map<std::string, std::string>& gameState,
-        DialogueCallback callback)
+    void Client::sendEvent(EventRequest request, EventCallback callback)
     {
-        if (!mConnected)
+        const Clock::time_point submitted = Clock::now();
+
+        // Broadcasts are limited and routed by the faction or cell they go to; NPC lists share one key
+        const std::string& npcKey = request.target ? request.target->id : request.npcId;
+
+        // Rate limits apply before connecting, so a flood cannot cause reconnect storms either
+        const RateLimiter::Admission admission = mRateLimiter.acquire(RequestKind::Event, npcKey, submitted);
+        if (admission.action == RateLimitAction::Drop)
         {
-            if (!connect())
-            {
-                callback("Error: Not connected to AI server", {});
-                return;
-            }
+            if (callback)
+                callback(false);
+            return;
+        }
+        if (admission.action == RateLimitAction::Reject)
+        {
+            if (callback)
+                callback(false);
+            return;
+        }
+
+        const std::size_t endpoint = isConnected() || connect() ? acquireEndpoint(npcKey) : LoadBalancer::sNone;
+        if (endpoint == LoadBalancer::sNone)
+        {
+            if (callback)
+                callback(false);
+            return;
         }
 
         // Generate request ID
         std::string requestId = generateRequestId();
 
-        // Create JSON request
-        json request;
-        request["type"] = "dialogue";
-        request["requestId"] = requestId;
-        request["npc"] = {
-            {"id", npcId},
-            {"name", npcName},
-            {"race", npcRace},
-            {"gender", npcGender},
-            {"class", npcClass},
-            {"faction", npcFaction}
-        };
-        request["playerMessage"] = playerMessage;
-        request["gameState"] = gameState;
+        // Store callback and queue the request; serialization happens on the IO thread
+        const std::uint64_t traceFlowId = traceSubmit(RequestKind::Event, submitted);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            Pending<EventCallback>& pending = mEventNodes.emplace(mEventCallbacks, requestId);
+            pending.callback = std::move(callback);
+            pending.submitted = submitted;
+            pending.traceFlowId = traceFlowId;
+            pending.endpoint = endpoint;
+            mStats.mInFlight.fetch_add(1, std::memory_order_relaxed);
+        }
+        mConnections[endpoint]->send(
+            {std::move(requestId), std::move(request), submitted, traceFlowId, admission.notBefore});
+    }
 
-        // Convert to string
-        std::string requestStr = request.dump();
+    void Client::runHealthChecks()
+    {
+        Tracer::get().setThreadName("AI health");
 
-        // Store callback
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mHealthRunning)
         {
-            std::lock_guard<std::mutex> lock(mMutex);
-            mDialogueCallbacks[requestId] = callback;
+            // Woken early when a connection or request finds a dropped connection or an endpoint starts draining
+            if (mLostDialogues.empty() && mLostEvents.empty())
+                mHealthCondition.wait_for(lock, mHealthInterval);
+            if (!mHealthRunning)
+                break;
+
+            // Step 1: Fail the requests of dropped connections; callbacks run outside the lock
+            std::vector<std::pair<std::string, std::size_t>> dialogues;
+            std::vector<std::pair<std::string, std::size_t>> events;
+            dialogues.swap(mLostDialogues);
+            events.swap(mLostEvents);
+            lock.unlock();
+            failRequests(dialogues, events);
+
+            // Step 2: Watch the endpoints; connecting blocks, so it happens outside the lock
+            if (mConnections.size() > 1)
+                checkEndpoints();
+            lock.lock();
         }
+    }
 
-        // Add to request queue
+    void Client::checkEndpoints()
+    {
+        for (std::size_t i = 0; i < mConnections.size(); ++i)
         {
-            std::lock_guard<std::mutex> lock(mMutex);
-            mRequestQueue.push({requestStr, [this, requestId](const std::string& response) {
-                try
-                {
-                    // Parse response
-                    json responseJson = json::parse(response);
+            Connection& connection = *mConnections[i];
+            switch (mBalancer.getState(i))
+            {
+                case EndpointState::Up:
+                    if (connection.isConnected())
+                        break;
+
+                    // Dropped: move its unsent requests elsewhere and fail those it will never answer
+                    mBalancer.setState(i, EndpointState::Down, Clock::now());
+                    rerouteQueued(i);
+                    failWritten(i);
+                    break;
+
+                case EndpointState::Draining:
+                    // New requests already avoid it; move the unsent ones and wait for the rest
+                    rerouteQueued(i);
+                    if (connection.isConnected() && !mBalancer.isDrained(i, Clock::now()))
+                        break;
 
-                    // Check for error
-                    if (responseJson.contains("error"))
                     {
-                        std::string error = responseJson["error"];
-                        std::lock_guard<std::mutex> lock(mMutex);
-                        auto it = mDialogueCallbacks.find(requestId);
-                        if (it != mDialogueCallbacks.end())
-                        {
-                            it->second(error, {});
-                            mDialogueCallbacks.erase(it);
-                        }
-                        return;
+                        std::lock_guard<std::mutex> lock(mConnectMutex);
+                        connection.disconnect();
                     }
+                    mBalancer.setState(i, EndpointState::Down, Clock::now());
+                    failWritten(i);
+                    break;
 
-                    // Extract text and actions
-                    std::string text = responseJson["text"];
-                    std::vector<Action> actions;
+                case EndpointState::Down:
+                {
+                    rerouteQueued(i);
 
-                    if (responseJson.contains("actions") && responseJson["actions"].is_array())
-                    {
-                        for (const auto& actionJson : responseJson["actions"])
-                        {
-                            Action action;
-                            std::string actionType = actionJson["type"];
-
-                            // Convert action type string to enum
-                            if (actionType == "EMOTE")
-                                action.type = ActionType::Emote;
-                            else if (actionType == "GIVE_ITEM")
-                                action.type = ActionType::GiveItem;
-                            else if (actionType == "TAKE_ITEM")
-                                action.type = ActionType::TakeItem;
-                            else if (actionType == "START_BARTER")
-                                action.type = ActionType::StartBarter;
-                            else if (actionType == "ATTACK")
-                                action.type = ActionType::Attack;
-                            else if (actionType == "END_CONVERSATION")
-                                action.type = ActionType::EndConversation;
-                            else
-                                action.type = ActionType::None;
-
-                            // Extract parameters
-                            if (actionJson.contains("params") && actionJson["params"].is_object())
-                            {
-                                for (auto& [key, value] : actionJson["params"].items())
-                                {
-                                    if (value.is_string())
-                                        action.params.params[key] = value.get<std::string>();
-                                    else
-                                        action.params.params[key] = value.dump();
-                                }
-                            }
-
-                            actions.push_back(action);
-                        }
-                    }
+                    std::lock_guard<std::mutex> lock(mConnectMutex);
+                    if (connection.isConnected() || connection.connect())
+                        mBalancer.setState(i, EndpointState::Up, Clock::now());
+                    break;
+                }
+            }
+        }
+    }
 
-                    // Call callback
-                    std::lock_guard<std::mutex> lock(mMutex);
-                    auto it = mDialogueCallbacks.find(requestId);
-                    if (it != mDialogueCallbacks.end())
-                    {
-                        it->second(text, actions);
-                        mDialogueCallbacks.erase(it);
-                    }
+    void Client::rerouteQueued(std::size_t endpoint)
+    {
+        for (OutgoingRequest& request : mConnections[endpoint]->takeQueued())
+        {
+            // Without another endpoint the request waits for this one to come back
+            const std::size_t target = acquireEndpoint(request.getNpcId());
+            if (target == LoadBalancer::sNone)
+            {
+                mConnections[endpoint]->send(std::move(request));
+                continue;
+            }
+
+            bool pending = false;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (request.getKind() == RequestKind::Dialogue)
+                {
+                    auto it = mDialogueCallbacks.find(request.requestId);
+                    if ((pending = it != mDialogueCallbacks.end()))
+                        it->second.endpoint = target;
                 }
-                catch (const std::exception& e)
+                else
                 {
-                    std::cerr << "Error parsing dialogue response: " << e.what() << std::endl;
-                    std::lock_guard<std::mutex> lock(mMutex);
-                    auto it = mDialogueCallbacks.find(requestId);
-                    if (it != mDialogueCallbacks.end())
-                    {
-                        it->second("Error parsing response: " + std::string(e.what()), {});
-                        mDialogueCallbacks.erase(it);
-                    }
+                    auto it = mEventCallbacks.find(request.requestId);
+                    if ((pending = it != mEventCallbacks.end()))
+                        it->second.endpoint = target;
                 }
-            }});
+            }
+
+            if (!pending)
+            {
+                mBalancer.cancel(target);
+                continue;
+            }
+            mBalancer.cancel(endpoint);
+            mConnections[target]->send(std::move(request));
         }
+    }
 
-        // Notify processing thread
-        mRequestCondition.notify_one();
+    void Client::collectWritten(std::size_t endpoint, std::vector<std::pair<std::string, std::size_t>>& dialogues,
+        std::vector<std::pair<std::string, std::size_t>>& events)
+    {
+        // Requests written to a lost connection get no reply; hedged ones may still get one from the hedge,
+        // and fail once it is lost as well
+        for (auto& [requestId, pending] : mDialogueCallbacks)
+        {
+            if (pending.endpoint != endpoint || pending.written == Clock::time_point())
+                continue;
+            if (pending.hedged)
+                pending.primaryLost = true;
+            else
+                dialogues.emplace_back(requestId, endpoint);
+        }
+        for (const auto& [requestId, pending] : mEventCallbacks)
+        {
+            if (pending.endpoint == endpoint && pending.written != Clock::time_point())
+                events.emplace_back(requestId, endpoint);
+        }
     }
 
-    void Client::sendEvent(
-        const std::string& npcId,
-        EventType eventType,
-        const std::string& description,
-        EventCallback callback)
+    void Client::failWritten(std::size_t endpoint)
     {
-        if (!mConnected)
+        std::vector<std::pair<std::string, std::size_t>> dialogues;
+        std::vector<std::pair<std::string, std::size_t>> events;
         {
-            if (!connect())
-            {
-                callback(false);
-                return;
-            }
+            std::lock_guard<std::mutex> lock(mMutex);
+            collectWritten(endpoint, dialogues, events);
         }
+        failRequests(dialogues, events);
+    }
 
-        // Generate request ID
-        std::string requestId = generateRequestId();
+    void Client::failRequests(const std::vector<std::pair<std::string, std::size_t>>& dialogues,
+        const std::vector<std::pair<std::string, std::size_t>>& events)
+    {
+        // Requests answered in the meantime are no longer pending and are skipped
+        const Clock::time_point now = Clock::now();
+        for (const auto& [requestId, endpoint] : dialogues)
+            completeDialogue(requestId, makeDialogueError("Error: Lost connection to AI server"), now, endpoint);
+        for (const auto& [requestId, endpoint] : events)
+            completeEvent(requestId, false, now, endpoint);
+    }
 
-        // Convert event type to string
-        std::string eventTypeStr;
-        switch (eventType)
+    void Client::handleConnectionLost(std::size_t endpoint)
+    {
+        // On the connection's reader thread, which a callback reconnecting the endpoint would have to join,
+        // so the health thread runs the callbacks
         {
-            case EventType::PlayerJoinedFaction:
-                eventTypeStr = "PLAYER_JOINED_FACTION";
-                break;
-            case EventType::PlayerLeftFaction:
-                eventTypeStr = "PLAYER_LEFT_FACTION";
-                break;
-            case EventType::PlayerCompletedQuest:
-                eventTypeStr = "PLAYER_COMPLETED_QUEST";
-                break;
-            case EventType::PlayerFailedQuest:
-                eventTypeStr = "PLAYER_FAILED_QUEST";
-                break;
-            case EventType::PlayerPromotion:
-                eventTypeStr = "PLAYER_PROMOTION";
-                break;
-            case EventType::PlayerDemotion:
-                eventTypeStr = "PLAYER_DEMOTION";
-                break;
-            case EventType::PlayerGaveItem:
-                eventTypeStr = "PLAYER_GAVE_ITEM";
-                break;
-            case EventType::PlayerTookItem:
-                eventTypeStr = "PLAYER_TOOK_ITEM";
-                break;
-            case EventType::NPCAttacked:
-                eventTypeStr = "NPC_ATTACKED";
-                break;
-            case EventType::NPCKilled:
-                eventTypeStr = "NPC_KILLED";
-                break;
-            default:
-                eventTypeStr = "UNKNOWN";
-                break;
+            std::lock_guard<std::mutex> lock(mMutex);
+            collectWritten(endpoint, mLostDialogues, mLostEvents);
         }
+        mHealthCondition.notify_one();
+    }
 
-        // Create JSON request
-        json request;
-        request["type"] = "event";
-        request["requestId"] = requestId;
-        request["npcId"] = npcId;
-        request["eventType"] = eventTypeStr;
-        request["description"] = description;
+    void Client::runHedger()
+    {
+        Tracer::get().setThreadName("AI hedger");
 
-        // Convert to string
-        std::string requestStr = request.dump();
+        // Hedging is best effort; without the secondary endpoint requests are just not hedged
+        mHedgeConnection->connect();
 
-        // Store callback
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mHedgeRunning)
         {
-            std::lock_guard<std::mutex> lock(mMutex);
-            mEventCallbacks[requestId] = callback;
+            if (mHedgeDeadlines.empty())
+            {
+                mHedgeCondition.wait(lock);
+                continue;
+            }
+
+            const auto next = mHedgeDeadlines.begin();
+            if (next->first > Clock::now())
+            {
+                mHedgeCondition.wait_until(lock, next->first);
+                continue;
+            }
+
+            const std::string requestId = std::move(next->second);
+            mHedgeDeadlines.erase(next);
+
+            // Sending may reconnect, so it happens outside the lock
+            lock.unlock();
+            sendHedge(requestId);
+            lock.lock();
         }
+    }
 
-        // Add to request queue
+    void Client::sendHedge(const std::string& requestId)
+    {
+        std::shared_ptr<const DialogueRequest> request;
         {
             std::lock_guard<std::mutex> lock(mMutex);
-            mRequestQueue.push({requestStr, [this, requestId](const std::string& response) {
-                try
-                {
-                    // Parse response
-                    json responseJson = json::parse(response);
 
-                    // Check for error
-                    if (responseJson.contains("error"))
-                    {
-                        std::cerr << "Error from AI server: " << responseJson["error"] << std::endl;
-                        std::lock_guard<std::mutex> lock(mMutex);
-                        auto it = mEventCallbacks.find(requestId);
-                        if (it != mEventCallbacks.end())
-                        {
-                            it->second(false);
-                            mEventCallbacks.erase(it);
-                        }
-                        return;
-                    }
+            // Answered already
+            auto it = mDialogueCallbacks.find(requestId);
+            if (it == mDialogueCallbacks.end() || it->second.hedged || !it->second.hedgeRequest)
+                return;
+        }
 
-                    // Check status
-                    bool success = responseJson.contains("status") && responseJson["status"] == "success";
+        // Without the hedge endpoint the request is not hedged, and spends no budget
+        if (!mHedgeConnection->isConnected() && !mHedgeConnection->connect())
+            return;
 
-                    // Call callback
-                    std::lock_guard<std::mutex> lock(mMutex);
-                    auto it = mEventCallbacks.find(requestId);
-                    if (it != mEventCallbacks.end())
-                    {
-                        it->second(success);
-                        mEventCallbacks.erase(it);
-                    }
-                }
-                catch (const std::exception& e)
-                {
-                    std::cerr << "Error parsing event response: " << e.what() << std::endl;
-                    std::lock_guard<std::mutex> lock(mMutex);
-                    auto it = mEventCallbacks.find(requestId);
-                    if (it != mEventCallbacks.end())
-                    {
-                        it->second(false);
-                        mEventCallbacks.erase(it);
-                    }
-                }
-            }});
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            // Answered, or failed with its primary connection, while connecting
+            auto it = mDialogueCallbacks.find(requestId);
+            if (it == mDialogueCallbacks.end() || !mHedge.tryHedge())
+                return;
+
+            it->second.hedged = true;
+            request = it->second.hedgeRequest;
         }
 
-        // Notify processing thread
-        mRequestCondition.notify_one();
+        // Same request ID: whichever reply arrives first completes the request
+        mHedgeConnection->send({requestId, *request, Clock::now(), 0, {}});
+
+        // Queued just after the connection dropped, the duplicate would wait for a reconnect
+        if (!mHedgeConnection->isConnected() && mHedgeConnection->cancel(requestId))
+            loseHedge(requestId, "Error: Lost connection to AI server");
     }
 
-    void Client::runIoContext()
+    void Client::loseHedge(const std::string& requestId, const std::string& error)
     {
-        // Start processing queue
-        std::thread processingThread(&Client::processQueue, this);
+        std::size_t endpoint = LoadBalancer::sNone;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mDialogueCallbacks.find(requestId);
+            if (it == mDialogueCallbacks.end() || !it->second.hedged)
+                return;
 
-        // Create buffer for reading
-        beast::flat_buffer buffer;
+            // The primary copy still answers unless its connection is gone
+            it->second.hedged = false;
+            if (!it->second.primaryLost)
+                return;
+            endpoint = it->second.endpoint;
+        }
+        completeDialogue(requestId, makeDialogueError(error), Clock::now(), endpoint);
+    }
+
+    void Client::handleHedgeConnectionLost()
+    {
+        // Unsent duplicates are dropped with the written ones; the next hedge reconnects
+        mHedgeConnection->takeQueued();
 
-        // Read loop
-        while (mRunning)
+        // On the hedge connection's reader thread, so the health thread fails the requests, as for any lost
+        // connection
         {
-            try
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto& [requestId, pending] : mDialogueCallbacks)
             {
-                // Read a message
-                mWebSocket->read(buffer);
+                if (!pending.hedged)
+                    continue;
+                pending.hedged = false;
+                if (pending.primaryLost)
+                    mLostDialogues.emplace_back(requestId, pending.endpoint);
+            }
+        }
+        mHealthCondition.notify_one();
+    }
 
-                // Get the message as a string
-                std::string response = beast::buffers_to_string(buffer.data());
+    void Client::failRequest(const OutgoingRequest& request, const std::string& error, std::size_t endpoint)
+    {
+        if (request.getKind() == RequestKind::Dialogue)
+            completeDialogue(request.requestId, makeDialogueError(error), Clock::now(), endpoint);
+        else
+            completeEvent(request.requestId, false, Clock::now(), endpoint);
+    }
 
-                // Clear the buffer
-                buffer.consume(buffer.size());
+    void Client::markWritten(const OutgoingRequest& request, Clock::time_point dequeued, Clock::time_point written)
+    {
+        const RequestKind kind = request.getKind();
+        mStats.recordLatency(kind, LatencyStage::Queue, request.submitted, dequeued);
+        mStats.recordLatency(kind, LatencyStage::Send, dequeued, written);
+        if (request.traceFlowId)
+        {
+            Tracer& tracer = Tracer::get();
+            tracer.span(traceSpanName(kind, LatencyStage::Queue), request.submitted, dequeued, request.traceFlowId,
+                FlowPhase::Step);
+            tracer.span(traceSpanName(kind, LatencyStage::Send), dequeued, written, request.traceFlowId,
+                FlowPhase::Step);
+        }
 
-                // Handle the response
-                handleResponse(response);
-            }
-            catch (const websocket::close_reason& reason)
+        bool hedgeable = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (kind == RequestKind::Dialogue)
             {
-                // WebSocket closed
-                std::cerr << "WebSocket closed: " << reason.reason << std::endl;
-                mConnected = false;
-                mRunning = false;
-                break;
+                auto it = mDialogueCallbacks.find(request.requestId);
+                if (it != mDialogueCallbacks.end())
+                {
+                    it->second.written = written;
+
+                    // The deadline counts from the write, so rate limit delays never trigger a hedge
+                    if (it->second.hedgeRequest)
+                    {
+                        mHedgeDeadlines.emplace(written + mHedge.getDelay(), request.requestId);
+                        hedgeable = true;
+                    }
+                }
             }
-            catch (const std::exception& e)
+            else
             {
-                // Error reading from WebSocket
-                std::cerr << "Error reading from WebSocket: " << e.what() << std::endl;
-                mConnected = false;
-                mRunning = false;
-                break;
+                auto it = mEventCallbacks.find(request.requestId);
+                if (it != mEventCallbacks.end())
+                    it->second.written = written;
             }
         }
 
-        // Wait for processing thread to finish
-        if (processingThread.joinable())
-            processingThread.join();
+        if (hedgeable)
+        {
+            mHedge.onRequest();
+            mHedgeCondition.notify_one();
+        }
     }
 
-    void Client::processQueue()
+    void Client::handleResponse(DecodedResponse& decoded, Clock::time_point received, std::size_t endpoint)
     {
-        while (mRunning)
+        const bool fromHedge = endpoint == sHedgeEndpoint;
+        if (decoded.kind == ResponseKind::Error)
         {
-            Request request;
+            std::cerr << "Error from AI server: " << decoded.error << std::endl;
+            mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
 
-            // Get a request from the queue
+            // A failed duplicate leaves the original request to answer, unless its connection is gone
+            if (fromHedge)
             {
-                std::unique_lock<std::mutex> lock(mMutex);
-                mRequestCondition.wait(lock, [this] { return !mRequestQueue.empty() || !mRunning; });
+                loseHedge(decoded.requestId, decoded.error);
+                return;
+            }
+        }
 
-                if (!mRunning)
-                    break;
+        bool isDialogue = false;
+        TopicMatcherPtr topicMatcher;
+        ItemIndexPtr itemIndex;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            isDialogue = mDialogueCallbacks.count(decoded.requestId) > 0;
+            if (isDialogue)
+            {
+                topicMatcher = mTopicMatcher;
+                itemIndex = mItemIndex;
+            }
+        }
 
-                request = mRequestQueue.front();
-                mRequestQueue.pop();
+        if (isDialogue)
+        {
+            DialogueResultPtr result;
+            if (decoded.kind == ResponseKind::Error)
+                result = makeDialogueError(std::move(decoded.error));
+            else if (decoded.dialogue)
+            {
+                // Raw model output never leaves the connection thread
+                if (mText.sanitize)
+                    sanitizeText(decoded.dialogue->text, mText.encoding);
+                if (topicMatcher)
+                {
+                    topicMatcher->match(decoded.dialogue->text, decoded.dialogue->topics);
+                    decoded.dialogue->topicMatcher = std::move(topicMatcher);
+                }
+                if (itemIndex)
+                    checkItemActions(decoded.dialogue->actions, *itemIndex);
+                result = std::move(decoded.dialogue);
             }
+            else
+                result = makeDialogueError("Error parsing response: missing dialogue text");
+            completeDialogue(decoded.requestId, result, received, endpoint);
+        }
+        else if (!fromHedge)
+        {
+            completeEvent(
+                decoded.requestId, decoded.kind == ResponseKind::EventAck && decoded.success, received, endpoint);
+        }
+    }
 
-            try
+    void Client::checkItemActions(ActionList& actions, const ItemIndex& items)
+    {
+        for (auto it = actions.begin(); it != actions.end();)
+        {
+            if (it->type != ActionType::GiveItem && it->type != ActionType::TakeItem)
             {
-                // Send the request
-                mWebSocket->write(net::buffer(request.message));
+                ++it;
+                continue;
             }
-            catch (const std::exception& e)
+
+            mStats.mItemsChecked.fetch_add(1, std::memory_order_relaxed);
+            const std::string_view text = it->params.getString(ActionParams::Key::ItemId);
+            ItemId id;
+            const ItemMatch match = items.resolve(text, id);
+            if (match == ItemMatch::Unknown)
             {
-                std::cerr << "Error sending request: " << e.what() << std::endl;
-                request.callback("Error sending request: " + std::string(e.what()));
+                // The script would fail on the item anyway, later and on the main thread
+                std::cerr << "Dropped " << actionTypeToString(it->type) << " action for unknown item '" << text << "'"
+                          << std::endl;
+                mStats.mItemsRejected.fetch_add(1, std::memory_order_relaxed);
+                it = actions.erase(it);
+                continue;
             }
+
+            if (match != ItemMatch::Exact)
+            {
+                it->params.set(ActionParams::Key::ItemId, id);
+                mStats.mItemsRepaired.fetch_add(1, std::memory_order_relaxed);
+            }
+            ++it;
         }
     }
 
-    void Client::handleResponse(const std::string& response)
+    void Client::completeDialogue(
+        const std::string& requestId, const DialogueResultPtr& result, Clock::time_point received, std::size_t source)
     {
-        try
+        Pending<DialogueCallback> pending;
         {
-            // Parse response
-            json responseJson = json::parse(response);
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mDialogueCallbacks.find(requestId);
+            if (it == mDialogueCallbacks.end())
+                return;
+            pending = mDialogueNodes.take(mDialogueCallbacks, it);
+        }
+        mStats.mInFlight.fetch_sub(1, std::memory_order_relaxed);
 
-            // Check if response has a request ID
-            if (responseJson.contains("requestId"))
+        // Cancel the losing copy if it is still queued; a reply to it finds no callback and is dropped
+        if (pending.hedged)
+        {
+            if (source == sHedgeEndpoint)
             {
-                std::string requestId = responseJson["requestId"];
+                mHedge.onWon();
+                mConnections[pending.endpoint]->cancel(requestId);
+            }
+            else
+                mHedgeConnection->cancel(requestId);
+        }
 
-                // Find callback
-                std::function<void(const std::string&)> callback;
-                {
-                    std::lock_guard<std::mutex> lock(mMutex);
-                    auto dialogueIt = mDialogueCallbacks.find(requestId);
-                    if (dialogueIt != mDialogueCallbacks.end())
-                    {
-                        // Call the callback with the response
-                        callback = [this, requestId, response](const std::string&) {
-                            try
-                            {
-                                // Parse response
-                                json responseJson = json::parse(response);
-
-                                // Extract text and actions
-                                std::string text = responseJson["text"];
-                                std::vector<Action> actions;
-
-                                if (responseJson.contains("actions") && responseJson["actions"].is_array())
-                                {
-                                    for (const auto& actionJson : responseJson["actions"])
-                                    {
-                                        Action action;
-                                        std::string actionType = actionJson["type"];
-
-                                        // Convert action type string to enum
-                                        if (actionType == "EMOTE")
-                                            action.type = ActionType::Emote;
-                                        else if (actionType == "GIVE_ITEM")
-                                            action.type = ActionType::GiveItem;
-                                        else if (actionType == "TAKE_ITEM")
-                                            action.type = ActionType::TakeItem;
-                                        else if (actionType == "START_BARTER")
-                                            action.type = ActionType::StartBarter;
-                                        else if (actionType == "ATTACK")
-                                            action.type = ActionType::Attack;
-                                        else if (actionType == "END_CONVERSATION")
-                                            action.type = ActionType::EndConversation;
-                                        else
-                                            action.type = ActionType::None;
-
-                                        // Extract parameters
-                                        if (actionJson.contains("params") && actionJson["params"].is_object())
-                                        {
-                                            for (auto& [key, value] : actionJson["params"].items())
-                                            {
-                                                if (value.is_string())
-                                                    action.params.params[key] = value.get<std::string>();
-                                                else
-                                                    action.params.params[key] = value.dump();
-                                            }
-                                        }
-
-                                        actions.push_back(action);
-                                    }
-                                }
-
-                                // Call callback
-                                std::lock_guard<std::mutex> lock(mMutex);
-                                auto it = mDialogueCallbacks.find(requestId);
-                                if (it != mDialogueCallbacks.end())
-                                {
-                                    it->second(text, actions);
-                                    mDialogueCallbacks.erase(it);
-                                }
-                            }
-                            catch (const std::exception& e)
-                            {
-                                std::cerr << "Error parsing dialogue response: " << e.what() << std::endl;
-                                std::lock_guard<std::mutex> lock(mMutex);
-                                auto it = mDialogueCallbacks.find(requestId);
-                                if (it != mDialogueCallbacks.end())
-                                {
-                                    it->second("Error parsing response: " + std::string(e.what()), {});
-                                    mDialogueCallbacks.erase(it);
-                                }
-                            }
-                        };
-                    }
-                    else
-                    {
-                        auto eventIt = mEventCallbacks.find(requestId);
-                        if (eventIt != mEventCallbacks.end())
-                        {
-                            // Call the callback with the response
-                            callback = [this, requestId, response](const std::string&) {
-                                try
-                                {
-                                    // Parse response
-                                    json responseJson = json::parse(response);
-
-                                    // Check for error
-                                    if (responseJson.contains("error"))
-                                    {
-                                        std::cerr << "Error from AI server: " << responseJson["error"] << std::endl;
-                                        std::lock_guard<std::mutex> lock(mMutex);
-                                        auto it = mEventCallbacks.find(requestId);
-                                        if (it != mEventCallbacks.end())
-                                        {
-                                            it->second(false);
-                                            mEventCallbacks.erase(it);
-                                        }
-                                        return;
-                                    }
-
-                                    // Check status
-                                    bool success = responseJson.contains("status") && responseJson["status"] == "success";
-
-                                    // Call callback
-                                    std::lock_guard<std::mutex> lock(mMutex);
-                                    auto it = mEventCallbacks.find(requestId);
-                                    if (it != mEventCallbacks.end())
-                                    {
-                                        it->second(success);
-                                        mEventCallbacks.erase(it);
-                                    }
-                                }
-                                catch (const std::exception& e)
-                                {
-                                    std::cerr << "Error parsing event response: " << e.what() << std::endl;
-                                    std::lock_guard<std::mutex> lock(mMutex);
-                                    auto it = mEventCallbacks.find(requestId);
-                                    if (it != mEventCallbacks.end())
-                                    {
-                                        it->second(false);
-                                        mEventCallbacks.erase(it);
-                                    }
-                                }
-                            };
-                        }
-                    }
-                }
+        std::chrono::microseconds latency(-1);
+        if (pending.written != Clock::time_point())
+            latency = std::chrono::duration_cast<std::chrono::microseconds>(received - pending.written);
+        releaseEndpoint(pending.endpoint, source, result->error, latency);
+
+        // Call the callback outside the lock so it may issue new requests
+        if (pending.callback)
+            pending.callback(result);
+
+        // Successful replies steer the hedge delay; a hedge win is a lower bound of the primary latency
+        if (pending.hedgeRequest && latency.count() >= 0 && !result->error)
+            mHedge.recordLatency(latency);
+
+        recordCompletion(RequestKind::Dialogue, pending, received);
+    }
 
-                // Call the callback if found
-                if (callback)
-                    callback(response);
+    void Client::completeEvent(
+        const std::string& requestId, bool success, Clock::time_point received, std::size_t source)
+    {
+        Pending<EventCallback> pending;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEventCallbacks.find(requestId);
+            if (it == mEventCallbacks.end())
+                return;
+            pending = mEventNodes.take(mEventCallbacks, it);
+        }
+        mStats.mInFlight.fetch_sub(1, std::memory_order_relaxed);
+
+        // Only dialogue latencies steer the balancer; events are answered without the LLM
+        releaseEndpoint(pending.endpoint, source, !success, std::chrono::microseconds(-1));
+
+        if (pending.callback)
+            pending.callback(success);
+
+        recordCompletion(RequestKind::Event, pending, received);
+    }
+
+    void Client::releaseEndpoint(
+        std::size_t endpoint, std::size_t source, bool failed, std::chrono::microseconds latency)
+    {
+        if (endpoint == LoadBalancer::sNone)
+            return;
+
+        // Requests answered elsewhere or failed locally say nothing about their endpoint
+        if (source != endpoint)
+        {
+            mBalancer.cancel(endpoint);
+            return;
+        }
+
+        if (mBalancer.release(endpoint, failed, latency))
+        {
+            std::cerr << "Draining AI server " << mConnections[endpoint]->getHost() << ":"
+                      << mConnections[endpoint]->getPort() << " after repeated failures" << std::endl;
+            mHealthCondition.notify_one();
+        }
+    }
+
+    template <class Callback>
+    void Client::recordCompletion(RequestKind kind, const Pending<Callback>& pending, Clock::time_point received)
+    {
+        const Clock::time_point done = Clock::now();
+
+        // Requests that failed before reaching the socket have no server time
+        const bool written = pending.written != Clock::time_point();
+        if (written)
+            mStats.recordLatency(kind, LatencyStage::Server, pending.written, received);
+        mStats.recordLatency(kind, LatencyStage::Callback, received, done);
+        mStats.recordLatency(kind, LatencyStage::Total, pending.submitted, done);
+
+        if (pending.traceFlowId)
+        {
+            Tracer& tracer = Tracer::get();
+            if (written)
+            {
+                tracer.span(traceSpanName(kind, LatencyStage::Server), pending.written, received, pending.traceFlowId,
+                    FlowPhase::Step);
             }
+            tracer.span(traceSpanName(kind, LatencyStage::Callback), received, done, pending.traceFlowId, FlowPhase::End);
         }
-        catch (const std::exception& e)
+    }
+
+    std::uint64_t Client::traceSubmit(RequestKind kind, Clock::time_point submitted)
+    {
+        Tracer& tracer = Tracer::get();
+        if (!tracer.isEnabled())
+            return 0;
+
+        const std::uint64_t flowId = tracer.newFlowId();
+        tracer.span(kind == RequestKind::Dialogue ? "dialogue.submit" : "event.submit", submitted, Clock::now(), flowId,
+            FlowPhase::Start);
+        return flowId;
+    }
+
+    void Client::setTopicMatcher(TopicMatcherPtr matcher)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTopicMatcher = std::move(matcher);
+    }
+
+    void Client::setItemIndex(ItemIndexPtr index)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mItemIndex = std::move(index);
+    }
+
+    ClientStats Client::getStats() const
+    {
+        ClientStats stats = mStats.snapshot();
+        stats.rateLimit = mRateLimiter.getStats();
+        stats.hedge = mHedge.getStats();
+        stats.endpoints = mBalancer.getStats();
+        if (mVoiceCache)
+            stats.voiceCache = mVoiceCache->getStats();
+        for (std::size_t i = 0; i < stats.endpoints.size(); ++i)
         {
-            std::cerr << "Error handling response: " << e.what() << std::endl;
+            stats.endpoints[i].host = mConnections[i]->getHost();
+            stats.endpoints[i].port = mConnections[i]->getPort();
+
+            const Handshake handshake = mConnections[i]->getHandshake();
+            stats.endpoints[i].protocol = handshake.version;
+            stats.endpoints[i].maxInFlight = handshake.maxInFlight;
         }
+        return stats;
     }
 
     std::string Client::generateRequestId()
     {
-        // Generate a random request ID
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_int_distribution<> dis(0, 15);
-        static const char* digits = "0123456789abcdef";
-
-        std::stringstream ss;
-        for (int i = 0; i < 32; ++i)
+        // Generate a random request ID, 6 bits per character from two 64-bit draws.
+        // 15 characters fit the small string buffer of the common standard libraries, so the
+        // copies the request path makes of its ID never allocate.
+        static const char* digits = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-_";
+        thread_local std::mt19937_64 gen(std::random_device{}());
+
+        std::string requestId(sRequestIdLength, '0');
+        std::uint64_t bits = gen();
+        for (std::size_t i = 0; i < sRequestIdLength; ++i)
         {
-            ss << digits[dis(gen)];
+            // Ten characters use 60 bits of a draw
+            if (i == 10)
+                bits = gen();
+            requestId[i] = digits[bits & 0x3f];
+            bits >>= 6;
         }
-        return ss.str();
+        return requestId;
     }
-}
+}
\ No newline at end of file
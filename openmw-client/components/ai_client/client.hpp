@@ -9,69 +9,24 @@
 #include <mutex>
 #include <thread>
 #include <condition_variable>
-#include <queue>
-#include <atomic>
 
-#include <boost/beast/core.hpp>
-#include <boost/beast/websocket.hpp>
-#include <boost/asio/ip/tcp.hpp>
+#include "clientoptions.hpp"
+#include "connection.hpp"
+#include "dialogueresult.hpp"
+#include "event.hpp"
+#include "gamestateprovider.hpp"
+#include "hedgepolicy.hpp"
+#include "itemindex.hpp"
+#include "loadbalancer.hpp"
+#include "pool.hpp"
+#include "ratelimiter.hpp"
+#include "request.hpp"
+#include "responsedecoder.hpp"
+#include "stats.hpp"
+#include "tracer.hpp"
 
 namespace AI
 {
-    /**
-     * @brief Enum for action types that can be performed by NPCs
-     */
-    enum class ActionType
-    {
-        None,
-        Emote,
-        GiveItem,
-        TakeItem,
-        StartBarter,
-        Attack,
-        EndConversation
-    };
-
-    /**
-     * @brief Struct for action parameters
-     */
-    struct ActionParams
-    {
-        std::map<std::string, std::string> params;
-    };
-
-    /**
-     * @brief Struct for an NPC action
-     */
-    struct Action
-    {
-        ActionType type;
-        ActionParams params;
-    };
-
-    /**
-     * @brief Enum for event types that can be sent to the AI server
-     */
-    enum class EventType
-    {
-        None,
-        PlayerJoinedFaction,
-        PlayerLeftFaction,
-        PlayerCompletedQuest,
-        PlayerFailedQuest,
-        PlayerPromotion,
-        PlayerDemotion,
-        PlayerGaveItem,
-        PlayerTookItem,
-        NPCAttacked,
-        NPCKilled
-    };
-
-    /**
-     * @brief Callback type for dialogue responses
-     */
-    using DialogueCallback = std::function<void(const std::string&, const std::vector<Action>&)>;
-
     /**
      * @brief Callback type for event responses
      */
@@ -79,17 +34,24 @@ namespace AI
 
     /**
      * @brief Class for WebSocket client to communicate with the AI server
+     *
+     * With further endpoints in the options, requests are spread over all
+     * servers by a LoadBalancer, and a health thread reconnects, drains and
+     * fails over endpoints. With voice streaming, dialogue results carry a
+     * VoiceStream that keeps filling after the callback, or a VoiceClip when
+     * the line is in the voice clip cache.
      */
     class Client
     {
     public:
         /**
          * @brief Constructor
-         * 
+         *
          * @param host Server host
          * @param port Server port
+         * @param options Rate limits and other tuning
          */
-        Client(const std::string& host, unsigned short port);
+        Client(const std::string& host, unsigned short port, const ClientOptions& options = ClientOptions());
 
         /**
          * @brief Destructor
@@ -97,102 +59,199 @@ namespace AI
         ~Client();
 
         /**
-         * @brief Connect to the server
-         * 
-         * @return true if connection successful, false otherwise
+         * @brief Connect to the servers
+         *
+         * Also connects to the hedge endpoint, if one is configured.
+         *
+         * @return true if any server could be connected, false otherwise
          */
         bool connect();
 
         /**
-         * @brief Disconnect from the server
+         * @brief Disconnect from the servers
          */
         void disconnect();
 
         /**
-         * @brief Check if connected to the server
-         * 
-         * @return true if connected, false otherwise
+         * @brief Check if connected to a server
+         *
+         * @return true if any server is connected, false otherwise
          */
         bool isConnected() const;
 
         /**
          * @brief Send a dialogue request to the server
-         * 
-         * @param npcId NPC ID
-         * @param npcName NPC name
-         * @param npcRace NPC race
-         * @param npcGender NPC gender
-         * @param npcClass NPC class
-         * @param npcFaction NPC faction
-         * @param playerMessage Player's message
-         * @param gameState Game state information
-         * @param callback Callback function for the response
+         *
+         * The request is only queued here; it is serialized on the IO thread.
+         * Rate limits may delay it, drop it (completing it with a result marked
+         * dropped) or fail it with an error. A slow
+         * request may also be sent to the hedge endpoint; the first reply wins.
+         *
+         * @param request Dialogue request
+         * @param callback Callback function for the response; may be empty
          */
-        void sendDialogueRequest(
-            const std::string& npcId,
-            const std::string& npcName,
-            const std::string& npcRace,
-            const std::string& npcGender,
-            const std::string& npcClass,
-            const std::string& npcFaction,
-            const std::string& playerMessage,
-            const std::map<std::string, std::string>& gameState,
-            DialogueCallback callback
-        );
+        void sendDialogueRequest(DialogueRequest request, DialogueCallback callback);
 
         /**
          * @brief Send an event to the server
-         * 
-         * @param npcId NPC ID
-         * @param eventType Event type
-         * @param description Event description
-         * @param callback Callback function for the response
+         *
+         * The request is only queued here; it is serialized on the IO thread.
+         * Rate limits may delay it, or drop or fail it, completing it with false.
+         * A request with a target
+         * is one message for the whole group, answered by a single ack once
+         * the server has passed it to every NPC of the group.
+         *
+         * @param request Event request
+         * @param callback Callback function for the response; may be empty
+         */
+        void sendEvent(EventRequest request, EventCallback callback);
+
+        /**
+         * @brief Set the dialogue topics to find in replies
+         *
+         * Replies are annotated with the topics they mention on the connection
+         * threads, after their text is cleaned up. Build the matcher once per
+         * loaded topic list; replies keep the matcher they were annotated with.
+         *
+         * @param matcher Matcher of the loaded topics; null to stop annotating
+         */
+        void setTopicMatcher(TopicMatcherPtr matcher);
+
+        /**
+         * @brief Set the item records that GIVE_ITEM and TAKE_ITEM actions are checked against
+         *
+         * On the connection threads, before callbacks run, the item ID of each
+         * such action is replaced by the record ID it means, matched in any
+         * case, by name or despite typos; actions that name no known item are
+         * dropped from the reply.
+         *
+         * @param index Index of the loaded item records; null to pass actions on unchecked
+         */
+        void setItemIndex(ItemIndexPtr index);
+
+        /**
+         * @brief Get a snapshot of the request statistics
+         *
+         * @return Counters and latency summaries per request type
+         */
+        ClientStats getStats() const;
+
+        // Length of generated request IDs, short enough for the small string optimization
+        static constexpr std::size_t sRequestIdLength = 15;
+
+        /**
+         * @brief Generate a random request ID
+         *
+         * @return sRequestIdLength characters of [0-9a-zA-Z_-], 90 random bits
          */
-        void sendEvent(
-            const std::string& npcId,
-            EventType eventType,
-            const std::string& description,
-            EventCallback callback
-        );
+        static std::string generateRequestId();
 
     private:
-        // Server information
-        std::string mHost;
-        unsigned short mPort;
-        
-        // Connection state
-        std::atomic<bool> mConnected;
-        std::atomic<bool> mRunning;
-        
-        // Boost.Beast WebSocket
-        boost::asio::io_context mIoContext;
-        std::unique_ptr<boost::asio::ip::tcp::resolver> mResolver;
-        std::unique_ptr<boost::beast::websocket::stream<boost::asio::ip::tcp::socket>> mWebSocket;
-        
-        // Thread for IO operations
-        std::thread mIoThread;
-        
+        using Clock = StatsRecorder::Clock;
+
+        // Connection index that stands for the hedge endpoint; LoadBalancer::sNone stands for no connection
+        static constexpr std::size_t sHedgeEndpoint = LoadBalancer::sNone - 1;
+
+        // Request statistics, shared with the connections
+        StatsRecorder mStats;
+
+        // Voice clip cache, shared with the connections; null without one
+        std::unique_ptr<VoiceCache> mVoiceCache;
+
+        // Connections to the servers, indexed like the balancer's endpoints, and to the hedge endpoint
+        std::vector<std::unique_ptr<Connection>> mConnections;
+        std::unique_ptr<Connection> mHedgeConnection;
+
+        // Serializes connecting and disconnecting the server connections
+        std::mutex mConnectMutex;
+
         // Mutex for thread safety
         mutable std::mutex mMutex;
-        
-        // Request queue
-        struct Request
+
+        // Topics to annotate replies with; null for none
+        TopicMatcherPtr mTopicMatcher;
+
+        // Items that actions may name; null to leave actions unchecked
+        ItemIndexPtr mItemIndex;
+
+        // Callbacks of requests awaiting a response
+        template <class Callback>
+        struct Pending
         {
-            std::string message;
-            std::function<void(const std::string&)> callback;
+            Callback callback;
+            Clock::time_point submitted;
+            Clock::time_point written;
+            std::uint64_t traceFlowId = 0;
+
+            // Server connection the request was routed to
+            std::size_t endpoint = LoadBalancer::sNone;
+
+            // Copy of a dialogue request for its hedge, whether the hedge is in flight, and whether the
+            // primary connection dropped meanwhile, leaving the hedge to answer
+            std::shared_ptr<const DialogueRequest> hedgeRequest;
+            bool hedged = false;
+            bool primaryLost = false;
         };
-        std::queue<Request> mRequestQueue;
-        std::condition_variable mRequestCondition;
-        
-        // Callbacks
-        std::map<std::string, DialogueCallback> mDialogueCallbacks;
-        std::map<std::string, EventCallback> mEventCallbacks;
-        
+        using DialogueTable = std::map<std::string, Pending<DialogueCallback>>;
+        using EventTable = std::map<std::string, Pending<EventCallback>>;
+        DialogueTable mDialogueCallbacks;
+        EventTable mEventCallbacks;
+
+        // Nodes of completed requests, reused by the next ones
+        NodePool<DialogueTable> mDialogueNodes;
+        NodePool<EventTable> mEventNodes;
+
+        RateLimiter mRateLimiter;
+
+        // Routing; the health thread watches the endpoints when there is more than one
+        LoadBalancer mBalancer;
+        std::chrono::milliseconds mHealthInterval;
+        std::thread mHealthThread;
+        bool mHealthRunning = false;
+        std::condition_variable mHealthCondition;
+
+        // Requests written to connections that dropped, with their endpoint; the health thread fails them
+        std::vector<std::pair<std::string, std::size_t>> mLostDialogues;
+        std::vector<std::pair<std::string, std::size_t>> mLostEvents;
+
+        // Hedging; the hedge thread sends the duplicates of requests whose deadline passed
+        HedgePolicy mHedge;
+        std::thread mHedgeThread;
+        bool mHedgeRunning = false;
+        std::condition_variable mHedgeCondition;
+        std::multimap<Clock::time_point, std::string> mHedgeDeadlines;
+
+        TextOptions mText;
+
         // Internal methods
-        void runIoContext();
-        void processQueue();
-        void handleResponse(const std::string& response);
-        std::string generateRequestId();
+        std::unique_ptr<Connection> makeConnection(const std::string& host, unsigned short port, std::size_t endpoint,
+            const ProtocolOptions& protocol, const VoiceOptions& voice);
+        std::size_t acquireEndpoint(const std::string& npcId);
+        void runHealthChecks();
+        void checkEndpoints();
+        void rerouteQueued(std::size_t endpoint);
+        void collectWritten(std::size_t endpoint, std::vector<std::pair<std::string, std::size_t>>& dialogues,
+            std::vector<std::pair<std::string, std::size_t>>& events);
+        void failWritten(std::size_t endpoint);
+        void failRequests(const std::vector<std::pair<std::string, std::size_t>>& dialogues,
+            const std::vector<std::pair<std::string, std::size_t>>& events);
+        void handleConnectionLost(std::size_t endpoint);
+        void runHedger();
+        void sendHedge(const std::string& requestId);
+        void loseHedge(const std::string& requestId, const std::string& error);
+        void handleHedgeConnectionLost();
+        void failRequest(const OutgoingRequest& request, const std::string& error, std::size_t endpoint);
+        void handleResponse(DecodedResponse& decoded, Clock::time_point received, std::size_t endpoint);
+        void checkItemActions(ActionList& actions, const ItemIndex& items);
+        void markWritten(const OutgoingRequest& request, Clock::time_point dequeued, Clock::time_point written);
+        void completeDialogue(const std::string& requestId, const DialogueResultPtr& result, Clock::time_point received,
+            std::size_t source = LoadBalancer::sNone);
+        void completeEvent(
+            const std::string& requestId, bool success, Clock::time_point received, std::size_t source = LoadBalancer::sNone);
+        void releaseEndpoint(std::size_t endpoint, std::size_t source, bool failed, std::chrono::microseconds latency);
+        template <class Callback>
+        void recordCompletion(RequestKind kind, const Pending<Callback>& pending, Clock::time_point received);
+        std::uint64_t traceSubmit(RequestKind kind, Clock::time_point submitted);
     };
 }
 
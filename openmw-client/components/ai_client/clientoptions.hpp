@@ -0,0 +1,41 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_CLIENTOPTIONS_H
+#define OPENMW_COMPONENTS_AI_CLIENT_CLIENTOPTIONS_H
+
+#include <vector>
+
+#include "hedgepolicy.hpp"
+#include "loadbalancer.hpp"
+#include "protocol.hpp"
+#include "ratelimiter.hpp"
+#include "textfilter.hpp"
+#include "voicestream.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Tuning of a client; the defaults match the behaviour of a client without options
+     */
+    struct ClientOptions
+    {
+        // Window and features asked for in the handshake of each connection
+        ProtocolOptions protocol;
+
+        // Token buckets that cap the request rate
+        RateLimitOptions rateLimit;
+
+        // Duplicates of slow dialogue requests sent to a secondary endpoint
+        HedgeOptions hedge;
+
+        // Further servers to spread requests over, next to the host and port given to the client
+        std::vector<Endpoint> endpoints;
+        BalanceOptions balance;
+
+        // Voice audio streamed alongside dialogue replies
+        VoiceOptions voice;
+
+        // Clean-up of reply text, done on the connection threads before callbacks see it
+        TextOptions text;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_CLIENTOPTIONS_H
@@ -0,0 +1,625 @@
+#include "connection.hpp"
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace AI
+{
+    namespace beast = boost::beast;
+    namespace websocket = beast::websocket;
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    namespace
+    {
+        // Ring buffers double when full and never shrink
+        template <class T>
+        void pushBack(boost::circular_buffer<T>& queue, T value)
+        {
+            if (queue.full())
+                queue.set_capacity(std::max<std::size_t>(16, queue.capacity() * 2));
+            queue.push_back(std::move(value));
+        }
+    }
+
+    Connection::Connection(const std::string& host, unsigned short port, StatsRecorder& stats, Handlers handlers,
+        const ProtocolOptions& protocol, const VoiceOptions& voice, VoiceCache* voiceCache)
+        : mHost(host)
+        , mPort(port)
+        , mStats(stats)
+        , mHandlers(std::move(handlers))
+        , mProtocol(protocol)
+        , mVoice(voice)
+        , mVoiceCache(voiceCache)
+        , mConnected(false)
+        , mRunning(false)
+        , mVoiceTimer(mIoContext)
+    {
+    }
+
+    Connection::~Connection()
+    {
+        disconnect();
+    }
+
+    bool Connection::connect()
+    {
+        if (mConnected)
+            return true;
+
+        // Reap the IO thread of a dropped connection before replacing the websocket it used
+        if (mIoThread.joinable())
+            mIoThread.join();
+
+        try
+        {
+            // Create resolver and websocket
+            mResolver = std::make_unique<tcp::resolver>(mIoContext);
+            mWebSocket = std::make_unique<websocket::stream<tcp::socket>>(mIoContext);
+
+            // Look up the domain name
+            auto const results = mResolver->resolve(mHost, std::to_string(mPort));
+
+            // Connect to the server
+            net::connect(mWebSocket->next_layer(), results.begin(), results.end());
+
+            // Perform the websocket handshake, then agree on the protocol
+            mWebSocket->handshake(mHost, "/");
+            negotiate();
+
+            // Set connected flag
+            mConnected = true;
+            mRunning = true;
+            if (mWasConnected)
+                mStats.mReconnects.fetch_add(1, std::memory_order_relaxed);
+            mWasConnected = true;
+
+            // Start IO thread
+            mIoThread = std::thread(&Connection::runReader, this);
+
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error connecting to AI server at " << mHost << ":" << mPort << ": " << e.what()
+                      << std::endl;
+            mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    void Connection::disconnect()
+    {
+        if (!mConnected)
+        {
+            // The connection dropped; its IO thread has exited but still needs joining
+            if (mIoThread.joinable())
+                mIoThread.join();
+            return;
+        }
+
+        try
+        {
+            // Set running flag to false
+            mRunning = false;
+
+            // Shut the socket down rather than closing the websocket from this thread: a close
+            // here would race the IO thread's pending read on the same stream
+            beast::error_code ec;
+            mWebSocket->next_layer().shutdown(tcp::socket::shutdown_both, ec);
+
+            // Wait for IO thread to finish
+            if (mIoThread.joinable())
+                mIoThread.join();
+
+            // Reset websocket and resolver
+            mWebSocket.reset();
+            mResolver.reset();
+
+            // Set connected flag to false
+            mConnected = false;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error disconnecting from AI server: " << e.what() << std::endl;
+        }
+    }
+
+    bool Connection::isConnected() const
+    {
+        return mConnected;
+    }
+
+    Handshake Connection::getHandshake() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mHandshake;
+    }
+
+    void Connection::negotiate()
+    {
+        std::string hello;
+        writeHello(hello, mProtocol);
+        mWebSocket->write(net::buffer(hello));
+
+        // Every server answers: version 2 with a welcome, older ones with an error
+        beast::flat_buffer buffer;
+        mWebSocket->read(buffer);
+        const Handshake handshake = readWelcome(beast::buffers_to_string(buffer.data()), mProtocol);
+        mStats.mBytesOut.fetch_add(hello.size(), std::memory_order_relaxed);
+        mStats.mBytesIn.fetch_add(buffer.size(), std::memory_order_relaxed);
+
+        // Replies to requests written on an earlier connection will not come
+        std::lock_guard<std::mutex> lock(mMutex);
+        mHandshake = handshake;
+        mControlMessages.clear();
+        mUnanswered.clear();
+        mDialoguesUnanswered = 0;
+    }
+
+    void Connection::send(OutgoingRequest request)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (request.notBefore > Clock::now())
+                mDelayedRequests.emplace(request.notBefore, std::move(request));
+            else
+                pushBack(mRequestQueue, std::move(request));
+
+            // Counted under the lock so the writer thread never sees the request before it is counted
+            mStats.mQueueDepth.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Notify writer thread
+        mRequestCondition.notify_one();
+    }
+
+    bool Connection::cancel(const std::string& requestId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto it = mRequestQueue.begin(); it != mRequestQueue.end(); ++it)
+        {
+            if (it->requestId == requestId)
+            {
+                mRequestQueue.erase(it);
+                mStats.mQueueDepth.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        for (auto it = mDelayedRequests.begin(); it != mDelayedRequests.end(); ++it)
+        {
+            if (it->second.requestId == requestId)
+            {
+                mDelayedRequests.erase(it);
+                mStats.mQueueDepth.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<OutgoingRequest> Connection::takeQueued()
+    {
+        std::vector<OutgoingRequest> requests;
+        std::lock_guard<std::mutex> lock(mMutex);
+        requests.reserve(mRequestQueue.size() + mDelayedRequests.size());
+        for (OutgoingRequest& request : mRequestQueue)
+            requests.push_back(std::move(request));
+        for (auto& [notBefore, request] : mDelayedRequests)
+            requests.push_back(std::move(request));
+        mRequestQueue.clear();
+        mDelayedRequests.clear();
+        mStats.mQueueDepth.fetch_sub(requests.size(), std::memory_order_relaxed);
+        return requests;
+    }
+
+    void Connection::runReader()
+    {
+        Tracer::get().setThreadName("AI reader");
+
+        // Start writer thread
+        std::thread writerThread(&Connection::runWriter, this);
+
+        // Each read is started by the handler of the one before, all within one run() so asio reuses their
+        // memory; the voice timer releases replies held for their prebuffer while the server sends nothing
+        mLost = false;
+        mVoiceDue = Clock::time_point::max();
+        mIoContext.restart();
+        readNext();
+        try
+        {
+            mIoContext.run();
+        }
+        catch (const std::exception& e)
+        {
+            // A response handler threw; the connection is given up like after a read error
+            std::cerr << "Error reading from WebSocket: " << e.what() << std::endl;
+            mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
+            mLost = mRunning;
+            mConnected = false;
+            mRunning = false;
+
+            // Cancel the pending read and timer and let their handlers finish
+            beast::error_code ec;
+            mWebSocket->next_layer().close(ec);
+            mVoiceTimer.cancel();
+            mIoContext.restart();
+            mIoContext.run();
+        }
+
+        endVoiceReplies();
+
+        // Wake the writer thread; taking the lock ensures it is waiting or sees mRunning
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mRequestCondition.notify_all();
+
+        // Wait for writer thread to finish
+        if (writerThread.joinable())
+            writerThread.join();
+
+        // Nothing is written any more, so the owner can fail what the server will not answer
+        if (mLost && mHandlers.closed)
+            mHandlers.closed();
+    }
+
+    void Connection::readNext()
+    {
+        mWebSocket->async_read(mReadBuffer, [this](const beast::error_code& ec, std::size_t) { onRead(ec); });
+    }
+
+    void Connection::onRead(const beast::error_code& ec)
+    {
+        if (ec)
+        {
+            if (ec == websocket::error::closed)
+            {
+                // WebSocket closed
+                std::cerr << "WebSocket closed: " << mWebSocket->reason().reason << std::endl;
+                mLost = mRunning;
+            }
+            else if (mRunning)
+            {
+                // Error reading from WebSocket, unless disconnect() shut the socket down
+                std::cerr << "Error reading from WebSocket: " << ec.message() << std::endl;
+                mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
+                mLost = true;
+            }
+            mConnected = false;
+            mRunning = false;
+
+            // Nothing else keeps run() going
+            mVoiceTimer.cancel();
+            return;
+        }
+
+        // The message is read in place; the buffer keeps its storage for the next one
+        const std::string_view message(static_cast<const char*>(mReadBuffer.data().data()), mReadBuffer.size());
+        mStats.mBytesIn.fetch_add(message.size(), std::memory_order_relaxed);
+
+        // Handle the message; binary frames carry voice audio
+        if (mWebSocket->got_binary())
+            handleVoiceChunk(message);
+        else
+            handleMessage(message);
+        mReadBuffer.consume(mReadBuffer.size());
+
+        scheduleVoiceRelease();
+        readNext();
+    }
+
+    void Connection::scheduleVoiceRelease()
+    {
+        // The timer is only moved when the earliest held reply changes
+        const Clock::time_point next = releaseVoiceReplies(Clock::now());
+        if (next == mVoiceDue)
+            return;
+
+        mVoiceDue = next;
+        if (next == Clock::time_point::max())
+        {
+            mVoiceTimer.cancel();
+            return;
+        }
+
+        mVoiceTimer.expires_at(next);
+        mVoiceTimer.async_wait([this](const beast::error_code& ec) {
+            if (ec)
+                return;
+            mVoiceDue = Clock::time_point::max();
+            scheduleVoiceRelease();
+        });
+    }
+
+    bool Connection::takeRequest(OutgoingRequest& request, std::string& control)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mRunning)
+        {
+            if (!mControlMessages.empty())
+            {
+                control = std::move(mControlMessages.front());
+                mControlMessages.pop_front();
+                return true;
+            }
+
+            // Release delayed requests whose tokens are due
+            const Clock::time_point now = Clock::now();
+            while (!mDelayedRequests.empty() && mDelayedRequests.begin()->first <= now)
+            {
+                pushBack(mRequestQueue, std::move(mDelayedRequests.begin()->second));
+                mDelayedRequests.erase(mDelayedRequests.begin());
+            }
+
+            // Dialogue requests wait for a free slot in the window; events overtake them
+            auto next = mRequestQueue.begin();
+            if (mHandshake.maxInFlight > 0 && mDialoguesUnanswered >= mHandshake.maxInFlight)
+            {
+                next = std::find_if(mRequestQueue.begin(), mRequestQueue.end(),
+                    [](const OutgoingRequest& queued) { return queued.getKind() == RequestKind::Event; });
+            }
+
+            if (next != mRequestQueue.end())
+            {
+                request = std::move(*next);
+                mRequestQueue.erase(next);
+
+                // Recorded before the write, so a fast reply always finds it
+                const RequestKind kind = request.getKind();
+                pushBack(mUnanswered, std::make_pair(request.requestId, kind));
+                if (kind == RequestKind::Dialogue)
+                    ++mDialoguesUnanswered;
+                return true;
+            }
+
+            if (mDelayedRequests.empty())
+                mRequestCondition.wait(lock);
+            else
+                mRequestCondition.wait_until(lock, mDelayedRequests.begin()->first);
+        }
+        return false;
+    }
+
+    void Connection::runWriter()
+    {
+        Tracer::get().setThreadName("AI writer");
+
+        OutgoingRequest request;
+        std::string control;
+        while (takeRequest(request, control))
+        {
+            if (!control.empty())
+            {
+                try
+                {
+                    mWebSocket->write(net::buffer(control));
+                    mStats.mBytesOut.fetch_add(control.size(), std::memory_order_relaxed);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Error sending control message: " << e.what() << std::endl;
+                    mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
+                }
+                control.clear();
+                continue;
+            }
+
+            const Clock::time_point dequeued = Clock::now();
+            mStats.mQueueDepth.fetch_sub(1, std::memory_order_relaxed);
+
+            // Serialize into a pooled buffer
+            std::string message = mBufferPool.acquire();
+            if (const auto* dialogue = std::get_if<DialogueRequest>(&request.payload))
+                writeDialogueRequest(message, request.requestId, *dialogue);
+            else
+                writeEventRequest(message, request.requestId, std::get<EventRequest>(request.payload));
+
+            try
+            {
+                // Send the request
+                mWebSocket->write(net::buffer(message));
+
+                mStats.mRequestsSent.fetch_add(1, std::memory_order_relaxed);
+                mStats.mBytesOut.fetch_add(message.size(), std::memory_order_relaxed);
+                mHandlers.written(request, dequeued, Clock::now());
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Error sending request: " << e.what() << std::endl;
+                mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
+                forgetUnanswered(request.requestId);
+                mHandlers.failed(request, "Error sending request: " + std::string(e.what()));
+            }
+
+            mBufferPool.release(std::move(message));
+        }
+    }
+
+    void Connection::forgetUnanswered(const std::string& requestId)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = std::find_if(mUnanswered.begin(), mUnanswered.end(),
+                [&](const auto& unanswered) { return unanswered.first == requestId; });
+            if (it == mUnanswered.end())
+                return;
+            if (it->second == RequestKind::Dialogue)
+                --mDialoguesUnanswered;
+            mUnanswered.erase(it);
+        }
+
+        // A slot in the window may have opened
+        mRequestCondition.notify_one();
+    }
+
+    void Connection::handleMessage(std::string_view message)
+    {
+        const Clock::time_point received = Clock::now();
+        mStats.mResponsesReceived.fetch_add(1, std::memory_order_relaxed);
+
+        DecodedResponse decoded;
+        if (!mDecoder.decode(message, decoded))
+            return;
+
+        // Fall back to the DOM for message types the streaming decoder does not know
+        if (decoded.kind == ResponseKind::Unknown)
+        {
+            decoded = DecodedResponse();
+            if (!ResponseDecoder::decodeDom(message, decoded))
+                return;
+        }
+
+        // Version 1 servers answer in order, so a reply without a request ID belongs to the oldest request
+        if (decoded.requestId.empty())
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mHandshake.version < 2 && !mUnanswered.empty())
+                decoded.requestId = mUnanswered.front().first;
+        }
+
+        // Responses without a request ID cannot be matched to a callback
+        if (decoded.requestId.empty())
+            return;
+
+        forgetUnanswered(decoded.requestId);
+
+        // Voice audio follows in binary frames; the reply waits until playback can start
+        if (mVoice.stream && decoded.kind == ResponseKind::Dialogue && decoded.dialogue && !decoded.voiceFormat.empty())
+        {
+            if (!serveCachedVoice(decoded))
+            {
+                startVoice(decoded, received);
+                return;
+            }
+        }
+
+        mHandlers.response(decoded, received);
+    }
+
+    void Connection::startVoice(DecodedResponse& decoded, Clock::time_point received)
+    {
+        mStats.mVoiceStreams.fetch_add(1, std::memory_order_relaxed);
+
+        auto stream = std::make_shared<VoiceStream>(std::move(decoded.voiceFormat), mVoice.bufferSize);
+        decoded.dialogue->voice = stream;
+
+        std::string requestId = decoded.requestId;
+        VoiceReply& reply = mVoiceReplies[std::move(requestId)];
+        reply.recording = mVoiceCache && !decoded.voiceId.empty();
+        if (reply.recording)
+        {
+            reply.voiceId = decoded.voiceId;
+            reply.text = decoded.dialogue->text;
+        }
+        reply.decoded = std::move(decoded);
+        reply.received = received;
+        reply.stream = std::move(stream);
+        reply.delivered = false;
+
+        if (mVoice.prebuffer == 0)
+            deliverVoiceReply(reply);
+    }
+
+    void Connection::handleVoiceChunk(std::string_view frame)
+    {
+        VoiceChunk chunk;
+        if (!readVoiceChunk(frame, chunk))
+        {
+            std::cerr << "Error parsing AI server voice frame" << std::endl;
+            mStats.mErrors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Audio of a reply that was not announced, or whose stream already ended, is dropped
+        auto it = mVoiceReplies.find(chunk.requestId);
+        if (it == mVoiceReplies.end())
+            return;
+
+        VoiceReply& reply = it->second;
+        mStats.mVoiceBytes.fetch_add(chunk.audio.size(), std::memory_order_relaxed);
+        reply.stream->append(chunk.audio);
+        if (chunk.last)
+            reply.stream->end(false);
+
+        if (reply.recording)
+        {
+            reply.recording = reply.recorded.size() + chunk.audio.size() <= mVoiceCache->getMaxClipSize();
+            if (reply.recording)
+                reply.recorded += chunk.audio;
+            else
+                reply.recorded = std::string();
+        }
+
+        if (!reply.delivered && (chunk.last || reply.stream->getReceived() >= mVoice.prebuffer))
+            deliverVoiceReply(reply);
+
+        if (chunk.last)
+        {
+            // The recording is complete even if the playback buffer overflowed
+            if (reply.recording)
+                mVoiceCache->insert(reply.voiceId, reply.text, reply.stream->getFormat(), reply.recorded);
+            if (reply.stream->isTruncated())
+                mStats.mVoiceTruncated.fetch_add(1, std::memory_order_relaxed);
+            mVoiceReplies.erase(it);
+        }
+    }
+
+    bool Connection::serveCachedVoice(DecodedResponse& decoded)
+    {
+        if (!mVoiceCache || decoded.voiceId.empty())
+            return false;
+
+        // A clip in another format than the server now sends is of no use to the decoder
+        VoiceClipPtr clip = mVoiceCache->find(decoded.voiceId, decoded.dialogue->text);
+        if (!clip || clip->format != decoded.voiceFormat)
+            return false;
+        decoded.dialogue->voiceClip = std::move(clip);
+
+        // Chunks already on their way find no stream and are dropped
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::string cancel;
+            writeVoiceCancel(cancel, decoded.requestId);
+            mControlMessages.push_back(std::move(cancel));
+        }
+        mRequestCondition.notify_one();
+        return true;
+    }
+
+    Connection::Clock::time_point Connection::releaseVoiceReplies(Clock::time_point now)
+    {
+        // Slow synthesis must not hold the text back for long; playback then starts with less audio
+        Clock::time_point next = Clock::time_point::max();
+        for (auto& [requestId, reply] : mVoiceReplies)
+        {
+            if (reply.delivered)
+                continue;
+            if (now - reply.received >= mVoice.prebufferWait)
+                deliverVoiceReply(reply);
+            else
+                next = std::min(next, reply.received + mVoice.prebufferWait);
+        }
+        return next;
+    }
+
+    void Connection::endVoiceReplies()
+    {
+        // The rest of the audio will not come; replies still held back are delivered with what they have
+        for (auto& [requestId, reply] : mVoiceReplies)
+        {
+            reply.stream->end(true);
+            mStats.mVoiceTruncated.fetch_add(1, std::memory_order_relaxed);
+            if (!reply.delivered)
+                deliverVoiceReply(reply);
+        }
+        mVoiceReplies.clear();
+    }
+
+    void Connection::deliverVoiceReply(VoiceReply& reply)
+    {
+        reply.delivered = true;
+        mHandlers.response(reply.decoded, reply.received);
+    }
+}
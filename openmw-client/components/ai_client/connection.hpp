@@ -0,0 +1,266 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_CONNECTION_H
+#define OPENMW_COMPONENTS_AI_CLIENT_CONNECTION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include "protocol.hpp"
+#include "request.hpp"
+#include "requestwriter.hpp"
+#include "responsedecoder.hpp"
+#include "stats.hpp"
+#include "voicecache.hpp"
+#include "voicestream.hpp"
+
+namespace AI
+{
+    /**
+     * @brief A request on its way to the server
+     */
+    struct OutgoingRequest
+    {
+        using Clock = StatsRecorder::Clock;
+
+        std::string requestId;
+        std::variant<DialogueRequest, EventRequest> payload;
+        Clock::time_point submitted;
+        std::uint64_t traceFlowId = 0;
+
+        // Earliest time to write the request, for rate limited requests
+        Clock::time_point notBefore;
+
+        RequestKind getKind() const
+        {
+            return std::holds_alternative<DialogueRequest>(payload) ? RequestKind::Dialogue : RequestKind::Event;
+        }
+
+        const std::string& getNpcId() const
+        {
+            return std::visit([](const auto& request) -> const std::string& { return request.npcId; }, payload);
+        }
+    };
+
+    /**
+     * @brief WebSocket connection to one AI server endpoint
+     *
+     * Requests are queued by the caller and serialized and written on the
+     * connection's writer thread; responses are read and decoded on its
+     * reader thread. The connection knows nothing about callbacks: it reports
+     * written and failed requests and decoded responses to its handlers.
+     *
+     * A handshake after connecting settles the protocol version, the window
+     * of dialogue requests awaiting replies and the optional features. Events
+     * bypass the window, so acks never wait behind slow dialogue generations.
+     * Version 1 servers answer in order and may omit the request ID, so their
+     * replies are matched to the oldest unanswered request.
+     *
+     * With voice streaming, a dialogue reply that announces audio is held
+     * back until enough of its audio has arrived in binary frames to start
+     * playback, the audio ends, or the prebuffer wait runs out. Lines found
+     * in the voice clip cache are delivered at once with the cached clip,
+     * and the server is told to stop synthesizing them; complete streams are
+     * added to the cache.
+     */
+    class Connection
+    {
+    public:
+        using Clock = StatsRecorder::Clock;
+
+        /**
+         * @brief Receivers of the connection's results; called on its writer and reader threads
+         */
+        struct Handlers
+        {
+            // A request reached the socket
+            std::function<void(const OutgoingRequest&, Clock::time_point dequeued, Clock::time_point written)> written;
+
+            // A request could not be written
+            std::function<void(const OutgoingRequest&, const std::string& error)> failed;
+
+            // A response was decoded
+            std::function<void(DecodedResponse&, Clock::time_point received)> response;
+
+            // The connection dropped, so requests written to it get no reply; called after the writer thread
+            // stopped, unless disconnect() closed the connection
+            std::function<void()> closed;
+        };
+
+        /**
+         * @brief Constructor
+         *
+         * @param host Server host
+         * @param port Server port
+         * @param stats Counters for bytes, errors and reconnects, shared with the owner
+         * @param handlers Receivers of the connection's results
+         * @param protocol Window and features to ask for in the handshake
+         * @param voice Buffering of streamed voice audio
+         * @param voiceCache Clip cache shared by the owner's connections; null for none
+         */
+        Connection(const std::string& host, unsigned short port, StatsRecorder& stats, Handlers handlers,
+            const ProtocolOptions& protocol = ProtocolOptions(), const VoiceOptions& voice = VoiceOptions(),
+            VoiceCache* voiceCache = nullptr);
+
+        /**
+         * @brief Destructor
+         */
+        ~Connection();
+
+        /**
+         * @brief Connect to the server
+         *
+         * @return true if connection successful, false otherwise
+         */
+        bool connect();
+
+        /**
+         * @brief Disconnect from the server
+         */
+        void disconnect();
+
+        /**
+         * @brief Check if connected to the server
+         *
+         * @return true if connected, false otherwise
+         */
+        bool isConnected() const;
+
+        /**
+         * @brief Queue a request for the writer thread
+         *
+         * @param request Request
+         */
+        void send(OutgoingRequest request);
+
+        /**
+         * @brief Remove a request that has not been written yet
+         *
+         * @param requestId Request ID
+         * @return true if the request was still queued, false otherwise
+         */
+        bool cancel(const std::string& requestId);
+
+        /**
+         * @brief Remove all requests that have not been written yet
+         *
+         * @return Queued requests, including those held back by the rate limiter
+         */
+        std::vector<OutgoingRequest> takeQueued();
+
+        /**
+         * @brief Get the outcome of the last handshake
+         *
+         * @return Negotiated protocol
+         */
+        Handshake getHandshake() const;
+
+        const std::string& getHost() const { return mHost; }
+        unsigned short getPort() const { return mPort; }
+
+    private:
+        void negotiate();
+        void runReader();
+        void readNext();
+        void onRead(const boost::beast::error_code& ec);
+        void scheduleVoiceRelease();
+        void runWriter();
+        bool takeRequest(OutgoingRequest& request, std::string& control);
+        void forgetUnanswered(const std::string& requestId);
+        void handleMessage(std::string_view message);
+        void startVoice(DecodedResponse& decoded, Clock::time_point received);
+        bool serveCachedVoice(DecodedResponse& decoded);
+        void handleVoiceChunk(std::string_view frame);
+        Clock::time_point releaseVoiceReplies(Clock::time_point now);
+        void endVoiceReplies();
+
+        // Dialogue reply whose voice audio is arriving
+        struct VoiceReply
+        {
+            DecodedResponse decoded;
+            Clock::time_point received;
+            VoiceStreamPtr stream;
+            bool delivered = false;
+
+            // Copy of the audio for the clip cache, kept while the line is small enough to cache
+            std::string voiceId;
+            std::string text;
+            std::string recorded;
+            bool recording = false;
+        };
+        void deliverVoiceReply(VoiceReply& reply);
+
+        // Server information
+        std::string mHost;
+        unsigned short mPort;
+
+        StatsRecorder& mStats;
+        Handlers mHandlers;
+        ProtocolOptions mProtocol;
+        VoiceOptions mVoice;
+        VoiceCache* mVoiceCache;
+
+        // Connection state
+        std::atomic<bool> mConnected;
+        std::atomic<bool> mRunning;
+        bool mWasConnected = false;
+
+        // Boost.Beast WebSocket
+        boost::asio::io_context mIoContext;
+        std::unique_ptr<boost::asio::ip::tcp::resolver> mResolver;
+        std::unique_ptr<boost::beast::websocket::stream<boost::asio::ip::tcp::socket>> mWebSocket;
+
+        // Reader thread; it starts and joins the writer thread
+        std::thread mIoThread;
+
+        // Reader state, used by the reader thread only: the message being read, the timer releasing held
+        // voice replies and when it is due, and whether the connection ended without disconnect()
+        boost::beast::flat_buffer mReadBuffer;
+        boost::asio::steady_timer mVoiceTimer;
+        Clock::time_point mVoiceDue;
+        bool mLost = false;
+
+        // Request queue; ring buffers keep their storage, so steady traffic queues without allocating
+        mutable std::mutex mMutex;
+        boost::circular_buffer<OutgoingRequest> mRequestQueue;
+
+        // Protocol messages that are not requests, written ahead of them
+        std::deque<std::string> mControlMessages;
+        std::condition_variable mRequestCondition;
+
+        // Negotiated protocol, and the written requests awaiting replies, oldest first
+        Handshake mHandshake;
+        boost::circular_buffer<std::pair<std::string, RequestKind>> mUnanswered;
+        std::size_t mDialoguesUnanswered = 0;
+
+        // Requests held back by the rate limiter, by the time they may be sent
+        std::multimap<Clock::time_point, OutgoingRequest> mDelayedRequests;
+
+        // Message buffers for serializing requests, used by the writer thread
+        BufferPool mBufferPool;
+
+        // Decoder for server messages, used by the reader thread only
+        ResponseDecoder mDecoder;
+
+        // Replies with audio still arriving, by request ID, used by the reader thread only
+        std::map<std::string, VoiceReply, std::less<>> mVoiceReplies;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_CONNECTION_H
@@ -0,0 +1,151 @@
+#include "dialoguefanout.hpp"
+
+namespace AI
+{
+    DialogueFanout::DialogueFanout(SendFunction send, DeliverFunction deliver, std::chrono::milliseconds staleAfter)
+        : mSend(std::move(send))
+        , mDeliver(std::move(deliver))
+        , mStaleAfter(staleAfter)
+    {
+    }
+
+    void DialogueFanout::setPlayerCell(PlayerId player, const std::string& cell)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mPlayerCells.find(player);
+        if (it != mPlayerCells.end())
+        {
+            if (it->second == cell)
+                return;
+
+            auto players = mCellPlayers.find(it->second);
+            players->second.erase(player);
+            if (players->second.empty())
+                mCellPlayers.erase(players);
+            it->second = cell;
+        }
+        else
+            mPlayerCells.emplace(player, cell);
+
+        mCellPlayers[cell].insert(player);
+    }
+
+    void DialogueFanout::removePlayer(PlayerId player)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mPlayerCells.find(player);
+        if (it == mPlayerCells.end())
+            return;
+
+        auto players = mCellPlayers.find(it->second);
+        players->second.erase(player);
+        if (players->second.empty())
+            mCellPlayers.erase(players);
+        mPlayerCells.erase(it);
+    }
+
+    bool DialogueFanout::request(PlayerId player, const std::string& conversationId, DialogueRequest request,
+        DialogueCallback callback)
+    {
+        std::string key;
+        std::uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mStats.requests;
+
+            auto cell = mPlayerCells.find(player);
+            const std::string& cellName = cell != mPlayerCells.end() ? cell->second : std::string();
+            const std::string& conversation = conversationId.empty() ? cellName : conversationId;
+
+            // NPC IDs cannot contain newlines, so the key is unambiguous
+            key.reserve(request.npcId.size() + 1 + conversation.size());
+            key.append(request.npcId).append(1, '\n').append(conversation);
+
+            const Clock::time_point now = Clock::now();
+            Conversation& pending = mConversations[key];
+            if (pending.generation != 0 && now - pending.sent < mStaleAfter)
+            {
+                pending.waiting.emplace_back(player, std::move(callback));
+                return false;
+            }
+
+            // A new conversation, or one whose reply was lost; its waiting players stay
+            generation = mNextGeneration++;
+            pending.generation = generation;
+            pending.sent = now;
+            pending.npcId = request.npcId;
+            pending.conversationId = conversation;
+            pending.cell = cellName;
+            pending.speaker = player;
+            pending.playerMessage = request.playerMessage;
+            pending.waiting.emplace_back(player, std::move(callback));
+            ++mStats.generations;
+        }
+
+        // Outside the lock: the client completes requests inline when it cannot connect
+        mSend(std::move(request),
+            [this, key, generation](const DialogueResultPtr& result) { complete(key, generation, result); });
+        return true;
+    }
+
+    void DialogueFanout::complete(const std::string& key, std::uint64_t generation, const DialogueResultPtr& result)
+    {
+        SharedDialogue shared;
+        std::vector<std::pair<PlayerId, DialogueCallback>> waiting;
+        std::set<PlayerId> recipients;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mConversations.find(key);
+            if (it == mConversations.end() || it->second.generation != generation)
+                return;
+
+            Conversation& conversation = it->second;
+            shared.npcId = std::move(conversation.npcId);
+            shared.conversationId = std::move(conversation.conversationId);
+            shared.cell = std::move(conversation.cell);
+            shared.speaker = conversation.speaker;
+            shared.playerMessage = std::move(conversation.playerMessage);
+            shared.result = result;
+            waiting = std::move(conversation.waiting);
+            mConversations.erase(it);
+
+            // Everyone in the cell sees the reply; an error only concerns the players who asked
+            if (!result->error)
+            {
+                auto players = mCellPlayers.find(shared.cell);
+                if (players != mCellPlayers.end())
+                    recipients = players->second;
+            }
+
+            // Requesters who moved on still get the reply they asked for, unless they left the session;
+            // a dropped request has nothing to deliver
+            for (const auto& request : waiting)
+            {
+                if (!result->dropped && mPlayerCells.count(request.first))
+                    recipients.insert(request.first);
+            }
+
+            mStats.deliveries += recipients.size();
+        }
+
+        for (const auto& request : waiting)
+        {
+            if (request.second)
+                request.second(result);
+        }
+
+        if (mDeliver)
+        {
+            for (PlayerId player : recipients)
+                mDeliver(player, shared);
+        }
+    }
+
+    FanoutStats DialogueFanout::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+}
@@ -0,0 +1,173 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_DIALOGUEFANOUT_H
+#define OPENMW_COMPONENTS_AI_CLIENT_DIALOGUEFANOUT_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dialogueresult.hpp"
+#include "request.hpp"
+
+namespace AI
+{
+    /**
+     * @brief A dialogue reply shared by everyone in a cell
+     */
+    struct SharedDialogue
+    {
+        std::string npcId;
+        std::string conversationId;
+        std::string cell;
+
+        // Player whose request was sent to the AI server, and what they said
+        std::uint64_t speaker = 0;
+        std::string playerMessage;
+
+        DialogueResultPtr result;
+    };
+
+    /**
+     * @brief Snapshot of the fan-out counters
+     */
+    struct FanoutStats
+    {
+        // Requests made by players
+        std::uint64_t requests = 0;
+
+        // Requests sent to the AI server; requests - generations were joined to one in flight
+        std::uint64_t generations = 0;
+
+        // Replies handed to players in the cell, including the requesters
+        std::uint64_t deliveries = 0;
+    };
+
+    /**
+     * @brief Server-side fan-out of dialogue replies in a multiplayer session
+     *
+     * The multiplayer server owns the only AI client. A request for an NPC
+     * conversation that already has a generation in flight joins it instead
+     * of starting another one, and the reply is delivered once to every
+     * player in the requester's cell, so all of them see the same answer and
+     * the LLM runs once per conversation turn rather than once per player.
+     *
+     * The server reports cell membership with setPlayerCell() and sends the
+     * deliveries to the players' clients. The completion callbacks given to
+     * the send function refer to the fan-out, so it must outlive the client
+     * that runs them.
+     */
+    class DialogueFanout
+    {
+    public:
+        using PlayerId = std::uint64_t;
+
+        /**
+         * @brief Sends a request to the AI server
+         */
+        using SendFunction = std::function<void(DialogueRequest, DialogueCallback)>;
+
+        /**
+         * @brief Hands a shared reply to one player; called on the thread completing the request
+         */
+        using DeliverFunction = std::function<void(PlayerId, const SharedDialogue&)>;
+
+        /**
+         * @brief Constructor
+         *
+         * @param send Sends a request to the AI server
+         * @param deliver Hands a shared reply to one player
+         * @param staleAfter Age at which a conversation's reply is given up on and the next request sends again
+         */
+        DialogueFanout(SendFunction send, DeliverFunction deliver,
+            std::chrono::milliseconds staleAfter = std::chrono::seconds(30));
+
+        /**
+         * @brief Record the cell a player is in
+         *
+         * @param player Player
+         * @param cell Cell name
+         */
+        void setPlayerCell(PlayerId player, const std::string& cell);
+
+        /**
+         * @brief Forget a player that left the session
+         *
+         * Requests the player is waiting on still complete, but nothing is delivered to them.
+         *
+         * @param player Player
+         */
+        void removePlayer(PlayerId player);
+
+        /**
+         * @brief Request a reply in a shared conversation
+         *
+         * Only the first request of a conversation turn reaches the AI server;
+         * later ones join it until the reply arrives, and their messages are
+         * dropped. The callback of every request receives the reply. Replies
+         * are delivered to every player in the cell; error replies only to
+         * the players who asked.
+         *
+         * A reply lost with its connection never arrives, so a request to a
+         * conversation waiting longer than staleAfter is sent again and takes
+         * over the players waiting on it.
+         *
+         * @param player Requesting player
+         * @param conversationId Conversation with the NPC; empty means the requester's cell
+         * @param request Dialogue request
+         * @param callback Callback function for the reply; may be empty
+         * @return true if the request was sent, false if it joined one in flight
+         */
+        bool request(PlayerId player, const std::string& conversationId, DialogueRequest request,
+            DialogueCallback callback);
+
+        /**
+         * @brief Get a snapshot of the fan-out counters
+         *
+         * @return Counters
+         */
+        FanoutStats getStats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Conversation
+        {
+            // Identifies the request in flight; replies to a replaced one are ignored
+            std::uint64_t generation = 0;
+            Clock::time_point sent;
+
+            std::string npcId;
+            std::string conversationId;
+            std::string cell;
+            PlayerId speaker = 0;
+            std::string playerMessage;
+
+            // Requesting players and their callbacks, in request order
+            std::vector<std::pair<PlayerId, DialogueCallback>> waiting;
+        };
+
+        void complete(const std::string& key, std::uint64_t generation, const DialogueResultPtr& result);
+
+        SendFunction mSend;
+        DeliverFunction mDeliver;
+        std::chrono::milliseconds mStaleAfter;
+
+        mutable std::mutex mMutex;
+
+        // Conversations with a generation in flight, by NPC and conversation
+        std::map<std::string, Conversation> mConversations;
+
+        std::map<PlayerId, std::string> mPlayerCells;
+        std::map<std::string, std::set<PlayerId>> mCellPlayers;
+
+        std::uint64_t mNextGeneration = 1;
+        FanoutStats mStats;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_DIALOGUEFANOUT_H
@@ -0,0 +1,79 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_DIALOGUERESULT_H
+#define OPENMW_COMPONENTS_AI_CLIENT_DIALOGUERESULT_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "action.hpp"
+#include "topicmatcher.hpp"
+#include "voicecache.hpp"
+#include "voicestream.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Result of a dialogue request
+     *
+     * Results are immutable once delivered and shared by reference count, so
+     * the manager and the Lua bindings can hand them on without copying.
+     */
+    struct DialogueResult
+    {
+        std::string text;
+        ActionList actions;
+
+        // Set when text is an error message rather than the NPC's reply
+        bool error = false;
+
+        // Set with error when a rate limit dropped the request; there is no message to show
+        bool dropped = false;
+
+        // Dialogue topics the text mentions, in text order; the matcher owns the topic names
+        std::vector<TopicSpan> topics;
+        TopicMatcherPtr topicMatcher;
+
+        // Voice audio, still arriving when the callback fires; null unless the server streams voice
+        VoiceStreamPtr voice;
+
+        // Complete voice audio from the clip cache, set instead of voice when the line was cached
+        VoiceClipPtr voiceClip;
+    };
+
+    using DialogueResultPtr = std::shared_ptr<const DialogueResult>;
+
+    /**
+     * @brief Create the result of a request dropped by a rate limit
+     *
+     * @return Shared result, marked as an error without a message
+     */
+    inline DialogueResultPtr makeDialogueDropped()
+    {
+        auto result = std::make_shared<DialogueResult>();
+        result->error = true;
+        result->dropped = true;
+        return result;
+    }
+
+    /**
+     * @brief Create a result that carries only an error message
+     *
+     * @param text Error message shown in place of the NPC's reply
+     * @return Shared result
+     */
+    inline DialogueResultPtr makeDialogueError(std::string text)
+    {
+        auto result = std::make_shared<DialogueResult>();
+        result->text = std::move(text);
+        result->error = true;
+        return result;
+    }
+
+    /**
+     * @brief Callback type for dialogue responses
+     */
+    using DialogueCallback = std::function<void(const DialogueResultPtr&)>;
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_DIALOGUERESULT_H
@@ -0,0 +1,126 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_EVENT_H
+#define OPENMW_COMPONENTS_AI_CLIENT_EVENT_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AI
+{
+    /**
+     * @brief Enum for event types that can be sent to the AI server
+     */
+    enum class EventType
+    {
+        None,
+        PlayerJoinedFaction,
+        PlayerLeftFaction,
+        PlayerCompletedQuest,
+        PlayerFailedQuest,
+        PlayerPromotion,
+        PlayerDemotion,
+        PlayerGaveItem,
+        PlayerTookItem,
+        NPCAttacked,
+        NPCKilled
+    };
+
+    /**
+     * @brief Wire name of an event type
+     */
+    struct EventTypeName
+    {
+        std::string_view name;
+        EventType type;
+    };
+
+    /**
+     * @brief Compile-time table mapping wire names to event types
+     */
+    inline constexpr std::array<EventTypeName, 10> sEventTypeNames{{
+        { "PLAYER_JOINED_FACTION", EventType::PlayerJoinedFaction },
+        { "PLAYER_LEFT_FACTION", EventType::PlayerLeftFaction },
+        { "PLAYER_COMPLETED_QUEST", EventType::PlayerCompletedQuest },
+        { "PLAYER_FAILED_QUEST", EventType::PlayerFailedQuest },
+        { "PLAYER_PROMOTION", EventType::PlayerPromotion },
+        { "PLAYER_DEMOTION", EventType::PlayerDemotion },
+        { "PLAYER_GAVE_ITEM", EventType::PlayerGaveItem },
+        { "PLAYER_TOOK_ITEM", EventType::PlayerTookItem },
+        { "NPC_ATTACKED", EventType::NPCAttacked },
+        { "NPC_KILLED", EventType::NPCKilled },
+    }};
+
+    /**
+     * @brief Get the wire name of an event type
+     *
+     * @param type Event type
+     * @return Wire name, or "UNKNOWN" for EventType::None
+     */
+    constexpr std::string_view eventTypeToString(EventType type)
+    {
+        for (const auto& entry : sEventTypeNames)
+        {
+            if (entry.type == type)
+                return entry.name;
+        }
+        return "UNKNOWN";
+    }
+
+    /**
+     * @brief Structured game event
+     *
+     * Only the fields relevant to the event type are set; empty fields are
+     * not sent. The server turns the fields into prose only when a prompt
+     * needs it.
+     */
+    struct Event
+    {
+        EventType type = EventType::None;
+        std::string faction;
+        std::string rank;
+        std::string questId;
+        std::string itemId;
+        int count = 0;
+        std::string actorId;
+    };
+
+    /**
+     * @brief Kind of NPC group a broadcast event goes to
+     *
+     * Npcs: the NPCs listed by record ID
+     * Faction: every member of a faction
+     * Cell: every NPC in a cell
+     */
+    enum class EventTargetKind
+    {
+        Npcs,
+        Faction,
+        Cell
+    };
+
+    inline constexpr std::size_t sEventTargetKindCount = 3;
+
+    // Keys of the target in the wire format, indexed by EventTargetKind
+    inline constexpr std::array<std::string_view, sEventTargetKindCount> sEventTargetKindNames
+        = { "npcIds", "faction", "cell" };
+
+    /**
+     * @brief NPCs a broadcast event goes to
+     *
+     * The server resolves factions and cells to their NPCs, so one message
+     * reaches all of them.
+     */
+    struct EventTarget
+    {
+        EventTargetKind kind = EventTargetKind::Npcs;
+
+        // NPC record IDs, for EventTargetKind::Npcs
+        std::vector<std::string> npcIds;
+
+        // Faction or cell ID, for the other kinds
+        std::string id;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_EVENT_H
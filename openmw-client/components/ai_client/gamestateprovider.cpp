@@ -0,0 +1,127 @@
+#include "gamestateprovider.hpp"
+
+#include <algorithm>
+
+namespace AI
+{
+    GameStateProvider::GameStateProvider()
+        : mSnapshot(std::make_shared<GameState>())
+    {
+    }
+
+    template <class Function>
+    void GameStateProvider::update(Function&& function)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Copy on write: readers may still hold the previous snapshot
+        auto next = std::make_shared<GameState>(*mSnapshot);
+        if (function(*next))
+            mSnapshot = std::move(next);
+    }
+
+    void GameStateProvider::setPlayer(
+        const std::string& name,
+        const std::string& race,
+        const std::string& gender,
+        const std::string& playerClass,
+        int level)
+    {
+        update([&](GameState& state) {
+            state.playerName = name;
+            state.playerRace = race;
+            state.playerGender = gender;
+            state.playerClass = playerClass;
+            state.playerLevel = level;
+            return true;
+        });
+    }
+
+    void GameStateProvider::onCellChanged(const std::string& cellName)
+    {
+        update([&](GameState& state) {
+            if (state.location == cellName)
+                return false;
+            state.location = cellName;
+            return true;
+        });
+    }
+
+    void GameStateProvider::onLevelUp(int level)
+    {
+        update([&](GameState& state) {
+            if (state.playerLevel == level)
+                return false;
+            state.playerLevel = level;
+            return true;
+        });
+    }
+
+    void GameStateProvider::onFactionChanged(const std::string& faction, int rank)
+    {
+        update([&](GameState& state) {
+            auto& factions = state.playerFactions;
+            auto it = std::find_if(factions.begin(), factions.end(),
+                [&](const auto& entry) { return entry.first == faction; });
+
+            if (rank < 0)
+            {
+                if (it == factions.end())
+                    return false;
+                factions.erase(it);
+                return true;
+            }
+
+            if (it == factions.end())
+                factions.emplace_back(faction, rank);
+            else if (it->second != rank)
+                it->second = rank;
+            else
+                return false;
+            return true;
+        });
+    }
+
+    void GameStateProvider::onWeatherChanged(const std::string& weather)
+    {
+        update([&](GameState& state) {
+            if (state.weather == weather)
+                return false;
+            state.weather = weather;
+            return true;
+        });
+    }
+
+    void GameStateProvider::onHourChanged(float hour)
+    {
+        std::string_view timeOfDay = getTimeOfDay(hour);
+        {
+            // Most hour ticks stay in the same bucket; avoid the copy for those
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mSnapshot->timeOfDay == timeOfDay)
+                return;
+        }
+
+        update([&](GameState& state) {
+            state.timeOfDay = timeOfDay;
+            return true;
+        });
+    }
+
+    GameStatePtr GameStateProvider::getSnapshot() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mSnapshot;
+    }
+
+    std::string_view GameStateProvider::getTimeOfDay(float hour)
+    {
+        if (hour < 6)
+            return "Night";
+        if (hour < 12)
+            return "Morning";
+        if (hour < 18)
+            return "Afternoon";
+        return "Evening";
+    }
+}
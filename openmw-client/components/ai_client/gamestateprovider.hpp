@@ -0,0 +1,128 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_GAMESTATEPROVIDER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_GAMESTATEPROVIDER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace AI
+{
+    /**
+     * @brief Snapshot of the game state sent along with dialogue requests
+     */
+    struct GameState
+    {
+        std::string playerName;
+        std::string playerRace;
+        std::string playerGender;
+        std::string playerClass;
+        int playerLevel = 1;
+        std::string location;
+        std::string_view timeOfDay = "Unknown";
+        std::string weather;
+
+        // Faction name and rank of every faction the player belongs to
+        std::vector<std::pair<std::string, int>> playerFactions;
+    };
+
+    using GameStatePtr = std::shared_ptr<const GameState>;
+
+    /**
+     * @brief Keeps an incrementally updated game state snapshot
+     *
+     * The engine reports changes as they happen (cell change, level-up, ...)
+     * and each change publishes a new immutable snapshot. Dialogue requests
+     * only take a reference to the current snapshot instead of rebuilding the
+     * game state every time.
+     */
+    class GameStateProvider
+    {
+    public:
+        /**
+         * @brief Constructor
+         */
+        GameStateProvider();
+
+        /**
+         * @brief Set the player's static information
+         *
+         * @param name Player name
+         * @param race Player race
+         * @param gender Player gender
+         * @param playerClass Player class
+         * @param level Player level
+         */
+        void setPlayer(
+            const std::string& name,
+            const std::string& race,
+            const std::string& gender,
+            const std::string& playerClass,
+            int level
+        );
+
+        /**
+         * @brief Called when the player enters a new cell
+         *
+         * @param cellName Name of the new cell
+         */
+        void onCellChanged(const std::string& cellName);
+
+        /**
+         * @brief Called when the player levels up
+         *
+         * @param level New level
+         */
+        void onLevelUp(int level);
+
+        /**
+         * @brief Called when the player joins, leaves or changes rank in a faction
+         *
+         * @param faction Faction name
+         * @param rank New rank, or a negative value if the player left the faction
+         */
+        void onFactionChanged(const std::string& faction, int rank);
+
+        /**
+         * @brief Called when the weather changes
+         *
+         * @param weather Name of the new weather
+         */
+        void onWeatherChanged(const std::string& weather);
+
+        /**
+         * @brief Called when the game hour advances
+         *
+         * A new snapshot is only published when the time-of-day bucket changes.
+         *
+         * @param hour Game hour, 0-24
+         */
+        void onHourChanged(float hour);
+
+        /**
+         * @brief Get the current snapshot
+         *
+         * @return Shared, immutable snapshot
+         */
+        GameStatePtr getSnapshot() const;
+
+        /**
+         * @brief Map a game hour to its time-of-day bucket
+         *
+         * @param hour Game hour, 0-24
+         * @return "Night", "Morning", "Afternoon" or "Evening"
+         */
+        static std::string_view getTimeOfDay(float hour);
+
+    private:
+        template <class Function>
+        void update(Function&& function);
+
+        mutable std::mutex mMutex;
+        GameStatePtr mSnapshot;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_GAMESTATEPROVIDER_H
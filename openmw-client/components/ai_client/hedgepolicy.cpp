@@ -0,0 +1,95 @@
+#include "hedgepolicy.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace AI
+{
+    namespace
+    {
+        // Credit kept for bursts of slow requests; at most this many hedges in a row
+        constexpr double sMaxCredit = 10.0;
+
+        // Latencies needed before the delay follows them
+        constexpr std::size_t sMinSamples = 32;
+    }
+
+    HedgePolicy::HedgePolicy(const HedgeOptions& options)
+        : mOptions(options)
+        , mEnabled(!options.host.empty())
+        , mDelayMicros(std::chrono::duration_cast<std::chrono::microseconds>(options.initialDelay).count())
+        , mCredit(1.0)
+    {
+        mOptions.percentile = std::clamp(mOptions.percentile, 0.0, 1.0);
+        mOptions.budget = std::max(mOptions.budget, 0.0);
+    }
+
+    std::chrono::microseconds HedgePolicy::getDelay() const
+    {
+        return std::chrono::microseconds(mDelayMicros.load(std::memory_order_relaxed));
+    }
+
+    void HedgePolicy::recordLatency(std::chrono::microseconds latency)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const auto micros = std::clamp<std::int64_t>(latency.count(), 0, std::numeric_limits<std::uint32_t>::max());
+        mWindow[mWindowNext] = static_cast<std::uint32_t>(micros);
+        mWindowNext = (mWindowNext + 1) % sWindowSize;
+        mWindowCount = std::min(mWindowCount + 1, sWindowSize);
+
+        if (mWindowCount < sMinSamples || mWindowNext % sUpdateInterval != 0)
+            return;
+
+        // Percentile of the window, bounded
+        std::array<std::uint32_t, sWindowSize> sorted = mWindow;
+        const auto end = sorted.begin() + mWindowCount;
+        const auto rank = static_cast<std::ptrdiff_t>(std::ceil(mOptions.percentile * mWindowCount)) - 1;
+        const auto nth = sorted.begin() + std::clamp<std::ptrdiff_t>(rank, 0, mWindowCount - 1);
+        std::nth_element(sorted.begin(), nth, end);
+
+        const std::int64_t minDelay = std::chrono::duration_cast<std::chrono::microseconds>(mOptions.minDelay).count();
+        const std::int64_t maxDelay = std::chrono::duration_cast<std::chrono::microseconds>(mOptions.maxDelay).count();
+        mDelayMicros.store(std::clamp<std::int64_t>(*nth, minDelay, std::max(minDelay, maxDelay)),
+            std::memory_order_relaxed);
+    }
+
+    void HedgePolicy::onRequest()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCredit = std::min(mCredit + mOptions.budget, sMaxCredit);
+    }
+
+    bool HedgePolicy::tryHedge()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCredit < 1.0)
+        {
+            ++mOverBudget;
+            return false;
+        }
+
+        mCredit -= 1.0;
+        ++mFired;
+        return true;
+    }
+
+    void HedgePolicy::onWon()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mWon;
+    }
+
+    HedgeStats HedgePolicy::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        HedgeStats stats;
+        stats.fired = mFired;
+        stats.won = mWon;
+        stats.overBudget = mOverBudget;
+        stats.delay = static_cast<std::uint64_t>(mDelayMicros.load(std::memory_order_relaxed));
+        return stats;
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_HEDGEPOLICY_H
+#define OPENMW_COMPONENTS_AI_CLIENT_HEDGEPOLICY_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "stats.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Settings for hedged dialogue requests
+     */
+    struct HedgeOptions
+    {
+        // Secondary endpoint that receives the duplicates; hedging is off while the host is empty
+        std::string host;
+        unsigned short port = 0;
+
+        // Percentile of recent dialogue server latencies after which a request is duplicated
+        double percentile = 0.9;
+
+        // Delay used until enough latencies are known, and the bounds of the adaptive delay
+        std::chrono::milliseconds initialDelay{ 1000 };
+        std::chrono::milliseconds minDelay{ 20 };
+        std::chrono::milliseconds maxDelay{ 10000 };
+
+        // Fraction of dialogue requests that may be duplicated
+        double budget = 0.1;
+    };
+
+    /**
+     * @brief Decides when and how often dialogue requests are hedged
+     *
+     * The hedge delay follows a percentile of the last few hundred dialogue
+     * server latencies, so only the slow tail is duplicated. Every dialogue
+     * request earns budget credit and every hedge spends one, which caps the
+     * extra load on the servers at the budget fraction. Thread-safe.
+     */
+    class HedgePolicy
+    {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param options Hedge settings
+         */
+        explicit HedgePolicy(const HedgeOptions& options);
+
+        /**
+         * @brief Check if hedging is configured
+         *
+         * @return true if there is a secondary endpoint, false otherwise
+         */
+        bool isEnabled() const { return mEnabled; }
+
+        /**
+         * @brief Get the time after which a request is hedged
+         *
+         * @return Delay after the request was written
+         */
+        std::chrono::microseconds getDelay() const;
+
+        /**
+         * @brief Record the server latency of a completed dialogue request
+         *
+         * @param latency Time from write to response
+         */
+        void recordLatency(std::chrono::microseconds latency);
+
+        /**
+         * @brief Earn budget for a dialogue request that may be hedged
+         */
+        void onRequest();
+
+        /**
+         * @brief Spend budget on a hedge
+         *
+         * @return true if the request may be hedged, false if the budget is spent
+         */
+        bool tryHedge();
+
+        /**
+         * @brief Count a hedge answered before its original request
+         */
+        void onWon();
+
+        /**
+         * @brief Get a snapshot of the hedge counters
+         *
+         * @return Statistics
+         */
+        HedgeStats getStats() const;
+
+    private:
+        static constexpr std::size_t sWindowSize = 256;
+
+        // Latencies recorded between recalculations of the delay
+        static constexpr std::size_t sUpdateInterval = 16;
+
+        HedgeOptions mOptions;
+        bool mEnabled;
+
+        mutable std::mutex mMutex;
+
+        // Most recent latencies in microseconds, as a ring
+        std::array<std::uint32_t, sWindowSize> mWindow{};
+        std::size_t mWindowCount = 0;
+        std::size_t mWindowNext = 0;
+
+        std::atomic<std::int64_t> mDelayMicros;
+        double mCredit;
+
+        std::uint64_t mFired = 0;
+        std::uint64_t mWon = 0;
+        std::uint64_t mOverBudget = 0;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_HEDGEPOLICY_H
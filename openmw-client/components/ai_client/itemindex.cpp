@@ -0,0 +1,263 @@
+#include "itemindex.hpp"
+
+#include <algorithm>
+
+namespace AI
+{
+    namespace
+    {
+        char toLower(char c)
+        {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        std::uint64_t hash(std::string_view folded)
+        {
+            // FNV-1a
+            std::uint64_t value = 14695981039346656037ull;
+            for (char c : folded)
+            {
+                value ^= static_cast<unsigned char>(c);
+                value *= 1099511628211ull;
+            }
+            return value;
+        }
+
+        std::string fold(std::string_view text)
+        {
+            std::string folded(text);
+            std::transform(folded.begin(), folded.end(), folded.begin(), toLower);
+            return folded;
+        }
+
+        std::vector<std::uint32_t> makeSlots(std::size_t count)
+        {
+            // At most half full, so probe runs stay short
+            std::size_t size = 16;
+            while (size < count * 2)
+                size *= 2;
+            return std::vector<std::uint32_t>(size, ~std::uint32_t(0));
+        }
+
+        /**
+         * @brief Levenshtein distance, giving up once it exceeds a limit
+         *
+         * @param left Text of up to ItemId::sMaxLength + 2 characters
+         * @param right Text of up to ItemId::sMaxLength characters
+         * @param limit Largest distance of interest
+         * @return Distance, or limit + 1 if it is larger
+         */
+        std::size_t editDistance(std::string_view left, std::string_view right, std::size_t limit)
+        {
+            std::array<std::uint8_t, ItemId::sMaxLength + 1> previous;
+            std::array<std::uint8_t, ItemId::sMaxLength + 1> current;
+            for (std::size_t j = 0; j <= right.size(); ++j)
+                previous[j] = static_cast<std::uint8_t>(j);
+
+            for (std::size_t i = 1; i <= left.size(); ++i)
+            {
+                current[0] = static_cast<std::uint8_t>(i);
+                std::size_t rowMin = current[0];
+                for (std::size_t j = 1; j <= right.size(); ++j)
+                {
+                    const std::size_t substitution = previous[j - 1] + std::size_t(left[i - 1] == right[j - 1] ? 0 : 1);
+                    const std::size_t insertion = current[j - 1] + std::size_t(1);
+                    const std::size_t deletion = previous[j] + std::size_t(1);
+                    const std::size_t value = std::min({ substitution, insertion, deletion });
+                    current[j] = static_cast<std::uint8_t>(value);
+                    rowMin = std::min(rowMin, value);
+                }
+                if (rowMin > limit)
+                    return limit + 1;
+                std::swap(previous, current);
+            }
+            return std::min<std::size_t>(previous[right.size()], limit + 1);
+        }
+
+        /**
+         * @brief Text from a model in lower case, without surrounding spaces, in a fixed buffer
+         */
+        class FoldedText
+        {
+        public:
+            explicit FoldedText(std::string_view text)
+            {
+                while (!text.empty() && isSpace(text.front()))
+                    text.remove_prefix(1);
+                while (!text.empty() && isSpace(text.back()))
+                    text.remove_suffix(1);
+
+                // Longer texts are neither IDs nor names, and are left empty
+                if (text.size() > mData.size())
+                    return;
+                std::transform(text.begin(), text.end(), mData.begin(), toLower);
+                mSize = text.size();
+            }
+
+            std::string_view view() const { return std::string_view(mData.data(), mSize); }
+
+            // Spaces for underscores, as models write IDs like words
+            void underscoreSpaces() { std::replace(mData.begin(), mData.begin() + mSize, ' ', '_'); }
+
+        private:
+            std::array<char, 64> mData;
+            std::size_t mSize = 0;
+        };
+    }
+
+    ItemIndex::ItemIndex(const std::vector<ItemRecord>& records)
+        : mIdSlots(makeSlots(records.size()))
+        , mNameSlots(makeSlots(records.size()))
+    {
+        // Step 1: Hash the IDs, dropping those the engine would not accept and repeated ones
+        for (const ItemRecord& record : records)
+        {
+            const std::optional<ItemId> id = ItemId::fromString(record.id);
+            if (!id)
+                continue;
+
+            const std::optional<ItemId> folded = ItemId::fromString(fold(record.id));
+            const std::size_t mask = mIdSlots.size() - 1;
+            std::size_t slot = hash(folded->view()) & mask;
+            while (mIdSlots[slot] != sEmpty && mFoldedIds[mIdSlots[slot]] != *folded)
+                slot = (slot + 1) & mask;
+            if (mIdSlots[slot] != sEmpty)
+                continue;
+
+            const auto index = static_cast<std::uint32_t>(mIds.size());
+            mIdSlots[slot] = index;
+            mIds.push_back(*id);
+            mFoldedIds.push_back(*folded);
+
+            // Step 2: Hash the name; the first item with a name is the one it stands for
+            if (record.name.empty())
+                continue;
+            std::string foldedName = fold(record.name);
+            const std::size_t nameMask = mNameSlots.size() - 1;
+            std::size_t nameSlot = hash(foldedName) & nameMask;
+            while (mNameSlots[nameSlot] != sEmpty && mFoldedNames[mNameSlots[nameSlot]] != foldedName)
+                nameSlot = (nameSlot + 1) & nameMask;
+            if (mNameSlots[nameSlot] != sEmpty)
+                continue;
+            mNameSlots[nameSlot] = static_cast<std::uint32_t>(mFoldedNames.size());
+            mFoldedNames.push_back(std::move(foldedName));
+            mNameIds.push_back(index);
+        }
+
+        // Step 3: Order the IDs by length for the typo search
+        mByLength.resize(mIds.size());
+        for (std::size_t i = 0; i < mByLength.size(); ++i)
+            mByLength[i] = static_cast<std::uint32_t>(i);
+        std::stable_sort(mByLength.begin(), mByLength.end(), [this](std::uint32_t left, std::uint32_t right) {
+            return mIds[left].view().size() < mIds[right].view().size();
+        });
+
+        std::size_t position = 0;
+        for (std::size_t length = 0; length < mLengthStarts.size(); ++length)
+        {
+            while (position < mByLength.size() && mIds[mByLength[position]].view().size() < length)
+                ++position;
+            mLengthStarts[length] = static_cast<std::uint32_t>(position);
+        }
+    }
+
+    std::uint32_t ItemIndex::findId(std::string_view folded) const
+    {
+        const std::size_t mask = mIdSlots.size() - 1;
+        for (std::size_t slot = hash(folded) & mask; mIdSlots[slot] != sEmpty; slot = (slot + 1) & mask)
+        {
+            if (mFoldedIds[mIdSlots[slot]].view() == folded)
+                return mIdSlots[slot];
+        }
+        return sEmpty;
+    }
+
+    std::uint32_t ItemIndex::findName(std::string_view folded) const
+    {
+        const std::size_t mask = mNameSlots.size() - 1;
+        for (std::size_t slot = hash(folded) & mask; mNameSlots[slot] != sEmpty; slot = (slot + 1) & mask)
+        {
+            if (mFoldedNames[mNameSlots[slot]] == folded)
+                return mNameIds[mNameSlots[slot]];
+        }
+        return sEmpty;
+    }
+
+    std::uint32_t ItemIndex::findClosest(std::string_view folded) const
+    {
+        // Short IDs get no typos, or any short ID would match any other
+        const std::size_t length = folded.size();
+        const std::size_t maxDistance = std::min(sMaxDistance, length / 4);
+        if (maxDistance == 0 || length > ItemId::sMaxLength + maxDistance)
+            return sEmpty;
+
+        // Only IDs whose length is within the distance can be close enough
+        std::size_t best = maxDistance;
+        std::uint32_t closest = sEmpty;
+        bool ambiguous = false;
+        const std::size_t shortest = length - maxDistance;
+        const std::size_t longest = std::min(length + maxDistance, ItemId::sMaxLength);
+        for (std::size_t position = mLengthStarts[shortest]; position < mLengthStarts[longest + 1]; ++position)
+        {
+            const std::uint32_t index = mByLength[position];
+            const std::size_t distance = editDistance(folded, mFoldedIds[index].view(), best);
+            if (distance > best)
+                continue;
+            if (distance < best || closest == sEmpty)
+            {
+                best = distance;
+                closest = index;
+                ambiguous = false;
+            }
+            else
+                ambiguous = true;
+        }
+        return ambiguous ? sEmpty : closest;
+    }
+
+    ItemMatch ItemIndex::resolve(std::string_view text, ItemId& id) const
+    {
+        FoldedText folded(text);
+        if (folded.view().empty())
+            return ItemMatch::Unknown;
+
+        // Step 1: The ID, in any case
+        std::uint32_t index = findId(folded.view());
+        if (index != sEmpty)
+        {
+            id = mIds[index];
+            return id.view() == text ? ItemMatch::Exact : ItemMatch::Normalized;
+        }
+
+        // Step 2: The item's name
+        index = findName(folded.view());
+        if (index != sEmpty)
+        {
+            id = mIds[index];
+            return ItemMatch::Name;
+        }
+
+        // Step 3: The ID written with spaces
+        folded.underscoreSpaces();
+        index = findId(folded.view());
+        if (index != sEmpty)
+        {
+            id = mIds[index];
+            return ItemMatch::Normalized;
+        }
+
+        // Step 4: The ID with a typo or two
+        index = findClosest(folded.view());
+        if (index != sEmpty)
+        {
+            id = mIds[index];
+            return ItemMatch::Fuzzy;
+        }
+        return ItemMatch::Unknown;
+    }
+}
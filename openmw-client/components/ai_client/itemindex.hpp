@@ -0,0 +1,114 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_ITEMINDEX_H
+#define OPENMW_COMPONENTS_AI_CLIENT_ITEMINDEX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "action.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Item record as loaded by the engine
+     */
+    struct ItemRecord
+    {
+        std::string id;
+
+        // Name shown in game, e.g. "Gold" for gold_001
+        std::string name;
+    };
+
+    /**
+     * @brief How an item ID from a model was matched to a record
+     *
+     * Exact: the record ID as written
+     * Normalized: the record ID in other case, with stray spaces or spaces for underscores
+     * Name: the name of the item rather than its ID
+     * Fuzzy: the one record ID within a few typos
+     * Unknown: no record, or more than one equally close
+     */
+    enum class ItemMatch
+    {
+        Exact,
+        Normalized,
+        Name,
+        Fuzzy,
+        Unknown
+    };
+
+    inline constexpr std::size_t sItemMatchCount = 5;
+
+    inline constexpr std::array<std::string_view, sItemMatchCount> sItemMatchNames
+        = { "exact", "normalized", "name", "fuzzy", "unknown" };
+
+    /**
+     * @brief All item record IDs, for checking the items named in actions
+     *
+     * Built once when the content files are loaded and immutable after, so
+     * any thread may query it without locks. IDs and names are found in
+     * open-addressed hash tables keyed by their lower case form, as the
+     * engine ignores case in record IDs; typos are looked for among the IDs
+     * of similar length only, which stays well below a millisecond for the
+     * full game's items.
+     */
+    class ItemIndex
+    {
+    public:
+        /**
+         * @brief Build the index
+         *
+         * @param records Item records; IDs longer than ItemId::sMaxLength are skipped, and the first record with a name
+         *                wins it
+         */
+        explicit ItemIndex(const std::vector<ItemRecord>& records);
+
+        /**
+         * @brief Find the record an item ID from a model means
+         *
+         * Does not allocate.
+         *
+         * @param text Item ID or name as written by the model
+         * @param id Record ID, set unless the result is ItemMatch::Unknown
+         * @return How the record was found
+         */
+        ItemMatch resolve(std::string_view text, ItemId& id) const;
+
+        std::size_t getSize() const { return mIds.size(); }
+
+    private:
+        // Typos allowed in an ID: one per four characters, up to this many
+        static constexpr std::size_t sMaxDistance = 2;
+
+        static constexpr std::uint32_t sEmpty = ~std::uint32_t(0);
+
+        std::uint32_t findId(std::string_view folded) const;
+        std::uint32_t findName(std::string_view folded) const;
+        std::uint32_t findClosest(std::string_view folded) const;
+
+        // Record IDs as loaded, and in lower case
+        std::vector<ItemId> mIds;
+        std::vector<ItemId> mFoldedIds;
+
+        // Lower case item names, and the ID each stands for
+        std::vector<std::string> mFoldedNames;
+        std::vector<std::uint32_t> mNameIds;
+
+        // Indices into the lists above, sEmpty for free slots; power of two sizes
+        std::vector<std::uint32_t> mIdSlots;
+        std::vector<std::uint32_t> mNameSlots;
+
+        // IDs ordered by length; those of length n start at mLengthStarts[n]
+        std::vector<std::uint32_t> mByLength;
+        std::array<std::uint32_t, ItemId::sMaxLength + 2> mLengthStarts{};
+    };
+
+    using ItemIndexPtr = std::shared_ptr<const ItemIndex>;
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_ITEMINDEX_H
@@ -0,0 +1,162 @@
+#include "loadbalancer.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace AI
+{
+    namespace
+    {
+        // Latency assumed on top of the average, so idle endpoints without samples still compare by load
+        constexpr double sBaseLatency = 1000.0;
+
+        // Rendezvous weight of an NPC on an endpoint; splitmix64 of the pair
+        std::uint64_t getWeight(std::size_t npcHash, std::size_t endpoint)
+        {
+            std::uint64_t x = static_cast<std::uint64_t>(npcHash) ^ (endpoint * 0x9e3779b97f4a7c15ull);
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+    }
+
+    LoadBalancer::LoadBalancer(std::size_t count, const BalanceOptions& options)
+        : mOptions(options)
+        , mEndpoints(count)
+    {
+        mOptions.latencyWeight = std::clamp(mOptions.latencyWeight, 0.0, 1.0);
+        mOptions.stickiness = std::max(mOptions.stickiness, 1.0);
+    }
+
+    double LoadBalancer::getScore(const State& state) const
+    {
+        return (state.latency + sBaseLatency) * static_cast<double>(state.outstanding + 1);
+    }
+
+    std::size_t LoadBalancer::acquire(const std::string& npcId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Least loaded endpoint, and the NPC's own one
+        const std::size_t npcHash = std::hash<std::string>()(npcId);
+        std::size_t best = sNone;
+        std::size_t preferred = sNone;
+        std::uint64_t preferredWeight = 0;
+        for (std::size_t i = 0; i < mEndpoints.size(); ++i)
+        {
+            if (mEndpoints[i].state != EndpointState::Up)
+                continue;
+
+            if (best == sNone || getScore(mEndpoints[i]) < getScore(mEndpoints[best]))
+                best = i;
+
+            const std::uint64_t weight = getWeight(npcHash, i);
+            if (preferred == sNone || weight > preferredWeight)
+            {
+                preferred = i;
+                preferredWeight = weight;
+            }
+        }
+
+        if (best == sNone)
+            return sNone;
+
+        std::size_t endpoint = best;
+        if (!npcId.empty() && getScore(mEndpoints[preferred]) <= mOptions.stickiness * getScore(mEndpoints[best]))
+            endpoint = preferred;
+
+        ++mEndpoints[endpoint].outstanding;
+        return endpoint;
+    }
+
+    bool LoadBalancer::release(std::size_t endpoint, bool failed, std::chrono::microseconds latency)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        State& state = mEndpoints[endpoint];
+        if (state.outstanding > 0)
+            --state.outstanding;
+
+        if (!failed)
+        {
+            state.consecutiveFailures = 0;
+            ++state.completed;
+            if (latency.count() >= 0)
+            {
+                const double sample = static_cast<double>(latency.count());
+                state.latency
+                    = state.hasLatency ? state.latency + mOptions.latencyWeight * (sample - state.latency) : sample;
+                state.hasLatency = true;
+            }
+            return false;
+        }
+
+        ++state.failures;
+        ++state.consecutiveFailures;
+        if (state.state != EndpointState::Up || state.consecutiveFailures < mOptions.failureThreshold)
+            return false;
+
+        // Never drain the last endpoint that is up; a struggling server beats none
+        const bool otherUp = std::any_of(mEndpoints.begin(), mEndpoints.end(),
+            [&](const State& other) { return &other != &state && other.state == EndpointState::Up; });
+        if (!otherUp)
+            return false;
+
+        state.state = EndpointState::Draining;
+        state.drainStart = Clock::now();
+        return true;
+    }
+
+    void LoadBalancer::cancel(std::size_t endpoint)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mEndpoints[endpoint].outstanding > 0)
+            --mEndpoints[endpoint].outstanding;
+    }
+
+    EndpointState LoadBalancer::getState(std::size_t endpoint) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEndpoints[endpoint].state;
+    }
+
+    void LoadBalancer::setState(std::size_t endpoint, EndpointState state, Clock::time_point now)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        State& current = mEndpoints[endpoint];
+        if (current.state == state)
+            return;
+
+        if (state == EndpointState::Up)
+        {
+            current.latency = 0.0;
+            current.hasLatency = false;
+            current.consecutiveFailures = 0;
+        }
+        else if (state == EndpointState::Draining)
+            current.drainStart = now;
+        current.state = state;
+    }
+
+    bool LoadBalancer::isDrained(std::size_t endpoint, Clock::time_point now) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const State& state = mEndpoints[endpoint];
+        return state.outstanding == 0 || now - state.drainStart >= mOptions.drainTimeout;
+    }
+
+    std::vector<EndpointStats> LoadBalancer::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        std::vector<EndpointStats> stats(mEndpoints.size());
+        for (std::size_t i = 0; i < mEndpoints.size(); ++i)
+        {
+            stats[i].state = mEndpoints[i].state;
+            stats[i].outstanding = mEndpoints[i].outstanding;
+            stats[i].latency = static_cast<std::uint64_t>(mEndpoints[i].latency);
+            stats[i].completed = mEndpoints[i].completed;
+            stats[i].failures = mEndpoints[i].failures;
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,154 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_LOADBALANCER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_LOADBALANCER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "stats.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Address of an AI server
+     */
+    struct Endpoint
+    {
+        std::string host;
+        unsigned short port = 0;
+    };
+
+    /**
+     * @brief Settings for spreading requests over several AI servers
+     */
+    struct BalanceOptions
+    {
+        // Time between health checks, which detect dropped connections and reconnect endpoints
+        std::chrono::milliseconds healthInterval{ 2000 };
+
+        // Weight of the newest sample in the latency moving average
+        double latencyWeight = 0.2;
+
+        // An NPC stays on its own endpoint while that endpoint's load is within this factor of the least loaded
+        double stickiness = 2.0;
+
+        // Failed requests in a row after which an endpoint is drained
+        unsigned failureThreshold = 3;
+
+        // Longest wait for a draining endpoint's outstanding requests before it is disconnected
+        std::chrono::milliseconds drainTimeout{ 10000 };
+    };
+
+    /**
+     * @brief Chooses the endpoint for each request
+     *
+     * Every endpoint has a load score: its moving average latency times its
+     * outstanding requests plus one. Each NPC prefers one endpoint, chosen by
+     * rendezvous hashing over the endpoints that are up, so its requests land
+     * where the server has its context cached and only move when endpoints
+     * come and go. The preferred endpoint is skipped while its score is more
+     * than the stickiness factor above the best one. Endpoints that fail
+     * repeatedly are drained, as long as another endpoint is up. Thread-safe.
+     */
+    class LoadBalancer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr std::size_t sNone = std::numeric_limits<std::size_t>::max();
+
+        /**
+         * @brief Constructor; all endpoints start down
+         *
+         * @param count Number of endpoints
+         * @param options Balancing settings
+         */
+        LoadBalancer(std::size_t count, const BalanceOptions& options = BalanceOptions());
+
+        /**
+         * @brief Choose the endpoint for a request and count it as outstanding there
+         *
+         * @param npcId NPC the request is for; empty for no preference
+         * @return Endpoint index, or sNone if no endpoint is up
+         */
+        std::size_t acquire(const std::string& npcId);
+
+        /**
+         * @brief Record the end of a request
+         *
+         * @param endpoint Endpoint the request was routed to
+         * @param failed Whether the endpoint failed to serve the request
+         * @param latency Server latency of the request; negative when there is no sample
+         * @return true if the failure started draining the endpoint, false otherwise
+         */
+        bool release(std::size_t endpoint, bool failed, std::chrono::microseconds latency);
+
+        /**
+         * @brief Forget an outstanding request that moved elsewhere or was abandoned
+         *
+         * @param endpoint Endpoint the request was routed to
+         */
+        void cancel(std::size_t endpoint);
+
+        /**
+         * @brief Get the routing state of an endpoint
+         *
+         * @param endpoint Endpoint index
+         * @return State
+         */
+        EndpointState getState(std::size_t endpoint) const;
+
+        /**
+         * @brief Change the routing state of an endpoint
+         *
+         * An endpoint coming up forgets its latency and failures.
+         *
+         * @param endpoint Endpoint index
+         * @param state New state
+         * @param now Current time, the start of a drain
+         */
+        void setState(std::size_t endpoint, EndpointState state, Clock::time_point now);
+
+        /**
+         * @brief Check if a draining endpoint may be disconnected
+         *
+         * @param endpoint Endpoint index
+         * @param now Current time
+         * @return true if it has no outstanding requests or the drain timed out, false otherwise
+         */
+        bool isDrained(std::size_t endpoint, Clock::time_point now) const;
+
+        /**
+         * @brief Get a snapshot of the endpoints; host and port are left empty
+         *
+         * @return Statistics per endpoint
+         */
+        std::vector<EndpointStats> getStats() const;
+
+    private:
+        struct State
+        {
+            EndpointState state = EndpointState::Down;
+            double latency = 0.0;
+            bool hasLatency = false;
+            std::uint64_t outstanding = 0;
+            unsigned consecutiveFailures = 0;
+            Clock::time_point drainStart;
+            std::uint64_t completed = 0;
+            std::uint64_t failures = 0;
+        };
+
+        double getScore(const State& state) const;
+
+        BalanceOptions mOptions;
+
+        mutable std::mutex mMutex;
+        std::vector<State> mEndpoints;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_LOADBALANCER_H
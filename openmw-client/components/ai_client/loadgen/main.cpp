@@ -0,0 +1,434 @@
+#include <components/ai_client/client.hpp>
+#include <components/ai_client/npcprofilecache.hpp>
+#include <components/ai_client/stats.hpp>
+#include <components/ai_client/stubserver/stubserver.hpp>
+
+#include <boost/program_options.hpp>
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace bpo = boost::program_options;
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    enum class ThinkTime
+    {
+        Exponential,
+        Uniform,
+        Constant
+    };
+
+    struct Options
+    {
+        std::string host = "localhost";
+        unsigned short port = 8080;
+        int players = 10;
+        int npcs = 50;
+        int connections = 1;
+        double durationSeconds = 30.0;
+        double dialogueRatio = 0.8;
+        double thinkTimeMs = 1000.0;
+        ThinkTime thinkTime = ThinkTime::Exponential;
+        double timeoutMs = 10000.0;
+        unsigned seed = 0;
+        std::string output;
+
+        // Run against an in-process stub server instead of host:port
+        bool stub = false;
+        AI::LatencyDistribution stubLatency;
+    };
+
+    /**
+     * @brief Outcome counters and latency of one request type
+     */
+    struct Results
+    {
+        std::atomic<std::uint64_t> sent{ 0 };
+        std::atomic<std::uint64_t> succeeded{ 0 };
+        std::atomic<std::uint64_t> failed{ 0 };
+        std::atomic<std::uint64_t> timedOut{ 0 };
+        AI::LatencyHistogram latency;
+    };
+
+    /**
+     * @brief One client connection shared by several simulated players
+     */
+    struct Connection
+    {
+        explicit Connection(const Options& options)
+            : client(options.host, options.port)
+        {
+        }
+
+        // Client::connect() is not safe to race, and the client reconnects from send calls
+        std::mutex sendMutex;
+        AI::Client client;
+    };
+
+    /**
+     * @brief Completion of one request, shared with the callback so late responses are harmless
+     */
+    struct Completion
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool done = false;
+        bool success = false;
+
+        void complete(bool result)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+                success = result;
+            }
+            condition.notify_one();
+        }
+    };
+
+    const std::array<const char*, 6> sPlayerMessages = {
+        "Hello there. What news from Vivec?",
+        "I'm looking for work. Do you know anyone who needs a sword arm?",
+        "Tell me about the Great Houses.",
+        "Have you seen anything strange around here lately?",
+        "What can you tell me about the Sixth House?",
+        "I have a package for you from Caius Cosades.",
+    };
+
+    const std::array<const char*, 4> sRaces = { "Dunmer", "Imperial", "Nord", "Khajiit" };
+    const std::array<const char*, 4> sClasses = { "Commoner", "Guard", "Trader", "Noble" };
+
+    std::chrono::microseconds drawThinkTime(const Options& options, std::mt19937& random)
+    {
+        double ms = options.thinkTimeMs;
+        switch (options.thinkTime)
+        {
+            case ThinkTime::Exponential:
+                ms = std::exponential_distribution<double>(1.0 / options.thinkTimeMs)(random);
+                break;
+            case ThinkTime::Uniform:
+                ms = std::uniform_real_distribution<double>(0.0, 2.0 * options.thinkTimeMs)(random);
+                break;
+            case ThinkTime::Constant:
+                break;
+        }
+        return std::chrono::microseconds(static_cast<std::int64_t>(ms * 1000.0));
+    }
+
+    constexpr std::string_view sNpcPrefix = "loadgen_npc_";
+
+    // Stands in for the engine's record stores; profiles are resolved once per NPC, as in the game
+    std::optional<AI::NpcRecord> lookupNpc(std::string_view recordId)
+    {
+        if (recordId.substr(0, sNpcPrefix.size()) != sNpcPrefix)
+            return std::nullopt;
+
+        const int npc = std::atoi(std::string(recordId.substr(sNpcPrefix.size())).c_str());
+        AI::NpcRecord record;
+        record.name = "Load Test NPC " + std::to_string(npc);
+        record.race = sRaces[npc % sRaces.size()];
+        record.gender = npc % 2 ? "Female" : "Male";
+        record.npcClass = sClasses[npc % sClasses.size()];
+        record.faction = "None";
+        return record;
+    }
+
+    AI::DialogueRequest makeDialogueRequest(int npc, AI::NpcProfileCache& profiles, std::mt19937& random)
+    {
+        AI::DialogueRequest request;
+        request.npcId = std::string(sNpcPrefix) + std::to_string(npc);
+        request.npc = profiles.get(request.npcId);
+        request.playerMessage = sPlayerMessages[random() % sPlayerMessages.size()];
+        return request;
+    }
+
+    AI::EventRequest makeEventRequest(int npc, std::mt19937& random)
+    {
+        AI::EventRequest request;
+        request.npcId = "loadgen_npc_" + std::to_string(npc);
+        if (random() % 2)
+        {
+            request.event.type = AI::EventType::PlayerGaveItem;
+            request.event.itemId = "gold_001";
+            request.event.count = 1 + static_cast<int>(random() % 100);
+        }
+        else
+        {
+            request.event.type = AI::EventType::PlayerCompletedQuest;
+            request.event.questId = "loadgen_quest";
+        }
+        return request;
+    }
+
+    /**
+     * @brief Simulate one player: think, talk to a random NPC, wait for the answer, repeat
+     */
+    void runPlayer(int player, const Options& options, Connection& connection, AI::NpcProfileCache& profiles,
+        Clock::time_point end, Results& dialogueResults, Results& eventResults)
+    {
+        std::mt19937 random(options.seed + static_cast<unsigned>(player) * 7919u);
+        std::uniform_int_distribution<int> pickNpc(0, options.npcs - 1);
+        std::bernoulli_distribution pickDialogue(options.dialogueRatio);
+        const auto timeout = std::chrono::microseconds(static_cast<std::int64_t>(options.timeoutMs * 1000.0));
+
+        while (true)
+        {
+            const Clock::time_point wakeUp = Clock::now() + drawThinkTime(options, random);
+            if (wakeUp >= end)
+                break;
+            std::this_thread::sleep_until(wakeUp);
+
+            const int npc = pickNpc(random);
+            const bool dialogue = pickDialogue(random);
+            Results& results = dialogue ? dialogueResults : eventResults;
+            auto completion = std::make_shared<Completion>();
+
+            const Clock::time_point start = Clock::now();
+            {
+                std::lock_guard<std::mutex> lock(connection.sendMutex);
+                if (dialogue)
+                {
+                    connection.client.sendDialogueRequest(makeDialogueRequest(npc, profiles, random),
+                        [completion](const AI::DialogueResultPtr& result) { completion->complete(!result->error); });
+                }
+                else
+                {
+                    connection.client.sendEvent(makeEventRequest(npc, random),
+                        [completion](bool success) { completion->complete(success); });
+                }
+            }
+            results.sent.fetch_add(1, std::memory_order_relaxed);
+
+            std::unique_lock<std::mutex> lock(completion->mutex);
+            if (!completion->condition.wait_for(lock, timeout, [&] { return completion->done; }))
+            {
+                results.timedOut.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            results.latency.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+            if (completion->success)
+                results.succeeded.fetch_add(1, std::memory_order_relaxed);
+            else
+                results.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    json summaryToJson(const AI::LatencySummary& summary)
+    {
+        return { { "count", summary.count }, { "mean", summary.mean / 1000.0 }, { "p50", summary.p50 / 1000.0 },
+            { "p90", summary.p90 / 1000.0 }, { "p99", summary.p99 / 1000.0 }, { "max", summary.max / 1000.0 } };
+    }
+
+    json resultsToJson(const Results& results, double elapsedSeconds)
+    {
+        const std::uint64_t sent = results.sent.load();
+        const std::uint64_t succeeded = results.succeeded.load();
+        const std::uint64_t failed = results.failed.load();
+        const std::uint64_t timedOut = results.timedOut.load();
+        return { { "sent", sent }, { "succeeded", succeeded }, { "failed", failed }, { "timedOut", timedOut },
+            { "throughputPerSecond", elapsedSeconds > 0 ? succeeded / elapsedSeconds : 0.0 },
+            { "errorRate", sent > 0 ? static_cast<double>(failed) / sent : 0.0 },
+            { "timeoutRate", sent > 0 ? static_cast<double>(timedOut) / sent : 0.0 },
+            { "latencyMs", summaryToJson(results.latency.summarize()) } };
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        std::string thinkTime = "exponential";
+        std::string stubLatency = "constant:0";
+
+        bpo::options_description desc("Usage: openmw-ai-loadgen [options]\n\nOptions");
+        desc.add_options()
+            ("help,h", "print help message")
+            ("host", bpo::value(&options.host)->default_value(options.host), "AI server host")
+            ("port", bpo::value(&options.port)->default_value(options.port), "AI server port")
+            ("players", bpo::value(&options.players)->default_value(options.players), "number of simulated players")
+            ("npcs", bpo::value(&options.npcs)->default_value(options.npcs), "number of distinct NPCs talked to")
+            ("connections", bpo::value(&options.connections)->default_value(options.connections),
+                "number of client connections the players are spread over")
+            ("duration", bpo::value(&options.durationSeconds)->default_value(options.durationSeconds),
+                "test duration in seconds")
+            ("dialogue-ratio", bpo::value(&options.dialogueRatio)->default_value(options.dialogueRatio),
+                "fraction of requests that are dialogue; the rest are events")
+            ("think-time", bpo::value(&options.thinkTimeMs)->default_value(options.thinkTimeMs),
+                "mean pause between a player's requests in milliseconds")
+            ("think-time-distribution", bpo::value(&thinkTime)->default_value(thinkTime),
+                "exponential, uniform or constant")
+            ("timeout", bpo::value(&options.timeoutMs)->default_value(options.timeoutMs),
+                "request timeout in milliseconds")
+            ("seed", bpo::value(&options.seed)->default_value(options.seed), "random seed")
+            ("output,o", bpo::value(&options.output), "write the JSON report to this file instead of stdout")
+            ("stub", bpo::bool_switch(&options.stub), "start an in-process stub server and run against it")
+            ("stub-latency", bpo::value(&stubLatency)->default_value(stubLatency),
+                "stub reply delay in ms: constant:MS, uniform:MIN:MAX, exponential:MEAN or lognormal:MEDIAN:SIGMA");
+
+        bpo::variables_map variables;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), variables);
+        bpo::notify(variables);
+
+        if (variables.count("help"))
+        {
+            std::cout << desc << std::endl;
+            return false;
+        }
+
+        if (thinkTime == "exponential")
+            options.thinkTime = ThinkTime::Exponential;
+        else if (thinkTime == "uniform")
+            options.thinkTime = ThinkTime::Uniform;
+        else if (thinkTime == "constant")
+            options.thinkTime = ThinkTime::Constant;
+        else
+            throw std::runtime_error("Unknown think time distribution: " + thinkTime);
+
+        std::optional<AI::LatencyDistribution> latency = AI::LatencyDistribution::parse(stubLatency);
+        if (!latency)
+            throw std::runtime_error("Invalid stub latency: " + stubLatency);
+        options.stubLatency = *latency;
+
+        if (options.players < 1 || options.npcs < 1 || options.connections < 1)
+            throw std::runtime_error("players, npcs and connections must be at least 1");
+        if (options.dialogueRatio < 0.0 || options.dialogueRatio > 1.0)
+            throw std::runtime_error("dialogue-ratio must be between 0 and 1");
+        if (options.thinkTimeMs <= 0.0 || options.timeoutMs <= 0.0 || options.durationSeconds <= 0.0)
+            throw std::runtime_error("think-time, timeout and duration must be positive");
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    try
+    {
+        if (!parseOptions(argc, argv, options))
+            return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::unique_ptr<AI::StubServer> stubServer;
+    if (options.stub)
+    {
+        AI::StubServerOptions stubOptions;
+        stubOptions.dialogueLatency = options.stubLatency;
+        stubOptions.eventLatency = options.stubLatency;
+        stubOptions.seed = options.seed;
+
+        stubServer = std::make_unique<AI::StubServer>(stubOptions);
+        if (!stubServer->start())
+            return 1;
+        options.host = stubOptions.address;
+        options.port = stubServer->getPort();
+    }
+
+    // Connect all clients before the clock starts
+    std::vector<std::unique_ptr<Connection>> connections;
+    for (int i = 0; i < options.connections; ++i)
+    {
+        auto connection = std::make_unique<Connection>(options);
+        if (!connection->client.connect())
+        {
+            std::cerr << "Error: failed to connect to " << options.host << ":" << options.port << std::endl;
+            return 1;
+        }
+        connections.push_back(std::move(connection));
+    }
+
+    Results dialogueResults;
+    Results eventResults;
+
+    AI::NpcProfileCache profiles;
+    profiles.setLookup(lookupNpc);
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end
+        = start + std::chrono::microseconds(static_cast<std::int64_t>(options.durationSeconds * 1e6));
+
+    std::vector<std::thread> players;
+    for (int player = 0; player < options.players; ++player)
+    {
+        Connection& connection = *connections[player % connections.size()];
+        players.emplace_back(runPlayer, player, std::cref(options), std::ref(connection), std::ref(profiles), end,
+            std::ref(dialogueResults), std::ref(eventResults));
+    }
+    for (std::thread& player : players)
+        player.join();
+
+    const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Client-side counters, summed over the connections
+    std::uint64_t bytesOut = 0;
+    std::uint64_t bytesIn = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t reconnects = 0;
+    for (const auto& connection : connections)
+    {
+        const AI::ClientStats stats = connection->client.getStats();
+        bytesOut += stats.bytesOut;
+        bytesIn += stats.bytesIn;
+        errors += stats.errors;
+        reconnects += stats.reconnects;
+    }
+
+    json report;
+    report["config"] = { { "host", options.host }, { "port", options.port }, { "stub", options.stub },
+        { "players", options.players },
+        { "npcs", options.npcs }, { "connections", options.connections },
+        { "durationSeconds", options.durationSeconds }, { "dialogueRatio", options.dialogueRatio },
+        { "thinkTimeMs", options.thinkTimeMs }, { "timeoutMs", options.timeoutMs }, { "seed", options.seed } };
+    report["elapsedSeconds"] = elapsedSeconds;
+    report["dialogue"] = resultsToJson(dialogueResults, elapsedSeconds);
+    report["event"] = resultsToJson(eventResults, elapsedSeconds);
+    report["client"]
+        = { { "bytesOut", bytesOut }, { "bytesIn", bytesIn }, { "errors", errors }, { "reconnects", reconnects } };
+
+    const std::uint64_t sent = dialogueResults.sent + eventResults.sent;
+    const std::uint64_t succeeded = dialogueResults.succeeded + eventResults.succeeded;
+    report["throughputPerSecond"] = elapsedSeconds > 0 ? succeeded / elapsedSeconds : 0.0;
+    report["errorRate"]
+        = sent > 0 ? static_cast<double>(dialogueResults.failed + eventResults.failed) / sent : 0.0;
+    report["timeoutRate"]
+        = sent > 0 ? static_cast<double>(dialogueResults.timedOut + eventResults.timedOut) / sent : 0.0;
+
+    if (options.output.empty())
+        std::cout << report.dump(2) << std::endl;
+    else
+    {
+        std::ofstream file(options.output);
+        if (!file)
+        {
+            std::cerr << "Error: cannot write " << options.output << std::endl;
+            return 1;
+        }
+        file << report.dump(2) << std::endl;
+    }
+
+    // Outstanding requests are abandoned; their callbacks only touch shared completions
+    for (auto& connection : connections)
+        connection->client.disconnect();
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "npcprofilecache.hpp"
+
+#include <algorithm>
+
+namespace AI
+{
+    namespace
+    {
+        char toLower(char c)
+        {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+    }
+
+    NpcProfilePtr makeNpcProfile(NpcRecord record)
+    {
+        auto storage = std::make_shared<const NpcRecord>(std::move(record));
+
+        auto profile = std::make_shared<NpcProfile>();
+        profile->name = storage->name;
+        profile->race = storage->race;
+        profile->gender = storage->gender;
+        profile->npcClass = storage->npcClass;
+        profile->faction = storage->faction;
+        profile->storage = std::move(storage);
+        return profile;
+    }
+
+    bool NpcProfileCache::CaseInsensitiveLess::operator()(std::string_view left, std::string_view right) const
+    {
+        return std::lexicographical_compare(left.begin(), left.end(), right.begin(), right.end(),
+            [](char a, char b) { return toLower(a) < toLower(b); });
+    }
+
+    NpcProfileCache::NpcProfileCache()
+        : mStrings(std::make_shared<Strings>())
+    {
+    }
+
+    void NpcProfileCache::setLookup(Lookup lookup)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLookup = std::move(lookup);
+        mProfiles.clear();
+        mStrings = std::make_shared<Strings>();
+    }
+
+    std::string_view NpcProfileCache::intern(std::string_view value)
+    {
+        auto it = mStrings->find(value);
+        if (it == mStrings->end())
+            it = mStrings->emplace(value).first;
+        return *it;
+    }
+
+    NpcProfilePtr NpcProfileCache::get(std::string_view recordId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mProfiles.find(recordId);
+        if (it != mProfiles.end())
+            return it->second;
+
+        std::optional<NpcRecord> record;
+        if (mLookup)
+            record = mLookup(recordId);
+
+        // Unknown NPCs are cached too, until the records change
+        auto profile = std::make_shared<NpcProfile>();
+        if (record)
+        {
+            profile->name = intern(record->name);
+            profile->race = intern(record->race);
+            profile->gender = intern(record->gender);
+            profile->npcClass = intern(record->npcClass);
+            profile->faction = intern(record->faction);
+        }
+        else
+            profile->name = intern(recordId);
+        profile->storage = mStrings;
+
+        mProfiles.emplace(recordId, profile);
+        return profile;
+    }
+
+    void NpcProfileCache::onRecordChanged(std::string_view recordId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mProfiles.find(recordId);
+        if (it != mProfiles.end())
+            mProfiles.erase(it);
+    }
+
+    void NpcProfileCache::onRecordsReloaded()
+    {
+        // Profiles still in use keep the old strings; the new ones start a fresh set
+        std::lock_guard<std::mutex> lock(mMutex);
+        mProfiles.clear();
+        mStrings = std::make_shared<Strings>();
+    }
+
+    std::size_t NpcProfileCache::getSize() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mProfiles.size();
+    }
+
+    std::size_t NpcProfileCache::getInternedCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStrings->size();
+    }
+}
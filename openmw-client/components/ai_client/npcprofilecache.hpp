@@ -0,0 +1,145 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_NPCPROFILECACHE_H
+#define OPENMW_COMPONENTS_AI_CLIENT_NPCPROFILECACHE_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace AI
+{
+    /**
+     * @brief NPC details as looked up in the engine's record stores
+     */
+    struct NpcRecord
+    {
+        std::string name;
+        std::string race;
+        std::string gender;
+        std::string npcClass;
+        std::string faction;
+    };
+
+    /**
+     * @brief NPC details sent along with dialogue requests
+     *
+     * The fields view strings owned by the storage the profile holds. Profiles
+     * from an NpcProfileCache view interned strings, so all NPCs of one race,
+     * class or faction share a single copy of its name.
+     */
+    struct NpcProfile
+    {
+        std::string_view name;
+        std::string_view race;
+        std::string_view gender;
+        std::string_view npcClass;
+        std::string_view faction;
+
+        // Keeps the viewed strings alive
+        std::shared_ptr<const void> storage;
+    };
+
+    using NpcProfilePtr = std::shared_ptr<const NpcProfile>;
+
+    /**
+     * @brief Create a profile that owns its strings, for NPCs that are not in the engine's stores
+     *
+     * @param record NPC details
+     * @return Shared profile
+     */
+    NpcProfilePtr makeNpcProfile(NpcRecord record);
+
+    /**
+     * @brief Profiles of the NPCs talked to, resolved once from the engine's records
+     *
+     * The engine installs a lookup that reads an NPC record and the race,
+     * class and faction records it refers to; each NPC is looked up on first
+     * use only, and later dialogue lines take a reference to the cached
+     * profile. Record IDs compare case-insensitively, as in the engine. The
+     * engine reports changed records, which are looked up again on their
+     * next use. Thread-safe.
+     */
+    class NpcProfileCache
+    {
+    public:
+        /**
+         * @brief Reads the details of an NPC record
+         *
+         * Returns std::nullopt for unknown records. Called with the cache locked,
+         * so it must not call back into the cache.
+         */
+        using Lookup = std::function<std::optional<NpcRecord>(std::string_view recordId)>;
+
+        /**
+         * @brief Constructor
+         */
+        NpcProfileCache();
+
+        /**
+         * @brief Install the record lookup and drop all cached profiles
+         *
+         * @param lookup Record lookup; empty for none
+         */
+        void setLookup(Lookup lookup);
+
+        /**
+         * @brief Get the profile of an NPC, looking it up on first use
+         *
+         * NPCs the lookup does not know get a profile named after their record ID.
+         *
+         * @param recordId NPC record ID
+         * @return Shared, immutable profile; never null
+         */
+        NpcProfilePtr get(std::string_view recordId);
+
+        /**
+         * @brief Called when an NPC record was added or modified
+         *
+         * @param recordId NPC record ID
+         */
+        void onRecordChanged(std::string_view recordId);
+
+        /**
+         * @brief Called when the records were reloaded, e.g. for a new game or other content files
+         */
+        void onRecordsReloaded();
+
+        /**
+         * @brief Get the number of cached profiles
+         *
+         * @return Profile count
+         */
+        std::size_t getSize() const;
+
+        /**
+         * @brief Get the number of distinct strings the cached profiles view
+         *
+         * @return String count
+         */
+        std::size_t getInternedCount() const;
+
+    private:
+        // Record IDs compare like the engine's, ignoring ASCII case
+        struct CaseInsensitiveLess
+        {
+            using is_transparent = void;
+            bool operator()(std::string_view left, std::string_view right) const;
+        };
+
+        // Interned strings; the set's nodes never move, so views of them stay valid
+        using Strings = std::set<std::string, std::less<>>;
+
+        std::string_view intern(std::string_view value);
+
+        mutable std::mutex mMutex;
+        Lookup mLookup;
+        std::shared_ptr<Strings> mStrings;
+        std::map<std::string, NpcProfilePtr, CaseInsensitiveLess> mProfiles;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_NPCPROFILECACHE_H
@@ -0,0 +1,125 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_POOL_H
+#define OPENMW_COMPONENTS_AI_CLIENT_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace AI
+{
+    /**
+     * @brief Spare nodes of a std::map, reused by later insertions
+     *
+     * Entries taken out of the map keep their node, so a table that
+     * registers and completes requests at a steady rate stops allocating
+     * once it has seen its largest size. Not thread-safe; guard it together
+     * with the map.
+     */
+    template <class Map>
+    class NodePool
+    {
+    public:
+        using Key = typename Map::key_type;
+        using Mapped = typename Map::mapped_type;
+
+        /**
+         * @brief Constructor
+         *
+         * @param capacity Largest number of spare nodes kept; nodes beyond it are freed
+         */
+        explicit NodePool(std::size_t capacity) { mNodes.reserve(capacity); }
+
+        /**
+         * @brief Insert an entry, reusing a spare node if there is one
+         *
+         * @param map Map to insert into
+         * @param key Key of the entry
+         * @return Value of the entry; default-constructed unless the key was present
+         */
+        Mapped& emplace(Map& map, const Key& key)
+        {
+            if (mNodes.empty())
+                return map.try_emplace(key).first->second;
+
+            typename Map::node_type node = std::move(mNodes.back());
+            mNodes.pop_back();
+            node.key() = key;
+            node.mapped() = Mapped();
+
+            auto result = map.insert(std::move(node));
+            if (!result.inserted)
+                mNodes.push_back(std::move(result.node));
+            return result.position->second;
+        }
+
+        /**
+         * @brief Remove an entry and keep its node
+         *
+         * @param map Map to remove from
+         * @param it Entry to remove
+         * @return Value of the entry
+         */
+        Mapped take(Map& map, typename Map::iterator it)
+        {
+            typename Map::node_type node = map.extract(it);
+            Mapped value = std::move(node.mapped());
+            if (mNodes.size() < mNodes.capacity())
+                mNodes.push_back(std::move(node));
+            return value;
+        }
+
+    private:
+        std::vector<typename Map::node_type> mNodes;
+    };
+
+    /**
+     * @brief Shared objects that are handed out again once nobody else holds them
+     *
+     * The pool keeps a reference to each object it created; an object whose
+     * only reference is the pool's is free. Acquired objects keep the state
+     * and buffers of their last use, so the caller resets what it needs.
+     * Only one thread may acquire; the objects may be released on any thread.
+     */
+    template <class T>
+    class SharedPool
+    {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param capacity Largest number of objects kept; objects beyond it are not reused
+         */
+        explicit SharedPool(std::size_t capacity) { mObjects.reserve(capacity); }
+
+        /**
+         * @brief Get a free object, or a new one if all are in use
+         *
+         * @return Object, holding whatever its last user left in it
+         */
+        std::shared_ptr<T> acquire()
+        {
+            for (const std::shared_ptr<T>& object : mObjects)
+            {
+                // Nobody else can take a new reference, so a count of one stays one.
+                // The fence orders the last user's accesses before ours.
+                if (object.use_count() == 1)
+                {
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    return object;
+                }
+            }
+
+            auto object = std::make_shared<T>();
+            if (mObjects.size() < mObjects.capacity())
+                mObjects.push_back(object);
+            return object;
+        }
+
+    private:
+        std::vector<std::shared_ptr<T>> mObjects;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_POOL_H
@@ -0,0 +1,101 @@
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+namespace AI
+{
+    using json = nlohmann::json;
+
+    void writeHello(std::string& out, const ProtocolOptions& options)
+    {
+        json hello;
+        hello["type"] = "hello";
+        hello["protocol"] = sProtocolVersion;
+        hello["maxInFlight"] = options.maxInFlight;
+        hello["features"] = json::array();
+        for (std::size_t feature = 0; feature < sProtocolFeatureCount; ++feature)
+        {
+            if (options.features.test(feature))
+                hello["features"].push_back(sProtocolFeatureNames[feature]);
+        }
+        out += hello.dump();
+    }
+
+    Handshake readWelcome(std::string_view message, const ProtocolOptions& options)
+    {
+        Handshake handshake;
+        try
+        {
+            const json welcome = json::parse(message);
+            if (!welcome.is_object() || welcome.value("type", "") != "welcome")
+                return handshake;
+
+            handshake.version = std::min(welcome.value("protocol", 1u), sProtocolVersion);
+            if (handshake.version < 2)
+                return Handshake();
+
+            // The smaller window wins; 0 on either side means no limit
+            const unsigned serverWindow = welcome.value("maxInFlight", 0u);
+            if (serverWindow == 0 || options.maxInFlight == 0)
+                handshake.maxInFlight = std::max(serverWindow, options.maxInFlight);
+            else
+                handshake.maxInFlight = std::min(serverWindow, options.maxInFlight);
+
+            auto featuresIt = welcome.find("features");
+            if (featuresIt != welcome.end() && featuresIt->is_array())
+            {
+                for (const json& name : *featuresIt)
+                {
+                    if (!name.is_string())
+                        continue;
+                    const auto known = std::find(
+                        sProtocolFeatureNames.begin(), sProtocolFeatureNames.end(), name.get_ref<const std::string&>());
+                    if (known != sProtocolFeatureNames.end())
+                        handshake.features.set(known - sProtocolFeatureNames.begin());
+                }
+            }
+            handshake.features &= options.features;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error parsing AI server handshake: " << e.what() << std::endl;
+            return Handshake();
+        }
+        return handshake;
+    }
+
+    void writeVoiceCancel(std::string& out, std::string_view requestId)
+    {
+        json cancel;
+        cancel["type"] = "voice_cancel";
+        cancel["requestId"] = requestId;
+        out += cancel.dump();
+    }
+
+    void writeVoiceChunk(std::string& out, const VoiceChunk& chunk)
+    {
+        out += static_cast<char>(chunk.requestId.size());
+        out += chunk.requestId;
+        out += static_cast<char>(chunk.last ? 1 : 0);
+        out += chunk.audio;
+    }
+
+    bool readVoiceChunk(std::string_view frame, VoiceChunk& chunk)
+    {
+        if (frame.empty())
+            return false;
+
+        // Length byte, request ID and flags byte come before the audio
+        const std::size_t idSize = static_cast<unsigned char>(frame[0]);
+        if (frame.size() < idSize + 2)
+            return false;
+
+        chunk.requestId = frame.substr(1, idSize);
+        chunk.last = (static_cast<unsigned char>(frame[idSize + 1]) & 1) != 0;
+        chunk.audio = frame.substr(idSize + 2);
+        return true;
+    }
+}
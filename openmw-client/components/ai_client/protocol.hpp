@@ -0,0 +1,132 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_PROTOCOL_H
+#define OPENMW_COMPONENTS_AI_CLIENT_PROTOCOL_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace AI
+{
+    /**
+     * @brief Protocol version spoken by this client
+     *
+     * 1: no handshake; the server answers one message at a time, in order,
+     *    and replies may lack the request ID
+     * 2: hello/welcome handshake; every reply echoes its request ID, and the
+     *    server works on several requests of a connection at once
+     *
+     * With the streaming feature, a dialogue reply that names a voiceFormat is
+     * followed by binary frames carrying its voice audio, see VoiceChunk.
+     */
+    inline constexpr unsigned sProtocolVersion = 2;
+
+    /**
+     * @brief Optional protocol features, advertised in the handshake
+     */
+    enum class ProtocolFeature
+    {
+        Compression,
+        Binary,
+        Streaming,
+        Batching
+    };
+
+    inline constexpr std::size_t sProtocolFeatureCount = 4;
+
+    inline constexpr std::array<std::string_view, sProtocolFeatureCount> sProtocolFeatureNames
+        = { "compression", "binary", "streaming", "batching" };
+
+    // Indexed by ProtocolFeature
+    using ProtocolFeatures = std::bitset<sProtocolFeatureCount>;
+
+    /**
+     * @brief What the client asks for in the handshake
+     */
+    struct ProtocolOptions
+    {
+        // Dialogue requests a connection may have awaiting replies, 0 for no limit; events are not limited
+        unsigned maxInFlight = 16;
+
+        // Features the client can use
+        ProtocolFeatures features;
+    };
+
+    /**
+     * @brief Outcome of the handshake of a connection
+     */
+    struct Handshake
+    {
+        unsigned version = 1;
+
+        // Dialogue requests awaiting replies at a time; 0 for no limit
+        unsigned maxInFlight = 0;
+
+        // Features both sides support
+        ProtocolFeatures features;
+    };
+
+    /**
+     * @brief Piece of streamed voice audio, sent in a binary frame
+     *
+     * Frame layout: one byte with the length of the request ID, the request
+     * ID, one flags byte (bit 0: last chunk) and the encoded audio.
+     */
+    struct VoiceChunk
+    {
+        // Views into the frame
+        std::string_view requestId;
+        std::string_view audio;
+
+        bool last = false;
+    };
+
+    /**
+     * @brief Serialize the hello message that opens a connection
+     *
+     * @param out Buffer to append to
+     * @param options Window and features to ask for
+     */
+    void writeHello(std::string& out, const ProtocolOptions& options);
+
+    /**
+     * @brief Read the server's answer to the hello message
+     *
+     * Servers that predate the handshake answer with an error, which yields
+     * version 1 without a window. Window and features are capped at what the
+     * client asked for.
+     *
+     * @param message Server message
+     * @param options What the client asked for
+     * @return Negotiated protocol
+     */
+    Handshake readWelcome(std::string_view message, const ProtocolOptions& options);
+
+    /**
+     * @brief Serialize the message that stops the voice audio of a reply, e.g. because the clip is cached
+     *
+     * @param out Buffer to append to
+     * @param requestId Request ID of the dialogue reply
+     */
+    void writeVoiceCancel(std::string& out, std::string_view requestId);
+
+    /**
+     * @brief Serialize a voice chunk into a binary frame
+     *
+     * @param out Buffer to append to
+     * @param chunk Chunk; the request ID must be shorter than 256 bytes
+     */
+    void writeVoiceChunk(std::string& out, const VoiceChunk& chunk);
+
+    /**
+     * @brief Parse a binary frame into a voice chunk
+     *
+     * @param frame Frame as received; must outlive the chunk
+     * @param chunk Parsed chunk
+     * @return true if the frame is well formed, false otherwise
+     */
+    bool readVoiceChunk(std::string_view frame, VoiceChunk& chunk);
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_PROTOCOL_H
@@ -0,0 +1,181 @@
+#include "ratelimiter.hpp"
+
+#include <algorithm>
+
+namespace AI
+{
+    namespace
+    {
+        // NPC buckets are swept for full ones, which are the same as new ones, once there are this many
+        constexpr std::size_t sMinSweepSize = 1024;
+
+        bool isEnabled(const RateLimit& limit)
+        {
+            return limit.rate > 0.0;
+        }
+    }
+
+    RateLimiter::RateLimiter(const RateLimitOptions& options)
+        : mOptions(options)
+        , mSweepSize(sMinSweepSize)
+    {
+        // A bucket smaller than one token could never let a request through
+        mOptions.global.burst = std::max(mOptions.global.burst, 1.0);
+        mOptions.perNpc.burst = std::max(mOptions.perNpc.burst, 1.0);
+        for (RateLimit& limit : mOptions.perKind)
+            limit.burst = std::max(limit.burst, 1.0);
+
+        mEnabled = isEnabled(mOptions.global) || isEnabled(mOptions.perNpc)
+            || std::any_of(mOptions.perKind.begin(), mOptions.perKind.end(), isEnabled);
+
+        const Clock::time_point now = Clock::now();
+        mGlobal = { mOptions.global.burst, now };
+        for (std::size_t kind = 0; kind < sRequestKindCount; ++kind)
+            mKinds[kind] = { mOptions.perKind[kind].burst, now };
+    }
+
+    RateLimiter::Admission RateLimiter::acquire(RequestKind kind, const std::string& npcId, Clock::time_point now)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!mEnabled)
+        {
+            ++mStats.admitted;
+            return { RateLimitAction::Admit, now };
+        }
+
+        // The buckets this request draws from, most specific first
+        struct Draw
+        {
+            Bucket* bucket;
+            const RateLimit* limit;
+            RateLimitScope scope;
+            double wait;
+        };
+        std::array<Draw, sRateLimitScopeCount> draws;
+        std::size_t drawCount = 0;
+
+        if (isEnabled(mOptions.perNpc))
+        {
+            if (mNpcs.size() >= mSweepSize)
+                sweepNpcBuckets(now);
+
+            auto inserted = mNpcs.try_emplace(npcId, Bucket{ mOptions.perNpc.burst, now });
+            draws[drawCount++] = { &inserted.first->second, &mOptions.perNpc, RateLimitScope::Npc, 0.0 };
+        }
+
+        const RateLimit& kindLimit = mOptions.perKind[static_cast<std::size_t>(kind)];
+        if (isEnabled(kindLimit))
+            draws[drawCount++] = { &mKinds[static_cast<std::size_t>(kind)], &kindLimit, RateLimitScope::Kind, 0.0 };
+
+        if (isEnabled(mOptions.global))
+            draws[drawCount++] = { &mGlobal, &mOptions.global, RateLimitScope::Global, 0.0 };
+
+        // Seconds until each bucket has a token for this request
+        for (std::size_t i = 0; i < drawCount; ++i)
+        {
+            Draw& draw = draws[i];
+            refill(*draw.bucket, *draw.limit, now);
+            if (draw.bucket->tokens < 1.0)
+                draw.wait = (1.0 - draw.bucket->tokens) / draw.limit->rate;
+        }
+
+        // Drop and reject as soon as one such bucket is empty; no tokens are taken
+        for (std::size_t i = 0; i < drawCount; ++i)
+        {
+            const Draw& draw = draws[i];
+            if (draw.wait <= 0.0 || draw.limit->policy == RateLimitPolicy::Delay)
+                continue;
+
+            ++mStats.limitedBy[static_cast<std::size_t>(draw.scope)];
+            if (draw.limit->policy == RateLimitPolicy::Drop)
+            {
+                ++mStats.dropped;
+                return { RateLimitAction::Drop, now };
+            }
+            ++mStats.rejected;
+            return { RateLimitAction::Reject, now };
+        }
+
+        // The remaining buckets delay; the slowest one decides
+        const Draw* slowest = nullptr;
+        for (std::size_t i = 0; i < drawCount; ++i)
+        {
+            if (draws[i].wait > 0.0 && (!slowest || draws[i].wait > slowest->wait))
+                slowest = &draws[i];
+        }
+
+        const auto delay = slowest ? std::chrono::duration<double>(slowest->wait) : std::chrono::duration<double>::zero();
+        if (delay > mOptions.maxDelay)
+        {
+            ++mStats.limitedBy[static_cast<std::size_t>(slowest->scope)];
+            ++mStats.rejected;
+            return { RateLimitAction::Reject, now };
+        }
+
+        // Take the tokens, going into debt for a delayed request
+        for (std::size_t i = 0; i < drawCount; ++i)
+            draws[i].bucket->tokens -= 1.0;
+
+        if (slowest)
+        {
+            ++mStats.limitedBy[static_cast<std::size_t>(slowest->scope)];
+            ++mStats.delayed;
+        }
+        else
+            ++mStats.admitted;
+
+        return { RateLimitAction::Admit, now + std::chrono::duration_cast<Clock::duration>(delay) };
+    }
+
+    RateLimitStats RateLimiter::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Levels as of now, without changing the buckets
+        const Clock::time_point now = Clock::now();
+        RateLimitStats stats = mStats;
+        if (isEnabled(mOptions.global))
+        {
+            Bucket global = mGlobal;
+            refill(global, mOptions.global, now);
+            stats.globalTokens = global.tokens;
+        }
+        for (std::size_t kind = 0; kind < sRequestKindCount; ++kind)
+        {
+            if (!isEnabled(mOptions.perKind[kind]))
+                continue;
+            Bucket bucket = mKinds[kind];
+            refill(bucket, mOptions.perKind[kind], now);
+            stats.kindTokens[kind] = bucket.tokens;
+        }
+        stats.npcBuckets = mNpcs.size();
+        return stats;
+    }
+
+    void RateLimiter::refill(Bucket& bucket, const RateLimit& limit, Clock::time_point now)
+    {
+        // Callers on other threads may pass a slightly older time
+        if (now <= bucket.updated)
+            return;
+
+        const double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+        bucket.tokens = std::min(limit.burst, bucket.tokens + elapsed * limit.rate);
+        bucket.updated = now;
+    }
+
+    void RateLimiter::sweepNpcBuckets(Clock::time_point now)
+    {
+        for (auto it = mNpcs.begin(); it != mNpcs.end();)
+        {
+            refill(it->second, mOptions.perNpc, now);
+            if (it->second.tokens >= mOptions.perNpc.burst)
+                it = mNpcs.erase(it);
+            else
+                ++it;
+        }
+
+        // Grow the threshold with the number of busy NPCs so sweeps stay amortized
+        mSweepSize = std::max(sMinSweepSize, mNpcs.size() * 2);
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_RATELIMITER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_RATELIMITER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "stats.hpp"
+
+namespace AI
+{
+    /**
+     * @brief What happens to a request when its token bucket is empty
+     *
+     * Delay: the request waits on the writer thread until tokens are available
+     * Drop: the request is discarded without an error message; dialogue callbacks get a result marked dropped and
+     *       event callbacks false
+     * Reject: the callback is called at once with an error
+     */
+    enum class RateLimitPolicy
+    {
+        Delay,
+        Drop,
+        Reject
+    };
+
+    /**
+     * @brief Token bucket settings
+     */
+    struct RateLimit
+    {
+        // Tokens added per second; 0 disables the bucket
+        double rate = 0.0;
+
+        // Bucket capacity, the number of requests let through in a burst
+        double burst = 1.0;
+
+        RateLimitPolicy policy = RateLimitPolicy::Delay;
+    };
+
+    /**
+     * @brief Rate limits of a client; all buckets are disabled by default
+     */
+    struct RateLimitOptions
+    {
+        // Shared by all requests
+        RateLimit global;
+
+        // One bucket per request type; indexed by RequestKind
+        std::array<RateLimit, sRequestKindCount> perKind;
+
+        // One bucket per NPC
+        RateLimit perNpc;
+
+        // Delayed requests that would wait longer than this are rejected instead
+        std::chrono::milliseconds maxDelay{ 5000 };
+    };
+
+    /**
+     * @brief Outcome of a rate limit check
+     */
+    enum class RateLimitAction
+    {
+        Admit,
+        Drop,
+        Reject
+    };
+
+    /**
+     * @brief Token buckets per NPC, per request type and global
+     *
+     * A request takes one token from each enabled bucket it belongs to. When
+     * a bucket is empty, its policy decides: Drop and Reject act at once,
+     * while Delay lets the bucket go into debt and tells the caller how long
+     * to hold the request, so requests delayed by one bucket do not overtake
+     * each other. Thread-safe.
+     */
+    class RateLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Admission
+        {
+            RateLimitAction action = RateLimitAction::Admit;
+
+            // Earliest time an admitted request may be sent
+            Clock::time_point notBefore;
+        };
+
+        /**
+         * @brief Constructor
+         *
+         * @param options Bucket settings
+         */
+        explicit RateLimiter(const RateLimitOptions& options = RateLimitOptions());
+
+        /**
+         * @brief Check a request against its buckets and take its tokens
+         *
+         * @param kind Request type
+         * @param npcId NPC the request is for
+         * @param now Current time
+         * @return Whether and when the request may be sent
+         */
+        Admission acquire(RequestKind kind, const std::string& npcId, Clock::time_point now);
+
+        /**
+         * @brief Get a snapshot of the counters and bucket levels
+         *
+         * @return Statistics
+         */
+        RateLimitStats getStats() const;
+
+    private:
+        struct Bucket
+        {
+            double tokens = 0.0;
+            Clock::time_point updated;
+        };
+
+        static void refill(Bucket& bucket, const RateLimit& limit, Clock::time_point now);
+        void sweepNpcBuckets(Clock::time_point now);
+
+        RateLimitOptions mOptions;
+        bool mEnabled;
+
+        mutable std::mutex mMutex;
+        Bucket mGlobal;
+        std::array<Bucket, sRequestKindCount> mKinds;
+        std::unordered_map<std::string, Bucket> mNpcs;
+
+        // NPC bucket count that triggers the next sweep of full buckets
+        std::size_t mSweepSize;
+
+        RateLimitStats mStats;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_RATELIMITER_H
@@ -0,0 +1,49 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_REQUEST_H
+#define OPENMW_COMPONENTS_AI_CLIENT_REQUEST_H
+
+#include <map>
+#include <optional>
+#include <string>
+
+#include "event.hpp"
+#include "gamestateprovider.hpp"
+#include "npcprofilecache.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Dialogue request as queued by the caller
+     *
+     * Requests are moved into the client's queue and serialized on the IO
+     * thread; the caller never builds JSON.
+     */
+    struct DialogueRequest
+    {
+        std::string npcId;
+
+        // Shared profile; queuing a request does not copy the NPC's details. Null sends them empty.
+        NpcProfilePtr npc;
+
+        std::string playerMessage;
+
+        // Shared snapshot; queuing a request does not copy the game state
+        GameStatePtr gameState;
+
+        // Entries that replace or extend the snapshot for this request
+        std::map<std::string, std::string> gameStateOverrides;
+    };
+
+    /**
+     * @brief Event request as queued by the caller
+     */
+    struct EventRequest
+    {
+        std::string npcId;
+        Event event;
+
+        // Set to send the event to a group of NPCs in one message, in place of npcId
+        std::optional<EventTarget> target;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_REQUEST_H
@@ -0,0 +1,338 @@
+#include "requestwriter.hpp"
+
+#include <charconv>
+
+namespace AI
+{
+    namespace
+    {
+        /**
+         * @brief Minimal streaming JSON object writer
+         */
+        class JsonWriter
+        {
+        public:
+            explicit JsonWriter(std::string& out)
+                : mOut(out)
+            {
+            }
+
+            void beginObject()
+            {
+                mOut += '{';
+                mFirst = true;
+            }
+
+            void endObject()
+            {
+                mOut += '}';
+                mFirst = false;
+            }
+
+            void key(std::string_view name)
+            {
+                if (!mFirst)
+                    mOut += ',';
+                mFirst = false;
+                writeString(name);
+                mOut += ':';
+            }
+
+            void beginObject(std::string_view name)
+            {
+                key(name);
+                beginObject();
+            }
+
+            void beginArray(std::string_view name)
+            {
+                key(name);
+                mOut += '[';
+                mFirst = true;
+            }
+
+            void endArray()
+            {
+                mOut += ']';
+                mFirst = false;
+            }
+
+            void element(std::string_view value)
+            {
+                if (!mFirst)
+                    mOut += ',';
+                mFirst = false;
+                writeString(value);
+            }
+
+            void field(std::string_view name, std::string_view value)
+            {
+                key(name);
+                writeString(value);
+            }
+
+            void field(std::string_view name, int value)
+            {
+                key(name);
+                char buffer[16];
+                auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                mOut.append(buffer, end);
+            }
+
+            void writeString(std::string_view value)
+            {
+                beginString();
+                appendString(value);
+                endString();
+            }
+
+            // A string value may be written in pieces between beginString() and endString()
+            void beginString() { mOut += '"'; }
+            void endString() { mOut += '"'; }
+
+            // Append string contents; escapes control characters and replaces invalid UTF-8 with U+FFFD
+            void appendString(std::string_view value)
+            {
+                static constexpr char hex[] = "0123456789abcdef";
+
+                std::size_t i = 0;
+                while (i < value.size())
+                {
+                    const auto c = static_cast<unsigned char>(value[i]);
+                    if (c < 0x80)
+                    {
+                        switch (c)
+                        {
+                            case '"': mOut += "\\\""; break;
+                            case '\\': mOut += "\\\\"; break;
+                            case '\b': mOut += "\\b"; break;
+                            case '\f': mOut += "\\f"; break;
+                            case '\n': mOut += "\\n"; break;
+                            case '\r': mOut += "\\r"; break;
+                            case '\t': mOut += "\\t"; break;
+                            default:
+                                if (c < 0x20)
+                                {
+                                    mOut += "\\u00";
+                                    mOut += hex[c >> 4];
+                                    mOut += hex[c & 0xf];
+                                }
+                                else
+                                    mOut += static_cast<char>(c);
+                                break;
+                        }
+                        ++i;
+                        continue;
+                    }
+
+                    const std::size_t length = utf8SequenceLength(value, i);
+                    if (length == 0)
+                    {
+                        mOut += "\xEF\xBF\xBD";
+                        ++i;
+                        continue;
+                    }
+                    mOut.append(value.data() + i, length);
+                    i += length;
+                }
+            }
+
+        private:
+            // Length of the valid UTF-8 sequence starting at offset, or 0 if invalid
+            static std::size_t utf8SequenceLength(std::string_view value, std::size_t offset)
+            {
+                const auto lead = static_cast<unsigned char>(value[offset]);
+                std::size_t length = 0;
+                unsigned char min = 0x80;
+                unsigned char max = 0xBF;
+                if (lead >= 0xC2 && lead <= 0xDF)
+                    length = 2;
+                else if (lead >= 0xE0 && lead <= 0xEF)
+                {
+                    length = 3;
+                    if (lead == 0xE0)
+                        min = 0xA0;
+                    else if (lead == 0xED)
+                        max = 0x9F;
+                }
+                else if (lead >= 0xF0 && lead <= 0xF4)
+                {
+                    length = 4;
+                    if (lead == 0xF0)
+                        min = 0x90;
+                    else if (lead == 0xF4)
+                        max = 0x8F;
+                }
+                else
+                    return 0;
+
+                if (offset + length > value.size())
+                    return 0;
+
+                // Only the first continuation byte has a restricted range
+                const auto second = static_cast<unsigned char>(value[offset + 1]);
+                if (second < min || second > max)
+                    return 0;
+                for (std::size_t i = 2; i < length; ++i)
+                {
+                    const auto next = static_cast<unsigned char>(value[offset + i]);
+                    if (next < 0x80 || next > 0xBF)
+                        return 0;
+                }
+                return length;
+            }
+
+            std::string& mOut;
+            bool mFirst = true;
+        };
+
+        void writeGameState(JsonWriter& writer, const GameState* gameState, const std::map<std::string, std::string>& overrides)
+        {
+            writer.beginObject("gameState");
+
+            if (gameState)
+            {
+                // Per-request entries win over the snapshot
+                auto snapshotField = [&](std::string_view name, std::string_view value) {
+                    if (overrides.find(std::string(name)) == overrides.end())
+                        writer.field(name, value);
+                };
+
+                char level[16];
+                auto [levelEnd, ec] = std::to_chars(level, level + sizeof(level), gameState->playerLevel);
+
+                snapshotField("player_name", gameState->playerName);
+                snapshotField("player_race", gameState->playerRace);
+                snapshotField("player_gender", gameState->playerGender);
+                snapshotField("player_class", gameState->playerClass);
+                snapshotField("player_level", std::string_view(level, levelEnd - level));
+                snapshotField("location", gameState->location);
+                snapshotField("time_of_day", gameState->timeOfDay);
+                snapshotField("weather", gameState->weather);
+
+                if (overrides.find("player_factions") == overrides.end())
+                {
+                    // "Faction:rank,Faction:rank"
+                    writer.key("player_factions");
+                    writer.beginString();
+                    bool first = true;
+                    for (const auto& [faction, rank] : gameState->playerFactions)
+                    {
+                        if (!first)
+                            writer.appendString(",");
+                        first = false;
+
+                        char rankText[16];
+                        auto [rankEnd, rankEc] = std::to_chars(rankText, rankText + sizeof(rankText), rank);
+                        writer.appendString(faction);
+                        writer.appendString(":");
+                        writer.appendString(std::string_view(rankText, rankEnd - rankText));
+                    }
+                    writer.endString();
+                }
+            }
+
+            for (const auto& [key, value] : overrides)
+                writer.field(key, value);
+
+            writer.endObject();
+        }
+    }
+
+    void writeDialogueRequest(std::string& out, std::string_view requestId, const DialogueRequest& request)
+    {
+        JsonWriter writer(out);
+        writer.beginObject();
+        writer.field("type", "dialogue");
+        writer.field("requestId", requestId);
+
+        static const NpcProfile unknown;
+        const NpcProfile& npc = request.npc ? *request.npc : unknown;
+        writer.beginObject("npc");
+        writer.field("id", request.npcId);
+        writer.field("name", npc.name);
+        writer.field("race", npc.race);
+        writer.field("gender", npc.gender);
+        writer.field("class", npc.npcClass);
+        writer.field("faction", npc.faction);
+        writer.endObject();
+
+        writer.field("playerMessage", request.playerMessage);
+        writeGameState(writer, request.gameState.get(), request.gameStateOverrides);
+        writer.endObject();
+    }
+
+    void writeEventRequest(std::string& out, std::string_view requestId, const EventRequest& request)
+    {
+        const Event& event = request.event;
+
+        JsonWriter writer(out);
+        writer.beginObject();
+        writer.field("type", "event");
+        writer.field("requestId", requestId);
+
+        // A broadcast names its group in place of the NPC: {"faction":"Fighters Guild"}
+        if (request.target)
+        {
+            const EventTarget& target = *request.target;
+            const std::string_view key = sEventTargetKindNames[static_cast<std::size_t>(target.kind)];
+            writer.beginObject("target");
+            if (target.kind == EventTargetKind::Npcs)
+            {
+                writer.beginArray(key);
+                for (const std::string& npcId : target.npcIds)
+                    writer.element(npcId);
+                writer.endArray();
+            }
+            else
+                writer.field(key, target.id);
+            writer.endObject();
+        }
+        else
+            writer.field("npcId", request.npcId);
+        writer.field("eventType", eventTypeToString(event.type));
+
+        // Only send the fields that are set
+        writer.beginObject("data");
+        if (!event.faction.empty())
+            writer.field("faction", event.faction);
+        if (!event.rank.empty())
+            writer.field("rank", event.rank);
+        if (!event.questId.empty())
+            writer.field("questId", event.questId);
+        if (!event.itemId.empty())
+            writer.field("itemId", event.itemId);
+        if (event.count != 0)
+            writer.field("count", event.count);
+        if (!event.actorId.empty())
+            writer.field("actorId", event.actorId);
+        writer.endObject();
+
+        writer.endObject();
+    }
+
+    BufferPool::BufferPool(std::size_t maxBuffers)
+        : mMaxBuffers(maxBuffers)
+    {
+    }
+
+    std::string BufferPool::acquire()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mBuffers.empty())
+            return std::string();
+
+        std::string buffer = std::move(mBuffers.back());
+        mBuffers.pop_back();
+        return buffer;
+    }
+
+    void BufferPool::release(std::string buffer)
+    {
+        buffer.clear();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mBuffers.size() < mMaxBuffers)
+            mBuffers.push_back(std::move(buffer));
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_REQUESTWRITER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_REQUESTWRITER_H
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "request.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Serialize a dialogue request
+     *
+     * Writes JSON directly into the output buffer without building a DOM.
+     *
+     * @param out Buffer to append to
+     * @param requestId Request ID
+     * @param request Dialogue request
+     */
+    void writeDialogueRequest(std::string& out, std::string_view requestId, const DialogueRequest& request);
+
+    /**
+     * @brief Serialize an event request
+     *
+     * @param out Buffer to append to
+     * @param requestId Request ID
+     * @param request Event request
+     */
+    void writeEventRequest(std::string& out, std::string_view requestId, const EventRequest& request);
+
+    /**
+     * @brief Pool of reusable message buffers
+     *
+     * Buffers keep their capacity between messages, so serializing a request
+     * on the IO thread does not allocate once the pool is warm.
+     */
+    class BufferPool
+    {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param maxBuffers Maximum number of idle buffers kept
+         */
+        explicit BufferPool(std::size_t maxBuffers = 8);
+
+        /**
+         * @brief Take an empty buffer from the pool
+         *
+         * @return Buffer, possibly with capacity left over from an earlier message
+         */
+        std::string acquire();
+
+        /**
+         * @brief Return a buffer to the pool
+         *
+         * @param buffer Buffer to recycle
+         */
+        void release(std::string buffer);
+
+    private:
+        std::mutex mMutex;
+        std::vector<std::string> mBuffers;
+        std::size_t mMaxBuffers;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_REQUESTWRITER_H
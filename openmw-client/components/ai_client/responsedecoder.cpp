@@ -0,0 +1,827 @@
+#include "responsedecoder.hpp"
+
+#include <charconv>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <optional>
+
+#include <nlohmann/json.hpp>
+
+namespace AI
+{
+    using json = nlohmann::json;
+
+    namespace
+    {
+        // Dialogue results per decoder; more outstanding replies than this get fresh ones
+        constexpr std::size_t sPooledResults = 16;
+
+        ResponseKind responseKindFromType(std::string_view type)
+        {
+            if (type == "dialogue")
+                return ResponseKind::Dialogue;
+            if (type == "event_ack")
+                return ResponseKind::EventAck;
+            if (type == "error")
+                return ResponseKind::Error;
+            return ResponseKind::Unknown;
+        }
+
+        std::int32_t clampToInt32(std::int64_t value)
+        {
+            if (value > std::numeric_limits<std::int32_t>::max())
+                return std::numeric_limits<std::int32_t>::max();
+            if (value < std::numeric_limits<std::int32_t>::min())
+                return std::numeric_limits<std::int32_t>::min();
+            return static_cast<std::int32_t>(value);
+        }
+
+        Action parseAction(const json& actionJson)
+        {
+            Action action;
+            action.type = actionTypeFromString(actionJson.at("type").get_ref<const std::string&>());
+
+            // Extract parameters
+            auto paramsIt = actionJson.find("params");
+            if (paramsIt != actionJson.end() && paramsIt->is_object())
+            {
+                for (const auto& [key, value] : paramsIt->items())
+                {
+                    // Same values as the SAX handler: nulls, objects and arrays are skipped, booleans are 0 or 1
+                    if (value.is_null() || value.is_structured())
+                        continue;
+
+                    std::optional<ActionParams::Key> knownKey = ActionParams::keyFromString(key);
+                    if (!knownKey)
+                    {
+                        if (value.is_string())
+                            action.params.setExtra(key, value.get<std::string>());
+                        else
+                            action.params.setExtra(key, value.dump());
+                    }
+                    else if (value.is_number_unsigned())
+                    {
+                        constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max());
+                        const std::uint64_t number = value.get<std::uint64_t>();
+                        action.params.set(*knownKey, static_cast<std::int32_t>(number > max ? max : number));
+                    }
+                    else if (value.is_number_integer())
+                        action.params.set(*knownKey, clampToInt32(value.get<std::int64_t>()));
+                    else if (value.is_number_float())
+                        action.params.set(*knownKey, value.get<float>());
+                    else if (value.is_boolean())
+                        action.params.set(*knownKey, static_cast<std::int32_t>(value.get<bool>()));
+                    else
+                        action.params.set(*knownKey, ActionParams::parseValue(*knownKey, value.get_ref<const std::string&>()));
+                }
+            }
+
+            return action;
+        }
+
+        /**
+         * @brief SAX handler for the known response schema
+         *
+         * Follows the top-level object, the "actions" array, each action object
+         * and its "params" object; everything else is skipped.
+         */
+        class ResponseSaxHandler
+        {
+        public:
+            ResponseSaxHandler(DecodedResponse& result, std::string& extraKey, SharedPool<DialogueResult>& results)
+                : mResult(result)
+                , mExtraKey(extraKey)
+                , mResults(results)
+            {
+            }
+
+            void null() {}
+
+            void boolean(bool value)
+            {
+                if (mSkipDepth == 0 && mDepth == ParamsDepth)
+                    setParam(static_cast<std::int32_t>(value), value ? "true" : "false");
+            }
+
+            void number_integer(std::int64_t value, std::string_view text)
+            {
+                if (mSkipDepth == 0 && mDepth == ParamsDepth)
+                    setParam(clampToInt32(value), text);
+            }
+
+            void number_unsigned(std::uint64_t value, std::string_view text)
+            {
+                if (mSkipDepth == 0 && mDepth == ParamsDepth)
+                {
+                    constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max());
+                    setParam(static_cast<std::int32_t>(value > max ? max : value), text);
+                }
+            }
+
+            void number_float(double value, std::string_view text)
+            {
+                if (mSkipDepth == 0 && mDepth == ParamsDepth)
+                    setParam(static_cast<float>(value), text);
+            }
+
+            // Strings are assigned rather than moved, so the targets keep their storage
+            void string(std::string_view value)
+            {
+                if (mSkipDepth > 0)
+                    return;
+
+                if (mDepth == TopDepth)
+                {
+                    switch (mTopField)
+                    {
+                        case TopField::Type:
+                            mResult.kind = responseKindFromType(value);
+                            break;
+                        case TopField::RequestId:
+                            mResult.requestId.assign(value);
+                            break;
+                        case TopField::Text:
+                            dialogue().text.assign(value);
+                            break;
+                        case TopField::Error:
+                            mResult.error.assign(value);
+                            mHasError = true;
+                            break;
+                        case TopField::Status:
+                            mResult.success = value == "success";
+                            break;
+                        case TopField::VoiceFormat:
+                            mResult.voiceFormat.assign(value);
+                            break;
+                        case TopField::VoiceId:
+                            mResult.voiceId.assign(value);
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                else if (mDepth == ActionDepth && mActionField == ActionField::Type)
+                    dialogue().actions.back().type = actionTypeFromString(value);
+                else if (mDepth == ParamsDepth)
+                {
+                    ActionParams& params = dialogue().actions.back().params;
+                    if (mParamKey)
+                        params.set(*mParamKey, ActionParams::parseValue(*mParamKey, value));
+                    else
+                        params.setExtra(mExtraKey, std::string(value));
+                }
+            }
+
+            void start_object()
+            {
+                if (mSkipDepth > 0)
+                    ++mSkipDepth;
+                else if (mDepth == 0)
+                    mDepth = TopDepth;
+                else if (mDepth == ActionsDepth)
+                {
+                    dialogue().actions.emplace_back();
+                    mActionField = ActionField::None;
+                    mDepth = ActionDepth;
+                }
+                else if (mDepth == ActionDepth && mActionField == ActionField::Params)
+                    mDepth = ParamsDepth;
+                else
+                    mSkipDepth = 1;
+            }
+
+            void end_object()
+            {
+                if (mSkipDepth > 0)
+                    --mSkipDepth;
+                else if (mDepth == ParamsDepth)
+                    mDepth = ActionDepth;
+                else if (mDepth == ActionDepth)
+                    mDepth = ActionsDepth;
+                else
+                    mDepth = 0;
+            }
+
+            void start_array()
+            {
+                if (mSkipDepth > 0)
+                    ++mSkipDepth;
+                else if (mDepth == TopDepth && mTopField == TopField::Actions)
+                    mDepth = ActionsDepth;
+                else
+                    mSkipDepth = 1;
+            }
+
+            void end_array()
+            {
+                if (mSkipDepth > 0)
+                    --mSkipDepth;
+                else
+                    mDepth = TopDepth;
+            }
+
+            void key(std::string_view key)
+            {
+                if (mSkipDepth > 0)
+                    return;
+
+                if (mDepth == TopDepth)
+                    mTopField = topFieldFromKey(key);
+                else if (mDepth == ActionDepth)
+                {
+                    if (key == "type")
+                        mActionField = ActionField::Type;
+                    else if (key == "params")
+                        mActionField = ActionField::Params;
+                    else
+                        mActionField = ActionField::None;
+                }
+                else if (mDepth == ParamsDepth)
+                {
+                    mParamKey = ActionParams::keyFromString(key);
+                    if (!mParamKey)
+                        mExtraKey.assign(key);
+                }
+            }
+
+            void parse_error(std::size_t position, std::string_view message)
+            {
+                std::cerr << "Error parsing AI server response: " << message << " at byte " << position << std::endl;
+            }
+
+            void finish()
+            {
+                // An "error" field makes any response an error, as with the DOM decoder
+                if (mHasError && mResult.kind != ResponseKind::Unknown)
+                    mResult.kind = ResponseKind::Error;
+            }
+
+        private:
+            enum class TopField
+            {
+                None,
+                Type,
+                RequestId,
+                Text,
+                Error,
+                Status,
+                Actions,
+                VoiceFormat,
+                VoiceId
+            };
+
+            enum class ActionField
+            {
+                None,
+                Type,
+                Params
+            };
+
+            // Nesting levels the handler follows
+            static constexpr std::size_t TopDepth = 1;
+            static constexpr std::size_t ActionsDepth = 2;
+            static constexpr std::size_t ActionDepth = 3;
+            static constexpr std::size_t ParamsDepth = 4;
+
+            static TopField topFieldFromKey(std::string_view key)
+            {
+                if (key == "type")
+                    return TopField::Type;
+                if (key == "requestId")
+                    return TopField::RequestId;
+                if (key == "text")
+                    return TopField::Text;
+                if (key == "error")
+                    return TopField::Error;
+                if (key == "status")
+                    return TopField::Status;
+                if (key == "actions")
+                    return TopField::Actions;
+                if (key == "voiceFormat")
+                    return TopField::VoiceFormat;
+                if (key == "voiceId")
+                    return TopField::VoiceId;
+                return TopField::None;
+            }
+
+            DialogueResult& dialogue()
+            {
+                if (!mResult.dialogue)
+                {
+                    // A pooled result still holds its last reply; clearing keeps the buffers
+                    mResult.dialogue = mResults.acquire();
+                    DialogueResult& result = *mResult.dialogue;
+                    result.text.clear();
+                    result.actions.clear();
+                    result.error = false;
+                    result.dropped = false;
+                    result.topics.clear();
+                    result.topicMatcher.reset();
+                    result.voice.reset();
+                    result.voiceClip.reset();
+                }
+                return *mResult.dialogue;
+            }
+
+            void setParam(ParamValue value, std::string_view text)
+            {
+                ActionParams& params = dialogue().actions.back().params;
+                if (mParamKey)
+                    params.set(*mParamKey, std::move(value));
+                else
+                    params.setExtra(mExtraKey, std::string(text));
+            }
+
+            DecodedResponse& mResult;
+            std::string& mExtraKey;
+            SharedPool<DialogueResult>& mResults;
+
+            std::size_t mDepth = 0;
+            std::size_t mSkipDepth = 0;
+            TopField mTopField = TopField::None;
+            ActionField mActionField = ActionField::None;
+            std::optional<ActionParams::Key> mParamKey;
+            bool mHasError = false;
+        };
+
+        /**
+         * @brief JSON reader that drives a SAX handler
+         *
+         * json::sax_parse builds a lexer with fresh token buffers for every
+         * message. This reader hands out views into the message instead, and
+         * only copies strings with escape sequences, into a scratch buffer
+         * that outlives the message.
+         */
+        template <class Handler>
+        class JsonReader
+        {
+        public:
+            JsonReader(std::string_view input, std::string& scratch, Handler& handler)
+                : mInput(input)
+                , mScratch(scratch)
+                , mHandler(handler)
+            {
+            }
+
+            /**
+             * @brief Read the whole input as one JSON value
+             *
+             * @return true if the input was valid JSON, false otherwise
+             */
+            bool read()
+            {
+                if (!readValue(0))
+                    return false;
+                skipWhitespace();
+                return mPosition == mInput.size() || fail("unexpected trailing characters");
+            }
+
+        private:
+            // Deeper documents are rejected rather than risking the stack
+            static constexpr std::size_t sMaxDepth = 64;
+
+            bool fail(std::string_view message)
+            {
+                mHandler.parse_error(mPosition, message);
+                return false;
+            }
+
+            void skipWhitespace()
+            {
+                while (mPosition < mInput.size())
+                {
+                    const char c = mInput[mPosition];
+                    if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                        break;
+                    ++mPosition;
+                }
+            }
+
+            bool consume(char expected)
+            {
+                skipWhitespace();
+                if (mPosition < mInput.size() && mInput[mPosition] == expected)
+                {
+                    ++mPosition;
+                    return true;
+                }
+                return false;
+            }
+
+            bool readValue(std::size_t depth)
+            {
+                skipWhitespace();
+                if (mPosition == mInput.size())
+                    return fail("unexpected end of input");
+
+                switch (mInput[mPosition])
+                {
+                    case '{':
+                        return readObject(depth + 1);
+                    case '[':
+                        return readArray(depth + 1);
+                    case '"':
+                    {
+                        std::string_view value;
+                        if (!readString(value))
+                            return false;
+                        mHandler.string(value);
+                        return true;
+                    }
+                    case 't':
+                        return readLiteral("true", [&] { mHandler.boolean(true); });
+                    case 'f':
+                        return readLiteral("false", [&] { mHandler.boolean(false); });
+                    case 'n':
+                        return readLiteral("null", [&] { mHandler.null(); });
+                    default:
+                        return readNumber();
+                }
+            }
+
+            bool readObject(std::size_t depth)
+            {
+                if (depth > sMaxDepth)
+                    return fail("too deeply nested");
+
+                ++mPosition;
+                mHandler.start_object();
+                if (consume('}'))
+                {
+                    mHandler.end_object();
+                    return true;
+                }
+
+                do
+                {
+                    skipWhitespace();
+                    std::string_view key;
+                    if (mPosition == mInput.size() || mInput[mPosition] != '"')
+                        return fail("expected object key");
+                    if (!readString(key))
+                        return false;
+                    mHandler.key(key);
+
+                    if (!consume(':'))
+                        return fail("expected ':'");
+                    if (!readValue(depth))
+                        return false;
+                } while (consume(','));
+
+                if (!consume('}'))
+                    return fail("expected ',' or '}'");
+                mHandler.end_object();
+                return true;
+            }
+
+            bool readArray(std::size_t depth)
+            {
+                if (depth > sMaxDepth)
+                    return fail("too deeply nested");
+
+                ++mPosition;
+                mHandler.start_array();
+                if (consume(']'))
+                {
+                    mHandler.end_array();
+                    return true;
+                }
+
+                do
+                {
+                    if (!readValue(depth))
+                        return false;
+                } while (consume(','));
+
+                if (!consume(']'))
+                    return fail("expected ',' or ']'");
+                mHandler.end_array();
+                return true;
+            }
+
+            template <class Emit>
+            bool readLiteral(std::string_view literal, Emit emit)
+            {
+                if (mInput.substr(mPosition, literal.size()) != literal)
+                    return fail("invalid literal");
+                mPosition += literal.size();
+                emit();
+                return true;
+            }
+
+            // Reads the string at the opening quote; the view is valid until the next string is read
+            bool readString(std::string_view& value)
+            {
+                const std::size_t start = ++mPosition;
+                while (mPosition < mInput.size())
+                {
+                    const char c = mInput[mPosition];
+                    if (c == '"')
+                    {
+                        value = mInput.substr(start, mPosition - start);
+                        ++mPosition;
+                        return true;
+                    }
+                    if (c == '\\')
+                    {
+                        mScratch.assign(mInput.substr(start, mPosition - start));
+                        return readEscapedString(value);
+                    }
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        return fail("control character in string");
+                    ++mPosition;
+                }
+                return fail("unterminated string");
+            }
+
+            bool readEscapedString(std::string_view& value)
+            {
+                while (mPosition < mInput.size())
+                {
+                    const char c = mInput[mPosition++];
+                    if (c == '"')
+                    {
+                        value = mScratch;
+                        return true;
+                    }
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        return fail("control character in string");
+                    if (c != '\\')
+                    {
+                        mScratch += c;
+                        continue;
+                    }
+
+                    if (mPosition == mInput.size())
+                        break;
+                    switch (mInput[mPosition++])
+                    {
+                        case '"': mScratch += '"'; break;
+                        case '\\': mScratch += '\\'; break;
+                        case '/': mScratch += '/'; break;
+                        case 'b': mScratch += '\b'; break;
+                        case 'f': mScratch += '\f'; break;
+                        case 'n': mScratch += '\n'; break;
+                        case 'r': mScratch += '\r'; break;
+                        case 't': mScratch += '\t'; break;
+                        case 'u':
+                            if (!readCodePoint())
+                                return false;
+                            break;
+                        default:
+                            return fail("invalid escape sequence");
+                    }
+                }
+                return fail("unterminated string");
+            }
+
+            bool readHex(std::uint32_t& value)
+            {
+                if (mInput.size() - mPosition < 4)
+                    return fail("invalid \\u escape");
+
+                value = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    const char c = mInput[mPosition++];
+                    value <<= 4;
+                    if (c >= '0' && c <= '9')
+                        value |= c - '0';
+                    else if (c >= 'a' && c <= 'f')
+                        value |= c - 'a' + 10;
+                    else if (c >= 'A' && c <= 'F')
+                        value |= c - 'A' + 10;
+                    else
+                        return fail("invalid \\u escape");
+                }
+                return true;
+            }
+
+            // Decodes the digits after "\u", and a low surrogate after a high one, into UTF-8
+            bool readCodePoint()
+            {
+                std::uint32_t codePoint = 0;
+                if (!readHex(codePoint))
+                    return false;
+
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+                {
+                    std::uint32_t low = 0;
+                    if (mInput.substr(mPosition, 2) != "\\u")
+                        return fail("unpaired surrogate");
+                    mPosition += 2;
+                    if (!readHex(low))
+                        return false;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return fail("unpaired surrogate");
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+                    return fail("unpaired surrogate");
+
+                if (codePoint < 0x80)
+                    mScratch += static_cast<char>(codePoint);
+                else if (codePoint < 0x800)
+                {
+                    mScratch += static_cast<char>(0xC0 | (codePoint >> 6));
+                    mScratch += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                else if (codePoint < 0x10000)
+                {
+                    mScratch += static_cast<char>(0xE0 | (codePoint >> 12));
+                    mScratch += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    mScratch += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                else
+                {
+                    mScratch += static_cast<char>(0xF0 | (codePoint >> 18));
+                    mScratch += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                    mScratch += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    mScratch += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                return true;
+            }
+
+            std::size_t skipDigits()
+            {
+                const std::size_t start = mPosition;
+                while (mPosition < mInput.size() && mInput[mPosition] >= '0' && mInput[mPosition] <= '9')
+                    ++mPosition;
+                return mPosition - start;
+            }
+
+            bool readNumber()
+            {
+                // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+                const std::size_t start = mPosition;
+                const bool negative = mInput[mPosition] == '-';
+                if (negative)
+                    ++mPosition;
+
+                const std::size_t integerStart = mPosition;
+                const std::size_t integerDigits = skipDigits();
+                if (integerDigits == 0 || (integerDigits > 1 && mInput[integerStart] == '0'))
+                    return fail("invalid number");
+
+                bool isFloat = false;
+                if (mPosition < mInput.size() && mInput[mPosition] == '.')
+                {
+                    ++mPosition;
+                    if (skipDigits() == 0)
+                        return fail("invalid number");
+                    isFloat = true;
+                }
+                if (mPosition < mInput.size() && (mInput[mPosition] == 'e' || mInput[mPosition] == 'E'))
+                {
+                    ++mPosition;
+                    if (mPosition < mInput.size() && (mInput[mPosition] == '+' || mInput[mPosition] == '-'))
+                        ++mPosition;
+                    if (skipDigits() == 0)
+                        return fail("invalid number");
+                    isFloat = true;
+                }
+
+                const std::string_view text = mInput.substr(start, mPosition - start);
+                const char* const first = text.data();
+                const char* const last = first + text.size();
+                if (!isFloat)
+                {
+                    // Integers out of range are read as floats, as nlohmann::json does
+                    if (negative)
+                    {
+                        std::int64_t value = 0;
+                        if (std::from_chars(first, last, value).ec == std::errc())
+                        {
+                            mHandler.number_integer(value, text);
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        std::uint64_t value = 0;
+                        if (std::from_chars(first, last, value).ec == std::errc())
+                        {
+                            mHandler.number_unsigned(value, text);
+                            return true;
+                        }
+                    }
+                }
+
+                mHandler.number_float(parseFloat(text), text);
+                return true;
+            }
+
+            // strtod reads the decimal point of the C locale, which the game may have changed
+            static double parseFloat(std::string_view text)
+            {
+                char buffer[64];
+                if (text.size() >= sizeof(buffer))
+                    return std::strtod(std::string(text).c_str(), nullptr);
+
+                const char decimalPoint = *std::localeconv()->decimal_point;
+                for (std::size_t i = 0; i < text.size(); ++i)
+                    buffer[i] = text[i] == '.' ? decimalPoint : text[i];
+                buffer[text.size()] = '\0';
+                return std::strtod(buffer, nullptr);
+            }
+
+            std::string_view mInput;
+            std::size_t mPosition = 0;
+            std::string& mScratch;
+            Handler& mHandler;
+        };
+    }
+
+    ResponseDecoder::ResponseDecoder()
+        : mResults(sPooledResults)
+    {
+    }
+
+    bool ResponseDecoder::decode(std::string_view message, DecodedResponse& result)
+    {
+        ResponseSaxHandler handler(result, mExtraKey, mResults);
+        if (!JsonReader<ResponseSaxHandler>(message, mScratch, handler).read())
+            return false;
+
+        handler.finish();
+        return true;
+    }
+
+    bool ResponseDecoder::decodeDom(std::string_view message, DecodedResponse& result)
+    {
+        try
+        {
+            json responseJson = json::parse(message);
+            if (!responseJson.is_object())
+                return false;
+
+            auto typeIt = responseJson.find("type");
+            if (typeIt != responseJson.end() && typeIt->is_string())
+                result.kind = responseKindFromType(typeIt->get_ref<const std::string&>());
+
+            // Unknown message types are classified by their fields
+            if (result.kind == ResponseKind::Unknown)
+            {
+                if (responseJson.contains("text"))
+                    result.kind = ResponseKind::Dialogue;
+                else if (responseJson.contains("status"))
+                    result.kind = ResponseKind::EventAck;
+            }
+
+            auto requestIdIt = responseJson.find("requestId");
+            if (requestIdIt != responseJson.end() && requestIdIt->is_string())
+                result.requestId = requestIdIt->get<std::string>();
+
+            // Check for error
+            auto errorIt = responseJson.find("error");
+            if (errorIt != responseJson.end())
+            {
+                result.kind = ResponseKind::Error;
+                result.error = errorIt->is_string() ? errorIt->get<std::string>() : errorIt->dump();
+                return true;
+            }
+
+            if (result.kind == ResponseKind::EventAck)
+            {
+                auto statusIt = responseJson.find("status");
+                result.success = statusIt != responseJson.end() && *statusIt == "success";
+            }
+            else if (result.kind == ResponseKind::Dialogue)
+            {
+                // Extract text and actions
+                result.dialogue = std::make_shared<DialogueResult>();
+                auto textIt = responseJson.find("text");
+                if (textIt != responseJson.end() && textIt->is_string())
+                    result.dialogue->text = textIt->get<std::string>();
+
+                auto voiceFormatIt = responseJson.find("voiceFormat");
+                if (voiceFormatIt != responseJson.end() && voiceFormatIt->is_string())
+                    result.voiceFormat = voiceFormatIt->get<std::string>();
+
+                auto voiceIdIt = responseJson.find("voiceId");
+                if (voiceIdIt != responseJson.end() && voiceIdIt->is_string())
+                    result.voiceId = voiceIdIt->get<std::string>();
+
+                auto actionsIt = responseJson.find("actions");
+                if (actionsIt != responseJson.end() && actionsIt->is_array())
+                {
+                    result.dialogue->actions.reserve(actionsIt->size());
+                    for (const auto& actionJson : *actionsIt)
+                    {
+                        result.dialogue->actions.push_back(parseAction(actionJson));
+                    }
+                }
+            }
+
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error parsing AI server response: " << e.what() << std::endl;
+            return false;
+        }
+    }
+}
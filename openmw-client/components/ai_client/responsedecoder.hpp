@@ -0,0 +1,101 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_RESPONSEDECODER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_RESPONSEDECODER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "dialogueresult.hpp"
+#include "pool.hpp"
+
+namespace AI
+{
+    /**
+     * @brief Kind of message received from the server
+     */
+    enum class ResponseKind
+    {
+        Unknown,
+        Dialogue,
+        EventAck,
+        Error
+    };
+
+    /**
+     * @brief Server message decoded into typed fields
+     */
+    struct DecodedResponse
+    {
+        ResponseKind kind = ResponseKind::Unknown;
+        std::string requestId;
+
+        // Set for dialogue responses
+        std::shared_ptr<DialogueResult> dialogue;
+
+        // Encoding of the voice audio that follows a dialogue response in binary frames; empty for none
+        std::string voiceFormat;
+
+        // Voice the audio is spoken with, which keys the clip cache together with the text
+        std::string voiceId;
+
+        // Set for event acknowledgements
+        bool success = false;
+
+        // Set for error responses
+        std::string error;
+    };
+
+    /**
+     * @brief Decoder for server messages
+     *
+     * The known response schema (dialogue, event_ack, error) is decoded with a
+     * streaming SAX handler that writes straight into the result structs
+     * without building a JSON DOM. Messages of any other type are left to
+     * decodeDom().
+     *
+     * Each connection owns one decoder and only uses it from its reader
+     * thread. Scratch buffers are kept between frames and dialogue results
+     * come from a pool, so decoding a warmed-up reply does not allocate
+     * unless it carries unknown action parameters.
+     */
+    class ResponseDecoder
+    {
+    public:
+        /**
+         * @brief Constructor
+         */
+        ResponseDecoder();
+
+        /**
+         * @brief Decode a message with the streaming decoder
+         *
+         * @param message Message as received from the server
+         * @param result Decoded message; kind is ResponseKind::Unknown for message types the decoder does not know
+         * @return true if the message was valid JSON, false otherwise
+         */
+        bool decode(std::string_view message, DecodedResponse& result);
+
+        /**
+         * @brief Decode a message through the JSON DOM
+         *
+         * Used for unknown message types and as the reference for benchmarks.
+         *
+         * @param message Message as received from the server
+         * @param result Decoded message
+         * @return true if the message was valid JSON, false otherwise
+         */
+        static bool decodeDom(std::string_view message, DecodedResponse& result);
+
+    private:
+        // Key of an unknown action parameter while its value is being read
+        std::string mExtraKey;
+
+        // Strings with escape sequences, unescaped
+        std::string mScratch;
+
+        // Results handed to callbacks, reused once the game dropped them
+        SharedPool<DialogueResult> mResults;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_RESPONSEDECODER_H
@@ -0,0 +1,118 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace AI
+{
+    std::size_t LatencyHistogram::bucketIndex(std::uint64_t value)
+    {
+        constexpr std::uint64_t maxValue = (std::uint64_t(1) << sMaxValueBits) - 1;
+        if (value > maxValue)
+            value = maxValue;
+
+        if (value < sSubBucketCount)
+            return static_cast<std::size_t>(value);
+
+        // Position of the highest set bit selects the power of two, the next bits the sub-bucket
+        unsigned highestBit = sSubBucketBits;
+        while ((value >> (highestBit + 1)) != 0)
+            ++highestBit;
+
+        const unsigned shift = highestBit - sSubBucketBits;
+        return (shift + 1) * sSubBucketCount + static_cast<std::size_t>((value >> shift) - sSubBucketCount);
+    }
+
+    std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index)
+    {
+        if (index < sSubBucketCount)
+            return index;
+
+        const std::size_t shift = index / sSubBucketCount - 1;
+        const std::uint64_t subBucket = index % sSubBucketCount + sSubBucketCount;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+    void LatencyHistogram::record(std::uint64_t micros)
+    {
+        mBuckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        mCount.fetch_add(1, std::memory_order_relaxed);
+        mSum.fetch_add(micros, std::memory_order_relaxed);
+
+        std::uint64_t max = mMax.load(std::memory_order_relaxed);
+        while (micros > max && !mMax.compare_exchange_weak(max, micros, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    LatencySummary LatencyHistogram::summarize() const
+    {
+        // Copy the buckets first; the total is taken from the copy so percentiles stay consistent
+        std::array<std::uint64_t, sBucketCount> buckets;
+        std::uint64_t count = 0;
+        for (std::size_t i = 0; i < sBucketCount; ++i)
+        {
+            buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+            count += buckets[i];
+        }
+
+        LatencySummary summary;
+        summary.count = count;
+        if (count == 0)
+            return summary;
+
+        const std::uint64_t recorded = mCount.load(std::memory_order_relaxed);
+        summary.mean = recorded > 0 ? static_cast<double>(mSum.load(std::memory_order_relaxed)) / recorded : 0.0;
+        summary.max = mMax.load(std::memory_order_relaxed);
+
+        auto percentile = [&](double fraction) {
+            const auto target = static_cast<std::uint64_t>(std::ceil(fraction * count));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < sBucketCount; ++i)
+            {
+                seen += buckets[i];
+                if (seen >= target)
+                    return std::min(bucketUpperBound(i), summary.max);
+            }
+            return summary.max;
+        };
+
+        summary.p50 = percentile(0.50);
+        summary.p90 = percentile(0.90);
+        summary.p99 = percentile(0.99);
+        return summary;
+    }
+
+    void StatsRecorder::recordLatency(RequestKind kind, LatencyStage stage, Clock::time_point start, Clock::time_point end)
+    {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        mLatency[static_cast<std::size_t>(kind)][static_cast<std::size_t>(stage)].record(
+            micros > 0 ? static_cast<std::uint64_t>(micros) : 0);
+    }
+
+    ClientStats StatsRecorder::snapshot() const
+    {
+        ClientStats stats;
+        stats.queueDepth = mQueueDepth.load(std::memory_order_relaxed);
+        stats.inFlight = mInFlight.load(std::memory_order_relaxed);
+        stats.requestsSent = mRequestsSent.load(std::memory_order_relaxed);
+        stats.responsesReceived = mResponsesReceived.load(std::memory_order_relaxed);
+        stats.bytesOut = mBytesOut.load(std::memory_order_relaxed);
+        stats.bytesIn = mBytesIn.load(std::memory_order_relaxed);
+        stats.errors = mErrors.load(std::memory_order_relaxed);
+        stats.reconnects = mReconnects.load(std::memory_order_relaxed);
+        stats.voice.streams = mVoiceStreams.load(std::memory_order_relaxed);
+        stats.voice.bytes = mVoiceBytes.load(std::memory_order_relaxed);
+        stats.voice.truncated = mVoiceTruncated.load(std::memory_order_relaxed);
+        stats.items.checked = mItemsChecked.load(std::memory_order_relaxed);
+        stats.items.repaired = mItemsRepaired.load(std::memory_order_relaxed);
+        stats.items.rejected = mItemsRejected.load(std::memory_order_relaxed);
+
+        for (std::size_t kind = 0; kind < sRequestKindCount; ++kind)
+        {
+            for (std::size_t stage = 0; stage < sLatencyStageCount; ++stage)
+                stats.latency[kind][stage] = mLatency[kind][stage].summarize();
+        }
+        return stats;
+    }
+}
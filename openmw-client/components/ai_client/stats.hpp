@@ -0,0 +1,322 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_STATS_H
+#define OPENMW_COMPONENTS_AI_CLIENT_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AI
+{
+    /**
+     * @brief Request types tracked separately in the statistics
+     */
+    enum class RequestKind
+    {
+        Dialogue,
+        Event
+    };
+
+    inline constexpr std::size_t sRequestKindCount = 2;
+
+    /**
+     * @brief Intervals of a request's life that are measured
+     *
+     * Queue: submit to dequeue on the writer thread
+     * Send: dequeue to socket write finished, including serialization
+     * Server: socket write to response received
+     * Callback: response received to callback finished
+     * Total: submit to callback finished
+     */
+    enum class LatencyStage
+    {
+        Queue,
+        Send,
+        Server,
+        Callback,
+        Total
+    };
+
+    inline constexpr std::size_t sLatencyStageCount = 5;
+
+    inline constexpr std::array<std::string_view, sRequestKindCount> sRequestKindNames = { "dialogue", "event" };
+    inline constexpr std::array<std::string_view, sLatencyStageCount> sLatencyStageNames
+        = { "queue", "send", "server", "callback", "total" };
+
+    /**
+     * @brief Summary of a latency histogram, in microseconds
+     */
+    struct LatencySummary
+    {
+        std::uint64_t count = 0;
+        double mean = 0.0;
+        std::uint64_t p50 = 0;
+        std::uint64_t p90 = 0;
+        std::uint64_t p99 = 0;
+        std::uint64_t max = 0;
+    };
+
+    /**
+     * @brief Lock-free latency histogram
+     *
+     * Log-linear buckets in the style of HdrHistogram: each power of two is
+     * split into 16 linear sub-buckets, so a recorded value is reported with
+     * at most ~6% error. Values are microseconds, capped at about 71 minutes.
+     * Recording is a few relaxed atomic increments and may happen from any
+     * thread.
+     */
+    class LatencyHistogram
+    {
+    public:
+        /**
+         * @brief Record a value
+         *
+         * @param micros Value in microseconds
+         */
+        void record(std::uint64_t micros);
+
+        /**
+         * @brief Summarize the recorded values
+         *
+         * @return Count, mean, percentiles and maximum
+         */
+        LatencySummary summarize() const;
+
+    private:
+        static constexpr unsigned sSubBucketBits = 4;
+        static constexpr std::size_t sSubBucketCount = std::size_t(1) << sSubBucketBits;
+        static constexpr unsigned sMaxValueBits = 32;
+        static constexpr std::size_t sBucketCount = (sMaxValueBits - sSubBucketBits + 1) * sSubBucketCount;
+
+        static std::size_t bucketIndex(std::uint64_t value);
+        static std::uint64_t bucketUpperBound(std::size_t index);
+
+        std::array<std::atomic<std::uint64_t>, sBucketCount> mBuckets{};
+        std::atomic<std::uint64_t> mCount{ 0 };
+        std::atomic<std::uint64_t> mSum{ 0 };
+        std::atomic<std::uint64_t> mMax{ 0 };
+    };
+
+    /**
+     * @brief Token buckets a request is checked against
+     */
+    enum class RateLimitScope
+    {
+        Global,
+        Kind,
+        Npc
+    };
+
+    inline constexpr std::size_t sRateLimitScopeCount = 3;
+
+    inline constexpr std::array<std::string_view, sRateLimitScopeCount> sRateLimitScopeNames
+        = { "global", "kind", "npc" };
+
+    /**
+     * @brief Snapshot of the rate limiter state
+     */
+    struct RateLimitStats
+    {
+        // Requests sent at once, held back until tokens were available, dropped and rejected
+        std::uint64_t admitted = 0;
+        std::uint64_t delayed = 0;
+        std::uint64_t dropped = 0;
+        std::uint64_t rejected = 0;
+
+        // Requests delayed, dropped or rejected, by the bucket that ran out; indexed by RateLimitScope
+        std::array<std::uint64_t, sRateLimitScopeCount> limitedBy{};
+
+        // Tokens left, negative while delayed requests are owed tokens; 0 for disabled buckets
+        double globalTokens = 0.0;
+        std::array<double, sRequestKindCount> kindTokens{};
+        std::size_t npcBuckets = 0;
+    };
+
+    /**
+     * @brief Snapshot of the hedged request counters
+     */
+    struct HedgeStats
+    {
+        // Duplicates sent to the secondary endpoint
+        std::uint64_t fired = 0;
+
+        // Hedged requests answered first by the secondary endpoint
+        std::uint64_t won = 0;
+
+        // Requests due for a hedge that the budget held back
+        std::uint64_t overBudget = 0;
+
+        // Current delay before a request is hedged, in microseconds
+        std::uint64_t delay = 0;
+    };
+
+    /**
+     * @brief Snapshot of the streamed voice counters
+     */
+    struct VoiceStats
+    {
+        // Dialogue replies that came with streamed voice audio
+        std::uint64_t streams = 0;
+
+        // Encoded audio received
+        std::uint64_t bytes = 0;
+
+        // Streams that lost audio to a full buffer or a lost connection
+        std::uint64_t truncated = 0;
+    };
+
+    /**
+     * @brief Snapshot of the voice clip cache
+     */
+    struct VoiceCacheStats
+    {
+        // Clips stored, and the size of the pack file
+        std::uint64_t entries = 0;
+        std::uint64_t bytes = 0;
+
+        // Lookups that found a clip, and those that did not
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+
+        // Clips dropped by compaction to stay within the capacity
+        std::uint64_t evictions = 0;
+    };
+
+    /**
+     * @brief Snapshot of the item checks of GIVE_ITEM and TAKE_ITEM actions
+     */
+    struct ItemCheckStats
+    {
+        // Actions checked against the item index
+        std::uint64_t checked = 0;
+
+        // Actions whose item ID was corrected, and those dropped for naming no known item
+        std::uint64_t repaired = 0;
+        std::uint64_t rejected = 0;
+    };
+
+    /**
+     * @brief Routing state of a server endpoint
+     *
+     * Up: takes new requests
+     * Draining: finishing its outstanding requests before it is disconnected
+     * Down: disconnected; health checks try to reconnect it
+     */
+    enum class EndpointState
+    {
+        Up,
+        Draining,
+        Down
+    };
+
+    inline constexpr std::size_t sEndpointStateCount = 3;
+
+    inline constexpr std::array<std::string_view, sEndpointStateCount> sEndpointStateNames
+        = { "up", "draining", "down" };
+
+    /**
+     * @brief Snapshot of one server endpoint
+     */
+    struct EndpointStats
+    {
+        std::string host;
+        unsigned short port = 0;
+        EndpointState state = EndpointState::Down;
+
+        // Negotiated protocol version, and dialogue requests allowed to await replies (0 for no limit)
+        unsigned protocol = 0;
+        unsigned maxInFlight = 0;
+
+        // Requests routed to the endpoint and not completed yet
+        std::uint64_t outstanding = 0;
+
+        // Moving average of the server latency, in microseconds
+        std::uint64_t latency = 0;
+
+        // Requests completed by the endpoint, and those that failed
+        std::uint64_t completed = 0;
+        std::uint64_t failures = 0;
+    };
+
+    /**
+     * @brief Snapshot of the client statistics
+     */
+    struct ClientStats
+    {
+        // Gauges
+        std::uint64_t queueDepth = 0;
+        std::uint64_t inFlight = 0;
+
+        // Counters since the client was created
+        std::uint64_t requestsSent = 0;
+        std::uint64_t responsesReceived = 0;
+        std::uint64_t bytesOut = 0;
+        std::uint64_t bytesIn = 0;
+        std::uint64_t errors = 0;
+        std::uint64_t reconnects = 0;
+
+        // Indexed by RequestKind, then LatencyStage
+        std::array<std::array<LatencySummary, sLatencyStageCount>, sRequestKindCount> latency{};
+
+        RateLimitStats rateLimit;
+        HedgeStats hedge;
+        VoiceStats voice;
+        VoiceCacheStats voiceCache;
+        ItemCheckStats items;
+
+        // In the order the endpoints were configured; the first is the client's own host and port
+        std::vector<EndpointStats> endpoints;
+    };
+
+    /**
+     * @brief Live statistics of a client
+     *
+     * Updated from the caller, writer and reader threads without locks.
+     */
+    class StatsRecorder
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Record the duration of a stage
+         *
+         * @param kind Request type
+         * @param stage Measured interval
+         * @param start Start of the interval
+         * @param end End of the interval
+         */
+        void recordLatency(RequestKind kind, LatencyStage stage, Clock::time_point start, Clock::time_point end);
+
+        /**
+         * @brief Take a snapshot of all counters and histograms
+         *
+         * @return Snapshot
+         */
+        ClientStats snapshot() const;
+
+        std::atomic<std::uint64_t> mQueueDepth{ 0 };
+        std::atomic<std::uint64_t> mInFlight{ 0 };
+        std::atomic<std::uint64_t> mRequestsSent{ 0 };
+        std::atomic<std::uint64_t> mResponsesReceived{ 0 };
+        std::atomic<std::uint64_t> mBytesOut{ 0 };
+        std::atomic<std::uint64_t> mBytesIn{ 0 };
+        std::atomic<std::uint64_t> mErrors{ 0 };
+        std::atomic<std::uint64_t> mReconnects{ 0 };
+        std::atomic<std::uint64_t> mVoiceStreams{ 0 };
+        std::atomic<std::uint64_t> mVoiceBytes{ 0 };
+        std::atomic<std::uint64_t> mVoiceTruncated{ 0 };
+        std::atomic<std::uint64_t> mItemsChecked{ 0 };
+        std::atomic<std::uint64_t> mItemsRepaired{ 0 };
+        std::atomic<std::uint64_t> mItemsRejected{ 0 };
+
+    private:
+        std::array<std::array<LatencyHistogram, sLatencyStageCount>, sRequestKindCount> mLatency;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_STATS_H
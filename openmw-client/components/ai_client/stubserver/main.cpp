@@ -0,0 +1,141 @@
+#include "stubserver.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace bpo = boost::program_options;
+
+namespace
+{
+    std::atomic<bool> sInterrupted{ false };
+
+    void onSignal(int)
+    {
+        sInterrupted = true;
+    }
+
+    AI::LatencyDistribution parseLatency(const std::string& text, const char* option)
+    {
+        std::optional<AI::LatencyDistribution> distribution = AI::LatencyDistribution::parse(text);
+        if (!distribution)
+            throw std::runtime_error(std::string("Invalid ") + option + ": " + text);
+        return *distribution;
+    }
+
+    double parseRate(double value, const char* option)
+    {
+        if (value < 0.0 || value > 1.0)
+            throw std::runtime_error(std::string(option) + " must be between 0 and 1");
+        return value;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    AI::StubServerOptions options;
+    double durationSeconds = 0.0;
+
+    try
+    {
+        std::string dialogueLatency = "constant:0";
+        std::string eventLatency = "constant:0";
+        std::string templateFile;
+        unsigned reorderDelayMs = 50;
+        unsigned readDelayMs = 0;
+        unsigned voiceIntervalMs = 20;
+
+        bpo::options_description desc("Usage: openmw-ai-stubserver [options]\n\nOptions");
+        desc.add_options()
+            ("help,h", "print help message")
+            ("address", bpo::value(&options.address)->default_value(options.address), "address to listen on")
+            ("port", bpo::value(&options.port)->default_value(options.port), "port to listen on; 0 picks a free one")
+            ("dialogue-latency", bpo::value(&dialogueLatency)->default_value(dialogueLatency),
+                "dialogue reply delay in ms: constant:MS, uniform:MIN:MAX, exponential:MEAN or lognormal:MEDIAN:SIGMA")
+            ("event-latency", bpo::value(&eventLatency)->default_value(eventLatency), "event reply delay, as above")
+            ("response-template", bpo::value(&templateFile),
+                "file with the dialogue reply; {{requestId}}, {{npcId}}, {{npcName}} and {{playerMessage}} are replaced")
+            ("drop-rate", bpo::value(&options.dropRate)->default_value(0.0), "fraction of requests never answered")
+            ("error-rate", bpo::value(&options.errorRate)->default_value(0.0), "fraction of requests answered with an error")
+            ("reorder-rate", bpo::value(&options.reorderRate)->default_value(0.0),
+                "fraction of replies held back so later replies overtake them")
+            ("reorder-delay", bpo::value(&reorderDelayMs)->default_value(reorderDelayMs), "hold-back in ms")
+            ("disconnect-after", bpo::value(&options.disconnectAfter)->default_value(0),
+                "cut each connection after this many requests; 0 for never")
+            ("read-delay", bpo::value(&readDelayMs)->default_value(readDelayMs), "pause in ms before each read")
+            ("protocol", bpo::value(&options.protocolVersion)->default_value(options.protocolVersion),
+                "protocol version; 1 skips the handshake and answers in order without request IDs")
+            ("max-in-flight", bpo::value(&options.maxInFlight)->default_value(0),
+                "dialogue window offered in the handshake; 0 for no limit")
+            ("voice-chunks", bpo::value(&options.voiceChunks)->default_value(0),
+                "voice audio chunks streamed after each dialogue reply to clients that ask; 0 for none")
+            ("voice-chunk-size", bpo::value(&options.voiceChunkSize)->default_value(options.voiceChunkSize),
+                "bytes per voice chunk")
+            ("voice-chunk-interval", bpo::value(&voiceIntervalMs)->default_value(voiceIntervalMs),
+                "ms between voice chunks, standing in for synthesis time")
+            ("seed", bpo::value(&options.seed)->default_value(0), "random seed")
+            ("duration", bpo::value(&durationSeconds)->default_value(0.0), "exit after this many seconds; 0 runs until interrupted");
+
+        bpo::variables_map variables;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), variables);
+        bpo::notify(variables);
+
+        if (variables.count("help"))
+        {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        options.dialogueLatency = parseLatency(dialogueLatency, "dialogue-latency");
+        options.eventLatency = parseLatency(eventLatency, "event-latency");
+        options.dropRate = parseRate(options.dropRate, "drop-rate");
+        options.errorRate = parseRate(options.errorRate, "error-rate");
+        options.reorderRate = parseRate(options.reorderRate, "reorder-rate");
+        options.reorderDelay = std::chrono::milliseconds(reorderDelayMs);
+        options.readDelay = std::chrono::milliseconds(readDelayMs);
+        options.voiceChunkInterval = std::chrono::milliseconds(voiceIntervalMs);
+
+        if (!templateFile.empty())
+        {
+            std::ifstream file(templateFile, std::ios::binary);
+            if (!file)
+                throw std::runtime_error("Cannot read " + templateFile);
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            options.dialogueTemplate = contents.str();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    AI::StubServer server(options);
+    if (!server.start())
+        return 1;
+
+    // Scripts read the port from the first line when started with --port 0
+    std::cout << "Listening on " << options.address << ":" << server.getPort() << std::endl;
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    const auto start = std::chrono::steady_clock::now();
+    while (!sInterrupted)
+    {
+        if (durationSeconds > 0.0
+            && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= durationSeconds)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    server.stop();
+    std::cout << "Served " << server.getRequestCount() << " requests on " << server.getConnectionCount()
+              << " connections" << std::endl;
+    return 0;
+}
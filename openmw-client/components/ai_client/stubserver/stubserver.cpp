@@ -0,0 +1,548 @@
+#include "stubserver.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <nlohmann/json.hpp>
+
+#include <components/ai_client/protocol.hpp>
+
+namespace AI
+{
+    using json = nlohmann::json;
+    namespace beast = boost::beast;
+    namespace websocket = beast::websocket;
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+    using Clock = std::chrono::steady_clock;
+
+    namespace
+    {
+        constexpr std::string_view sDefaultDialogueTemplate
+            = R"({"type":"dialogue","requestId":"{{requestId}}","npc":{"id":"{{npcId}}","name":"{{npcName}}"},)"
+              R"("text":"You said: {{playerMessage}}","actions":[]})";
+
+        std::string escapeJson(const std::string& value)
+        {
+            const std::string quoted = json(value).dump(-1, ' ', false, json::error_handler_t::replace);
+            return quoted.substr(1, quoted.size() - 2);
+        }
+
+        void replaceAll(std::string& text, std::string_view placeholder, const std::string& value)
+        {
+            std::size_t position = 0;
+            while ((position = text.find(placeholder, position)) != std::string::npos)
+            {
+                text.replace(position, placeholder.size(), value);
+                position += value.size();
+            }
+        }
+
+        std::string stringField(const json& object, const char* key)
+        {
+            auto it = object.find(key);
+            return it != object.end() && it->is_string() ? it->get<std::string>() : std::string();
+        }
+    }
+
+    std::optional<LatencyDistribution> LatencyDistribution::parse(std::string_view text)
+    {
+        std::vector<std::string> parts;
+        std::size_t start = 0;
+        while (true)
+        {
+            const std::size_t end = text.find(':', start);
+            parts.emplace_back(text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+            if (end == std::string_view::npos)
+                break;
+            start = end + 1;
+        }
+
+        std::vector<double> values;
+        for (std::size_t i = 1; i < parts.size(); ++i)
+        {
+            char* end = nullptr;
+            const double value = std::strtod(parts[i].c_str(), &end);
+            if (parts[i].empty() || *end != '\0' || value < 0.0)
+                return std::nullopt;
+            values.push_back(value);
+        }
+
+        LatencyDistribution distribution;
+        const std::string& kind = parts[0];
+        if (kind == "constant" && values.size() == 1)
+            distribution.kind = Kind::Constant;
+        else if (kind == "uniform" && values.size() == 2 && values[0] <= values[1])
+            distribution.kind = Kind::Uniform;
+        else if (kind == "exponential" && values.size() == 1)
+            distribution.kind = Kind::Exponential;
+        else if (kind == "lognormal" && values.size() == 2 && values[0] > 0.0)
+            distribution.kind = Kind::LogNormal;
+        else
+            return std::nullopt;
+
+        distribution.first = values[0];
+        distribution.second = values.size() > 1 ? values[1] : 0.0;
+        return distribution;
+    }
+
+    std::chrono::microseconds LatencyDistribution::draw(std::mt19937& random) const
+    {
+        double ms = first;
+        switch (kind)
+        {
+            case Kind::Constant:
+                break;
+            case Kind::Uniform:
+                ms = std::uniform_real_distribution<double>(first, second)(random);
+                break;
+            case Kind::Exponential:
+                ms = first > 0.0 ? std::exponential_distribution<double>(1.0 / first)(random) : 0.0;
+                break;
+            case Kind::LogNormal:
+                ms = std::lognormal_distribution<double>(std::log(first), second)(random);
+                break;
+        }
+        return std::chrono::microseconds(static_cast<std::int64_t>(ms * 1000.0));
+    }
+
+    /**
+     * @brief One client connection: a reader thread answering requests and a writer thread sending due replies
+     */
+    class StubServer::Session
+    {
+    public:
+        Session(tcp::socket socket, const StubServerOptions& options, unsigned seed, std::atomic<std::size_t>& requestCount)
+            : mWebSocket(std::move(socket))
+            , mOptions(options)
+            , mRandom(seed)
+            , mRequestCount(requestCount)
+        {
+        }
+
+        void start()
+        {
+            mReader = std::thread(&Session::readLoop, this);
+            mWriter = std::thread(&Session::writeLoop, this);
+        }
+
+        void stop()
+        {
+            close();
+            cut();
+            if (mReader.joinable())
+                mReader.join();
+            if (mWriter.joinable())
+                mWriter.join();
+        }
+
+    private:
+        void readLoop()
+        {
+            if (mOptions.threadStarted)
+                mOptions.threadStarted();
+
+            try
+            {
+                mWebSocket.accept();
+
+                beast::flat_buffer buffer;
+                while (true)
+                {
+                    if (mOptions.readDelay.count() > 0)
+                        std::this_thread::sleep_for(mOptions.readDelay);
+
+                    mWebSocket.read(buffer);
+                    std::string message = beast::buffers_to_string(buffer.data());
+                    buffer.consume(buffer.size());
+
+                    if (!handle(message))
+                        break;
+                }
+            }
+            catch (const std::exception&)
+            {
+                // Client went away or the connection was cut
+            }
+            close();
+        }
+
+        void writeLoop()
+        {
+            if (mOptions.threadStarted)
+                mOptions.threadStarted();
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (true)
+            {
+                mCondition.wait(lock, [this] { return mClosed || !mReplies.empty(); });
+                if (mClosed)
+                    break;
+
+                // Wait for the earliest reply, which may change while waiting
+                const Clock::time_point due = mReplies.begin()->first;
+                if (Clock::now() < due)
+                {
+                    mCondition.wait_until(lock, due);
+                    continue;
+                }
+
+                Reply reply = std::move(mReplies.begin()->second);
+                mReplies.erase(mReplies.begin());
+                lock.unlock();
+
+                try
+                {
+                    std::lock_guard<std::mutex> socketLock(mSocketMutex);
+                    mWebSocket.binary(reply.binary);
+                    mWebSocket.write(net::buffer(reply.data));
+                }
+                catch (const std::exception&)
+                {
+                    lock.lock();
+                    break;
+                }
+                lock.lock();
+            }
+        }
+
+        // Returns false once the connection has been cut
+        bool handle(const std::string& message)
+        {
+            json request;
+            std::string parseError;
+            try
+            {
+                request = json::parse(message);
+            }
+            catch (const std::exception& e)
+            {
+                parseError = e.what();
+            }
+
+            // The handshake is not counted as a request
+            const std::string type = stringField(request, "type");
+            if (parseError.empty() && type == "hello")
+            {
+                // Streaming is the only feature the stub implements, and only when it has audio to stream
+                json features = json::array();
+                const json requested = request.value("features", json::array());
+                if (mOptions.voiceChunks > 0 && mOptions.protocolVersion >= 2
+                    && std::find(requested.begin(), requested.end(), "streaming") != requested.end())
+                {
+                    features.push_back("streaming");
+                    mStreaming = true;
+                }
+
+                schedule(mOptions.protocolVersion >= 2
+                        ? json{ { "type", "welcome" }, { "protocol", mOptions.protocolVersion },
+                              { "maxInFlight", mOptions.maxInFlight }, { "features", features } }
+                              .dump()
+                        : json{ { "type", "error" }, { "error", "Unknown message type: hello" },
+                              { "code", "unknown_type" } }
+                              .dump(),
+                    Clock::now());
+                return true;
+            }
+
+            // Cancelling voice audio is not a request either; chunks not written yet are dropped
+            if (parseError.empty() && type == "voice_cancel")
+            {
+                cancelVoice(stringField(request, "requestId"));
+                return true;
+            }
+
+            ++mRequests;
+            mRequestCount.fetch_add(1, std::memory_order_relaxed);
+
+            if (mOptions.disconnectAfter != 0 && mRequests >= mOptions.disconnectAfter)
+            {
+                cut();
+                return false;
+            }
+
+            if (!parseError.empty())
+            {
+                schedule(json{ { "type", "error" }, { "error", "Invalid JSON: " + parseError },
+                                 { "code", "invalid_json" } }
+                             .dump(),
+                    Clock::now());
+                return true;
+            }
+
+            const std::string requestId = stringField(request, "requestId");
+
+            std::uniform_real_distribution<double> chance(0.0, 1.0);
+            if (chance(mRandom) < mOptions.dropRate)
+                return true;
+
+            std::string reply;
+            std::chrono::microseconds delay{ 0 };
+            bool voice = false;
+            if (chance(mRandom) < mOptions.errorRate)
+            {
+                reply = json{ { "type", "error" }, { "requestId", requestId }, { "error", "Injected error" },
+                    { "code", "stub_error" } }
+                            .dump();
+            }
+            else if (type == "dialogue")
+            {
+                const json npc = request.value("npc", json::object());
+                reply = mOptions.dialogueTemplate.empty() ? std::string(sDefaultDialogueTemplate) : mOptions.dialogueTemplate;
+                replaceAll(reply, "{{requestId}}", escapeJson(requestId));
+                replaceAll(reply, "{{npcId}}", escapeJson(stringField(npc, "id")));
+                replaceAll(reply, "{{npcName}}", escapeJson(stringField(npc, "name")));
+                replaceAll(reply, "{{playerMessage}}", escapeJson(stringField(request, "playerMessage")));
+                delay = mOptions.dialogueLatency.draw(mRandom);
+                voice = mStreaming;
+            }
+            else if (type == "event" && request.contains("target"))
+            {
+                // The stub knows no factions or cells, so only listed NPCs count as reached
+                const json target = request.value("target", json::object());
+                const json npcIds = target.value("npcIds", json::array());
+                const std::size_t targets = npcIds.is_array() ? npcIds.size() : 0;
+                reply = json{ { "type", "event_ack" }, { "requestId", requestId },
+                    { "eventType", stringField(request, "eventType") }, { "status", "success" },
+                    { "targets", targets } }
+                            .dump();
+                delay = mOptions.eventLatency.draw(mRandom);
+            }
+            else if (type == "event")
+            {
+                reply = json{ { "type", "event_ack" }, { "requestId", requestId },
+                    { "npcId", stringField(request, "npcId") }, { "eventType", stringField(request, "eventType") },
+                    { "status", "success" } }
+                            .dump();
+                delay = mOptions.eventLatency.draw(mRandom);
+            }
+            else
+            {
+                reply = json{ { "type", "error" }, { "requestId", requestId },
+                    { "error", "Unknown message type: " + type }, { "code", "unknown_type" } }
+                            .dump();
+            }
+
+            if (chance(mRandom) < mOptions.reorderRate)
+                delay += mOptions.reorderDelay;
+
+            Clock::time_point due = Clock::now() + delay;
+            if (mOptions.protocolVersion < 2)
+            {
+                // Old servers answer one request after the other and do not echo the request ID
+                json stripped = json::parse(reply);
+                stripped.erase("requestId");
+                reply = stripped.dump();
+                due = std::max(due, mLastDue);
+                mLastDue = due;
+            }
+
+            // Voice audio follows the reply text, one chunk per interval as if it were being synthesized
+            if (voice)
+            {
+                json withVoice = json::parse(reply);
+                withVoice["voiceFormat"] = "pcm16";
+                withVoice["voiceId"] = stringField(request.value("npc", json::object()), "id");
+                reply = withVoice.dump();
+            }
+
+            schedule(std::move(reply), due);
+
+            if (voice)
+            {
+                for (std::size_t i = 0; i < mOptions.voiceChunks; ++i)
+                {
+                    VoiceChunk chunk;
+                    chunk.requestId = requestId;
+                    chunk.last = i + 1 == mOptions.voiceChunks;
+                    const std::string audio(mOptions.voiceChunkSize, static_cast<char>(i));
+                    chunk.audio = audio;
+
+                    std::string frame;
+                    writeVoiceChunk(frame, chunk);
+                    schedule(std::move(frame), due + mOptions.voiceChunkInterval * (i + 1), requestId);
+                }
+            }
+            return true;
+        }
+
+        // Voice chunks are binary and name the request whose audio they carry
+        void schedule(std::string reply, Clock::time_point due, std::string voiceOf = std::string())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                const bool binary = !voiceOf.empty();
+                mReplies.emplace(due, Reply{ std::move(reply), binary, std::move(voiceOf) });
+            }
+            mCondition.notify_one();
+        }
+
+        void cancelVoice(const std::string& requestId)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto it = mReplies.begin(); it != mReplies.end();)
+            {
+                if (it->second.binary && it->second.voiceOf == requestId)
+                    it = mReplies.erase(it);
+                else
+                    ++it;
+            }
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mClosed = true;
+            }
+            mCondition.notify_one();
+        }
+
+        // Drop the TCP connection without a WebSocket close frame
+        void cut()
+        {
+            // Shutting down first wakes a write blocked on a slow client, which holds the socket mutex
+            beast::error_code ec;
+            mWebSocket.next_layer().shutdown(tcp::socket::shutdown_both, ec);
+
+            std::lock_guard<std::mutex> lock(mSocketMutex);
+            mWebSocket.next_layer().close(ec);
+        }
+
+        websocket::stream<tcp::socket> mWebSocket;
+        const StubServerOptions& mOptions;
+        std::mt19937 mRandom;
+        std::atomic<std::size_t>& mRequestCount;
+        std::size_t mRequests = 0;
+
+        // Due time of the last reply, which keeps version 1 replies in order
+        Clock::time_point mLastDue;
+
+        std::thread mReader;
+        std::thread mWriter;
+
+        // Whether the client agreed to voice streaming in the handshake
+        bool mStreaming = false;
+
+        // Replies by due time; binary ones are voice chunks
+        struct Reply
+        {
+            std::string data;
+            bool binary = false;
+            std::string voiceOf;
+        };
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::multimap<Clock::time_point, Reply> mReplies;
+        bool mClosed = false;
+
+        // Serializes writes with cutting the connection
+        std::mutex mSocketMutex;
+    };
+
+    StubServer::StubServer(StubServerOptions options)
+        : mOptions(std::move(options))
+    {
+    }
+
+    StubServer::~StubServer()
+    {
+        stop();
+    }
+
+    bool StubServer::start()
+    {
+        if (mRunning)
+            return true;
+
+        try
+        {
+            const tcp::endpoint endpoint(net::ip::make_address(mOptions.address), mOptions.port);
+            mAcceptor = std::make_unique<tcp::acceptor>(mIoContext, endpoint);
+            mAcceptor->non_blocking(true);
+            mPort = mAcceptor->local_endpoint().port();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error starting stub server: " << e.what() << std::endl;
+            return false;
+        }
+
+        mRunning = true;
+        mAcceptThread = std::thread(&StubServer::acceptLoop, this);
+        return true;
+    }
+
+    void StubServer::stop()
+    {
+        if (!mRunning.exchange(false))
+            return;
+
+        if (mAcceptThread.joinable())
+            mAcceptThread.join();
+
+        beast::error_code ec;
+        mAcceptor->close(ec);
+
+        std::vector<std::shared_ptr<Session>> sessions;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            sessions.swap(mSessions);
+        }
+        for (const auto& session : sessions)
+            session->stop();
+    }
+
+    unsigned short StubServer::getPort() const
+    {
+        return mPort;
+    }
+
+    std::size_t StubServer::getConnectionCount() const
+    {
+        return mConnectionCount;
+    }
+
+    std::size_t StubServer::getRequestCount() const
+    {
+        return mRequestCount;
+    }
+
+    void StubServer::acceptLoop()
+    {
+        if (mOptions.threadStarted)
+            mOptions.threadStarted();
+
+        while (mRunning)
+        {
+            // The acceptor does not block, so stop() is noticed within one poll interval
+            tcp::socket socket(mIoContext);
+            beast::error_code ec;
+            mAcceptor->accept(socket, ec);
+            if (ec == net::error::would_block || ec == net::error::try_again)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            if (ec)
+            {
+                std::cerr << "Error accepting connection: " << ec.message() << std::endl;
+                break;
+            }
+            socket.non_blocking(false);
+
+            const auto index = static_cast<unsigned>(mConnectionCount.fetch_add(1));
+            auto session = std::make_shared<Session>(std::move(socket), mOptions, mOptions.seed + index, mRequestCount);
+            session->start();
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mSessions.push_back(std::move(session));
+        }
+    }
+}
@@ -0,0 +1,187 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_STUBSERVER_STUBSERVER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_STUBSERVER_STUBSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+namespace AI
+{
+    /**
+     * @brief Distribution reply delays are drawn from
+     */
+    struct LatencyDistribution
+    {
+        enum class Kind
+        {
+            Constant,
+            Uniform,
+            Exponential,
+            LogNormal
+        };
+
+        Kind kind = Kind::Constant;
+
+        // Milliseconds: constant value, uniform min/max, exponential mean, log-normal median and sigma
+        double first = 0.0;
+        double second = 0.0;
+
+        /**
+         * @brief Parse a distribution
+         *
+         * Accepted forms: "constant:MS", "uniform:MIN:MAX", "exponential:MEAN", "lognormal:MEDIAN:SIGMA".
+         *
+         * @param text Distribution description
+         * @return Distribution, or std::nullopt if the text is malformed
+         */
+        static std::optional<LatencyDistribution> parse(std::string_view text);
+
+        /**
+         * @brief Draw a delay
+         *
+         * @param random Random generator
+         * @return Delay
+         */
+        std::chrono::microseconds draw(std::mt19937& random) const;
+    };
+
+    /**
+     * @brief Behavior of the stub server
+     */
+    struct StubServerOptions
+    {
+        std::string address = "127.0.0.1";
+
+        // 0 picks a free port; see StubServer::getPort()
+        unsigned short port = 0;
+
+        LatencyDistribution dialogueLatency;
+        LatencyDistribution eventLatency;
+
+        // Dialogue reply with {{requestId}}, {{npcId}}, {{npcName}} and {{playerMessage}} placeholders;
+        // empty for the built-in reply
+        std::string dialogueTemplate;
+
+        // Probabilities per request
+        double dropRate = 0.0;
+        double errorRate = 0.0;
+        double reorderRate = 0.0;
+
+        // Extra delay of reordered replies, so later replies overtake them
+        std::chrono::milliseconds reorderDelay{ 50 };
+
+        // Close the socket without a close frame after this many requests on a connection; 0 for never
+        std::size_t disconnectAfter = 0;
+
+        // Pause before each read, to make the server a slow reader
+        std::chrono::milliseconds readDelay{ 0 };
+
+        // Protocol version answered to the hello message; 1 acts like a server without the handshake,
+        // which replies in order and without request IDs
+        unsigned protocolVersion = 2;
+
+        // Dialogue window offered in the welcome message; 0 for no limit
+        unsigned maxInFlight = 0;
+
+        // Voice audio streamed after each dialogue reply to clients that ask for streaming; 0 chunks for none.
+        // Chunk n of a reply is voiceChunkSize bytes of value n, and the chunks follow the reply at intervals.
+        std::size_t voiceChunks = 0;
+        std::size_t voiceChunkSize = 1024;
+        std::chrono::milliseconds voiceChunkInterval{ 20 };
+
+        unsigned seed = 0;
+
+        // Called first on each thread the server starts, e.g. to leave them out of allocation counts
+        std::function<void()> threadStarted;
+    };
+
+    /**
+     * @brief WebSocket server speaking the dialogue/event protocol with canned replies
+     *
+     * Stands in for the AI server in tests, benchmarks and load tests. Replies
+     * are delayed, dropped, turned into errors or reordered as configured,
+     * and connections can be cut mid-stream. Dialogue replies can be
+     * followed by synthetic voice audio in binary frames.
+     */
+    class StubServer
+    {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param options Server behavior
+         */
+        explicit StubServer(StubServerOptions options);
+
+        /**
+         * @brief Destructor; stops the server
+         */
+        ~StubServer();
+
+        /**
+         * @brief Start listening and accepting connections
+         *
+         * @return true if listening, false otherwise
+         */
+        bool start();
+
+        /**
+         * @brief Close all connections and stop listening
+         */
+        void stop();
+
+        /**
+         * @brief Get the port the server listens on
+         *
+         * @return Port, valid after start()
+         */
+        unsigned short getPort() const;
+
+        /**
+         * @brief Get the number of connections accepted so far
+         *
+         * @return Connection count
+         */
+        std::size_t getConnectionCount() const;
+
+        /**
+         * @brief Get the number of requests received so far
+         *
+         * @return Request count
+         */
+        std::size_t getRequestCount() const;
+
+    private:
+        class Session;
+
+        void acceptLoop();
+
+        StubServerOptions mOptions;
+
+        boost::asio::io_context mIoContext;
+        std::unique_ptr<boost::asio::ip::tcp::acceptor> mAcceptor;
+        std::thread mAcceptThread;
+        std::atomic<bool> mRunning{ false };
+        unsigned short mPort = 0;
+
+        mutable std::mutex mMutex;
+        std::vector<std::shared_ptr<Session>> mSessions;
+
+        std::atomic<std::size_t> mConnectionCount{ 0 };
+        std::atomic<std::size_t> mRequestCount{ 0 };
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_STUBSERVER_STUBSERVER_H
@@ -0,0 +1,27 @@
+#include <components/ai_client/action.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    using Key = AI::ActionParams::Key;
+
+    TEST(AIActionTest, float_quantity_should_be_rounded_and_clamped)
+    {
+        AI::ActionParams params;
+        params.set(Key::Quantity, 2.6f);
+        EXPECT_EQ(params.getInt(Key::Quantity), 3);
+
+        params.set(Key::Quantity, 1e30f);
+        EXPECT_EQ(params.getInt(Key::Quantity), std::numeric_limits<std::int32_t>::max());
+
+        params.set(Key::Quantity, -std::numeric_limits<float>::infinity());
+        EXPECT_EQ(params.getInt(Key::Quantity), std::numeric_limits<std::int32_t>::min());
+
+        params.set(Key::Quantity, std::nanf(""));
+        EXPECT_EQ(params.getInt(Key::Quantity, 1), 1);
+    }
+}
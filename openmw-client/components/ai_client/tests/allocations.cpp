@@ -0,0 +1,131 @@
+#include <components/ai_client/client.hpp>
+#include <components/ai_client/stubserver/stubserver.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // The replaced operators serve the whole test binary; allocations are counted while enabled,
+    // on every thread but the stub server's
+    std::atomic<bool> sCounting{ false };
+    std::atomic<std::size_t> sAllocations{ 0 };
+    thread_local bool tIgnored = false;
+
+    void* allocate(std::size_t size)
+    {
+        if (sCounting.load(std::memory_order_relaxed) && !tIgnored)
+            sAllocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* memory = std::malloc(size == 0 ? 1 : size))
+            return memory;
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    struct Reply
+    {
+        std::atomic<bool> done{ false };
+        bool matched = false;
+    };
+
+    bool roundTrip(AI::Client& client, AI::DialogueRequest request)
+    {
+        // The callback captures one pointer, so it fits std::function's inline storage; a future would allocate
+        Reply reply;
+        client.sendDialogueRequest(std::move(request), [reply = &reply](const AI::DialogueResultPtr& result) {
+            reply->matched = !result->error && result->text == "You said: \"Hello\"" && result->actions.size() == 1
+                && result->actions[0].params.getInt(AI::ActionParams::Key::Quantity) == 5;
+            reply->done.store(true, std::memory_order_release);
+        });
+
+        const auto end = std::chrono::steady_clock::now() + 2s;
+        while (!reply.done.load(std::memory_order_acquire))
+        {
+            if (std::chrono::steady_clock::now() > end)
+                return false;
+            std::this_thread::sleep_for(1ms);
+        }
+        return reply.matched;
+    }
+
+    TEST(AIClientAllocationTest, warmed_up_dialogue_round_trip_should_not_allocate)
+    {
+        // Escaped text and an action, so every part of the decoder runs
+        AI::StubServerOptions options;
+        options.dialogueTemplate = R"({"type":"dialogue","requestId":"{{requestId}}",)"
+                                   R"("text":"You said: \"{{playerMessage}}\"",)"
+                                   R"("actions":[{"type":"GIVE_ITEM","params":{"item_id":"gold_001","quantity":5}}]})";
+        options.threadStarted = [] { tIgnored = true; };
+        AI::StubServer server(options);
+        ASSERT_TRUE(server.start());
+
+        AI::Client client("127.0.0.1", server.getPort());
+        ASSERT_TRUE(client.connect());
+
+        // Requests are built up front; the caller's own strings are not the client's allocations
+        constexpr std::size_t warmUp = 32;
+        constexpr std::size_t measured = 32;
+        const AI::NpcProfilePtr npc = AI::makeNpcProfile({ "Test NPC", "Dunmer", "Male", "Commoner", "None" });
+        std::vector<AI::DialogueRequest> requests(warmUp + measured);
+        for (AI::DialogueRequest& request : requests)
+        {
+            request.npcId = "test_npc";
+            request.npc = npc;
+            request.playerMessage = "Hello";
+        }
+
+        for (std::size_t i = 0; i < warmUp; ++i)
+            ASSERT_TRUE(roundTrip(client, std::move(requests[i])));
+
+        sCounting = true;
+        bool replied = true;
+        for (std::size_t i = warmUp; i < requests.size(); ++i)
+            replied = roundTrip(client, std::move(requests[i])) && replied;
+        sCounting = false;
+
+        EXPECT_TRUE(replied);
+        EXPECT_EQ(sAllocations.load(), 0u);
+
+        client.disconnect();
+        server.stop();
+    }
+}
@@ -0,0 +1,610 @@
+#include <components/ai_client/client.hpp>
+#include <components/ai_client/stubserver/stubserver.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <future>
+#include <random>
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    AI::DialogueRequest makeRequest(std::string playerMessage)
+    {
+        AI::DialogueRequest request;
+        request.npcId = "test_npc";
+        request.npc = AI::makeNpcProfile({ "Test NPC", "Dunmer", "Male", "Commoner", "None" });
+        request.playerMessage = std::move(playerMessage);
+        return request;
+    }
+
+    std::future<AI::DialogueResultPtr> sendDialogue(AI::Client& client, std::string playerMessage)
+    {
+        auto promise = std::make_shared<std::promise<AI::DialogueResultPtr>>();
+        std::future<AI::DialogueResultPtr> future = promise->get_future();
+        client.sendDialogueRequest(makeRequest(std::move(playerMessage)),
+            [promise](const AI::DialogueResultPtr& result) { promise->set_value(result); });
+        return future;
+    }
+
+    template <class Predicate>
+    bool waitUntil(Predicate predicate, std::chrono::milliseconds timeout = 2s)
+    {
+        const auto end = std::chrono::steady_clock::now() + timeout;
+        while (!predicate())
+        {
+            if (std::chrono::steady_clock::now() > end)
+                return false;
+            std::this_thread::sleep_for(5ms);
+        }
+        return true;
+    }
+
+    struct AIClientTest : ::testing::Test
+    {
+        std::unique_ptr<AI::StubServer> mServer;
+        std::unique_ptr<AI::Client> mClient;
+
+        void start(AI::StubServerOptions options = {}, const AI::ClientOptions& clientOptions = {})
+        {
+            mServer = std::make_unique<AI::StubServer>(std::move(options));
+            ASSERT_TRUE(mServer->start());
+            mClient = std::make_unique<AI::Client>("127.0.0.1", mServer->getPort(), clientOptions);
+            ASSERT_TRUE(mClient->connect());
+        }
+
+        void TearDown() override
+        {
+            if (mClient)
+                mClient->disconnect();
+            if (mServer)
+                mServer->stop();
+        }
+    };
+
+    TEST_F(AIClientTest, dialogue_request_should_complete_with_reply)
+    {
+        start();
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+
+        const AI::DialogueResultPtr dialogue = result.get();
+        EXPECT_FALSE(dialogue->error);
+        EXPECT_EQ(dialogue->text, "You said: Hello");
+    }
+
+    TEST_F(AIClientTest, event_should_be_acknowledged)
+    {
+        start();
+        std::promise<bool> promise;
+        std::future<bool> result = promise.get_future();
+
+        AI::EventRequest request;
+        request.npcId = "test_npc";
+        request.event.type = AI::EventType::PlayerCompletedQuest;
+        request.event.questId = "test_quest";
+        mClient->sendEvent(std::move(request), [&](bool success) { promise.set_value(success); });
+
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+        EXPECT_TRUE(result.get());
+    }
+
+    TEST_F(AIClientTest, broadcast_event_should_be_one_request_with_one_ack)
+    {
+        start();
+        std::promise<bool> promise;
+        std::future<bool> result = promise.get_future();
+
+        AI::EventRequest request;
+        request.target = AI::EventTarget{};
+        request.target->npcIds = { "guard_1", "guard_\"2\"", "guard_3" };
+        request.event.type = AI::EventType::PlayerJoinedFaction;
+        request.event.faction = "Fighters Guild";
+        mClient->sendEvent(std::move(request), [&](bool success) { promise.set_value(success); });
+
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+        EXPECT_TRUE(result.get());
+        EXPECT_EQ(mServer->getRequestCount(), 1u);
+    }
+
+    TEST_F(AIClientTest, server_error_should_complete_dialogue_with_error)
+    {
+        AI::StubServerOptions options;
+        options.errorRate = 1.0;
+        start(options);
+
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+        EXPECT_TRUE(result.get()->error);
+    }
+
+    TEST_F(AIClientTest, reply_should_be_cleaned_up_and_list_its_topics)
+    {
+        start();
+        mClient->setTopicMatcher(std::make_shared<const AI::TopicMatcher>(
+            std::vector<std::string>{ "Caius Cosades", "Balmora", "Caius" }));
+
+        // Curly quotes and the ellipsis are replaced before the topics are found
+        std::future<AI::DialogueResultPtr> result
+            = sendDialogue(*mClient, "\xE2\x80\x9C" "Caius Cosades\xE2\x80\x9D lives in Balmora\xE2\x80\xA6");
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+
+        const AI::DialogueResultPtr dialogue = result.get();
+        EXPECT_EQ(dialogue->text, "You said: \"Caius Cosades\" lives in Balmora...");
+        ASSERT_EQ(dialogue->topics.size(), 2u);
+        EXPECT_EQ(dialogue->topics[0].topic, "Caius Cosades");
+        EXPECT_EQ(dialogue->topics[0].offset, 11u);
+        EXPECT_EQ(dialogue->topics[1].topic, "Balmora");
+    }
+
+    TEST_F(AIClientTest, item_actions_should_be_repaired_or_dropped)
+    {
+        AI::StubServerOptions options;
+        options.dialogueTemplate = R"({"type":"dialogue","requestId":"{{requestId}}","text":"Take it.","actions":[)"
+                                   R"({"type":"GIVE_ITEM","params":{"item_id":"Gold","quantity":5}},)"
+                                   R"({"type":"TAKE_ITEM","params":{"item_id":"daedric_dai-katana"}},)"
+                                   R"({"type":"GIVE_ITEM","params":{"item_id":"ebony_mail"}},)"
+                                   R"({"type":"EMOTE","params":{"description":"smiles"}}]})";
+        start(std::move(options));
+        mClient->setItemIndex(std::make_shared<const AI::ItemIndex>(
+            std::vector<AI::ItemRecord>{ { "gold_001", "Gold" }, { "daedric dai-katana", "Daedric Dai-katana" } }));
+
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Pay me");
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+
+        // The name and the misspelled ID are repaired; the unknown item's action is dropped
+        const AI::DialogueResultPtr dialogue = result.get();
+        ASSERT_EQ(dialogue->actions.size(), 3u);
+        EXPECT_EQ(dialogue->actions[0].params.getString(AI::ActionParams::Key::ItemId), "gold_001");
+        EXPECT_EQ(dialogue->actions[1].params.getString(AI::ActionParams::Key::ItemId), "daedric dai-katana");
+        EXPECT_EQ(dialogue->actions[2].type, AI::ActionType::Emote);
+
+        const AI::ClientStats stats = mClient->getStats();
+        EXPECT_EQ(stats.items.checked, 3u);
+        EXPECT_EQ(stats.items.repaired, 2u);
+        EXPECT_EQ(stats.items.rejected, 1u);
+    }
+
+    TEST_F(AIClientTest, reordered_replies_should_reach_their_own_callbacks)
+    {
+        AI::StubServerOptions options;
+        options.dialogueLatency = *AI::LatencyDistribution::parse("uniform:0:50");
+        options.reorderRate = 0.5;
+        options.seed = 42;
+        start(options);
+
+        std::vector<std::future<AI::DialogueResultPtr>> results;
+        for (int i = 0; i < 20; ++i)
+            results.push_back(sendDialogue(*mClient, "Message " + std::to_string(i)));
+
+        for (int i = 0; i < 20; ++i)
+        {
+            ASSERT_EQ(results[i].wait_for(2s), std::future_status::ready);
+            EXPECT_EQ(results[i].get()->text, "You said: Message " + std::to_string(i));
+        }
+    }
+
+    TEST_F(AIClientTest, dropped_reply_should_leave_request_in_flight)
+    {
+        AI::StubServerOptions options;
+        options.dropRate = 1.0;
+        start(options);
+
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+        EXPECT_EQ(result.wait_for(200ms), std::future_status::timeout);
+        EXPECT_EQ(mClient->getStats().inFlight, 1u);
+    }
+
+    TEST_F(AIClientTest, client_should_reconnect_after_connection_is_cut)
+    {
+        AI::StubServerOptions options;
+        options.disconnectAfter = 2;
+        start(options);
+
+        std::future<AI::DialogueResultPtr> first = sendDialogue(*mClient, "First");
+        ASSERT_EQ(first.wait_for(2s), std::future_status::ready);
+
+        // The second request makes the server cut the connection
+        std::future<AI::DialogueResultPtr> second = sendDialogue(*mClient, "Second");
+        ASSERT_TRUE(waitUntil([&] { return !mClient->isConnected(); }));
+
+        std::future<AI::DialogueResultPtr> third = sendDialogue(*mClient, "Third");
+        ASSERT_EQ(third.wait_for(2s), std::future_status::ready);
+        EXPECT_EQ(third.get()->text, "You said: Third");
+        EXPECT_EQ(mServer->getConnectionCount(), 2u);
+        EXPECT_EQ(mClient->getStats().reconnects, 1u);
+    }
+
+    TEST_F(AIClientTest, written_requests_should_fail_when_only_connection_drops)
+    {
+        AI::StubServerOptions options;
+        options.disconnectAfter = 2;
+        options.dialogueLatency = *AI::LatencyDistribution::parse("constant:500");
+        start(options);
+
+        // The dialogue waits for its reply when the event makes the server cut the connection
+        std::future<AI::DialogueResultPtr> dialogue = sendDialogue(*mClient, "Hello");
+        ASSERT_TRUE(waitUntil([&] { return mServer->getRequestCount() == 1; }));
+        std::promise<bool> promise;
+        std::future<bool> ack = promise.get_future();
+        AI::EventRequest request;
+        request.npcId = "test_npc";
+        request.event.type = AI::EventType::NPCAttacked;
+        mClient->sendEvent(std::move(request), [&](bool success) { promise.set_value(success); });
+
+        ASSERT_EQ(dialogue.wait_for(400ms), std::future_status::ready);
+        const AI::DialogueResultPtr result = dialogue.get();
+        EXPECT_TRUE(result->error);
+        EXPECT_EQ(result->text, "Error: Lost connection to AI server");
+        ASSERT_EQ(ack.wait_for(400ms), std::future_status::ready);
+        EXPECT_FALSE(ack.get());
+        EXPECT_EQ(mClient->getStats().inFlight, 0u);
+    }
+
+    TEST_F(AIClientTest, rate_limited_requests_should_be_delayed_or_rejected)
+    {
+        AI::ClientOptions clientOptions;
+        clientOptions.rateLimit.perNpc.rate = 20.0;
+        clientOptions.rateLimit.maxDelay = 60ms;
+        start({}, clientOptions);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<AI::DialogueResultPtr>> results;
+        for (int i = 0; i < 3; ++i)
+            results.push_back(sendDialogue(*mClient, "Hello"));
+
+        // One token at once, one 50 ms later, and the third would wait too long
+        ASSERT_EQ(results[1].wait_for(2s), std::future_status::ready);
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 50ms);
+        EXPECT_FALSE(results[0].get()->error);
+        EXPECT_FALSE(results[1].get()->error);
+        ASSERT_EQ(results[2].wait_for(0s), std::future_status::ready);
+        EXPECT_TRUE(results[2].get()->error);
+
+        const AI::RateLimitStats stats = mClient->getStats().rateLimit;
+        EXPECT_EQ(stats.admitted, 1u);
+        EXPECT_EQ(stats.delayed, 1u);
+        EXPECT_EQ(stats.rejected, 1u);
+    }
+
+    TEST_F(AIClientTest, dropped_requests_should_still_complete)
+    {
+        AI::ClientOptions clientOptions;
+        clientOptions.rateLimit.perNpc = { 0.1, 1.0, AI::RateLimitPolicy::Drop };
+        start({}, clientOptions);
+
+        std::future<AI::DialogueResultPtr> first = sendDialogue(*mClient, "Hello");
+        std::future<AI::DialogueResultPtr> second = sendDialogue(*mClient, "Hello again");
+
+        // The second request finds the bucket empty and completes at once, without a message
+        ASSERT_EQ(second.wait_for(0s), std::future_status::ready);
+        const AI::DialogueResultPtr dropped = second.get();
+        EXPECT_TRUE(dropped->error);
+        EXPECT_TRUE(dropped->dropped);
+        EXPECT_TRUE(dropped->text.empty());
+        ASSERT_EQ(first.wait_for(2s), std::future_status::ready);
+        EXPECT_FALSE(first.get()->dropped);
+
+        std::promise<bool> promise;
+        std::future<bool> ack = promise.get_future();
+        AI::EventRequest request;
+        request.npcId = "test_npc";
+        request.event.type = AI::EventType::NPCAttacked;
+        mClient->sendEvent(std::move(request), [&](bool success) { promise.set_value(success); });
+        ASSERT_EQ(ack.wait_for(0s), std::future_status::ready);
+        EXPECT_FALSE(ack.get());
+
+        EXPECT_EQ(mClient->getStats().rateLimit.dropped, 2u);
+        EXPECT_EQ(mServer->getRequestCount(), 1u);
+    }
+
+    TEST_F(AIClientTest, requests_without_callback_should_complete_quietly)
+    {
+        AI::ClientOptions clientOptions;
+        clientOptions.rateLimit.perNpc = { 0.1, 1.0, AI::RateLimitPolicy::Reject };
+        start({}, clientOptions);
+
+        // One request is answered, the other rejected at once; neither has a callback to call
+        mClient->sendDialogueRequest(makeRequest("Hello"), AI::DialogueCallback());
+        mClient->sendDialogueRequest(makeRequest("Hello again"), AI::DialogueCallback());
+        ASSERT_TRUE(waitUntil([&] { return mClient->getStats().inFlight == 0; }));
+        EXPECT_EQ(mServer->getRequestCount(), 1u);
+        EXPECT_EQ(mClient->getStats().rateLimit.rejected, 1u);
+    }
+
+    TEST_F(AIClientTest, slow_dialogue_should_be_answered_by_hedge)
+    {
+        AI::StubServerOptions secondaryOptions;
+        secondaryOptions.dialogueTemplate
+            = R"({"type":"dialogue","requestId":"{{requestId}}","text":"Hedge: {{playerMessage}}","actions":[]})";
+        AI::StubServer secondary(secondaryOptions);
+        ASSERT_TRUE(secondary.start());
+
+        AI::StubServerOptions options;
+        options.dialogueLatency = *AI::LatencyDistribution::parse("constant:500");
+        AI::ClientOptions clientOptions;
+        clientOptions.hedge.host = "127.0.0.1";
+        clientOptions.hedge.port = secondary.getPort();
+        clientOptions.hedge.initialDelay = 50ms;
+        start(options, clientOptions);
+
+        // The primary is still thinking when the hedge answers; its late reply must be ignored
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+        ASSERT_EQ(result.wait_for(400ms), std::future_status::ready);
+        EXPECT_EQ(result.get()->text, "Hedge: Hello");
+        std::this_thread::sleep_for(300ms);
+
+        const AI::ClientStats stats = mClient->getStats();
+        EXPECT_EQ(stats.hedge.fired, 1u);
+        EXPECT_EQ(stats.hedge.won, 1u);
+        EXPECT_EQ(stats.inFlight, 0u);
+
+        mClient->disconnect();
+        secondary.stop();
+    }
+
+    TEST_F(AIClientTest, hedged_dialogue_should_fail_when_primary_and_hedge_are_lost)
+    {
+        // The hedge either answers with an error or cuts its connection, each after the primary dropped
+        AI::StubServerOptions erroring;
+        erroring.errorRate = 1.0;
+        AI::StubServerOptions cutting;
+        cutting.disconnectAfter = 1;
+        for (AI::StubServerOptions secondaryOptions : { erroring, cutting })
+        {
+            secondaryOptions.readDelay = 200ms;
+            AI::StubServer secondary(secondaryOptions);
+            ASSERT_TRUE(secondary.start());
+
+            AI::StubServerOptions options;
+            options.dialogueLatency = *AI::LatencyDistribution::parse("constant:2000");
+            options.disconnectAfter = 2;
+            AI::ClientOptions clientOptions;
+            clientOptions.hedge.host = "127.0.0.1";
+            clientOptions.hedge.port = secondary.getPort();
+            clientOptions.hedge.initialDelay = 50ms;
+            start(options, clientOptions);
+
+            // The event makes the primary cut the connection while the hedge is still being read
+            std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+            ASSERT_TRUE(waitUntil([&] { return mClient->getStats().hedge.fired == 1; }));
+            AI::EventRequest request;
+            request.npcId = "test_npc";
+            request.event.type = AI::EventType::NPCAttacked;
+            mClient->sendEvent(std::move(request), nullptr);
+
+            ASSERT_EQ(result.wait_for(1s), std::future_status::ready);
+            EXPECT_TRUE(result.get()->error);
+            EXPECT_EQ(secondary.getRequestCount(), 1u);
+            EXPECT_EQ(mClient->getStats().inFlight, 0u);
+
+            mClient->disconnect();
+            mServer->stop();
+            secondary.stop();
+        }
+    }
+
+    TEST_F(AIClientTest, requests_should_fail_over_to_remaining_endpoint)
+    {
+        AI::StubServer second{ AI::StubServerOptions() };
+        ASSERT_TRUE(second.start());
+
+        AI::ClientOptions clientOptions;
+        clientOptions.endpoints = { { "127.0.0.1", second.getPort() } };
+        clientOptions.balance.healthInterval = 20ms;
+        start({}, clientOptions);
+
+        const auto talkToAll = [&] {
+            for (int npc = 0; npc < 16; ++npc)
+            {
+                AI::DialogueRequest request = makeRequest("Hello");
+                request.npcId = "npc" + std::to_string(npc);
+                std::promise<AI::DialogueResultPtr> promise;
+                std::future<AI::DialogueResultPtr> result = promise.get_future();
+                mClient->sendDialogueRequest(
+                    std::move(request), [&](const AI::DialogueResultPtr& reply) { promise.set_value(reply); });
+                ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+                EXPECT_FALSE(result.get()->error);
+            }
+        };
+
+        // NPCs are spread over both servers
+        talkToAll();
+        EXPECT_GT(mServer->getRequestCount(), 0u);
+        EXPECT_GT(second.getRequestCount(), 0u);
+
+        second.stop();
+        ASSERT_TRUE(waitUntil([&] { return mClient->getStats().endpoints[1].state == AI::EndpointState::Down; }));
+
+        const std::size_t before = mServer->getRequestCount();
+        talkToAll();
+        EXPECT_EQ(mServer->getRequestCount(), before + 16);
+
+        const AI::ClientStats stats = mClient->getStats();
+        ASSERT_EQ(stats.endpoints.size(), 2u);
+        EXPECT_EQ(stats.endpoints[0].state, AI::EndpointState::Up);
+        EXPECT_EQ(stats.endpoints[0].port, mServer->getPort());
+        EXPECT_EQ(stats.endpoints[0].outstanding, 0u);
+    }
+
+    TEST_F(AIClientTest, version_one_replies_should_be_matched_in_order)
+    {
+        AI::StubServerOptions options;
+        options.protocolVersion = 1;
+        options.dialogueLatency = *AI::LatencyDistribution::parse("uniform:0:20");
+        start(options);
+
+        std::vector<std::future<AI::DialogueResultPtr>> results;
+        for (int i = 0; i < 8; ++i)
+            results.push_back(sendDialogue(*mClient, "Message " + std::to_string(i)));
+        for (int i = 0; i < 8; ++i)
+        {
+            ASSERT_EQ(results[i].wait_for(2s), std::future_status::ready);
+            EXPECT_EQ(results[i].get()->text, "You said: Message " + std::to_string(i));
+        }
+        EXPECT_EQ(mClient->getStats().endpoints[0].protocol, 1u);
+    }
+
+    TEST_F(AIClientTest, event_should_overtake_dialogue_waiting_for_window)
+    {
+        AI::StubServerOptions options;
+        options.maxInFlight = 1;
+        options.dialogueLatency = *AI::LatencyDistribution::parse("constant:300");
+        start(options);
+
+        std::future<AI::DialogueResultPtr> first = sendDialogue(*mClient, "First");
+        std::future<AI::DialogueResultPtr> second = sendDialogue(*mClient, "Second");
+
+        std::promise<bool> promise;
+        std::future<bool> ack = promise.get_future();
+        AI::EventRequest request;
+        request.npcId = "test_npc";
+        request.event.type = AI::EventType::PlayerCompletedQuest;
+        request.event.questId = "test_quest";
+        mClient->sendEvent(std::move(request), [&](bool success) { promise.set_value(success); });
+
+        // The event is written while the second dialogue still waits for the first one's slot
+        ASSERT_EQ(ack.wait_for(200ms), std::future_status::ready);
+        EXPECT_TRUE(ack.get());
+        EXPECT_EQ(first.wait_for(0s), std::future_status::timeout);
+        EXPECT_EQ(mServer->getRequestCount(), 2u);
+
+        ASSERT_EQ(second.wait_for(2s), std::future_status::ready);
+        EXPECT_EQ(second.get()->text, "You said: Second");
+        EXPECT_EQ(mClient->getStats().endpoints[0].maxInFlight, 1u);
+    }
+
+    TEST_F(AIClientTest, voice_reply_should_be_delivered_before_synthesis_ends)
+    {
+        AI::StubServerOptions options;
+        options.voiceChunks = 10;
+        options.voiceChunkSize = 1024;
+        options.voiceChunkInterval = 50ms;
+        AI::ClientOptions clientOptions;
+        clientOptions.voice.stream = true;
+        clientOptions.voice.prebuffer = 2048;
+        start(options, clientOptions);
+
+        // The callback fires once the prebuffer arrived, while the rest is still being synthesized
+        std::promise<AI::DialogueResultPtr> promise;
+        std::future<AI::DialogueResultPtr> result = promise.get_future();
+        bool completeAtCallback = true;
+        mClient->sendDialogueRequest(makeRequest("Hello"), [&](const AI::DialogueResultPtr& dialogue) {
+            completeAtCallback = dialogue->voice && dialogue->voice->isComplete();
+            promise.set_value(dialogue);
+        });
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+        const AI::DialogueResultPtr dialogue = result.get();
+        EXPECT_EQ(dialogue->text, "You said: Hello");
+        ASSERT_TRUE(dialogue->voice);
+        EXPECT_FALSE(completeAtCallback);
+        EXPECT_EQ(dialogue->voice->getFormat(), "pcm16");
+
+        // Drain the stream like an audio decoder would, in chunk order
+        std::string audio;
+        ASSERT_TRUE(waitUntil([&] {
+            char buffer[700];
+            while (const std::size_t count = dialogue->voice->read(buffer, sizeof(buffer)))
+                audio.append(buffer, count);
+            return dialogue->voice->isFinished();
+        }));
+        ASSERT_EQ(audio.size(), 10240u);
+        EXPECT_EQ(audio[0], 0);
+        EXPECT_EQ(audio[1024], 1);
+        EXPECT_EQ(audio[10239], 9);
+        EXPECT_FALSE(dialogue->voice->isTruncated());
+
+        const AI::ClientStats stats = mClient->getStats();
+        EXPECT_EQ(stats.voice.streams, 1u);
+        EXPECT_EQ(stats.voice.bytes, 10240u);
+        EXPECT_EQ(stats.voice.truncated, 0u);
+    }
+
+    TEST_F(AIClientTest, voice_reply_should_be_released_when_audio_stalls)
+    {
+        // The only chunk comes long after the text, and nothing else arrives meanwhile
+        AI::StubServerOptions options;
+        options.voiceChunks = 1;
+        options.voiceChunkInterval = 2s;
+        AI::ClientOptions clientOptions;
+        clientOptions.voice.stream = true;
+        clientOptions.voice.prebuffer = 2048;
+        clientOptions.voice.prebufferWait = 100ms;
+        start(options, clientOptions);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+        ASSERT_EQ(result.wait_for(1s), std::future_status::ready);
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 100ms);
+        const AI::DialogueResultPtr dialogue = result.get();
+        EXPECT_EQ(dialogue->text, "You said: Hello");
+        ASSERT_TRUE(dialogue->voice);
+        EXPECT_EQ(dialogue->voice->getReceived(), 0u);
+    }
+
+    TEST_F(AIClientTest, cached_voice_line_should_be_served_without_streaming)
+    {
+        const std::filesystem::path cacheFile = std::filesystem::temp_directory_path()
+            / ("openmw_ai_client_voice_" + std::to_string(std::random_device{}()) + ".pack");
+        AI::StubServerOptions options;
+        options.voiceChunks = 4;
+        options.voiceChunkSize = 256;
+        options.voiceChunkInterval = 20ms;
+        AI::ClientOptions clientOptions;
+        clientOptions.voice.stream = true;
+        clientOptions.voice.prebuffer = 0;
+        clientOptions.voice.cacheFile = cacheFile.string();
+        start(options, clientOptions);
+
+        // The first time the line is streamed and recorded once complete
+        std::future<AI::DialogueResultPtr> first = sendDialogue(*mClient, "Hello");
+        ASSERT_EQ(first.wait_for(2s), std::future_status::ready);
+        const AI::DialogueResultPtr streamed = first.get();
+        ASSERT_TRUE(streamed->voice);
+        ASSERT_TRUE(waitUntil([&] { return mClient->getStats().voiceCache.entries == 1; }));
+
+        // The second time it comes from the cache, and the rest of the stream is cancelled
+        std::future<AI::DialogueResultPtr> second = sendDialogue(*mClient, "hello");
+        ASSERT_EQ(second.wait_for(2s), std::future_status::ready);
+        const AI::DialogueResultPtr cached = second.get();
+        EXPECT_FALSE(cached->voice);
+        ASSERT_TRUE(cached->voiceClip);
+        EXPECT_EQ(cached->voiceClip->format, "pcm16");
+        ASSERT_EQ(cached->voiceClip->audio.size(), 1024u);
+        EXPECT_EQ(cached->voiceClip->audio[1023], 3);
+
+        std::this_thread::sleep_for(150ms);
+        const AI::ClientStats stats = mClient->getStats();
+        EXPECT_EQ(stats.voice.streams, 1u);
+        EXPECT_EQ(stats.voice.bytes, 1024u);
+        EXPECT_EQ(stats.voiceCache.hits, 1u);
+
+        mClient->disconnect();
+        mClient.reset();
+        std::filesystem::remove(cacheFile);
+    }
+
+    TEST_F(AIClientTest, completed_request_should_be_recorded_in_stats)
+    {
+        start();
+        std::future<AI::DialogueResultPtr> result = sendDialogue(*mClient, "Hello");
+        ASSERT_EQ(result.wait_for(2s), std::future_status::ready);
+
+        // Latencies are recorded after the callback returns
+        ASSERT_TRUE(waitUntil([&] {
+            return mClient->getStats().latency[static_cast<std::size_t>(AI::RequestKind::Dialogue)]
+                                                 [static_cast<std::size_t>(AI::LatencyStage::Total)]
+                                                     .count
+                == 1;
+        }));
+
+        const AI::ClientStats stats = mClient->getStats();
+        EXPECT_EQ(stats.requestsSent, 1u);
+        EXPECT_EQ(stats.responsesReceived, 1u);
+        EXPECT_EQ(stats.inFlight, 0u);
+        EXPECT_GT(stats.bytesOut, 0u);
+        EXPECT_GT(stats.bytesIn, 0u);
+    }
+}
@@ -0,0 +1,130 @@
+#include <components/ai_client/dialoguefanout.hpp>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using PlayerId = AI::DialogueFanout::PlayerId;
+
+    AI::DialogueRequest makeRequest(std::string npcId, std::string playerMessage)
+    {
+        AI::DialogueRequest request;
+        request.npcId = std::move(npcId);
+        request.playerMessage = std::move(playerMessage);
+        return request;
+    }
+
+    AI::DialogueResultPtr makeReply(std::string text)
+    {
+        auto result = std::make_shared<AI::DialogueResult>();
+        result->text = std::move(text);
+        return result;
+    }
+
+    struct AIDialogueFanoutTest : ::testing::Test
+    {
+        // Requests "sent" to the AI server, completed by the test
+        std::vector<std::pair<AI::DialogueRequest, AI::DialogueCallback>> mSent;
+        std::vector<std::pair<PlayerId, AI::SharedDialogue>> mDelivered;
+
+        AI::DialogueFanout mFanout{
+            [this](AI::DialogueRequest request, AI::DialogueCallback callback) {
+                mSent.emplace_back(std::move(request), std::move(callback));
+            },
+            [this](PlayerId player, const AI::SharedDialogue& dialogue) { mDelivered.emplace_back(player, dialogue); },
+            100ms,
+        };
+
+        std::vector<PlayerId> deliveredTo() const
+        {
+            std::vector<PlayerId> players;
+            for (const auto& delivery : mDelivered)
+                players.push_back(delivery.first);
+            return players;
+        }
+    };
+
+    TEST_F(AIDialogueFanoutTest, requests_for_same_conversation_should_share_one_generation)
+    {
+        mFanout.setPlayerCell(1, "Balmora");
+        mFanout.setPlayerCell(2, "Balmora");
+        mFanout.setPlayerCell(3, "Balmora");
+
+        std::vector<std::string> replies;
+        auto callback = [&](const AI::DialogueResultPtr& result) { replies.push_back(result->text); };
+        EXPECT_TRUE(mFanout.request(1, "", makeRequest("caius", "Hello"), callback));
+        EXPECT_FALSE(mFanout.request(2, "", makeRequest("caius", "Greetings"), callback));
+        ASSERT_EQ(mSent.size(), 1u);
+        EXPECT_EQ(mSent[0].first.playerMessage, "Hello");
+
+        mSent[0].second(makeReply("Well met"));
+        EXPECT_EQ(replies, std::vector<std::string>({ "Well met", "Well met" }));
+        EXPECT_EQ(deliveredTo(), std::vector<PlayerId>({ 1, 2, 3 }));
+        EXPECT_EQ(mDelivered[0].second.speaker, 1u);
+        EXPECT_EQ(mDelivered[0].second.cell, "Balmora");
+
+        const AI::FanoutStats stats = mFanout.getStats();
+        EXPECT_EQ(stats.requests, 2u);
+        EXPECT_EQ(stats.generations, 1u);
+        EXPECT_EQ(stats.deliveries, 3u);
+    }
+
+    TEST_F(AIDialogueFanoutTest, different_cells_and_conversations_should_not_be_shared)
+    {
+        mFanout.setPlayerCell(1, "Balmora");
+        mFanout.setPlayerCell(2, "Vivec");
+
+        EXPECT_TRUE(mFanout.request(1, "", makeRequest("caius", "Hello"), {}));
+        EXPECT_TRUE(mFanout.request(2, "", makeRequest("caius", "Hello"), {}));
+        EXPECT_TRUE(mFanout.request(1, "quest", makeRequest("caius", "Hello"), {}));
+        EXPECT_TRUE(mFanout.request(1, "", makeRequest("ajira", "Hello"), {}));
+        ASSERT_EQ(mSent.size(), 4u);
+
+        mSent[1].second(makeReply("Vivec reply"));
+        EXPECT_EQ(deliveredTo(), std::vector<PlayerId>({ 2 }));
+    }
+
+    TEST_F(AIDialogueFanoutTest, error_reply_should_only_reach_requesters)
+    {
+        mFanout.setPlayerCell(1, "Balmora");
+        mFanout.setPlayerCell(2, "Balmora");
+
+        mFanout.request(1, "", makeRequest("caius", "Hello"), {});
+        mSent[0].second(AI::makeDialogueError("Server error"));
+        EXPECT_EQ(deliveredTo(), std::vector<PlayerId>({ 1 }));
+    }
+
+    TEST_F(AIDialogueFanoutTest, removed_player_should_not_receive_reply)
+    {
+        mFanout.setPlayerCell(1, "Balmora");
+        mFanout.setPlayerCell(2, "Balmora");
+
+        mFanout.request(1, "", makeRequest("caius", "Hello"), {});
+        mFanout.removePlayer(1);
+        mSent[0].second(makeReply("Well met"));
+        EXPECT_EQ(deliveredTo(), std::vector<PlayerId>({ 2 }));
+    }
+
+    TEST_F(AIDialogueFanoutTest, stale_conversation_should_be_sent_again)
+    {
+        mFanout.setPlayerCell(1, "Balmora");
+
+        int replies = 0;
+        auto callback = [&](const AI::DialogueResultPtr&) { ++replies; };
+        mFanout.request(1, "", makeRequest("caius", "Hello"), callback);
+        std::this_thread::sleep_for(150ms);
+        EXPECT_TRUE(mFanout.request(1, "", makeRequest("caius", "Hello?"), callback));
+        ASSERT_EQ(mSent.size(), 2u);
+
+        // The lost reply turns up late and is ignored; the new one completes both requests
+        mSent[0].second(makeReply("Late"));
+        EXPECT_EQ(replies, 0);
+        mSent[1].second(makeReply("Well met"));
+        EXPECT_EQ(replies, 2);
+        ASSERT_EQ(mDelivered.size(), 1u);
+        EXPECT_EQ(mDelivered[0].second.result->text, "Well met");
+    }
+}
@@ -0,0 +1,78 @@
+#include <components/ai_client/hedgepolicy.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    AI::HedgeOptions makeOptions()
+    {
+        AI::HedgeOptions options;
+        options.host = "127.0.0.1";
+        options.port = 1;
+        return options;
+    }
+
+    TEST(AIHedgePolicyTest, hedging_should_be_disabled_without_host)
+    {
+        EXPECT_FALSE(AI::HedgePolicy(AI::HedgeOptions()).isEnabled());
+        EXPECT_TRUE(AI::HedgePolicy(makeOptions()).isEnabled());
+    }
+
+    TEST(AIHedgePolicyTest, delay_should_follow_latency_percentile)
+    {
+        AI::HedgeOptions options = makeOptions();
+        options.initialDelay = 1000ms;
+        AI::HedgePolicy policy(options);
+        EXPECT_EQ(policy.getDelay(), 1000ms);
+
+        // 1 ms to 100 ms; the 90th percentile is 90 ms
+        for (int i = 1; i <= 100; ++i)
+            policy.recordLatency(std::chrono::milliseconds(i));
+        policy.recordLatency(100ms);
+        for (int i = 0; i < 11; ++i)
+            policy.recordLatency(50ms);
+
+        EXPECT_EQ(policy.getDelay(), 90ms);
+        EXPECT_EQ(policy.getStats().delay, 90000u);
+    }
+
+    TEST(AIHedgePolicyTest, delay_should_stay_within_bounds)
+    {
+        AI::HedgeOptions options = makeOptions();
+        options.minDelay = 20ms;
+        options.maxDelay = 200ms;
+        AI::HedgePolicy fast(options);
+        AI::HedgePolicy slow(options);
+        for (int i = 0; i < 64; ++i)
+        {
+            fast.recordLatency(1ms);
+            slow.recordLatency(5s);
+        }
+        EXPECT_EQ(fast.getDelay(), 20ms);
+        EXPECT_EQ(slow.getDelay(), 200ms);
+    }
+
+    TEST(AIHedgePolicyTest, budget_should_cap_hedges)
+    {
+        AI::HedgeOptions options = makeOptions();
+        options.budget = 0.25;
+        AI::HedgePolicy policy(options);
+
+        // One hedge of initial credit, then one per four requests
+        EXPECT_TRUE(policy.tryHedge());
+        EXPECT_FALSE(policy.tryHedge());
+        for (int i = 0; i < 3; ++i)
+            policy.onRequest();
+        EXPECT_FALSE(policy.tryHedge());
+        policy.onRequest();
+        EXPECT_TRUE(policy.tryHedge());
+        policy.onWon();
+
+        const AI::HedgeStats stats = policy.getStats();
+        EXPECT_EQ(stats.fired, 2u);
+        EXPECT_EQ(stats.won, 1u);
+        EXPECT_EQ(stats.overBudget, 2u);
+    }
+}
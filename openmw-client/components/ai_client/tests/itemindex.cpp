@@ -0,0 +1,59 @@
+#include <components/ai_client/itemindex.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    struct AIItemIndexTest : ::testing::Test
+    {
+        AI::ItemIndex mIndex{ {
+            { "gold_001", "Gold" },
+            { "gold_005", "Gold" },
+            { "p_restore_health_s", "Standard Restore Health" },
+            { "iron dagger", "Iron Dagger" },
+            { "Misc_SoulGem_Petty", "Petty Soul Gem" },
+            { "silver_longsword", "Silver Longsword" },
+            { "silver_shortsword", "Silver Shortsword" },
+            { "GOLD_001", "" },
+        } };
+
+        std::string resolve(std::string_view text, AI::ItemMatch expected)
+        {
+            AI::ItemId id;
+            EXPECT_EQ(mIndex.resolve(text, id), expected) << text;
+            return std::string(id.view());
+        }
+    };
+
+    TEST_F(AIItemIndexTest, record_ids_should_be_found_in_any_case)
+    {
+        EXPECT_EQ(mIndex.getSize(), 7u);
+        EXPECT_EQ(resolve("gold_001", AI::ItemMatch::Exact), "gold_001");
+        EXPECT_EQ(resolve("misc_soulgem_petty", AI::ItemMatch::Normalized), "Misc_SoulGem_Petty");
+        EXPECT_EQ(resolve(" P_Restore_Health_S ", AI::ItemMatch::Normalized), "p_restore_health_s");
+        EXPECT_EQ(resolve("iron dagger", AI::ItemMatch::Exact), "iron dagger");
+        EXPECT_EQ(resolve("silver longsword", AI::ItemMatch::Name), "silver_longsword");
+    }
+
+    TEST_F(AIItemIndexTest, names_and_typos_should_be_resolved)
+    {
+        // The first record with a name is the one it stands for
+        EXPECT_EQ(resolve("gold", AI::ItemMatch::Name), "gold_001");
+        EXPECT_EQ(resolve("Petty Soul Gem", AI::ItemMatch::Name), "Misc_SoulGem_Petty");
+        EXPECT_EQ(resolve("misc soulgem petty", AI::ItemMatch::Normalized), "Misc_SoulGem_Petty");
+        EXPECT_EQ(resolve("p_restor_health_s", AI::ItemMatch::Fuzzy), "p_restore_health_s");
+        EXPECT_EQ(resolve("gold_0001", AI::ItemMatch::Fuzzy), "gold_001");
+    }
+
+    TEST_F(AIItemIndexTest, unknown_and_ambiguous_items_should_be_rejected)
+    {
+        resolve("ebony_mail", AI::ItemMatch::Unknown);
+        resolve("", AI::ItemMatch::Unknown);
+
+        // One typo from either gold pile
+        resolve("gold_00", AI::ItemMatch::Unknown);
+
+        // Short IDs get no typos
+        resolve("gld", AI::ItemMatch::Unknown);
+    }
+}
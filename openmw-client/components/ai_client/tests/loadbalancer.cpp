@@ -0,0 +1,102 @@
+#include <components/ai_client/loadbalancer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using Clock = AI::LoadBalancer::Clock;
+
+    void setAllUp(AI::LoadBalancer& balancer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            balancer.setState(i, AI::EndpointState::Up, Clock::now());
+    }
+
+    TEST(AILoadBalancerTest, no_endpoint_should_be_chosen_while_all_are_down)
+    {
+        AI::LoadBalancer balancer(2);
+        EXPECT_EQ(balancer.acquire("npc"), AI::LoadBalancer::sNone);
+    }
+
+    TEST(AILoadBalancerTest, npc_should_stick_to_its_endpoint)
+    {
+        AI::LoadBalancer balancer(4);
+        setAllUp(balancer, 4);
+
+        // Released at once, so load never outweighs the preference
+        std::set<std::size_t> used;
+        for (int npc = 0; npc < 32; ++npc)
+        {
+            const std::string npcId = "npc" + std::to_string(npc);
+            const std::size_t endpoint = balancer.acquire(npcId);
+            balancer.release(endpoint, false, 500us);
+            for (int i = 0; i < 4; ++i)
+            {
+                EXPECT_EQ(balancer.acquire(npcId), endpoint);
+                balancer.release(endpoint, false, 500us);
+            }
+            used.insert(endpoint);
+        }
+        EXPECT_GT(used.size(), 1u);
+    }
+
+    TEST(AILoadBalancerTest, busy_endpoint_should_be_avoided)
+    {
+        AI::BalanceOptions options;
+        options.stickiness = 1.0;
+        AI::LoadBalancer balancer(2, options);
+        setAllUp(balancer, 2);
+
+        // Anonymous requests alternate while both endpoints are equally loaded
+        const std::size_t first = balancer.acquire("");
+        const std::size_t second = balancer.acquire("");
+        EXPECT_NE(first, second);
+
+        // A slow endpoint gets fewer requests
+        balancer.release(first, false, 100ms);
+        balancer.release(second, false, 1ms);
+        for (int i = 0; i < 10; ++i)
+            EXPECT_EQ(balancer.acquire(""), second);
+        EXPECT_EQ(balancer.getStats()[second].outstanding, 10u);
+    }
+
+    TEST(AILoadBalancerTest, failing_endpoint_should_be_drained)
+    {
+        AI::BalanceOptions options;
+        options.failureThreshold = 2;
+        AI::LoadBalancer balancer(2, options);
+        setAllUp(balancer, 2);
+
+        EXPECT_FALSE(balancer.release(0, true, -1us));
+        EXPECT_TRUE(balancer.release(0, true, -1us));
+        EXPECT_EQ(balancer.getState(0), AI::EndpointState::Draining);
+        EXPECT_TRUE(balancer.isDrained(0, Clock::now()));
+
+        // The last endpoint up is never drained
+        EXPECT_FALSE(balancer.release(1, true, -1us));
+        EXPECT_FALSE(balancer.release(1, true, -1us));
+        EXPECT_EQ(balancer.getState(1), AI::EndpointState::Up);
+        for (int i = 0; i < 4; ++i)
+            EXPECT_EQ(balancer.acquire("npc"), 1u);
+        EXPECT_EQ(balancer.getStats()[0].failures, 2u);
+    }
+
+    TEST(AILoadBalancerTest, drain_should_wait_for_outstanding_requests)
+    {
+        AI::BalanceOptions options;
+        options.drainTimeout = 1s;
+        AI::LoadBalancer balancer(1, options);
+        setAllUp(balancer, 1);
+        ASSERT_EQ(balancer.acquire("npc"), 0u);
+
+        const Clock::time_point now = Clock::now();
+        balancer.setState(0, AI::EndpointState::Draining, now);
+        EXPECT_FALSE(balancer.isDrained(0, now));
+        EXPECT_TRUE(balancer.isDrained(0, now + 1s));
+        balancer.release(0, false, 1ms);
+        EXPECT_TRUE(balancer.isDrained(0, now));
+    }
+}
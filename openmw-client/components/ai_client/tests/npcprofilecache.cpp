@@ -0,0 +1,78 @@
+#include <components/ai_client/npcprofilecache.hpp>
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+namespace
+{
+    struct AINpcProfileCacheTest : ::testing::Test
+    {
+        AI::NpcProfileCache mCache;
+        std::map<std::string, AI::NpcRecord> mRecords;
+        std::size_t mLookups = 0;
+
+        void SetUp() override
+        {
+            mRecords["fargoth"] = { "Fargoth", "Wood Elf", "Male", "Commoner", "" };
+            mRecords["sellus gravius"] = { "Sellus Gravius", "Imperial", "Male", "Guard", "Imperial Legion" };
+            mRecords["hrisskar flat-foot"] = { "Hrisskar Flat-Foot", "Nord", "Male", "Warrior", "Imperial Legion" };
+
+            mCache.setLookup([this](std::string_view recordId) -> std::optional<AI::NpcRecord> {
+                ++mLookups;
+                auto it = mRecords.find(std::string(recordId));
+                if (it == mRecords.end())
+                    return std::nullopt;
+                return it->second;
+            });
+        }
+    };
+
+    TEST_F(AINpcProfileCacheTest, profile_should_be_looked_up_once)
+    {
+        const AI::NpcProfilePtr first = mCache.get("sellus gravius");
+        EXPECT_EQ(first->name, "Sellus Gravius");
+        EXPECT_EQ(first->race, "Imperial");
+        EXPECT_EQ(first->npcClass, "Guard");
+        EXPECT_EQ(first->faction, "Imperial Legion");
+
+        // Record IDs ignore case, as in the engine
+        EXPECT_EQ(mCache.get("Sellus Gravius"), first);
+        EXPECT_EQ(mCache.get("SELLUS GRAVIUS"), first);
+        EXPECT_EQ(mLookups, 1u);
+        EXPECT_EQ(mCache.getSize(), 1u);
+
+        // Unknown NPCs are named after their record
+        EXPECT_EQ(mCache.get("nobody")->name, "nobody");
+        EXPECT_EQ(mCache.get("nobody")->race, "");
+        EXPECT_EQ(mLookups, 2u);
+    }
+
+    TEST_F(AINpcProfileCacheTest, profiles_should_share_interned_strings)
+    {
+        const AI::NpcProfilePtr sellus = mCache.get("sellus gravius");
+        const AI::NpcProfilePtr hrisskar = mCache.get("hrisskar flat-foot");
+        EXPECT_EQ(sellus->faction.data(), hrisskar->faction.data());
+        EXPECT_EQ(sellus->gender.data(), hrisskar->gender.data());
+
+        // Two names, two races, two classes, one gender and one faction
+        EXPECT_EQ(mCache.getInternedCount(), 8u);
+    }
+
+    TEST_F(AINpcProfileCacheTest, changed_record_should_be_looked_up_again)
+    {
+        const AI::NpcProfilePtr before = mCache.get("fargoth");
+        mRecords["fargoth"].name = "Fargoth the Thief";
+        EXPECT_EQ(mCache.get("fargoth")->name, "Fargoth");
+
+        mCache.onRecordChanged("Fargoth");
+        EXPECT_EQ(mCache.get("fargoth")->name, "Fargoth the Thief");
+        EXPECT_EQ(mLookups, 2u);
+
+        // Profiles handed out before stay valid after a reload
+        mCache.onRecordsReloaded();
+        EXPECT_EQ(mCache.getSize(), 0u);
+        EXPECT_EQ(before->name, "Fargoth");
+        EXPECT_EQ(before->race, "Wood Elf");
+    }
+}
@@ -0,0 +1,45 @@
+#include <components/ai_client/protocol.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    AI::ProtocolOptions makeOptions(unsigned maxInFlight)
+    {
+        AI::ProtocolOptions options;
+        options.maxInFlight = maxInFlight;
+        options.features.set(static_cast<std::size_t>(AI::ProtocolFeature::Streaming));
+        options.features.set(static_cast<std::size_t>(AI::ProtocolFeature::Batching));
+        return options;
+    }
+
+    TEST(AIProtocolTest, hello_should_advertise_window_and_features)
+    {
+        std::string hello;
+        AI::writeHello(hello, makeOptions(8));
+        EXPECT_EQ(hello, R"({"features":["streaming","batching"],"maxInFlight":8,"protocol":2,"type":"hello"})");
+    }
+
+    TEST(AIProtocolTest, welcome_should_settle_window_and_common_features)
+    {
+        const AI::Handshake handshake = AI::readWelcome(
+            R"({"type":"welcome","protocol":2,"maxInFlight":4,"features":["compression","streaming","unknown"]})",
+            makeOptions(8));
+        EXPECT_EQ(handshake.version, 2u);
+        EXPECT_EQ(handshake.maxInFlight, 4u);
+        EXPECT_TRUE(handshake.features.test(static_cast<std::size_t>(AI::ProtocolFeature::Streaming)));
+        EXPECT_EQ(handshake.features.count(), 1u);
+
+        // A server without a limit takes the client's
+        EXPECT_EQ(AI::readWelcome(R"({"type":"welcome","protocol":2,"maxInFlight":0})", makeOptions(8)).maxInFlight, 8u);
+    }
+
+    TEST(AIProtocolTest, error_reply_should_fall_back_to_version_one)
+    {
+        const AI::Handshake handshake
+            = AI::readWelcome(R"({"type":"error","error":"Unknown message type: hello","code":400})", makeOptions(8));
+        EXPECT_EQ(handshake.version, 1u);
+        EXPECT_EQ(handshake.maxInFlight, 0u);
+        EXPECT_TRUE(handshake.features.none());
+    }
+}
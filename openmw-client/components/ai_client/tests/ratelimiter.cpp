@@ -0,0 +1,106 @@
+#include <components/ai_client/ratelimiter.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using Clock = AI::RateLimiter::Clock;
+
+    AI::RateLimit makeLimit(double rate, double burst, AI::RateLimitPolicy policy)
+    {
+        AI::RateLimit limit;
+        limit.rate = rate;
+        limit.burst = burst;
+        limit.policy = policy;
+        return limit;
+    }
+
+    TEST(AIRateLimiterTest, disabled_limiter_should_admit_everything)
+    {
+        AI::RateLimiter limiter;
+        const Clock::time_point now = Clock::now();
+        for (int i = 0; i < 100; ++i)
+        {
+            const AI::RateLimiter::Admission admission = limiter.acquire(AI::RequestKind::Dialogue, "npc", now);
+            EXPECT_EQ(admission.action, AI::RateLimitAction::Admit);
+            EXPECT_EQ(admission.notBefore, now);
+        }
+        EXPECT_EQ(limiter.getStats().admitted, 100u);
+    }
+
+    TEST(AIRateLimiterTest, delay_policy_should_space_requests_at_the_rate)
+    {
+        AI::RateLimitOptions options;
+        options.global = makeLimit(10.0, 2.0, AI::RateLimitPolicy::Delay);
+        AI::RateLimiter limiter(options);
+
+        const Clock::time_point now = Clock::now();
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Event, "a", now).notBefore, now);
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Event, "b", now).notBefore, now);
+
+        // The burst is spent; each further request waits one more tenth of a second
+        const AI::RateLimiter::Admission third = limiter.acquire(AI::RequestKind::Event, "c", now);
+        const AI::RateLimiter::Admission fourth = limiter.acquire(AI::RequestKind::Event, "d", now);
+        EXPECT_EQ(third.action, AI::RateLimitAction::Admit);
+        EXPECT_NEAR(std::chrono::duration<double>(third.notBefore - now).count(), 0.1, 1e-6);
+        EXPECT_NEAR(std::chrono::duration<double>(fourth.notBefore - now).count(), 0.2, 1e-6);
+
+        const AI::RateLimitStats stats = limiter.getStats();
+        EXPECT_EQ(stats.admitted, 2u);
+        EXPECT_EQ(stats.delayed, 2u);
+        EXPECT_EQ(stats.limitedBy[static_cast<std::size_t>(AI::RateLimitScope::Global)], 2u);
+    }
+
+    TEST(AIRateLimiterTest, delay_beyond_max_delay_should_reject)
+    {
+        AI::RateLimitOptions options;
+        options.global = makeLimit(1.0, 1.0, AI::RateLimitPolicy::Delay);
+        options.maxDelay = 1500ms;
+        AI::RateLimiter limiter(options);
+
+        const Clock::time_point now = Clock::now();
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Admit);
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Admit);
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Reject);
+        EXPECT_EQ(limiter.getStats().rejected, 1u);
+    }
+
+    TEST(AIRateLimiterTest, per_npc_buckets_should_be_independent)
+    {
+        AI::RateLimitOptions options;
+        options.perNpc = makeLimit(1.0, 1.0, AI::RateLimitPolicy::Drop);
+        AI::RateLimiter limiter(options);
+
+        const Clock::time_point now = Clock::now();
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Admit);
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Drop);
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "b", now).action, AI::RateLimitAction::Admit);
+
+        // Refilled after a second
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now + 1s).action, AI::RateLimitAction::Admit);
+
+        const AI::RateLimitStats stats = limiter.getStats();
+        EXPECT_EQ(stats.dropped, 1u);
+        EXPECT_EQ(stats.limitedBy[static_cast<std::size_t>(AI::RateLimitScope::Npc)], 1u);
+        EXPECT_EQ(stats.npcBuckets, 2u);
+    }
+
+    TEST(AIRateLimiterTest, rejected_request_should_not_take_tokens)
+    {
+        AI::RateLimitOptions options;
+        options.perKind[static_cast<std::size_t>(AI::RequestKind::Dialogue)]
+            = makeLimit(1.0, 1.0, AI::RateLimitPolicy::Reject);
+        options.global = makeLimit(1.0, 2.0, AI::RateLimitPolicy::Delay);
+        AI::RateLimiter limiter(options);
+
+        const Clock::time_point now = Clock::now();
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Admit);
+        EXPECT_EQ(limiter.acquire(AI::RequestKind::Dialogue, "a", now).action, AI::RateLimitAction::Reject);
+
+        // The rejected dialogue left its global token for the event
+        const AI::RateLimiter::Admission event = limiter.acquire(AI::RequestKind::Event, "a", now);
+        EXPECT_EQ(event.action, AI::RateLimitAction::Admit);
+        EXPECT_EQ(event.notBefore, now);
+    }
+}
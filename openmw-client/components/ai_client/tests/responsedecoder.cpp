@@ -0,0 +1,50 @@
+#include <components/ai_client/responsedecoder.hpp>
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace
+{
+    using Key = AI::ActionParams::Key;
+
+    constexpr std::string_view sPayload = R"({"type":"dialogue","requestId":"r1","text":"Take these.","actions":[
+        {"type":"GIVE_ITEM","params":{"itemId":"gold_001","quantity":true,"reason":{"why":"debt"},
+        "description":99999999999,"target":{"id":"player"},"emote":["smile"],"note":null,"weight":2.5}}]})";
+
+    void expectSameActions(const AI::DecodedResponse& streamed, const AI::DecodedResponse& dom)
+    {
+        ASSERT_TRUE(streamed.dialogue && dom.dialogue);
+        ASSERT_EQ(streamed.dialogue->actions.size(), 1u);
+        ASSERT_EQ(dom.dialogue->actions.size(), 1u);
+
+        const AI::ActionParams& left = streamed.dialogue->actions[0].params;
+        const AI::ActionParams& right = dom.dialogue->actions[0].params;
+        for (std::size_t i = 0; i < AI::ActionParams::sKeyCount; ++i)
+        {
+            const Key key = static_cast<Key>(i);
+            EXPECT_EQ(left.get(key), right.get(key)) << AI::ActionParams::keyToString(key);
+        }
+        EXPECT_EQ(left.getExtras(), right.getExtras());
+    }
+
+    TEST(AIResponseDecoderTest, structured_params_should_decode_alike_on_both_paths)
+    {
+        AI::ResponseDecoder decoder;
+        AI::DecodedResponse streamed;
+        ASSERT_TRUE(decoder.decode(sPayload, streamed));
+        AI::DecodedResponse dom;
+        ASSERT_TRUE(AI::ResponseDecoder::decodeDom(sPayload, dom));
+        expectSameActions(streamed, dom);
+
+        // Objects, arrays and nulls are skipped; booleans are numbers
+        const AI::ActionParams& params = streamed.dialogue->actions[0].params;
+        EXPECT_FALSE(params.has(Key::Reason));
+        EXPECT_EQ(params.getInt(Key::Quantity), 1);
+        EXPECT_EQ(params.getInt(Key::Description), std::numeric_limits<std::int32_t>::max());
+        EXPECT_EQ(params.getExtras().count("target"), 0u);
+        EXPECT_EQ(params.getExtras().count("emote"), 0u);
+        EXPECT_EQ(params.getExtras().count("note"), 0u);
+        EXPECT_EQ(params.getExtras().at("weight"), "2.5");
+    }
+}
@@ -0,0 +1,52 @@
+#include <components/ai_client/textfilter.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    std::string sanitized(std::string text, AI::TextEncoding encoding = AI::TextEncoding::Utf8)
+    {
+        AI::sanitizeText(text, encoding);
+        return text;
+    }
+
+    TEST(AITextFilterTest, plain_text_should_be_unchanged)
+    {
+        const std::string text = "Welcome to Seyda Neen.\n\tI'm Sellus Gravius, and I'll be processing your release.";
+        EXPECT_EQ(AI::findNonPlainByte(text), text.size());
+        EXPECT_EQ(sanitized(text), text);
+        EXPECT_EQ(sanitized(""), "");
+    }
+
+    TEST(AITextFilterTest, typographic_characters_should_become_ascii)
+    {
+        EXPECT_EQ(sanitized("\xE2\x80\x9CWait\xE2\x80\xA6\xE2\x80\x9D he said \xE2\x80\x94 it\xE2\x80\x99s Fargoth"),
+            "\"Wait...\" he said -- it's Fargoth");
+        EXPECT_EQ(sanitized("5\xE2\x80\x93" "10 septims\xC2\xA0\xE2\x80\xA2 cheap"), "5-10 septims * cheap");
+        EXPECT_EQ(sanitized("\xEF\xBB\xBFzero\xE2\x80\x8Bwidth"), "zerowidth");
+    }
+
+    TEST(AITextFilterTest, control_characters_should_be_removed)
+    {
+        EXPECT_EQ(sanitized("line\r\none\x01\x7F\ttwo\xC2\x85!"), "line\none\ttwo!");
+
+        // Found past the first 16 bytes, by the vectorized scan
+        const std::string text = std::string(40, 'a') + '\x1B' + "b";
+        EXPECT_EQ(AI::findNonPlainByte(text), 40u);
+        EXPECT_EQ(sanitized(text), std::string(40, 'a') + "b");
+    }
+
+    TEST(AITextFilterTest, invalid_utf8_should_become_question_marks)
+    {
+        // A lone continuation byte, a truncated sequence, an overlong form and a surrogate
+        EXPECT_EQ(sanitized("a\x80" "b\xE2\x80" "c\xC0\xAF" "d\xED\xA0\x80" "e"), "a?b?c??d???e");
+        EXPECT_EQ(sanitized("end\xF0\x9F"), "end?");
+    }
+
+    TEST(AITextFilterTest, characters_should_be_limited_to_windows1252)
+    {
+        // Latin-1 letters and the euro sign are in the fonts; CJK and emoji are not
+        EXPECT_EQ(sanitized("Caf\xC3\xA9 \xE2\x82\xAC" "5 \xE6\x97\xA5 \xF0\x9F\x98\x80"), "Caf\xC3\xA9 \xE2\x82\xAC" "5 ? ?");
+        EXPECT_EQ(sanitized("Caf\xC3\xA9 \xE2\x82\xAC" "5 \xE2\x80\x99", AI::TextEncoding::Windows1252), "Caf\xE9 \x80" "5 '");
+    }
+}
@@ -0,0 +1,56 @@
+#include <components/ai_client/topicmatcher.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    std::vector<std::string> findTopics(const AI::TopicMatcher& matcher, std::string_view text)
+    {
+        std::vector<AI::TopicSpan> spans;
+        matcher.match(text, spans);
+
+        std::vector<std::string> found;
+        for (const AI::TopicSpan& span : spans)
+        {
+            EXPECT_EQ(text.substr(span.offset, span.length).size(), span.topic.size());
+            found.emplace_back(span.topic);
+        }
+        return found;
+    }
+
+    TEST(AITopicMatcherTest, topics_should_be_found_in_text_order)
+    {
+        const AI::TopicMatcher matcher({ "Balmora", "Caius Cosades", "latest rumors", "Blades" });
+        const std::string text = "Go to Balmora and find Caius Cosades. The Blades will want the latest rumors.";
+
+        std::vector<AI::TopicSpan> spans;
+        matcher.match(text, spans);
+        ASSERT_EQ(spans.size(), 4u);
+        EXPECT_EQ(spans[0].topic, "Balmora");
+        EXPECT_EQ(spans[0].offset, 6u);
+        EXPECT_EQ(spans[0].length, 7u);
+        EXPECT_EQ(text.substr(spans[1].offset, spans[1].length), "Caius Cosades");
+        EXPECT_EQ(spans[2].topic, "Blades");
+        EXPECT_EQ(spans[3].topic, "latest rumors");
+    }
+
+    TEST(AITopicMatcherTest, topics_should_match_whole_words_ignoring_case)
+    {
+        const AI::TopicMatcher matcher({ "Ashlander", "Ald'ruhn", "ash" });
+        EXPECT_EQ(findTopics(matcher, "ASHLANDERS roam near ald'ruhn."), std::vector<std::string>{ "Ald'ruhn" });
+        EXPECT_EQ(findTopics(matcher, "Ash, ash-storms and an Ashlander"),
+            (std::vector<std::string>{ "ash", "ash", "Ashlander" }));
+        EXPECT_TRUE(findTopics(matcher, "Cash and crashes").empty());
+    }
+
+    TEST(AITopicMatcherTest, overlapping_topics_should_prefer_leftmost_then_longest)
+    {
+        const AI::TopicMatcher matcher({ "Vivec", "Vivec City", "City guard", "guard" });
+        EXPECT_EQ(findTopics(matcher, "Vivec City guard"), (std::vector<std::string>{ "Vivec City", "guard" }));
+        EXPECT_EQ(findTopics(matcher, "A City guard of Vivec"), (std::vector<std::string>{ "City guard", "Vivec" }));
+
+        // Duplicates and empty topics are dropped
+        const AI::TopicMatcher duplicates({ "Vivec", "vivec", "" });
+        EXPECT_EQ(duplicates.getTopicCount(), 1u);
+    }
+}
@@ -0,0 +1,41 @@
+#include <components/ai_client/tracer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace
+{
+    TEST(AITracerTest, buffers_of_exited_threads_should_be_reused)
+    {
+        AI::Tracer& tracer = AI::Tracer::get();
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "ai_tracer_test.json";
+        tracer.start(path.string());
+
+        // Threads that come and go, like connection threads over reconnects
+        auto record = [&tracer] {
+            tracer.setThreadName("AI test");
+            const AI::Tracer::Clock::time_point now = AI::Tracer::Clock::now();
+            tracer.span("test span", now, now);
+        };
+        std::thread(record).join();
+        const std::size_t buffers = tracer.getBufferCount();
+        for (int i = 0; i < 20; ++i)
+            std::thread(record).join();
+        EXPECT_EQ(tracer.getBufferCount(), buffers);
+
+        // Events of the exited threads are still written
+        ASSERT_TRUE(tracer.stop());
+        std::ifstream file(path);
+        const std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::size_t spans = 0;
+        for (std::size_t position = trace.find("test span"); position != std::string::npos;
+             position = trace.find("test span", position + 1))
+            ++spans;
+        EXPECT_EQ(spans, 21u);
+        std::filesystem::remove(path);
+    }
+}
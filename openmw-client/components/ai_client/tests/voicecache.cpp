@@ -0,0 +1,142 @@
+#include <components/ai_client/voicecache.hpp>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <random>
+
+namespace
+{
+    struct AIVoiceCacheTest : ::testing::Test
+    {
+        std::filesystem::path mPath;
+
+        void SetUp() override
+        {
+            mPath = std::filesystem::temp_directory_path()
+                / ("openmw_ai_voicecache_" + std::to_string(std::random_device{}()) + ".pack");
+        }
+
+        void TearDown() override
+        {
+            // The pack and the generations compactions wrote next to it
+            std::error_code ec;
+            const std::string prefix = mPath.filename().string();
+            for (const auto& file : std::filesystem::directory_iterator(mPath.parent_path(), ec))
+            {
+                if (file.path().filename().string().compare(0, prefix.size(), prefix) == 0)
+                    std::filesystem::remove(file.path(), ec);
+            }
+        }
+    };
+
+    TEST_F(AIVoiceCacheTest, line_should_be_found_regardless_of_case_and_spacing)
+    {
+        AI::VoiceCache cache(mPath, 1024 * 1024);
+        ASSERT_TRUE(cache.open());
+        EXPECT_EQ(cache.find("fargoth", "Hello, outlander."), nullptr);
+
+        ASSERT_TRUE(cache.insert("fargoth", "Hello, outlander.", "mp3", "audio"));
+        const AI::VoiceClipPtr clip = cache.find("fargoth", "  hello,   OUTLANDER. ");
+        ASSERT_NE(clip, nullptr);
+        EXPECT_EQ(clip->format, "mp3");
+        EXPECT_EQ(clip->audio, "audio");
+
+        // Another voice speaking the same line is another clip
+        EXPECT_EQ(cache.find("caius", "Hello, outlander."), nullptr);
+
+        const AI::VoiceCacheStats stats = cache.getStats();
+        EXPECT_EQ(stats.entries, 1u);
+        EXPECT_EQ(stats.hits, 1u);
+        EXPECT_EQ(stats.misses, 2u);
+    }
+
+    TEST_F(AIVoiceCacheTest, pack_should_be_reindexed_and_torn_tail_cut_off)
+    {
+        {
+            AI::VoiceCache cache(mPath, 1024 * 1024);
+            ASSERT_TRUE(cache.open());
+            ASSERT_TRUE(cache.insert("fargoth", "First", "mp3", "one"));
+            ASSERT_TRUE(cache.insert("fargoth", "Second", "mp3", "two"));
+        }
+        const std::uintmax_t validSize = std::filesystem::file_size(mPath);
+        {
+            std::ofstream torn(mPath, std::ios::binary | std::ios::app);
+            torn << "AIVC and then the crash";
+        }
+
+        AI::VoiceCache cache(mPath, 1024 * 1024);
+        ASSERT_TRUE(cache.open());
+        EXPECT_EQ(std::filesystem::file_size(mPath), validSize);
+        ASSERT_NE(cache.find("fargoth", "first"), nullptr);
+        EXPECT_EQ(cache.find("fargoth", "second")->audio, "two");
+
+        // Appends continue after the valid records
+        ASSERT_TRUE(cache.insert("fargoth", "Third", "mp3", "three"));
+        EXPECT_EQ(cache.find("fargoth", "third")->audio, "three");
+    }
+
+    TEST_F(AIVoiceCacheTest, least_recently_used_clips_should_be_evicted_at_capacity)
+    {
+        // Records of about 1 KiB in a 4 KiB pack
+        AI::VoiceCache cache(mPath, 4096);
+        ASSERT_TRUE(cache.open());
+        const std::string audio(1000, 'x');
+        ASSERT_TRUE(cache.insert("v", "a", "mp3", audio));
+        ASSERT_TRUE(cache.insert("v", "b", "mp3", audio));
+        ASSERT_TRUE(cache.insert("v", "c", "mp3", audio));
+
+        // A clip handed out before the compaction stays readable after it
+        const AI::VoiceClipPtr held = cache.find("v", "a");
+        ASSERT_NE(held, nullptr);
+        ASSERT_TRUE(cache.insert("v", "d", "mp3", audio));
+
+        EXPECT_LE(std::filesystem::file_size(cache.getPath()), 4096u);
+        EXPECT_EQ(cache.find("v", "b"), nullptr);
+        EXPECT_NE(cache.find("v", "a"), nullptr);
+        EXPECT_NE(cache.find("v", "d"), nullptr);
+        EXPECT_EQ(held->audio, audio);
+        EXPECT_GT(cache.getStats().evictions, 0u);
+
+        // Clips larger than a quarter of the capacity are not cached
+        EXPECT_FALSE(cache.insert("v", "e", "mp3", std::string(2000, 'y')));
+    }
+
+    TEST_F(AIVoiceCacheTest, compaction_should_move_to_a_new_generation_while_clips_are_held)
+    {
+        const std::string audio(1000, 'x');
+        std::filesystem::path compacted;
+        {
+            AI::VoiceCache cache(mPath, 4096);
+            ASSERT_TRUE(cache.open());
+            EXPECT_EQ(cache.getPath(), mPath);
+            ASSERT_TRUE(cache.insert("v", "a", "mp3", audio));
+            ASSERT_TRUE(cache.insert("v", "b", "mp3", audio));
+            ASSERT_TRUE(cache.insert("v", "c", "mp3", audio));
+
+            // The held clip maps the old pack, which is never written over
+            const AI::VoiceClipPtr held = cache.find("v", "c");
+            ASSERT_NE(held, nullptr);
+            ASSERT_TRUE(cache.insert("v", "d", "mp3", audio));
+
+            compacted = cache.getPath();
+            EXPECT_NE(compacted, mPath);
+            EXPECT_EQ(held->audio, audio);
+            EXPECT_NE(cache.find("v", "c"), nullptr);
+            EXPECT_NE(cache.find("v", "d"), nullptr);
+            EXPECT_EQ(cache.getStats().entries, 2u);
+
+            // Appends go on into the new generation
+            ASSERT_TRUE(cache.insert("v", "e", "mp3", std::string(500, 'z')));
+            EXPECT_EQ(cache.find("v", "e")->audio, std::string(500, 'z'));
+        }
+
+        // Reopening picks the newest generation and removes the older packs
+        AI::VoiceCache cache(mPath, 4096);
+        ASSERT_TRUE(cache.open());
+        EXPECT_EQ(cache.getPath(), compacted);
+        EXPECT_FALSE(std::filesystem::exists(mPath));
+        EXPECT_EQ(cache.getStats().entries, 3u);
+        EXPECT_EQ(cache.find("v", "d")->audio, audio);
+    }
+}
@@ -0,0 +1,63 @@
+#include <components/ai_client/protocol.hpp>
+#include <components/ai_client/voicestream.hpp>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    TEST(AIVoiceStreamTest, ring_buffer_should_wrap_around)
+    {
+        AI::AudioRingBuffer buffer(6);
+        EXPECT_EQ(buffer.getCapacity(), 8u);
+
+        char out[8];
+        EXPECT_EQ(buffer.write("abcdef", 6), 6u);
+        EXPECT_EQ(buffer.read(out, 4), 4u);
+        EXPECT_EQ(std::string(out, 4), "abcd");
+
+        // The write runs past the end of the storage and continues at its start
+        EXPECT_EQ(buffer.write("ghijklmn", 8), 6u);
+        EXPECT_EQ(buffer.getReadable(), 8u);
+        EXPECT_EQ(buffer.read(out, sizeof(out)), 8u);
+        EXPECT_EQ(std::string(out, 8), "efghijkl");
+        EXPECT_EQ(buffer.read(out, sizeof(out)), 0u);
+    }
+
+    TEST(AIVoiceStreamTest, overflow_should_truncate_stream)
+    {
+        AI::VoiceStream stream("pcm16", 4);
+        EXPECT_EQ(stream.append("abc"), 0u);
+        EXPECT_FALSE(stream.isTruncated());
+        EXPECT_EQ(stream.append("def"), 2u);
+        EXPECT_TRUE(stream.isTruncated());
+        EXPECT_EQ(stream.getReceived(), 6u);
+
+        char out[4];
+        stream.end(false);
+        EXPECT_TRUE(stream.isComplete());
+        EXPECT_FALSE(stream.isFinished());
+        EXPECT_EQ(stream.read(out, sizeof(out)), 4u);
+        EXPECT_TRUE(stream.isFinished());
+    }
+
+    TEST(AIVoiceStreamTest, chunk_should_round_trip_through_frame)
+    {
+        AI::VoiceChunk chunk;
+        chunk.requestId = "abc123";
+        chunk.audio = std::string_view("\0\1\2", 3);
+        chunk.last = true;
+
+        std::string frame;
+        AI::writeVoiceChunk(frame, chunk);
+        EXPECT_EQ(frame.size(), 11u);
+
+        AI::VoiceChunk parsed;
+        ASSERT_TRUE(AI::readVoiceChunk(frame, parsed));
+        EXPECT_EQ(parsed.requestId, "abc123");
+        EXPECT_EQ(parsed.audio, chunk.audio);
+        EXPECT_TRUE(parsed.last);
+
+        // A frame shorter than its request ID is rejected
+        EXPECT_FALSE(AI::readVoiceChunk(frame.substr(0, 5), parsed));
+    }
+}
@@ -0,0 +1,298 @@
+#include "textfilter.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AI_TEXTFILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace AI
+{
+    namespace
+    {
+        constexpr char32_t sInvalid = 0xFFFFFFFF;
+
+        // Characters of Windows-1252 from 0x80 to 0x9F; zero where the code page has none
+        constexpr std::array<char32_t, 32> sWindows1252Specials = { 0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020,
+            0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0, 0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022,
+            0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178 };
+
+        bool isPlain(char c)
+        {
+            return (c >= 0x20 && c < 0x7F) || c == '\n' || c == '\t';
+        }
+
+        unsigned countTrailingZeros(unsigned mask)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
+
+        /**
+         * @brief Decode one UTF-8 character
+         *
+         * @param bytes Start of the character
+         * @param available Bytes left in the text
+         * @param codePoint Decoded character, or sInvalid
+         * @return Bytes consumed; for invalid input the longest malformed prefix, at least one byte
+         */
+        std::size_t decode(const unsigned char* bytes, std::size_t available, char32_t& codePoint)
+        {
+            const unsigned char lead = bytes[0];
+            std::size_t length = 0;
+            char32_t value = 0;
+
+            // Overlong forms, surrogates and values past U+10FFFF are ruled out by the second byte's range
+            unsigned char low = 0x80;
+            unsigned char high = 0xBF;
+            if (lead < 0x80)
+            {
+                codePoint = lead;
+                return 1;
+            }
+            else if (lead >= 0xC2 && lead <= 0xDF)
+            {
+                length = 2;
+                value = lead & 0x1F;
+            }
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                length = 3;
+                value = lead & 0x0F;
+                if (lead == 0xE0)
+                    low = 0xA0;
+                else if (lead == 0xED)
+                    high = 0x9F;
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                length = 4;
+                value = lead & 0x07;
+                if (lead == 0xF0)
+                    low = 0x90;
+                else if (lead == 0xF4)
+                    high = 0x8F;
+            }
+            else
+            {
+                codePoint = sInvalid;
+                return 1;
+            }
+
+            for (std::size_t i = 1; i < length; ++i)
+            {
+                if (i >= available || bytes[i] < low || bytes[i] > high)
+                {
+                    codePoint = sInvalid;
+                    return i;
+                }
+                value = (value << 6) | (bytes[i] & 0x3F);
+                low = 0x80;
+                high = 0xBF;
+            }
+            codePoint = value;
+            return length;
+        }
+
+        /**
+         * @brief Get the ASCII stand-in of a typographic character
+         *
+         * Stand-ins are never longer than the UTF-8 they replace.
+         *
+         * @param codePoint Character
+         * @param text Stand-in; empty to drop the character
+         * @return Whether the character has a stand-in
+         */
+        bool substitute(char32_t codePoint, std::string_view& text)
+        {
+            switch (codePoint)
+            {
+                case 0x00A0: // No-break space
+                case 0x202F: // Narrow no-break space
+                    text = " ";
+                    return true;
+                case 0x00AD: // Soft hyphen
+                case 0x200B: // Zero-width space
+                case 0x200C: // Zero-width non-joiner
+                case 0x200D: // Zero-width joiner
+                case 0x2060: // Word joiner
+                case 0xFEFF: // Byte order mark
+                    text = {};
+                    return true;
+                case 0x2010: // Hyphen
+                case 0x2011: // Non-breaking hyphen
+                case 0x2012: // Figure dash
+                case 0x2013: // En dash
+                case 0x2212: // Minus sign
+                    text = "-";
+                    return true;
+                case 0x2014: // Em dash
+                case 0x2015: // Horizontal bar
+                    text = "--";
+                    return true;
+                case 0x2018: // Single quotes
+                case 0x2019:
+                case 0x201A:
+                case 0x201B:
+                case 0x2032: // Prime
+                    text = "'";
+                    return true;
+                case 0x201C: // Double quotes
+                case 0x201D:
+                case 0x201E:
+                case 0x201F:
+                case 0x2033: // Double prime
+                    text = "\"";
+                    return true;
+                case 0x2022: // Bullet
+                    text = "*";
+                    return true;
+                case 0x2026: // Ellipsis
+                    text = "...";
+                    return true;
+                case 0x2028: // Line separator
+                case 0x2029: // Paragraph separator
+                    text = "\n";
+                    return true;
+                default:
+                    break;
+            }
+
+            // En quad to hair space
+            if (codePoint >= 0x2000 && codePoint <= 0x200A)
+            {
+                text = " ";
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Get the Windows-1252 byte of a character
+         *
+         * @param codePoint Character, not ASCII
+         * @return Byte, or -1 if the code page lacks the character
+         */
+        int toWindows1252(char32_t codePoint)
+        {
+            if (codePoint >= 0xA0 && codePoint <= 0xFF)
+                return static_cast<int>(codePoint);
+            for (std::size_t i = 0; i < sWindows1252Specials.size(); ++i)
+            {
+                if (sWindows1252Specials[i] == codePoint && codePoint != 0)
+                    return static_cast<int>(0x80 + i);
+            }
+            return -1;
+        }
+    }
+
+    std::size_t findNonPlainByte(std::string_view text)
+    {
+        const char* const data = text.data();
+        const std::size_t size = text.size();
+        std::size_t i = 0;
+
+#ifdef AI_TEXTFILTER_SSE2
+        // Compared as signed bytes, everything from 0x80 up is negative, so one comparison
+        // catches both control characters and the bytes of multi-byte characters
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i del = _mm_set1_epi8(0x7F);
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i tab = _mm_set1_epi8('\t');
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const __m128i allowed = _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, tab));
+            const __m128i special = _mm_or_si128(
+                _mm_andnot_si128(allowed, _mm_cmplt_epi8(chunk, space)), _mm_cmpeq_epi8(chunk, del));
+            if (const int mask = _mm_movemask_epi8(special))
+                return i + countTrailingZeros(static_cast<unsigned>(mask));
+        }
+#else
+        // Eight bytes at a time: the high bit of a byte is set in a flag word when the byte is
+        // at least 0x80, below 0x20 or 0x7F; flagged words are searched byte by byte, as
+        // newlines and tabs flag them too
+        constexpr std::uint64_t ones = 0x0101010101010101ull;
+        constexpr std::uint64_t highs = 0x8080808080808080ull;
+        for (; i + 8 <= size; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            const std::uint64_t notDel = word ^ (0x7F * ones);
+            const std::uint64_t flags = word | ((word - 0x20 * ones) & ~word) | ((notDel - ones) & ~notDel);
+            if ((flags & highs) == 0)
+                continue;
+            for (std::size_t j = i; j < i + 8; ++j)
+            {
+                if (!isPlain(data[j]))
+                    return j;
+            }
+        }
+#endif
+
+        for (; i < size; ++i)
+        {
+            if (!isPlain(data[i]))
+                return i;
+        }
+        return size;
+    }
+
+    void sanitizeText(std::string& text, TextEncoding encoding)
+    {
+        char* const data = text.data();
+        const unsigned char* const bytes = reinterpret_cast<const unsigned char*>(data);
+        const std::size_t size = text.size();
+
+        // Nothing is written before the first character that needs attention
+        std::size_t read = findNonPlainByte(text);
+        std::size_t write = read;
+        while (read < size)
+        {
+            // Step 1: Replace, transcode or drop one character; the result fits where it was read from
+            char32_t codePoint;
+            const std::size_t length = decode(bytes + read, size - read, codePoint);
+            std::string_view replacement;
+            if (codePoint == sInvalid)
+                data[write++] = '?';
+            else if (codePoint < 0xA0)
+            {
+                // Only control characters get here from the ASCII and C1 ranges; they are dropped
+            }
+            else if (substitute(codePoint, replacement))
+            {
+                std::memmove(data + write, replacement.data(), replacement.size());
+                write += replacement.size();
+            }
+            else if (const int byte = toWindows1252(codePoint); byte < 0)
+                data[write++] = '?';
+            else if (encoding == TextEncoding::Windows1252)
+                data[write++] = static_cast<char>(byte);
+            else
+            {
+                std::memmove(data + write, data + read, length);
+                write += length;
+            }
+            read += length;
+
+            // Step 2: Move the plain run that follows down over what was removed
+            const std::size_t run = findNonPlainByte(std::string_view(data + read, size - read));
+            if (write != read)
+                std::memmove(data + write, data + read, run);
+            write += run;
+            read += run;
+        }
+        text.resize(write);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_TEXTFILTER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_TEXTFILTER_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace AI
+{
+    /**
+     * @brief Encoding of NPC text handed to the engine
+     */
+    enum class TextEncoding
+    {
+        // UTF-8, limited to the characters of the Windows-1252 dialogue fonts
+        Utf8,
+
+        // Windows-1252 bytes, as read by the original game's fonts
+        Windows1252
+    };
+
+    inline constexpr std::size_t sTextEncodingCount = 2;
+
+    inline constexpr std::array<std::string_view, sTextEncodingCount> sTextEncodingNames = { "utf-8", "windows-1252" };
+
+    /**
+     * @brief Post-processing of the text of dialogue replies
+     */
+    struct TextOptions
+    {
+        // Clean up reply text before it reaches callbacks
+        bool sanitize = true;
+
+        TextEncoding encoding = TextEncoding::Utf8;
+    };
+
+    /**
+     * @brief Find the first byte of a text that is not printable ASCII, a newline or a tab
+     *
+     * Scans 16 bytes at a time with SSE2 where available, 8 at a time otherwise.
+     *
+     * @param text Text to scan
+     * @return Offset of the byte, or the size of the text if there is none
+     */
+    std::size_t findNonPlainByte(std::string_view text);
+
+    /**
+     * @brief Make model output displayable by the dialogue fonts, in place
+     *
+     * Invalid UTF-8 becomes '?', one per malformed sequence. Typographic
+     * characters the fonts lack become their ASCII equivalents: curly quotes,
+     * dashes, the ellipsis, special spaces and bullets. Control characters
+     * other than newline and tab, zero-width characters and byte order marks
+     * are removed, and characters outside Windows-1252 become '?'. The text
+     * never grows, so this does not allocate; runs of plain ASCII are skipped
+     * without being decoded.
+     *
+     * @param text Text to clean up
+     * @param encoding Encoding of the result
+     */
+    void sanitizeText(std::string& text, TextEncoding encoding);
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_TEXTFILTER_H
@@ -0,0 +1,145 @@
+#include "topicmatcher.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <set>
+
+namespace AI
+{
+    namespace
+    {
+        unsigned char toLower(unsigned char c)
+        {
+            return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+        }
+
+        bool isWordByte(unsigned char c)
+        {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+        }
+    }
+
+    TopicMatcher::TopicMatcher(const std::vector<std::string>& topics)
+    {
+        // Step 1: Keep one copy of each topic
+        std::set<std::string> folded;
+        for (const std::string& topic : topics)
+        {
+            if (topic.empty())
+                continue;
+
+            std::string key(topic);
+            std::transform(key.begin(), key.end(), key.begin(),
+                [](char c) { return static_cast<char>(toLower(static_cast<unsigned char>(c))); });
+            if (folded.insert(std::move(key)).second)
+                mTopics.push_back(topic);
+        }
+
+        // Step 2: Give every byte that occurs in a topic its own column; upper case shares the
+        // column of lower case, so there are at most 231 columns
+        for (const std::string& topic : mTopics)
+        {
+            for (char c : topic)
+            {
+                const unsigned char lower = toLower(static_cast<unsigned char>(c));
+                if (mClasses[lower] == 0)
+                    mClasses[lower] = static_cast<std::uint8_t>(mClassCount++);
+            }
+        }
+        for (unsigned c = 'A'; c <= 'Z'; ++c)
+            mClasses[c] = mClasses[toLower(static_cast<unsigned char>(c))];
+
+        // Step 3: Build the trie; 0 marks a missing child, as no edge leads back to the root
+        mTransitions.assign(mClassCount, 0);
+        mMatches.assign(1, sNoTopic);
+        for (std::size_t i = 0; i < mTopics.size(); ++i)
+        {
+            std::uint32_t state = 0;
+            for (char c : mTopics[i])
+            {
+                std::uint32_t& child = mTransitions[state * mClassCount + mClasses[static_cast<unsigned char>(c)]];
+                if (child == 0)
+                {
+                    child = static_cast<std::uint32_t>(mMatches.size());
+                    mTransitions.resize(mTransitions.size() + mClassCount, 0);
+                    mMatches.push_back(sNoTopic);
+                }
+                state = mTransitions[state * mClassCount + mClasses[static_cast<unsigned char>(c)]];
+            }
+            mMatches[state] = static_cast<std::uint32_t>(i);
+        }
+
+        // Step 4: Fill in the missing edges from the failure links, breadth first, turning the trie into a DFA
+        const std::size_t stateCount = mMatches.size();
+        std::vector<std::uint32_t> failures(stateCount, 0);
+        mOutputs.assign(stateCount, 0);
+        std::queue<std::uint32_t> pending;
+        pending.push(0);
+        while (!pending.empty())
+        {
+            const std::uint32_t state = pending.front();
+            pending.pop();
+            for (std::size_t c = 0; c < mClassCount; ++c)
+            {
+                std::uint32_t& edge = mTransitions[state * mClassCount + c];
+                const std::uint32_t fallback = state == 0 ? 0 : mTransitions[failures[state] * mClassCount + c];
+
+                // Edges without a child go where the longest proper suffix would
+                if (edge == 0)
+                {
+                    edge = fallback;
+                    continue;
+                }
+
+                failures[edge] = fallback;
+                mOutputs[edge] = mMatches[fallback] != sNoTopic ? fallback : mOutputs[fallback];
+                pending.push(edge);
+            }
+        }
+    }
+
+    void TopicMatcher::match(std::string_view text, std::vector<TopicSpan>& spans) const
+    {
+        spans.clear();
+        if (mTopics.empty())
+            return;
+
+        // Step 1: Collect every topic that ends at each byte and stands as whole words
+        const unsigned char* const bytes = reinterpret_cast<const unsigned char*>(text.data());
+        std::uint32_t state = 0;
+        for (std::size_t i = 0; i < text.size(); ++i)
+        {
+            state = next(state, bytes[i]);
+
+            const std::size_t end = i + 1;
+            if (end < text.size() && isWordByte(bytes[end]))
+                continue;
+
+            for (std::uint32_t found = mMatches[state] != sNoTopic ? state : mOutputs[state]; found != 0;
+                 found = mOutputs[found])
+            {
+                const std::string& topic = mTopics[mMatches[found]];
+                const std::size_t offset = end - topic.size();
+                if (offset > 0 && isWordByte(bytes[offset - 1]))
+                    continue;
+                spans.push_back({ offset, topic.size(), topic });
+            }
+        }
+
+        // Step 2: Keep the leftmost of overlapping topics, and the longest of those starting together
+        std::sort(spans.begin(), spans.end(), [](const TopicSpan& left, const TopicSpan& right) {
+            return left.offset != right.offset ? left.offset < right.offset : left.length > right.length;
+        });
+
+        std::size_t kept = 0;
+        std::size_t keptEnd = 0;
+        for (const TopicSpan& span : spans)
+        {
+            if (kept > 0 && span.offset < keptEnd)
+                continue;
+            spans[kept++] = span;
+            keptEnd = span.offset + span.length;
+        }
+        spans.resize(kept);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_TOPICMATCHER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_TOPICMATCHER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AI
+{
+    /**
+     * @brief Dialogue topic mentioned in a reply, to be shown as a hyperlink
+     */
+    struct TopicSpan
+    {
+        // Bytes of the reply text that name the topic
+        std::size_t offset = 0;
+        std::size_t length = 0;
+
+        // Topic as given to the matcher, which owns the string
+        std::string_view topic;
+    };
+
+    /**
+     * @brief Finds the dialogue topics a text mentions, in one pass over the text
+     *
+     * An Aho-Corasick automaton is built once from the topic list and turned
+     * into a DFA, so matching costs one table lookup per byte however many
+     * topics there are. Bytes that occur in no topic share one column of the
+     * table, which keeps it to a few megabytes for the full game's topics.
+     *
+     * Matching ignores ASCII case and, like the dialogue window, only finds
+     * topics that are whole words: the bytes around a match must not be ASCII
+     * letters, digits or part of a non-ASCII character. Where topics overlap,
+     * the leftmost wins, and of those the longest. Topics must be in the
+     * encoding of the text. Immutable once built, so any thread may match.
+     */
+    class TopicMatcher
+    {
+    public:
+        /**
+         * @brief Build the automaton
+         *
+         * @param topics Topic names; empty names and case-insensitive duplicates are ignored
+         */
+        explicit TopicMatcher(const std::vector<std::string>& topics);
+
+        /**
+         * @brief Find the topics a text mentions
+         *
+         * Only grows the span list, so a reused list stops allocating.
+         *
+         * @param text Text to search
+         * @param spans Cleared, then filled with the topics in text order; they view this matcher's strings
+         */
+        void match(std::string_view text, std::vector<TopicSpan>& spans) const;
+
+        std::size_t getTopicCount() const { return mTopics.size(); }
+
+        std::size_t getStateCount() const { return mMatches.size(); }
+
+    private:
+        static constexpr std::uint32_t sNoTopic = ~std::uint32_t(0);
+
+        std::uint32_t next(std::uint32_t state, unsigned char byte) const
+        {
+            return mTransitions[state * mClassCount + mClasses[byte]];
+        }
+
+        std::vector<std::string> mTopics;
+
+        // Column of each byte; case-folded, 0 for bytes that occur in no topic
+        std::array<std::uint8_t, 256> mClasses{};
+        std::size_t mClassCount = 1;
+
+        // Row per state, column per byte class; state 0 is the root
+        std::vector<std::uint32_t> mTransitions;
+
+        // Topic ending in each state, or sNoTopic
+        std::vector<std::uint32_t> mMatches;
+
+        // Nearest state on the suffix chain with a topic, 0 for none
+        std::vector<std::uint32_t> mOutputs;
+    };
+
+    using TopicMatcherPtr = std::shared_ptr<const TopicMatcher>;
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_TOPICMATCHER_H
@@ -0,0 +1,202 @@
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace AI
+{
+    namespace
+    {
+        std::uint64_t toMicros(Tracer::Clock::time_point time)
+        {
+            return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+        }
+
+        char flowPhaseCode(FlowPhase flow)
+        {
+            switch (flow)
+            {
+                case FlowPhase::Start: return 's';
+                case FlowPhase::Step: return 't';
+                case FlowPhase::End: return 'f';
+                default: return 0;
+            }
+        }
+    }
+
+    thread_local Tracer::ThreadHandle Tracer::sThreadHandle;
+    thread_local const char* Tracer::sThreadName = nullptr;
+
+    Tracer& Tracer::get()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer::ThreadHandle::~ThreadHandle()
+    {
+        if (buffer)
+            Tracer::get().releaseThreadBuffer(*buffer);
+    }
+
+    void Tracer::start(const std::string& path)
+    {
+        // Buffers are only reset once no thread stores into them
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEnabled.store(false);
+        waitForWriters();
+        mPath = path;
+        for (const auto& buffer : mBuffers)
+            buffer->written.store(0, std::memory_order_relaxed);
+        mEnabled.store(true);
+    }
+
+    bool Tracer::stop()
+    {
+        if (!mEnabled.exchange(false))
+            return false;
+
+        // Spans stored before recording was disabled are finished before the file is written
+        std::lock_guard<std::mutex> lock(mMutex);
+        waitForWriters();
+        std::ofstream file(mPath);
+        if (!file)
+        {
+            std::cerr << "Error writing AI trace: cannot open " << mPath << std::endl;
+            return false;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]() -> std::ostream& {
+            if (!first)
+                file << ",\n";
+            first = false;
+            return file;
+        };
+
+        for (const auto& buffer : mBuffers)
+        {
+            if (const char* name = buffer->name.load(std::memory_order_relaxed))
+            {
+                separator() << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+                            << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << name << "\"}}";
+            }
+
+            // Only the newest sBufferSize events survive a wrapped buffer
+            const std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+            const std::uint64_t begin = written > sBufferSize ? written - sBufferSize : 0;
+            for (std::uint64_t i = begin; i < written; ++i)
+            {
+                const Event& event = buffer->events[i % sBufferSize];
+                separator() << "{\"ph\":\"X\",\"cat\":\"ai\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"name\":\""
+                            << event.name << "\",\"ts\":" << event.timestamp << ",\"dur\":" << event.duration << "}";
+
+                // Flow events bind to the span they start in
+                if (event.flow != FlowPhase::None)
+                {
+                    separator() << "{\"ph\":\"" << flowPhaseCode(event.flow) << "\",\"bp\":\"e\",\"cat\":\"ai\",\"pid\":1"
+                                << ",\"tid\":" << buffer->threadId << ",\"name\":\"request\",\"id\":" << event.flowId
+                                << ",\"ts\":" << event.timestamp << "}";
+                }
+            }
+        }
+
+        file << "]}\n";
+        return static_cast<bool>(file);
+    }
+
+    void Tracer::setThreadName(const char* name)
+    {
+        // Threads only get a buffer once they record, so naming a thread costs nothing while disabled
+        sThreadName = name;
+        if (sThreadHandle.buffer)
+            sThreadHandle.buffer->name.store(name, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Tracer::newFlowId()
+    {
+        return mNextFlowId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Tracer::span(
+        const char* name, Clock::time_point start, Clock::time_point end, std::uint64_t flowId, FlowPhase flow)
+    {
+        if (!isEnabled())
+            return;
+
+        // Announce the store before checking again; stop() disables recording before it looks at the
+        // flags, so either it waits for this span or the span sees recording disabled
+        ThreadBuffer& buffer = getThreadBuffer();
+        buffer.active.store(true);
+        if (!mEnabled.load())
+        {
+            buffer.active.store(false, std::memory_order_release);
+            return;
+        }
+
+        const std::uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        const std::uint64_t startMicros = toMicros(start);
+        const std::uint64_t endMicros = toMicros(end);
+
+        buffer.events[index % sBufferSize]
+            = { name, startMicros, endMicros > startMicros ? endMicros - startMicros : 0, flowId, flowId ? flow : FlowPhase::None };
+        buffer.written.store(index + 1, std::memory_order_release);
+        buffer.active.store(false, std::memory_order_release);
+    }
+
+    std::size_t Tracer::getBufferCount()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mBuffers.size();
+    }
+
+    Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+    {
+        // Buffers are owned by the tracer, so their events outlive their threads until the trace is written
+        if (!sThreadHandle.buffer)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            // Step 1: Take a free buffer, preferably one of a thread with the same name
+            auto it = std::find_if(mFreeBuffers.begin(), mFreeBuffers.end(),
+                [](const ThreadBuffer* buffer) { return buffer->name.load(std::memory_order_relaxed) == sThreadName; });
+            if (it == mFreeBuffers.end() && !mFreeBuffers.empty())
+                it = mFreeBuffers.begin();
+
+            if (it != mFreeBuffers.end())
+            {
+                sThreadHandle.buffer = *it;
+                mFreeBuffers.erase(it);
+            }
+            else
+            {
+                // Step 2: Allocate one if none is free
+                auto buffer = std::make_shared<ThreadBuffer>();
+                buffer->threadId = static_cast<std::uint32_t>(mBuffers.size() + 1);
+                mBuffers.push_back(buffer);
+                sThreadHandle.buffer = buffer.get();
+            }
+            sThreadHandle.buffer->name.store(sThreadName, std::memory_order_relaxed);
+        }
+        return *sThreadHandle.buffer;
+    }
+
+    void Tracer::releaseThreadBuffer(ThreadBuffer& buffer)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFreeBuffers.push_back(&buffer);
+    }
+
+    void Tracer::waitForWriters()
+    {
+        for (const auto& buffer : mBuffers)
+        {
+            while (buffer->active.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_TRACER_H
+#define OPENMW_COMPONENTS_AI_CLIENT_TRACER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace AI
+{
+    /**
+     * @brief How a traced span takes part in a request's flow
+     */
+    enum class FlowPhase : char
+    {
+        None,
+        Start,
+        Step,
+        End
+    };
+
+    /**
+     * @brief Opt-in recorder of request timelines in Chrome trace-event format
+     *
+     * Each thread records into its own fixed-size ring buffer, so tracing
+     * takes no lock after a thread's first event; the oldest events are
+     * overwritten when a buffer is full. While disabled, recording is a
+     * single relaxed atomic load.
+     *
+     * Buffers go back to a free list when their thread exits and are handed
+     * to the next thread that records, keeping their events and thread ID.
+     * Threads that replace each other, like a connection's reader after a
+     * reconnect, thus share a lane in the trace, and memory stays bounded
+     * by the number of threads recording at once.
+     *
+     * Timestamps are steady clock microseconds, so the file can be loaded
+     * into chrome://tracing or Perfetto next to captures using the same clock.
+     */
+    class Tracer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Get the process-wide tracer
+         *
+         * @return Tracer
+         */
+        static Tracer& get();
+
+        /**
+         * @brief Check if events are being recorded
+         *
+         * @return true if enabled, false otherwise
+         */
+        bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Start recording
+         *
+         * Events recorded before a previous stop() are discarded.
+         *
+         * @param path File the trace is written to by stop()
+         */
+        void start(const std::string& path);
+
+        /**
+         * @brief Stop recording and write the trace file
+         *
+         * @return true if the file was written, false otherwise
+         */
+        bool stop();
+
+        /**
+         * @brief Name the calling thread in the trace
+         *
+         * @param name Thread name; must be a string literal or otherwise outlive the tracer
+         */
+        void setThreadName(const char* name);
+
+        /**
+         * @brief Allocate an ID linking the spans of one request
+         *
+         * @return Flow ID, never 0
+         */
+        std::uint64_t newFlowId();
+
+        /**
+         * @brief Record a span on the calling thread
+         *
+         * Does nothing while disabled.
+         *
+         * @param name Span name; must be a string literal
+         * @param start Span start
+         * @param end Span end
+         * @param flowId Flow ID from newFlowId(), or 0 for none
+         * @param flow How the span takes part in the flow
+         */
+        void span(const char* name, Clock::time_point start, Clock::time_point end, std::uint64_t flowId = 0,
+            FlowPhase flow = FlowPhase::None);
+
+        /**
+         * @brief Get the number of thread buffers allocated so far
+         *
+         * @return Buffers in use or free
+         */
+        std::size_t getBufferCount();
+
+    private:
+        struct Event
+        {
+            const char* name;
+            std::uint64_t timestamp;
+            std::uint64_t duration;
+            std::uint64_t flowId;
+            FlowPhase flow;
+        };
+
+        static constexpr std::size_t sBufferSize = 8192;
+
+        struct ThreadBuffer
+        {
+            std::uint32_t threadId = 0;
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<std::uint64_t> written{ 0 };
+
+            // Set while the owning thread stores an event, so start() and stop() can wait for it
+            std::atomic<bool> active{ false };
+
+            std::array<Event, sBufferSize> events;
+        };
+
+        /**
+         * @brief Buffer of the calling thread, returned to the free list when the thread exits
+         */
+        struct ThreadHandle
+        {
+            ThreadBuffer* buffer = nullptr;
+
+            ~ThreadHandle();
+        };
+
+        Tracer() = default;
+
+        ThreadBuffer& getThreadBuffer();
+
+        void releaseThreadBuffer(ThreadBuffer& buffer);
+
+        // Wait until no thread stores an event; recording must be disabled and mMutex held
+        void waitForWriters();
+
+        static thread_local ThreadHandle sThreadHandle;
+        static thread_local const char* sThreadName;
+
+        std::atomic<bool> mEnabled{ false };
+        std::atomic<std::uint64_t> mNextFlowId{ 1 };
+
+        std::mutex mMutex;
+        std::string mPath;
+        std::vector<std::shared_ptr<ThreadBuffer>> mBuffers;
+        std::vector<ThreadBuffer*> mFreeBuffers;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_TRACER_H
@@ -0,0 +1,467 @@
+#include "voicecache.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace AI
+{
+    namespace bip = boost::interprocess;
+
+    namespace
+    {
+        // "AIVC" in little-endian byte order
+        constexpr std::uint32_t sRecordMagic = 0x43564941;
+
+        // Magic, key, then the sizes of voice ID, text, format and audio
+        constexpr std::uint64_t sHeaderSize = 4 + 8 + 4 * 4;
+
+        template <class T>
+        T readValue(const char* data)
+        {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        template <class T>
+        void writeValue(std::ostream& out, T value)
+        {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        }
+    }
+
+    VoiceCache::VoiceCache(std::filesystem::path path, std::uint64_t capacity)
+        : mPath(std::move(path))
+        , mCapacity(capacity)
+    {
+    }
+
+    VoiceCache::~VoiceCache() = default;
+
+    std::string VoiceCache::normalizeText(std::string_view text)
+    {
+        std::string result;
+        result.reserve(text.size());
+        bool space = false;
+        for (char c : text)
+        {
+            if (isSpace(c))
+            {
+                space = !result.empty();
+                continue;
+            }
+            if (space)
+            {
+                result += ' ';
+                space = false;
+            }
+
+            // ASCII only; other bytes of UTF-8 text are kept as they are
+            result += c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+        return result;
+    }
+
+    std::uint64_t VoiceCache::makeKey(std::string_view voiceId, std::string_view normalizedText)
+    {
+        // FNV-1a over the voice ID, a separator and the text
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        const auto mix = [&](std::string_view bytes) {
+            for (char c : bytes)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 0x100000001b3ull;
+            }
+        };
+        mix(voiceId);
+        mix(std::string_view("\0", 1));
+        mix(normalizedText);
+        return hash;
+    }
+
+    bool VoiceCache::readRecord(const char* data, std::uint64_t available, Record& record)
+    {
+        if (available < sHeaderSize || readValue<std::uint32_t>(data) != sRecordMagic)
+            return false;
+
+        record.key = readValue<std::uint64_t>(data + 4);
+        const std::uint64_t voiceSize = readValue<std::uint32_t>(data + 12);
+        const std::uint64_t textSize = readValue<std::uint32_t>(data + 16);
+        const std::uint64_t formatSize = readValue<std::uint32_t>(data + 20);
+        const std::uint64_t audioSize = readValue<std::uint32_t>(data + 24);
+        record.size = sHeaderSize + voiceSize + textSize + formatSize + audioSize;
+        if (record.size > available)
+            return false;
+
+        const char* field = data + sHeaderSize;
+        record.voiceId = std::string_view(field, voiceSize);
+        field += voiceSize;
+        record.text = std::string_view(field, textSize);
+        field += textSize;
+        record.format = std::string_view(field, formatSize);
+        field += formatSize;
+        record.audio = std::string_view(field, audioSize);
+        return true;
+    }
+
+    void VoiceCache::writeRecord(std::ostream& out, std::uint64_t key, std::string_view voiceId,
+        std::string_view normalizedText, std::string_view format, std::string_view audio)
+    {
+        writeValue(out, sRecordMagic);
+        writeValue(out, key);
+        writeValue(out, static_cast<std::uint32_t>(voiceId.size()));
+        writeValue(out, static_cast<std::uint32_t>(normalizedText.size()));
+        writeValue(out, static_cast<std::uint32_t>(format.size()));
+        writeValue(out, static_cast<std::uint32_t>(audio.size()));
+        out.write(voiceId.data(), voiceId.size());
+        out.write(normalizedText.data(), normalizedText.size());
+        out.write(format.data(), format.size());
+        out.write(audio.data(), audio.size());
+    }
+
+    const char* VoiceCache::getData() const
+    {
+        return mRegion ? static_cast<const char*>(mRegion->get_address()) : nullptr;
+    }
+
+    std::filesystem::path VoiceCache::getGenerationPath(std::uint64_t generation) const
+    {
+        if (generation == 0)
+            return mPath;
+        std::filesystem::path path = mPath;
+        path += "." + std::to_string(generation);
+        return path;
+    }
+
+    std::filesystem::path VoiceCache::getPath() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return getGenerationPath(mGeneration);
+    }
+
+    void VoiceCache::removeStalePacks()
+    {
+        // A pack that clips still map cannot be removed on every platform; try again on the next compaction
+        const auto removed = [](const std::filesystem::path& path) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            return !ec;
+        };
+        mStalePacks.erase(std::remove_if(mStalePacks.begin(), mStalePacks.end(), removed), mStalePacks.end());
+    }
+
+    bool VoiceCache::remap()
+    {
+        try
+        {
+            if (mFile.is_open())
+                mFile.flush();
+
+            // Clips still hold the old mapping, so it stays valid for them
+            const std::filesystem::path path = getGenerationPath(mGeneration);
+            const std::uint64_t size = std::filesystem::file_size(path);
+            if (size == 0)
+                mRegion.reset();
+            else
+            {
+                const bip::file_mapping file(path.string().c_str(), bip::read_only);
+                mRegion = std::make_shared<bip::mapped_region>(file, bip::read_only, 0, size);
+            }
+            mMappedSize = size;
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error mapping voice cache " << getGenerationPath(mGeneration) << ": " << e.what()
+                      << std::endl;
+            mRegion.reset();
+            mMappedSize = 0;
+            return false;
+        }
+    }
+
+    bool VoiceCache::open()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        try
+        {
+            // Use the newest generation; older ones and unfinished compactions are left over from earlier runs
+            mGeneration = 0;
+            std::vector<std::pair<std::uint64_t, std::filesystem::path>> generations;
+            if (std::filesystem::exists(mPath))
+                generations.emplace_back(0, mPath);
+            const std::filesystem::path directory = mPath.has_parent_path() ? mPath.parent_path() : ".";
+            const std::string prefix = mPath.filename().string() + ".";
+            for (const auto& file : std::filesystem::directory_iterator(directory))
+            {
+                const std::string name = file.path().filename().string();
+                if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+                    continue;
+                std::string_view suffix = std::string_view(name).substr(prefix.size());
+                if (suffix == "tmp" || (suffix.size() > 4 && suffix.substr(suffix.size() - 4) == ".tmp"))
+                {
+                    mStalePacks.push_back(file.path());
+                    continue;
+                }
+                std::uint64_t generation = 0;
+                const char* end = suffix.data() + suffix.size();
+                auto [ptr, ec] = std::from_chars(suffix.data(), end, generation);
+                if (ec == std::errc() && ptr == end && generation > 0)
+                    generations.emplace_back(generation, file.path());
+            }
+            for (const auto& [generation, path] : generations)
+                mGeneration = std::max(mGeneration, generation);
+            for (const auto& [generation, path] : generations)
+            {
+                if (generation != mGeneration)
+                    mStalePacks.push_back(path);
+            }
+            removeStalePacks();
+
+            // Create the file if it is missing
+            const std::filesystem::path path = getGenerationPath(mGeneration);
+            {
+                std::ofstream touch(path, std::ios::binary | std::ios::app);
+                if (!touch)
+                {
+                    std::cerr << "Error creating voice cache " << path << std::endl;
+                    return false;
+                }
+            }
+            if (!remap())
+                return false;
+
+            // Index the records; a later record of the same line replaces the earlier one
+            const char* data = getData();
+            std::uint64_t offset = 0;
+            Record record;
+            while (offset < mMappedSize && readRecord(data + offset, mMappedSize - offset, record))
+            {
+                auto [it, inserted] = mEntries.try_emplace(record.key);
+                if (!inserted)
+                    mLiveSize -= it->second.size;
+                it->second.offset = offset;
+                it->second.size = record.size;
+                it->second.lastUsed = ++mUseCounter;
+                mLiveSize += record.size;
+                offset += record.size;
+            }
+
+            // A crash while appending leaves a torn record at the end
+            if (offset < mMappedSize)
+            {
+                std::cerr << "Voice cache " << path << " ends in a torn record, discarding "
+                          << mMappedSize - offset << " bytes" << std::endl;
+                mRegion.reset();
+                std::filesystem::resize_file(path, offset);
+                if (!remap())
+                    return false;
+            }
+            mFileSize = offset;
+
+            mFile.open(path, std::ios::binary | std::ios::app);
+            if (!mFile)
+            {
+                std::cerr << "Error opening voice cache " << path << " for writing" << std::endl;
+                return false;
+            }
+
+            // The capacity may have shrunk since the pack was written
+            if (mFileSize > mCapacity)
+                compact(mCapacity / 4 * 3);
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error opening voice cache " << mPath << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    VoiceClipPtr VoiceCache::find(std::string_view voiceId, std::string_view text)
+    {
+        const std::string normalized = normalizeText(text);
+        const std::uint64_t key = makeKey(voiceId, normalized);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        if (it == mEntries.end())
+        {
+            ++mMisses;
+            return nullptr;
+        }
+
+        // The record may have been appended after the last mapping
+        Entry& entry = it->second;
+        if (entry.offset + entry.size > mMappedSize && !remap())
+        {
+            ++mMisses;
+            return nullptr;
+        }
+
+        // A hash collision is a miss
+        Record record;
+        if (!readRecord(getData() + entry.offset, mMappedSize - entry.offset, record) || record.voiceId != voiceId
+            || record.text != normalized)
+        {
+            ++mMisses;
+            return nullptr;
+        }
+
+        entry.lastUsed = ++mUseCounter;
+        ++mHits;
+
+        auto clip = std::make_shared<VoiceClip>();
+        clip->format = std::string(record.format);
+        clip->audio = record.audio;
+        clip->mapping = mRegion;
+        return clip;
+    }
+
+    bool VoiceCache::insert(
+        std::string_view voiceId, std::string_view text, std::string_view format, std::string_view audio)
+    {
+        if (audio.empty() || audio.size() > getMaxClipSize())
+            return false;
+
+        const std::string normalized = normalizeText(text);
+        const std::uint64_t key = makeKey(voiceId, normalized);
+        const std::uint64_t size = sHeaderSize + voiceId.size() + normalized.size() + format.size() + audio.size();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mFile.is_open())
+            return false;
+
+        // Make room, leaving some slack so the next appends do not compact again at once
+        if (mFileSize + size > mCapacity)
+        {
+            const std::uint64_t target = mCapacity / 4 * 3;
+            if (!compact(target > size ? target - size : 0))
+                return false;
+        }
+
+        writeRecord(mFile, key, voiceId, normalized, format, audio);
+        mFile.flush();
+        if (!mFile)
+        {
+            // The torn record is cut off on the next open; until then the pack takes no more appends
+            std::cerr << "Error writing voice cache " << getGenerationPath(mGeneration) << std::endl;
+            mFile.close();
+            return false;
+        }
+
+        auto [it, inserted] = mEntries.try_emplace(key);
+        if (!inserted)
+            mLiveSize -= it->second.size;
+        it->second.offset = mFileSize;
+        it->second.size = size;
+        it->second.lastUsed = ++mUseCounter;
+        mFileSize += size;
+        mLiveSize += size;
+        return true;
+    }
+
+    bool VoiceCache::compact(std::uint64_t target)
+    {
+        // Least recently used first
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> order;
+        order.reserve(mEntries.size());
+        for (const auto& [key, entry] : mEntries)
+            order.emplace_back(entry.lastUsed, key);
+        std::sort(order.begin(), order.end());
+
+        std::size_t evicted = 0;
+        while (mLiveSize > target && evicted < order.size())
+        {
+            auto it = mEntries.find(order[evicted].second);
+            mLiveSize -= it->second.size;
+            mEntries.erase(it);
+            ++mEvictions;
+            ++evicted;
+        }
+
+        // Rewrite the survivors oldest first, so a rescan restores their recency
+        if (mMappedSize < mFileSize && !remap())
+            return false;
+
+        // Clips may still map the current pack, and a mapped file cannot be replaced on every platform, so the
+        // survivors go to the next generation; the index only moves over once that pack is complete
+        const std::filesystem::path current = getGenerationPath(mGeneration);
+        const std::filesystem::path next = getGenerationPath(mGeneration + 1);
+        std::filesystem::path temporary = next;
+        temporary += ".tmp";
+        std::vector<std::uint64_t> offsets;
+        offsets.reserve(order.size() - evicted);
+        std::uint64_t offset = 0;
+        try
+        {
+            {
+                std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+                for (std::size_t i = evicted; i < order.size(); ++i)
+                {
+                    const Entry& entry = mEntries.at(order[i].second);
+                    out.write(getData() + entry.offset, entry.size);
+                    offsets.push_back(offset);
+                    offset += entry.size;
+                }
+                out.flush();
+                if (!out)
+                    throw std::runtime_error("cannot write " + temporary.string());
+            }
+            std::filesystem::rename(temporary, next);
+        }
+        catch (const std::exception& e)
+        {
+            // The current pack and the offsets into it are untouched, so the cache keeps serving from it
+            std::cerr << "Error compacting voice cache " << current << ": " << e.what() << std::endl;
+            std::error_code ec;
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+
+        // Switch to the new pack; the old one goes once no clip maps it any more
+        mFile.close();
+        mRegion.reset();
+        mMappedSize = 0;
+        ++mGeneration;
+        for (std::size_t i = evicted; i < order.size(); ++i)
+            mEntries.at(order[i].second).offset = offsets[i - evicted];
+        mFileSize = offset;
+        mLiveSize = offset;
+        mStalePacks.push_back(current);
+        removeStalePacks();
+
+        mFile.open(next, std::ios::binary | std::ios::app);
+        if (!mFile)
+        {
+            // Lookups still work from the mapping; the pack takes no more appends until the next open
+            std::cerr << "Error opening voice cache " << next << " for writing" << std::endl;
+            remap();
+            return false;
+        }
+        return remap();
+    }
+
+    VoiceCacheStats VoiceCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        VoiceCacheStats stats;
+        stats.entries = mEntries.size();
+        stats.bytes = mFileSize;
+        stats.hits = mHits;
+        stats.misses = mMisses;
+        stats.evictions = mEvictions;
+        return stats;
+    }
+}
@@ -0,0 +1,191 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_VOICECACHE_H
+#define OPENMW_COMPONENTS_AI_CLIENT_VOICECACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "stats.hpp"
+
+namespace boost::interprocess
+{
+    class mapped_region;
+}
+
+namespace AI
+{
+    /**
+     * @brief Complete voice line served from the cache
+     *
+     * The audio is a view into the memory-mapped pack file; the clip keeps
+     * its mapping alive, even across compactions, for as long as it is held.
+     */
+    struct VoiceClip
+    {
+        std::string format;
+        std::string_view audio;
+        std::shared_ptr<const boost::interprocess::mapped_region> mapping;
+    };
+
+    using VoiceClipPtr = std::shared_ptr<const VoiceClip>;
+
+    /**
+     * @brief On-disk cache of synthesized voice lines
+     *
+     * Clips live in one append-only pack file of records (key, voice ID,
+     * normalized text, format, audio) that is memory-mapped for reading. The
+     * index is kept in memory, keyed by a hash of the voice ID and the
+     * normalized text, and rebuilt by scanning the pack on open; a torn
+     * record at the end is cut off. Once an append would take the file past
+     * its capacity, the least recently used clips are evicted and the
+     * survivors rewritten into a fresh pack. The fresh pack is a new
+     * generation next to the configured path ("<path>.1", "<path>.2", ...)
+     * rather than a replacement of the old file, which clips may still have
+     * mapped; open() picks the newest generation and removes the rest.
+     * Thread-safe.
+     */
+    class VoiceCache
+    {
+    public:
+        /**
+         * @brief Constructor; call open() before use
+         *
+         * @param path Pack file, created if missing; compactions move to generations named after it
+         * @param capacity Largest size of the pack file in bytes
+         */
+        VoiceCache(std::filesystem::path path, std::uint64_t capacity);
+
+        /**
+         * @brief Destructor
+         */
+        ~VoiceCache();
+
+        /**
+         * @brief Open or create the pack file and index its records
+         *
+         * @return true if the cache is usable, false otherwise
+         */
+        bool open();
+
+        /**
+         * @brief Look up a voice line
+         *
+         * @param voiceId Voice the line was spoken with
+         * @param text Line as shown to the player; case and spacing do not matter
+         * @return Clip, or null if the line is not cached
+         */
+        VoiceClipPtr find(std::string_view voiceId, std::string_view text);
+
+        /**
+         * @brief Add a voice line
+         *
+         * @param voiceId Voice the line was spoken with
+         * @param text Line as shown to the player
+         * @param format Encoding of the audio
+         * @param audio Complete encoded audio
+         * @return true if the line was stored, false if it is too large or the pack could not be written
+         */
+        bool insert(std::string_view voiceId, std::string_view text, std::string_view format, std::string_view audio);
+
+        /**
+         * @brief Get the pack file currently in use
+         *
+         * @return Configured path, or the generation written by the last compaction
+         */
+        std::filesystem::path getPath() const;
+
+        /**
+         * @brief Get the largest clip the cache accepts
+         *
+         * @return Audio size in bytes
+         */
+        std::uint64_t getMaxClipSize() const { return mCapacity / 4; }
+
+        /**
+         * @brief Get a snapshot of the cache counters
+         *
+         * @return Statistics
+         */
+        VoiceCacheStats getStats() const;
+
+        /**
+         * @brief Reduce a line to the form it is keyed by
+         *
+         * @param text Line as shown to the player
+         * @return Lowercase text with runs of whitespace collapsed and trimmed
+         */
+        static std::string normalizeText(std::string_view text);
+
+        /**
+         * @brief Hash a voice ID and a normalized line
+         *
+         * @param voiceId Voice ID
+         * @param normalizedText Line after normalizeText()
+         * @return Key
+         */
+        static std::uint64_t makeKey(std::string_view voiceId, std::string_view normalizedText);
+
+    private:
+        struct Entry
+        {
+            // Start of the record, and its size including the header
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+
+            // Recency for eviction; larger is more recent
+            std::uint64_t lastUsed = 0;
+        };
+
+        // A record as found in a mapping
+        struct Record
+        {
+            std::uint64_t key = 0;
+            std::string_view voiceId;
+            std::string_view text;
+            std::string_view format;
+            std::string_view audio;
+            std::uint64_t size = 0;
+        };
+
+        static bool readRecord(const char* data, std::uint64_t available, Record& record);
+        static void writeRecord(std::ostream& out, std::uint64_t key, std::string_view voiceId,
+            std::string_view normalizedText, std::string_view format, std::string_view audio);
+
+        bool remap();
+        bool compact(std::uint64_t target);
+        const char* getData() const;
+        std::filesystem::path getGenerationPath(std::uint64_t generation) const;
+        void removeStalePacks();
+
+        std::filesystem::path mPath;
+        std::uint64_t mCapacity;
+
+        // Generation of the pack in use, and older packs that could not be removed yet
+        std::uint64_t mGeneration = 0;
+        std::vector<std::filesystem::path> mStalePacks;
+
+        mutable std::mutex mMutex;
+
+        // Append handle and the current mapping, which covers the file as of the last remap
+        std::ofstream mFile;
+        std::shared_ptr<boost::interprocess::mapped_region> mRegion;
+        std::uint64_t mMappedSize = 0;
+
+        std::unordered_map<std::uint64_t, Entry> mEntries;
+        std::uint64_t mFileSize = 0;
+        std::uint64_t mLiveSize = 0;
+        std::uint64_t mUseCounter = 0;
+
+        std::uint64_t mHits = 0;
+        std::uint64_t mMisses = 0;
+        std::uint64_t mEvictions = 0;
+    };
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_VOICECACHE_H
@@ -0,0 +1,122 @@
+#include "voicestream.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace AI
+{
+    namespace
+    {
+        std::size_t roundUpToPowerOfTwo(std::size_t value)
+        {
+            std::size_t result = 1;
+            while (result < value)
+                result <<= 1;
+            return result;
+        }
+    }
+
+    AudioRingBuffer::AudioRingBuffer(std::size_t capacity)
+        : mMask(roundUpToPowerOfTwo(std::max<std::size_t>(capacity, 1)) - 1)
+    {
+        mData = std::make_unique<char[]>(mMask + 1);
+    }
+
+    std::size_t AudioRingBuffer::write(const char* data, std::size_t size)
+    {
+        const std::size_t writePosition = mWritePosition.load(std::memory_order_relaxed);
+        const std::size_t readPosition = mReadPosition.load(std::memory_order_acquire);
+        const std::size_t count = std::min(size, getCapacity() - (writePosition - readPosition));
+        if (count == 0)
+            return 0;
+
+        // Copy in up to two pieces, the second one wrapping to the start
+        const std::size_t offset = writePosition & mMask;
+        const std::size_t first = std::min(count, getCapacity() - offset);
+        std::memcpy(mData.get() + offset, data, first);
+        std::memcpy(mData.get(), data + first, count - first);
+
+        // Publish the bytes only once they are in place
+        mWritePosition.store(writePosition + count, std::memory_order_release);
+        return count;
+    }
+
+    std::size_t AudioRingBuffer::read(char* data, std::size_t size)
+    {
+        const std::size_t readPosition = mReadPosition.load(std::memory_order_relaxed);
+        const std::size_t writePosition = mWritePosition.load(std::memory_order_acquire);
+        const std::size_t count = std::min(size, writePosition - readPosition);
+        if (count == 0)
+            return 0;
+
+        const std::size_t offset = readPosition & mMask;
+        const std::size_t first = std::min(count, getCapacity() - offset);
+        std::memcpy(data, mData.get() + offset, first);
+        std::memcpy(data + first, mData.get(), count - first);
+
+        // Hand the space back to the producer only once the bytes are copied out
+        mReadPosition.store(readPosition + count, std::memory_order_release);
+        return count;
+    }
+
+    std::size_t AudioRingBuffer::getReadable() const
+    {
+        const std::size_t readPosition = mReadPosition.load(std::memory_order_acquire);
+        return mWritePosition.load(std::memory_order_acquire) - readPosition;
+    }
+
+    VoiceStream::VoiceStream(std::string format, std::size_t capacity)
+        : mFormat(std::move(format))
+        , mBuffer(capacity)
+    {
+    }
+
+    std::size_t VoiceStream::read(char* data, std::size_t size)
+    {
+        return mBuffer.read(data, size);
+    }
+
+    std::size_t VoiceStream::getAvailable() const
+    {
+        return mBuffer.getReadable();
+    }
+
+    bool VoiceStream::isComplete() const
+    {
+        return mComplete.load(std::memory_order_acquire);
+    }
+
+    bool VoiceStream::isFinished() const
+    {
+        // The end is published after the last write, so no audio can follow once it is seen
+        return isComplete() && mBuffer.getReadable() == 0;
+    }
+
+    bool VoiceStream::isTruncated() const
+    {
+        return mTruncated.load(std::memory_order_acquire);
+    }
+
+    std::size_t VoiceStream::append(std::string_view audio)
+    {
+        mReceived.fetch_add(audio.size(), std::memory_order_relaxed);
+
+        // The reader thread must not wait for a slow consumer; audio that does not fit is lost
+        const std::size_t lost = audio.size() - mBuffer.write(audio.data(), audio.size());
+        if (lost > 0)
+            mTruncated.store(true, std::memory_order_release);
+        return lost;
+    }
+
+    void VoiceStream::end(bool truncated)
+    {
+        if (truncated)
+            mTruncated.store(true, std::memory_order_release);
+        mComplete.store(true, std::memory_order_release);
+    }
+
+    std::uint64_t VoiceStream::getReceived() const
+    {
+        return mReceived.load(std::memory_order_relaxed);
+    }
+}
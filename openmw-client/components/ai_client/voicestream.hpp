@@ -0,0 +1,182 @@
+#ifndef OPENMW_COMPONENTS_AI_CLIENT_VOICESTREAM_H
+#define OPENMW_COMPONENTS_AI_CLIENT_VOICESTREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace AI
+{
+    /**
+     * @brief Byte ring buffer for one producer and one consumer thread
+     *
+     * Lock-free: the producer only advances the write position and the
+     * consumer only the read position, so neither ever waits for the other.
+     * Positions count bytes since creation and wrap through a power of two
+     * mask.
+     */
+    class AudioRingBuffer
+    {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param capacity Bytes the buffer holds; rounded up to a power of two
+         */
+        explicit AudioRingBuffer(std::size_t capacity);
+
+        /**
+         * @brief Append bytes; producer thread only
+         *
+         * @param data Bytes to append
+         * @param size Number of bytes
+         * @return Number of bytes appended, less than size when the buffer is full
+         */
+        std::size_t write(const char* data, std::size_t size);
+
+        /**
+         * @brief Take bytes out of the buffer; consumer thread only
+         *
+         * @param data Destination
+         * @param size Room in the destination
+         * @return Number of bytes taken
+         */
+        std::size_t read(char* data, std::size_t size);
+
+        /**
+         * @brief Get the number of bytes waiting to be read
+         *
+         * @return Byte count
+         */
+        std::size_t getReadable() const;
+
+        std::size_t getCapacity() const { return mMask + 1; }
+
+    private:
+        std::unique_ptr<char[]> mData;
+        std::size_t mMask;
+
+        // On separate cache lines, so the two threads do not contend for one
+        alignas(64) std::atomic<std::size_t> mWritePosition{ 0 };
+        alignas(64) std::atomic<std::size_t> mReadPosition{ 0 };
+    };
+
+    /**
+     * @brief Settings for streamed NPC voice audio
+     */
+    struct VoiceOptions
+    {
+        // Ask servers to stream voice audio of dialogue replies
+        bool stream = false;
+
+        // Encoded audio buffered per reply; audio that does not fit is lost
+        std::size_t bufferSize = 256 * 1024;
+
+        // Audio received before the dialogue callback fires, so playback does not underrun at once
+        std::size_t prebuffer = 4 * 1024;
+
+        // Longest wait for the prebuffer after the reply text arrived, even if no frame arrives meanwhile
+        std::chrono::milliseconds prebufferWait{ 300 };
+
+        // Pack file of the voice clip cache, empty for no cache, and its largest size in bytes.
+        // Lines found there are played from disk and their synthesis is cancelled.
+        std::string cacheFile;
+        std::uint64_t cacheCapacity = 64 * 1024 * 1024;
+    };
+
+    /**
+     * @brief Encoded voice audio of one dialogue reply, filled while the server synthesizes it
+     *
+     * The connection's reader thread appends chunks as they arrive; an
+     * engine audio decoder reads them from any one other thread. The reply's
+     * callback fires once enough audio has arrived to start playback, long
+     * before synthesis ends.
+     */
+    class VoiceStream
+    {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param format Encoding named by the server, e.g. "mp3" or "pcm16"
+         * @param capacity Bytes the ring buffer holds
+         */
+        VoiceStream(std::string format, std::size_t capacity);
+
+        const std::string& getFormat() const { return mFormat; }
+
+        /**
+         * @brief Take audio out of the stream; consumer thread only
+         *
+         * @param data Destination
+         * @param size Room in the destination
+         * @return Number of bytes taken; 0 when nothing is buffered yet or the stream is finished
+         */
+        std::size_t read(char* data, std::size_t size);
+
+        /**
+         * @brief Get the number of bytes buffered and not read yet
+         *
+         * @return Byte count
+         */
+        std::size_t getAvailable() const;
+
+        /**
+         * @brief Check if all audio has arrived
+         *
+         * @return true if the server ended the stream or the connection was lost, false otherwise
+         */
+        bool isComplete() const;
+
+        /**
+         * @brief Check if all audio has arrived and been read
+         *
+         * @return true if the consumer may stop polling, false otherwise
+         */
+        bool isFinished() const;
+
+        /**
+         * @brief Check if audio was lost
+         *
+         * @return true if the buffer overflowed or the stream broke off, false otherwise
+         */
+        bool isTruncated() const;
+
+        /**
+         * @brief Append a chunk; producer thread only
+         *
+         * @param audio Encoded audio
+         * @return Number of bytes that did not fit
+         */
+        std::size_t append(std::string_view audio);
+
+        /**
+         * @brief Mark the end of the audio; producer thread only
+         *
+         * @param truncated Whether the stream broke off before the server ended it
+         */
+        void end(bool truncated);
+
+        /**
+         * @brief Get the number of bytes appended so far
+         *
+         * @return Byte count, including bytes that did not fit
+         */
+        std::uint64_t getReceived() const;
+
+    private:
+        std::string mFormat;
+        AudioRingBuffer mBuffer;
+        std::atomic<std::uint64_t> mReceived{ 0 };
+        std::atomic<bool> mComplete{ false };
+        std::atomic<bool> mTruncated{ false };
+    };
+
+    using VoiceStreamPtr = std::shared_ptr<VoiceStream>;
+}
+
+#endif // OPENMW_COMPONENTS_AI_CLIENT_VOICESTREAM_H
@@ -1,23 +1,434 @@
 #include "ai.hpp"
+#include "components/ai_client/gamestateprovider.hpp"
 #include "components/openmw-mp/mwbase/aimanager.hpp"
 
+#include <cmath>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
 namespace LuaUtil
 {
+    namespace
+    {
+        /**
+         * @brief Lua handle to a dialogue result; keeps the shared result alive
+         */
+        struct DialogueResultView
+        {
+            AI::DialogueResultPtr mResult;
+        };
+
+        /**
+         * @brief Lua handle to one action of a dialogue result
+         */
+        struct ActionView
+        {
+            AI::DialogueResultPtr mResult;
+            std::size_t mIndex;
+
+            const AI::Action& get() const { return mResult->actions[mIndex]; }
+        };
+
+        /**
+         * @brief Lua handle to the parameters of one action of a dialogue result
+         */
+        struct ActionParamsView
+        {
+            AI::DialogueResultPtr mResult;
+            std::size_t mIndex;
+
+            const AI::ActionParams& get() const { return mResult->actions[mIndex].params; }
+        };
+
+        /**
+         * @brief Lua handle to one topic mentioned in a dialogue result
+         */
+        struct TopicView
+        {
+            AI::DialogueResultPtr mResult;
+            std::size_t mIndex;
+
+            const AI::TopicSpan& get() const { return mResult->topics[mIndex]; }
+        };
+
+        /**
+         * @brief Lua handle to a dialogue reply shared with a cell
+         */
+        struct SharedDialogueView
+        {
+            AI::SharedDialogue mDialogue;
+        };
+
+        std::map<std::string, std::string> toGameStateOverrides(const sol::optional<sol::table>& table)
+        {
+            // The game state snapshot is attached by the manager; only explicit overrides come from Lua
+            std::map<std::string, std::string> gameStateOverrides;
+            if (table)
+            {
+                for (const auto& pair : table.value())
+                {
+                    if (pair.second.is<std::string>())
+                        gameStateOverrides[pair.first.as<std::string>()] = pair.second.as<std::string>();
+                }
+            }
+            return gameStateOverrides;
+        }
+
+        AI::DialogueCallback makeDialogueCallback(sol::protected_function callback)
+        {
+            return [callback](const AI::DialogueResultPtr& dialogueResult) {
+                // Call Lua callback with response
+                if (callback)
+                {
+                    sol::protected_function_result result = callback(DialogueResultView{ dialogueResult });
+                    if (!result.valid())
+                    {
+                        sol::error err = result;
+                        std::cerr << "Error in AI dialogue callback: " << err.what() << std::endl;
+                    }
+                }
+            };
+        }
+
+        AI::Event toEvent(const sol::table& eventTable)
+        {
+            // Event fields: { type = AI.Event.PlayerPromotion, faction = "...", rank = "..." }
+            AI::Event event;
+            event.type = eventTable.get_or("type", AI::EventType::None);
+            event.faction = eventTable.get_or<std::string>("faction", "");
+            event.rank = eventTable.get_or<std::string>("rank", "");
+            event.questId = eventTable.get_or<std::string>("questId", "");
+            event.itemId = eventTable.get_or<std::string>("itemId", "");
+            event.count = eventTable.get_or("count", 0);
+            event.actorId = eventTable.get_or<std::string>("actorId", "");
+            return event;
+        }
+
+        std::optional<AI::EventTarget> toEventTarget(const sol::table& targetTable)
+        {
+            // Target fields: { npcIds = { "...", "..." } }, { faction = "..." } or { cell = "..." }
+            AI::EventTarget target;
+            if (const sol::optional<sol::table> npcIds = targetTable["npcIds"])
+            {
+                target.kind = AI::EventTargetKind::Npcs;
+                for (const auto& pair : npcIds.value())
+                {
+                    if (pair.second.is<std::string>())
+                        target.npcIds.push_back(pair.second.as<std::string>());
+                }
+                return target;
+            }
+            if (const sol::optional<std::string> faction = targetTable["faction"])
+            {
+                target.kind = AI::EventTargetKind::Faction;
+                target.id = faction.value();
+                return target;
+            }
+            if (const sol::optional<std::string> cell = targetTable["cell"])
+            {
+                target.kind = AI::EventTargetKind::Cell;
+                target.id = cell.value();
+                return target;
+            }
+            return std::nullopt;
+        }
+
+        MWBase::AIManager::EventCallback makeEventCallback(sol::optional<sol::protected_function> callback)
+        {
+            return [callback](bool success) {
+                // Call Lua callback with response
+                if (callback && callback.value())
+                {
+                    sol::protected_function_result result = callback.value()(success);
+                    if (!result.valid())
+                    {
+                        sol::error err = result;
+                        std::cerr << "Error in AI event callback: " << err.what() << std::endl;
+                    }
+                }
+            };
+        }
+
+        sol::object paramToLua(sol::this_state lua, const AI::ParamValue& value)
+        {
+            if (const auto* intValue = std::get_if<std::int32_t>(&value))
+                return sol::make_object(lua, *intValue);
+            if (const auto* floatValue = std::get_if<float>(&value))
+                return sol::make_object(lua, *floatValue);
+            if (const auto* stringValue = std::get_if<std::string>(&value))
+                return sol::make_object(lua, *stringValue);
+            if (const auto* itemId = std::get_if<AI::ItemId>(&value))
+                return sol::make_object(lua, itemId->view());
+            return sol::lua_nil;
+        }
+    }
+
     void registerAIFunctions(sol::state& lua, MWBase::AIManager* aiManager)
     {
         // Create AI table
         auto ai = lua.create_named_table("AI");
 
+        // Register action type constants (AI.Action.GiveItem, ...)
+        ai.new_enum("Action",
+            "None", AI::ActionType::None,
+            "Emote", AI::ActionType::Emote,
+            "GiveItem", AI::ActionType::GiveItem,
+            "TakeItem", AI::ActionType::TakeItem,
+            "StartBarter", AI::ActionType::StartBarter,
+            "Attack", AI::ActionType::Attack,
+            "EndConversation", AI::ActionType::EndConversation
+        );
+
+        // Register event type constants (AI.Event.PlayerPromotion, ...)
+        ai.new_enum("Event",
+            "None", AI::EventType::None,
+            "PlayerJoinedFaction", AI::EventType::PlayerJoinedFaction,
+            "PlayerLeftFaction", AI::EventType::PlayerLeftFaction,
+            "PlayerCompletedQuest", AI::EventType::PlayerCompletedQuest,
+            "PlayerFailedQuest", AI::EventType::PlayerFailedQuest,
+            "PlayerPromotion", AI::EventType::PlayerPromotion,
+            "PlayerDemotion", AI::EventType::PlayerDemotion,
+            "PlayerGaveItem", AI::EventType::PlayerGaveItem,
+            "PlayerTookItem", AI::EventType::PlayerTookItem,
+            "NPCAttacked", AI::EventType::NPCAttacked,
+            "NPCKilled", AI::EventType::NPCKilled
+        );
+
+        // Register dialogue results. Nothing is copied into Lua tables: text and
+        // actions are read from the shared C++ result when the script asks for them.
+        ai.new_usertype<ActionParamsView>("NPCActionParams",
+            sol::no_constructor,
+            sol::meta_function::index, [](const ActionParamsView& view, const std::string& key, sol::this_state lua) -> sol::object {
+                const AI::ActionParams& params = view.get();
+                if (std::optional<AI::ActionParams::Key> knownKey = AI::ActionParams::keyFromString(key))
+                {
+                    // Quantities go to tes3.addItem, so they are always whole numbers in the int32 range
+                    const AI::ParamValue& value = params.get(*knownKey);
+                    if (*knownKey == AI::ActionParams::Key::Quantity && std::holds_alternative<float>(value))
+                    {
+                        if (std::isnan(std::get<float>(value)))
+                            return sol::lua_nil;
+                        return sol::make_object(lua, params.getInt(*knownKey));
+                    }
+                    return paramToLua(lua, value);
+                }
+
+                const auto& extras = params.getExtras();
+                auto it = extras.find(key);
+                if (it != extras.end())
+                    return sol::make_object(lua, it->second);
+                return sol::lua_nil;
+            }
+        );
+
+        ai.new_usertype<ActionView>("NPCAction",
+            sol::no_constructor,
+            "type", sol::readonly_property([](const ActionView& view) { return view.get().type; }),
+            "params", sol::readonly_property([](const ActionView& view) {
+                return ActionParamsView{ view.mResult, view.mIndex };
+            })
+        );
+
+        // Topic spans use 1-based, inclusive byte positions, so text:sub(first, last) is the hyperlink
+        ai.new_usertype<TopicView>("DialogueTopic",
+            sol::no_constructor,
+            "topic", sol::readonly_property([](const TopicView& view) { return view.get().topic; }),
+            "first", sol::readonly_property([](const TopicView& view) { return view.get().offset + 1; }),
+            "last", sol::readonly_property([](const TopicView& view) {
+                return view.get().offset + view.get().length;
+            })
+        );
+
+        ai.new_usertype<DialogueResultView>("DialogueResult",
+            sol::no_constructor,
+            "text", sol::readonly_property([](const DialogueResultView& view) -> const std::string& {
+                return view.mResult->text;
+            }),
+            "isError", sol::readonly_property([](const DialogueResultView& view) {
+                return view.mResult->error;
+            }),
+            "isDropped", sol::readonly_property([](const DialogueResultView& view) {
+                return view.mResult->dropped;
+            }),
+            // The audio itself goes to the engine's decoder; scripts only learn that there is some
+            "hasVoice", sol::readonly_property([](const DialogueResultView& view) {
+                return view.mResult->voice != nullptr || view.mResult->voiceClip != nullptr;
+            }),
+            "actionCount", sol::readonly_property([](const DialogueResultView& view) {
+                return view.mResult->actions.size();
+            }),
+            "getAction", [](const DialogueResultView& view, std::size_t index) -> sol::optional<ActionView> {
+                // Lua indices are 1-based
+                if (index < 1 || index > view.mResult->actions.size())
+                    return sol::nullopt;
+                return ActionView{ view.mResult, index - 1 };
+            },
+            // Topics found in the text, in text order, for the dialogue window to hyperlink
+            "topicCount", sol::readonly_property([](const DialogueResultView& view) {
+                return view.mResult->topics.size();
+            }),
+            "getTopic", [](const DialogueResultView& view, std::size_t index) -> sol::optional<TopicView> {
+                if (index < 1 || index > view.mResult->topics.size())
+                    return sol::nullopt;
+                return TopicView{ view.mResult, index - 1 };
+            },
+            sol::meta_function::length, [](const DialogueResultView& view) {
+                return view.mResult->actions.size();
+            }
+        );
+
+        // Register game state updates; scripts report changes as they happen
+        auto gameState = ai.create_named("gameState");
+        gameState.set_function("setPlayer", [aiManager](
+            const std::string& name,
+            const std::string& race,
+            const std::string& gender,
+            const std::string& playerClass,
+            int level)
+        {
+            if (aiManager)
+                aiManager->getGameStateProvider().setPlayer(name, race, gender, playerClass, level);
+        });
+        gameState.set_function("onCellChanged", [aiManager](const std::string& cellName) {
+            if (aiManager)
+                aiManager->getGameStateProvider().onCellChanged(cellName);
+        });
+        gameState.set_function("onLevelUp", [aiManager](int level) {
+            if (aiManager)
+                aiManager->getGameStateProvider().onLevelUp(level);
+        });
+        gameState.set_function("onFactionChanged", [aiManager](const std::string& faction, int rank) {
+            if (aiManager)
+                aiManager->getGameStateProvider().onFactionChanged(faction, rank);
+        });
+        gameState.set_function("onWeatherChanged", [aiManager](const std::string& weather) {
+            if (aiManager)
+                aiManager->getGameStateProvider().onWeatherChanged(weather);
+        });
+        gameState.set_function("onHourChanged", [aiManager](float hour) {
+            if (aiManager)
+                aiManager->getGameStateProvider().onHourChanged(hour);
+        });
+
+        // Register statistics; latencies are reported in milliseconds
+        ai.set_function("getStats", [aiManager](sol::this_state lua) -> sol::table {
+            sol::state_view state(lua);
+            sol::table result = state.create_table();
+            if (!aiManager)
+                return result;
+
+            const AI::ClientStats stats = aiManager->getStats();
+            result["queueDepth"] = stats.queueDepth;
+            result["inFlight"] = stats.inFlight;
+            result["requestsSent"] = stats.requestsSent;
+            result["responsesReceived"] = stats.responsesReceived;
+            result["bytesOut"] = stats.bytesOut;
+            result["bytesIn"] = stats.bytesIn;
+            result["errors"] = stats.errors;
+            result["reconnects"] = stats.reconnects;
+
+            // latency.dialogue.total.p99, ...
+            sol::table latency = state.create_table();
+            for (std::size_t kind = 0; kind < AI::sRequestKindCount; ++kind)
+            {
+                sol::table stages = state.create_table();
+                for (std::size_t stage = 0; stage < AI::sLatencyStageCount; ++stage)
+                {
+                    const AI::LatencySummary& summary = stats.latency[kind][stage];
+                    stages[std::string(AI::sLatencyStageNames[stage])] = state.create_table_with(
+                        "count", summary.count,
+                        "mean", summary.mean / 1000.0,
+                        "p50", summary.p50 / 1000.0,
+                        "p90", summary.p90 / 1000.0,
+                        "p99", summary.p99 / 1000.0,
+                        "max", summary.max / 1000.0
+                    );
+                }
+                latency[std::string(AI::sRequestKindNames[kind])] = stages;
+            }
+            result["latency"] = latency;
+
+            // rateLimit.limitedBy.npc, rateLimit.tokens.dialogue, ...
+            const AI::RateLimitStats& rateLimit = stats.rateLimit;
+            sol::table limitedBy = state.create_table();
+            for (std::size_t scope = 0; scope < AI::sRateLimitScopeCount; ++scope)
+                limitedBy[std::string(AI::sRateLimitScopeNames[scope])] = rateLimit.limitedBy[scope];
+            sol::table tokens = state.create_table();
+            tokens["global"] = rateLimit.globalTokens;
+            for (std::size_t kind = 0; kind < AI::sRequestKindCount; ++kind)
+                tokens[std::string(AI::sRequestKindNames[kind])] = rateLimit.kindTokens[kind];
+            result["rateLimit"] = state.create_table_with(
+                "admitted", rateLimit.admitted,
+                "delayed", rateLimit.delayed,
+                "dropped", rateLimit.dropped,
+                "rejected", rateLimit.rejected,
+                "limitedBy", limitedBy,
+                "tokens", tokens,
+                "npcBuckets", rateLimit.npcBuckets
+            );
+
+            // hedge.delay is in milliseconds
+            result["hedge"] = state.create_table_with(
+                "fired", stats.hedge.fired,
+                "won", stats.hedge.won,
+                "overBudget", stats.hedge.overBudget,
+                "delay", stats.hedge.delay / 1000.0
+            );
+
+            result["voice"] = state.create_table_with(
+                "streams", stats.voice.streams,
+                "bytes", stats.voice.bytes,
+                "truncated", stats.voice.truncated
+            );
+            result["voiceCache"] = state.create_table_with(
+                "entries", stats.voiceCache.entries,
+                "bytes", stats.voiceCache.bytes,
+                "hits", stats.voiceCache.hits,
+                "misses", stats.voiceCache.misses,
+                "evictions", stats.voiceCache.evictions
+            );
+            result["items"] = state.create_table_with(
+                "checked", stats.items.checked,
+                "repaired", stats.items.repaired,
+                "rejected", stats.items.rejected
+            );
+
+            // endpoints[1].host, endpoints[1].state, endpoints[1].latency (ms), ...
+            sol::table endpoints = state.create_table();
+            for (std::size_t i = 0; i < stats.endpoints.size(); ++i)
+            {
+                const AI::EndpointStats& endpoint = stats.endpoints[i];
+                endpoints[i + 1] = state.create_table_with(
+                    "host", endpoint.host,
+                    "port", endpoint.port,
+                    "state", std::string(AI::sEndpointStateNames[static_cast<std::size_t>(endpoint.state)]),
+                    "protocol", endpoint.protocol,
+                    "maxInFlight", endpoint.maxInFlight,
+                    "outstanding", endpoint.outstanding,
+                    "latency", endpoint.latency / 1000.0,
+                    "completed", endpoint.completed,
+                    "failures", endpoint.failures
+                );
+            }
+            result["endpoints"] = endpoints;
+
+            const AI::FanoutStats shared = aiManager->getSharedDialogueStats();
+            result["shared"] = state.create_table_with(
+                "requests", shared.requests,
+                "generations", shared.generations,
+                "deliveries", shared.deliveries
+            );
+            return result;
+        });
+
         // Register AI functions
         ai.set_function("sendDialogue", [aiManager](
             const std::string& npcId,
             const std::string& playerMessage,
-            sol::optional<sol::table> gameStateTable,
+            sol::optional<sol::table> gameStateOverridesTable,
             sol::protected_function callback) -> void
         {
             if (!aiManager)
@@ -26,51 +437,137 @@ namespace LuaUtil
                 return;
             }
 
-            // Get NPC information from the NPC ID
-            // In a real implementation, this would be retrieved from the game
-            std::string npcName = "Unknown NPC";
-            std::string npcRace = "Dunmer";
-            std::string npcGender = "Male";
-            std::string npcClass = "Warrior";
-            std::string npcFaction = "None";
-
-            // Convert game state table to map
-            std::map<std::string, std::string> gameState;
-            if (gameStateTable)
-            {
-                for (const auto& pair : gameStateTable.value())
-                {
-                    if (pair.second.is<std::string>())
-                        gameState[pair.first.as<std::string>()] = pair.second.as<std::string>();
-                }
-            }
+            // Resolved from the engine's records on the NPC's first line only
+            const AI::NpcProfilePtr npc = aiManager->getNpcProfileCache().get(npcId);
 
             // Send dialogue request
             aiManager->sendDialogueRequest(
                 npcId,
-                npcName,
-                npcRace,
-                npcGender,
-                npcClass,
-                npcFaction,
+                npc,
                 playerMessage,
-                gameState,
-                [callback](const std::string& text, const std::vector<std::pair<std::string, std::map<std::string, std::string>>>& actions) {
-                    // Call Lua callback with response
-                    if (callback)
+                toGameStateOverrides(gameStateOverridesTable),
+                makeDialogueCallback(std::move(callback))
+            );
+        });
+
+        // Register shared dialogue for the multiplayer server: one reply per NPC
+        // conversation, handed to every player in the cell
+        ai.new_usertype<SharedDialogueView>("SharedDialogue",
+            sol::no_constructor,
+            "npcId", sol::readonly_property([](const SharedDialogueView& view) -> const std::string& {
+                return view.mDialogue.npcId;
+            }),
+            "conversationId", sol::readonly_property([](const SharedDialogueView& view) -> const std::string& {
+                return view.mDialogue.conversationId;
+            }),
+            "cell", sol::readonly_property([](const SharedDialogueView& view) -> const std::string& {
+                return view.mDialogue.cell;
+            }),
+            "speaker", sol::readonly_property([](const SharedDialogueView& view) {
+                return view.mDialogue.speaker;
+            }),
+            "playerMessage", sol::readonly_property([](const SharedDialogueView& view) -> const std::string& {
+                return view.mDialogue.playerMessage;
+            }),
+            "result", sol::readonly_property([](const SharedDialogueView& view) {
+                return DialogueResultView{ view.mDialogue.result };
+            })
+        );
+
+        ai.set_function("enableSharedDialogue", [aiManager](sol::protected_function deliver) {
+            if (!aiManager)
+            {
+                std::cerr << "Error: AI manager not initialized" << std::endl;
+                return;
+            }
+
+            aiManager->enableSharedDialogue(
+                [deliver](MWBase::AIManager::PlayerId player, const AI::SharedDialogue& dialogue) {
+                    sol::protected_function_result result = deliver(player, SharedDialogueView{ dialogue });
+                    if (!result.valid())
                     {
-                        sol::protected_function_result result = callback(text, actions);
-                        if (!result.valid())
-                        {
-                            sol::error err = result;
-                            std::cerr << "Error in AI dialogue callback: " << err.what() << std::endl;
-                        }
+                        sol::error err = result;
+                        std::cerr << "Error in AI shared dialogue callback: " << err.what() << std::endl;
                     }
                 }
             );
         });
+        ai.set_function("setPlayerCell", [aiManager](MWBase::AIManager::PlayerId player, const std::string& cell) {
+            if (aiManager)
+                aiManager->setPlayerCell(player, cell);
+        });
+        ai.set_function("removePlayer", [aiManager](MWBase::AIManager::PlayerId player) {
+            if (aiManager)
+                aiManager->removePlayer(player);
+        });
+
+        ai.set_function("sendSharedDialogue", [aiManager](
+            MWBase::AIManager::PlayerId player,
+            const std::string& npcId,
+            const std::string& playerMessage,
+            sol::optional<std::string> conversationId,
+            sol::optional<sol::table> gameStateOverridesTable,
+            sol::optional<sol::protected_function> callback) -> bool
+        {
+            if (!aiManager)
+            {
+                std::cerr << "Error: AI manager not initialized" << std::endl;
+                return false;
+            }
+
+            const AI::NpcProfilePtr npc = aiManager->getNpcProfileCache().get(npcId);
+
+            // Returns false when the request joined a reply already being generated
+            return aiManager->sendSharedDialogueRequest(
+                player,
+                conversationId.value_or(std::string()),
+                npcId,
+                npc,
+                playerMessage,
+                toGameStateOverrides(gameStateOverridesTable),
+                callback ? makeDialogueCallback(std::move(callback.value())) : AI::DialogueCallback()
+            );
+        });
 
         // Register event functions
+        ai.set_function("sendEvent", [aiManager](
+            const std::string& npcId,
+            const sol::table& eventTable,
+            sol::optional<sol::protected_function> callback) -> void
+        {
+            if (!aiManager)
+            {
+                std::cerr << "Error: AI manager not initialized" << std::endl;
+                return;
+            }
+
+            // Send event
+            aiManager->sendEvent(npcId, toEvent(eventTable), makeEventCallback(std::move(callback)));
+        });
+
+        // Register broadcast events: one message for a list of NPCs, a faction or a cell
+        ai.set_function("broadcastEvent", [aiManager](
+            const sol::table& targetTable,
+            const sol::table& eventTable,
+            sol::optional<sol::protected_function> callback) -> void
+        {
+            if (!aiManager)
+            {
+                std::cerr << "Error: AI manager not initialized" << std::endl;
+                return;
+            }
+
+            const std::optional<AI::EventTarget> target = toEventTarget(targetTable);
+            if (!target)
+            {
+                std::cerr << "Error: AI broadcast target needs npcIds, faction or cell" << std::endl;
+                return;
+            }
+
+            // Send event
+            aiManager->sendBroadcastEvent(*target, toEvent(eventTable), makeEventCallback(std::move(callback)));
+        });
+
         ai.set_function("sendPlayerJoinedFactionEvent", [aiManager](
             const std::string& npcId,
             const std::string& factionName,
@@ -6,6 +6,19 @@
 #include <functional>
 #include <vector>
 
+#include "components/ai_client/clientoptions.hpp"
+#include "components/ai_client/dialoguefanout.hpp"
+#include "components/ai_client/dialogueresult.hpp"
+#include "components/ai_client/event.hpp"
+#include "components/ai_client/itemindex.hpp"
+#include "components/ai_client/npcprofilecache.hpp"
+#include "components/ai_client/stats.hpp"
+
+namespace AI
+{
+    class GameStateProvider;
+}
+
 namespace MWBase
 {
     /**
@@ -17,13 +30,23 @@ namespace MWBase
         /**
          * @brief Callback type for dialogue responses
          */
-        using DialogueCallback = std::function<void(const std::string&, const std::vector<std::pair<std::string, std::map<std::string, std::string>>>&)>;
+        using DialogueCallback = AI::DialogueCallback;
 
         /**
          * @brief Callback type for event responses
          */
         using EventCallback = std::function<void(bool)>;
 
+        /**
+         * @brief Player in a multiplayer session
+         */
+        using PlayerId = AI::DialogueFanout::PlayerId;
+
+        /**
+         * @brief Callback that sends a shared dialogue reply to one player
+         */
+        using SharedDialogueCallback = AI::DialogueFanout::DeliverFunction;
+
         /**
          * @brief Virtual destructor
          */
@@ -34,9 +57,11 @@ namespace MWBase
          * 
          * @param host Server host
          * @param port Server port
+         * @param options Client tuning, such as rate limits
          * @return true if initialization successful, false otherwise
          */
-        virtual bool init(const std::string& host, unsigned short port) = 0;
+        virtual bool init(const std::string& host, unsigned short port,
+            const AI::ClientOptions& options = AI::ClientOptions()) = 0;
 
         /**
          * @brief Shutdown the AI manager
@@ -50,31 +75,179 @@ namespace MWBase
          */
         virtual bool isInitialized() const = 0;
 
+        /**
+         * @brief Get the game state provider
+         *
+         * The engine reports game state changes here; dialogue requests attach
+         * the provider's current snapshot.
+         *
+         * @return Game state provider
+         */
+        virtual AI::GameStateProvider& getGameStateProvider() = 0;
+
+        /**
+         * @brief Get the NPC profile cache
+         *
+         * The engine installs the record lookup and reports changed records
+         * here; dialogue requests take their NPC details from it.
+         *
+         * @return NPC profile cache
+         */
+        virtual AI::NpcProfileCache& getNpcProfileCache() = 0;
+
+        /**
+         * @brief Set the dialogue topics to find in replies
+         *
+         * The engine passes the topics of the loaded content files, and again
+         * whenever they change. Dialogue results then list the topics their
+         * text mentions, found off the main thread. Building the matcher takes
+         * a while, so this belongs to loading, not to each conversation.
+         *
+         * @param topics Topic names, in the encoding of the reply text
+         */
+        virtual void setDialogueTopics(const std::vector<std::string>& topics) = 0;
+
+        /**
+         * @brief Set the item records that actions may name
+         *
+         * The engine passes the items of the loaded content files, and again
+         * whenever they change. GIVE_ITEM and TAKE_ITEM actions in replies then
+         * carry a valid record ID, repaired off the main thread if the model
+         * got it slightly wrong; actions naming no known item are dropped.
+         *
+         * @param records IDs and names of all item records
+         */
+        virtual void setItemRecords(const std::vector<AI::ItemRecord>& records) = 0;
+
+        /**
+         * @brief Get a snapshot of the request statistics
+         *
+         * @return Counters and latency summaries per request type; empty if not initialized
+         */
+        virtual AI::ClientStats getStats() const = 0;
+
+        /**
+         * @brief Start recording request timelines
+         *
+         * @param path Chrome trace-event JSON file written by stopTrace()
+         */
+        virtual void startTrace(const std::string& path) = 0;
+
+        /**
+         * @brief Stop recording request timelines and write the trace file
+         *
+         * @return true if the file was written, false otherwise
+         */
+        virtual bool stopTrace() = 0;
+
         /**
          * @brief Send a dialogue request to the AI server
          * 
          * @param npcId NPC ID
-         * @param npcName NPC name
-         * @param npcRace NPC race
-         * @param npcGender NPC gender
-         * @param npcClass NPC class
-         * @param npcFaction NPC faction
+         * @param npc NPC details, usually from getNpcProfileCache()
          * @param playerMessage Player's message
-         * @param gameState Game state information
+         * @param gameStateOverrides Game state entries that replace or extend the current snapshot
          * @param callback Callback function for the response
          */
         virtual void sendDialogueRequest(
             const std::string& npcId,
-            const std::string& npcName,
-            const std::string& npcRace,
-            const std::string& npcGender,
-            const std::string& npcClass,
-            const std::string& npcFaction,
+            const AI::NpcProfilePtr& npc,
+            const std::string& playerMessage,
+            const std::map<std::string, std::string>& gameStateOverrides,
+            DialogueCallback callback
+        ) = 0;
+
+        /**
+         * @brief Share dialogue replies between the players of a cell
+         *
+         * For the multiplayer server, which owns the only AI client. Requests
+         * made with sendSharedDialogueRequest() for a conversation that is
+         * already waiting on a reply join it, and the reply is handed to every
+         * player in the cell.
+         *
+         * Must be called once, before init(). Replies in flight refer to the
+         * fan-out, so it is never replaced: later calls are ignored.
+         *
+         * @param deliver Sends a shared reply to one player; called on the client's IO thread
+         */
+        virtual void enableSharedDialogue(SharedDialogueCallback deliver) = 0;
+
+        /**
+         * @brief Record the cell a player is in, for shared dialogue
+         *
+         * @param player Player
+         * @param cell Cell name
+         */
+        virtual void setPlayerCell(PlayerId player, const std::string& cell) = 0;
+
+        /**
+         * @brief Forget a player that left the session
+         *
+         * @param player Player
+         */
+        virtual void removePlayer(PlayerId player) = 0;
+
+        /**
+         * @brief Send a dialogue request in a conversation shared by the player's cell
+         *
+         * Without enableSharedDialogue() this is a plain dialogue request.
+         *
+         * @param player Requesting player
+         * @param conversationId Conversation with the NPC; empty means the player's cell
+         * @param npcId NPC ID
+         * @param npc NPC details, usually from getNpcProfileCache()
+         * @param playerMessage Player's message
+         * @param gameStateOverrides Game state entries that replace or extend the current snapshot
+         * @param callback Callback function for the response; may be empty
+         * @return true if the request was sent, false if it joined one already waiting on a reply
+         */
+        virtual bool sendSharedDialogueRequest(
+            PlayerId player,
+            const std::string& conversationId,
+            const std::string& npcId,
+            const AI::NpcProfilePtr& npc,
             const std::string& playerMessage,
-            const std::map<std::string, std::string>& gameState,
+            const std::map<std::string, std::string>& gameStateOverrides,
             DialogueCallback callback
         ) = 0;
 
+        /**
+         * @brief Get the shared dialogue counters
+         *
+         * @return Requests, generations and deliveries; empty if shared dialogue is not enabled
+         */
+        virtual AI::FanoutStats getSharedDialogueStats() const = 0;
+
+        /**
+         * @brief Send a structured event to the AI server
+         * 
+         * @param npcId NPC ID
+         * @param event Event type and fields
+         * @param callback Callback function for the response
+         */
+        virtual void sendEvent(
+            const std::string& npcId,
+            const AI::Event& event,
+            EventCallback callback
+        ) = 0;
+
+        /**
+         * @brief Send a structured event to a group of NPCs in one message
+         *
+         * The server passes the event to every NPC the target selects, e.g.
+         * all members of the faction the player joined, and answers with one
+         * ack for the group.
+         *
+         * @param target NPCs by ID, a faction or a cell
+         * @param event Event type and fields
+         * @param callback Callback function for the aggregate response
+         */
+        virtual void sendBroadcastEvent(
+            const AI::EventTarget& target,
+            const AI::Event& event,
+            EventCallback callback
+        ) = 0;
+
         /**
          * @brief Send a player joined faction event to the AI server
          * 
@@ -1,8 +1,9 @@
 #include "aimanagerimpl.hpp"
 #include "components/ai_client/client.hpp"
+#include "components/ai_client/tracer.hpp"
 
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
 
 namespace MWBase
 {
@@ -16,15 +17,24 @@ namespace MWBase
         shutdown();
     }
 
-    bool AIManagerImpl::init(const std::string& host, unsigned short port)
+    bool AIManagerImpl::init(const std::string& host, unsigned short port, const AI::ClientOptions& options)
     {
         if (mInitialized)
             return true;
 
+        // Opt-in request tracing
+        if (const char* tracePath = std::getenv("OPENMW_AI_TRACE"))
+        {
+            if (*tracePath)
+                startTrace(tracePath);
+        }
+
         try
         {
             // Create AI client
-            mClient = std::make_unique<AI::Client>(host, port);
+            mClient = std::make_unique<AI::Client>(host, port, options);
+            mClient->setTopicMatcher(mTopicMatcher);
+            mClient->setItemIndex(mItemIndex);
 
             // Connect to server
             if (!mClient->connect())
@@ -57,6 +67,9 @@ namespace MWBase
             // Reset client
             mClient.reset();
 
+            // Write the trace, if one is being recorded
+            stopTrace();
+
             mInitialized = false;
         }
         catch (const std::exception& e)
@@ -70,165 +83,241 @@ namespace MWBase
         return mInitialized;
     }
 
+    AI::GameStateProvider& AIManagerImpl::getGameStateProvider()
+    {
+        return mGameState;
+    }
+
+    AI::NpcProfileCache& AIManagerImpl::getNpcProfileCache()
+    {
+        return mNpcProfiles;
+    }
+
+    void AIManagerImpl::setDialogueTopics(const std::vector<std::string>& topics)
+    {
+        mTopicMatcher = topics.empty() ? nullptr : std::make_shared<const AI::TopicMatcher>(topics);
+        if (mClient)
+            mClient->setTopicMatcher(mTopicMatcher);
+    }
+
+    void AIManagerImpl::setItemRecords(const std::vector<AI::ItemRecord>& records)
+    {
+        mItemIndex = records.empty() ? nullptr : std::make_shared<const AI::ItemIndex>(records);
+        if (mClient)
+            mClient->setItemIndex(mItemIndex);
+    }
+
+    void AIManagerImpl::startTrace(const std::string& path)
+    {
+        AI::Tracer& tracer = AI::Tracer::get();
+        tracer.setThreadName("Main");
+        tracer.start(path);
+    }
+
+    bool AIManagerImpl::stopTrace()
+    {
+        return AI::Tracer::get().stop();
+    }
+
+    AI::ClientStats AIManagerImpl::getStats() const
+    {
+        if (!mClient)
+            return AI::ClientStats();
+
+        return mClient->getStats();
+    }
+
     void AIManagerImpl::sendDialogueRequest(
         const std::string& npcId,
-        const std::string& npcName,
-        const std::string& npcRace,
-        const std::string& npcGender,
-        const std::string& npcClass,
-        const std::string& npcFaction,
+        const AI::NpcProfilePtr& npc,
         const std::string& playerMessage,
-        const std::map<std::string, std::string>& gameState,
+        const std::map<std::string, std::string>& gameStateOverrides,
         DialogueCallback callback)
     {
         if (!mInitialized)
         {
-            callback("Error: AI manager not initialized", {});
+            if (callback)
+                callback(AI::makeDialogueError("Error: AI manager not initialized"));
             return;
         }
 
         // Send dialogue request to AI client
         mClient->sendDialogueRequest(
-            npcId,
-            npcName,
-            npcRace,
-            npcGender,
-            npcClass,
-            npcFaction,
-            playerMessage,
-            gameState,
-            [callback](const std::string& text, const std::vector<AI::Action>& actions) {
-                // Convert actions to the format expected by the callback
-                std::vector<std::pair<std::string, std::map<std::string, std::string>>> convertedActions;
-                for (const auto& action : actions)
-                {
-                    std::string actionType;
-                    switch (action.type)
-                    {
-                        case AI::ActionType::Emote:
-                            actionType = "EMOTE";
-                            break;
-                        case AI::ActionType::GiveItem:
-                            actionType = "GIVE_ITEM";
-                            break;
-                        case AI::ActionType::TakeItem:
-                            actionType = "TAKE_ITEM";
-                            break;
-                        case AI::ActionType::StartBarter:
-                            actionType = "START_BARTER";
-                            break;
-                        case AI::ActionType::Attack:
-                            actionType = "ATTACK";
-                            break;
-                        case AI::ActionType::EndConversation:
-                            actionType = "END_CONVERSATION";
-                            break;
-                        default:
-                            actionType = "UNKNOWN";
-                            break;
-                    }
-                    convertedActions.emplace_back(actionType, action.params.params);
-                }
-                callback(text, convertedActions);
-            }
-        );
+            makeDialogueRequest(npcId, npc, playerMessage, gameStateOverrides),
+            std::move(callback));
     }
 
-    void AIManagerImpl::sendPlayerJoinedFactionEvent(
-        const std::string& npcId,
-        const std::string& factionName,
-        const std::string& rank,
-        EventCallback callback)
+    void AIManagerImpl::enableSharedDialogue(SharedDialogueCallback deliver)
     {
-        if (!mInitialized)
+        // Client callbacks of shared requests point at the fan-out, so it lives as long as the manager
+        if (mFanout)
         {
-            callback(false);
+            std::cerr << "Warning: AI shared dialogue is already enabled" << std::endl;
             return;
         }
+        if (mInitialized)
+            std::cerr << "Warning: AI shared dialogue should be enabled before init" << std::endl;
+
+        // Requests only reach the fan-out while initialized, so the client exists when it sends
+        mFanout = std::make_unique<AI::DialogueFanout>(
+            [this](AI::DialogueRequest request, AI::DialogueCallback callback) {
+                mClient->sendDialogueRequest(std::move(request), std::move(callback));
+            },
+            std::move(deliver));
+    }
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has joined " << factionName << " and is now a " << rank << ".";
+    void AIManagerImpl::setPlayerCell(PlayerId player, const std::string& cell)
+    {
+        if (mFanout)
+            mFanout->setPlayerCell(player, cell);
+    }
 
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerJoinedFaction,
-            description.str(),
-            callback
-        );
+    void AIManagerImpl::removePlayer(PlayerId player)
+    {
+        if (mFanout)
+            mFanout->removePlayer(player);
     }
 
-    void AIManagerImpl::sendPlayerLeftFactionEvent(
+    bool AIManagerImpl::sendSharedDialogueRequest(
+        PlayerId player,
+        const std::string& conversationId,
         const std::string& npcId,
-        const std::string& factionName,
-        EventCallback callback)
+        const AI::NpcProfilePtr& npc,
+        const std::string& playerMessage,
+        const std::map<std::string, std::string>& gameStateOverrides,
+        DialogueCallback callback)
     {
         if (!mInitialized)
         {
-            callback(false);
-            return;
+            if (callback)
+                callback(AI::makeDialogueError("Error: AI manager not initialized"));
+            return false;
         }
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has left " << factionName << ".";
+        AI::DialogueRequest request = makeDialogueRequest(npcId, npc, playerMessage, gameStateOverrides);
 
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerLeftFaction,
-            description.str(),
-            callback
-        );
+        if (!mFanout)
+        {
+            mClient->sendDialogueRequest(std::move(request), std::move(callback));
+            return true;
+        }
+
+        return mFanout->request(player, conversationId, std::move(request), std::move(callback));
     }
 
-    void AIManagerImpl::sendPlayerCompletedQuestEvent(
+    AI::FanoutStats AIManagerImpl::getSharedDialogueStats() const
+    {
+        if (!mFanout)
+            return AI::FanoutStats();
+
+        return mFanout->getStats();
+    }
+
+    AI::DialogueRequest AIManagerImpl::makeDialogueRequest(
         const std::string& npcId,
-        const std::string& questName,
+        const AI::NpcProfilePtr& npc,
+        const std::string& playerMessage,
+        const std::map<std::string, std::string>& gameStateOverrides) const
+    {
+        AI::DialogueRequest request;
+        request.npcId = npcId;
+        request.npc = npc;
+        request.playerMessage = playerMessage;
+        request.gameState = mGameState.getSnapshot();
+        request.gameStateOverrides = gameStateOverrides;
+        return request;
+    }
+
+    void AIManagerImpl::sendEvent(
+        const std::string& npcId,
+        const AI::Event& event,
         EventCallback callback)
     {
         if (!mInitialized)
         {
-            callback(false);
+            if (callback)
+                callback(false);
             return;
         }
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has completed the quest: " << questName << ".";
-
         // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerCompletedQuest,
-            description.str(),
-            callback
-        );
+        AI::EventRequest request;
+        request.npcId = npcId;
+        request.event = event;
+        mClient->sendEvent(std::move(request), std::move(callback));
     }
 
-    void AIManagerImpl::sendPlayerFailedQuestEvent(
-        const std::string& npcId,
-        const std::string& questName,
+    void AIManagerImpl::sendBroadcastEvent(
+        const AI::EventTarget& target,
+        const AI::Event& event,
         EventCallback callback)
     {
         if (!mInitialized)
         {
-            callback(false);
+            if (callback)
+                callback(false);
             return;
         }
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has failed the quest: " << questName << ".";
+        // One request for the whole group; the server fans it out
+        AI::EventRequest request;
+        request.event = event;
+        request.target = target;
+        mClient->sendEvent(std::move(request), std::move(callback));
+    }
 
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerFailedQuest,
-            description.str(),
-            callback
-        );
+    void AIManagerImpl::sendPlayerJoinedFactionEvent(
+        const std::string& npcId,
+        const std::string& factionName,
+        const std::string& rank,
+        EventCallback callback)
+    {
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerJoinedFaction;
+        event.faction = factionName;
+        event.rank = rank;
+
+        sendEvent(npcId, event, std::move(callback));
+    }
+
+    void AIManagerImpl::sendPlayerLeftFactionEvent(
+        const std::string& npcId,
+        const std::string& factionName,
+        EventCallback callback)
+    {
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerLeftFaction;
+        event.faction = factionName;
+
+        sendEvent(npcId, event, std::move(callback));
+    }
+
+    void AIManagerImpl::sendPlayerCompletedQuestEvent(
+        const std::string& npcId,
+        const std::string& questName,
+        EventCallback callback)
+    {
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerCompletedQuest;
+        event.questId = questName;
+
+        sendEvent(npcId, event, std::move(callback));
+    }
+
+    void AIManagerImpl::sendPlayerFailedQuestEvent(
+        const std::string& npcId,
+        const std::string& questName,
+        EventCallback callback)
+    {
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerFailedQuest;
+        event.questId = questName;
+
+        sendEvent(npcId, event, std::move(callback));
     }
 
     void AIManagerImpl::sendPlayerPromotionEvent(
@@ -237,23 +326,13 @@ namespace MWBase
         const std::string& newRank,
         EventCallback callback)
     {
-        if (!mInitialized)
-        {
-            callback(false);
-            return;
-        }
-
-        // Create description
-        std::ostringstream description;
-        description << "The player has been promoted to " << newRank << " in " << factionName << ".";
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerPromotion;
+        event.faction = factionName;
+        event.rank = newRank;
 
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerPromotion,
-            description.str(),
-            callback
-        );
+        sendEvent(npcId, event, std::move(callback));
     }
 
     void AIManagerImpl::sendPlayerDemotionEvent(
@@ -262,23 +341,13 @@ namespace MWBase
         const std::string& newRank,
         EventCallback callback)
     {
-        if (!mInitialized)
-        {
-            callback(false);
-            return;
-        }
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerDemotion;
+        event.faction = factionName;
+        event.rank = newRank;
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has been demoted to " << newRank << " in " << factionName << ".";
-
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerDemotion,
-            description.str(),
-            callback
-        );
+        sendEvent(npcId, event, std::move(callback));
     }
 
     void AIManagerImpl::sendPlayerGaveItemEvent(
@@ -287,23 +356,13 @@ namespace MWBase
         int count,
         EventCallback callback)
     {
-        if (!mInitialized)
-        {
-            callback(false);
-            return;
-        }
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerGaveItem;
+        event.itemId = itemId;
+        event.count = count;
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has given " << count << " " << itemId << " to the NPC.";
-
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerGaveItem,
-            description.str(),
-            callback
-        );
+        sendEvent(npcId, event, std::move(callback));
     }
 
     void AIManagerImpl::sendPlayerTookItemEvent(
@@ -312,23 +371,13 @@ namespace MWBase
         int count,
         EventCallback callback)
     {
-        if (!mInitialized)
-        {
-            callback(false);
-            return;
-        }
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::PlayerTookItem;
+        event.itemId = itemId;
+        event.count = count;
 
-        // Create description
-        std::ostringstream description;
-        description << "The player has taken " << count << " " << itemId << " from the NPC.";
-
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::PlayerTookItem,
-            description.str(),
-            callback
-        );
+        sendEvent(npcId, event, std::move(callback));
     }
 
     void AIManagerImpl::sendNPCAttackedEvent(
@@ -336,23 +385,12 @@ namespace MWBase
         const std::string& attackerId,
         EventCallback callback)
     {
-        if (!mInitialized)
-        {
-            callback(false);
-            return;
-        }
-
-        // Create description
-        std::ostringstream description;
-        description << "The NPC has been attacked by " << attackerId << ".";
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::NPCAttacked;
+        event.actorId = attackerId;
 
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::NPCAttacked,
-            description.str(),
-            callback
-        );
+        sendEvent(npcId, event, std::move(callback));
     }
 
     void AIManagerImpl::sendNPCKilledEvent(
@@ -360,29 +398,11 @@ namespace MWBase
         const std::string& killerId,
         EventCallback callback)
     {
-        if (!mInitialized)
-        {
-            callback(false);
-            return;
-        }
-
-        // Create description
-        std::ostringstream description;
-        description << "The NPC has been killed by " << killerId << ".";
+        // Create event
+        AI::Event event;
+        event.type = AI::EventType::NPCKilled;
+        event.actorId = killerId;
 
-        // Send event to AI client
-        mClient->sendEvent(
-            npcId,
-            AI::EventType::NPCKilled,
-            description.str(),
-            callback
-        );
-    }
-
-    std::vector<std::pair<std::string, std::map<std::string, std::string>>> AIManagerImpl::convertActions(
-        const std::vector<std::pair<std::string, std::map<std::string, std::string>>>& clientActions)
-    {
-        // This function is not used in the current implementation
-        return clientActions;
+        sendEvent(npcId, event, std::move(callback));
     }
 }
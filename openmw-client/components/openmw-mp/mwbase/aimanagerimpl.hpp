@@ -2,6 +2,8 @@
 #define OPENMW_COMPONENTS_MWBASE_AIMANAGERIMPL_H
 
 #include "aimanager.hpp"
+#include "components/ai_client/gamestateprovider.hpp"
+#include "components/ai_client/request.hpp"
 #include <memory>
 
 namespace AI
@@ -32,9 +34,11 @@ namespace MWBase
          * 
          * @param host Server host
          * @param port Server port
+         * @param options Client tuning, such as rate limits
          * @return true if initialization successful, false otherwise
          */
-        bool init(const std::string& host, unsigned short port) override;
+        bool init(const std::string& host, unsigned short port,
+            const AI::ClientOptions& options = AI::ClientOptions()) override;
 
         /**
          * @brief Shutdown the AI manager
@@ -48,31 +52,155 @@ namespace MWBase
          */
         bool isInitialized() const override;
 
+        /**
+         * @brief Get the game state provider
+         *
+         * @return Game state provider
+         */
+        AI::GameStateProvider& getGameStateProvider() override;
+
+        /**
+         * @brief Get the NPC profile cache
+         *
+         * @return NPC profile cache
+         */
+        AI::NpcProfileCache& getNpcProfileCache() override;
+
+        /**
+         * @brief Set the dialogue topics to find in replies
+         *
+         * @param topics Topic names
+         */
+        void setDialogueTopics(const std::vector<std::string>& topics) override;
+
+        /**
+         * @brief Set the item records that actions may name
+         *
+         * @param records IDs and names of all item records
+         */
+        void setItemRecords(const std::vector<AI::ItemRecord>& records) override;
+
+        /**
+         * @brief Get a snapshot of the request statistics
+         *
+         * @return Counters and latency summaries per request type
+         */
+        AI::ClientStats getStats() const override;
+
+        /**
+         * @brief Start recording request timelines
+         *
+         * Tracing also starts in init() if OPENMW_AI_TRACE names a file.
+         *
+         * @param path Chrome trace-event JSON file written by stopTrace()
+         */
+        void startTrace(const std::string& path) override;
+
+        /**
+         * @brief Stop recording request timelines and write the trace file
+         *
+         * Called by shutdown().
+         *
+         * @return true if the file was written, false otherwise
+         */
+        bool stopTrace() override;
+
         /**
          * @brief Send a dialogue request to the AI server
          * 
          * @param npcId NPC ID
-         * @param npcName NPC name
-         * @param npcRace NPC race
-         * @param npcGender NPC gender
-         * @param npcClass NPC class
-         * @param npcFaction NPC faction
+         * @param npc NPC details, usually from getNpcProfileCache()
          * @param playerMessage Player's message
-         * @param gameState Game state information
+         * @param gameStateOverrides Game state entries that replace or extend the current snapshot
          * @param callback Callback function for the response
          */
         void sendDialogueRequest(
             const std::string& npcId,
-            const std::string& npcName,
-            const std::string& npcRace,
-            const std::string& npcGender,
-            const std::string& npcClass,
-            const std::string& npcFaction,
+            const AI::NpcProfilePtr& npc,
             const std::string& playerMessage,
-            const std::map<std::string, std::string>& gameState,
+            const std::map<std::string, std::string>& gameStateOverrides,
             DialogueCallback callback
         ) override;
 
+        /**
+         * @brief Share dialogue replies between the players of a cell
+         *
+         * Must be called once, before init(); later calls are ignored.
+         *
+         * @param deliver Sends a shared reply to one player; called on the client's IO thread
+         */
+        void enableSharedDialogue(SharedDialogueCallback deliver) override;
+
+        /**
+         * @brief Record the cell a player is in, for shared dialogue
+         *
+         * @param player Player
+         * @param cell Cell name
+         */
+        void setPlayerCell(PlayerId player, const std::string& cell) override;
+
+        /**
+         * @brief Forget a player that left the session
+         *
+         * @param player Player
+         */
+        void removePlayer(PlayerId player) override;
+
+        /**
+         * @brief Send a dialogue request in a conversation shared by the player's cell
+         *
+         * @param player Requesting player
+         * @param conversationId Conversation with the NPC; empty means the player's cell
+         * @param npcId NPC ID
+         * @param npc NPC details, usually from getNpcProfileCache()
+         * @param playerMessage Player's message
+         * @param gameStateOverrides Game state entries that replace or extend the current snapshot
+         * @param callback Callback function for the response; may be empty
+         * @return true if the request was sent, false if it joined one already waiting on a reply
+         */
+        bool sendSharedDialogueRequest(
+            PlayerId player,
+            const std::string& conversationId,
+            const std::string& npcId,
+            const AI::NpcProfilePtr& npc,
+            const std::string& playerMessage,
+            const std::map<std::string, std::string>& gameStateOverrides,
+            DialogueCallback callback
+        ) override;
+
+        /**
+         * @brief Get the shared dialogue counters
+         *
+         * @return Requests, generations and deliveries; empty if shared dialogue is not enabled
+         */
+        AI::FanoutStats getSharedDialogueStats() const override;
+
+        /**
+         * @brief Send a structured event to the AI server
+         * 
+         * @param npcId NPC ID
+         * @param event Event type and fields
+         * @param callback Callback function for the response
+         */
+        void sendEvent(
+            const std::string& npcId,
+            const AI::Event& event,
+            EventCallback callback
+        ) override;
+
+        /**
+         * @brief Send a structured event to a group of NPCs in one message
+         * 
+         * @param target NPCs by ID, a faction or a cell
+         * @param event Event type and fields
+         * @param callback Callback function for the aggregate response
+         */
+        void sendBroadcastEvent(
+            const AI::EventTarget& target,
+            const AI::Event& event,
+            EventCallback callback
+        ) override;
+
         /**
          * @brief Send a player joined faction event to the AI server
          * 
@@ -214,19 +342,31 @@ namespace MWBase
         ) override;
 
     private:
-        /**
-         * @brief Convert AI client actions to AI manager actions
-         * 
-         * @param clientActions Client actions
-         * @return AI manager actions
-         */
-        std::vector<std::pair<std::string, std::map<std::string, std::string>>> convertActions(
-            const std::vector<std::pair<std::string, std::map<std::string, std::string>>>& clientActions
-        );
+        AI::DialogueRequest makeDialogueRequest(
+            const std::string& npcId,
+            const AI::NpcProfilePtr& npc,
+            const std::string& playerMessage,
+            const std::map<std::string, std::string>& gameStateOverrides
+        ) const;
 
         // AI client
         std::unique_ptr<AI::Client> mClient;
 
+        // Game state snapshot attached to dialogue requests
+        AI::GameStateProvider mGameState;
+
+        // NPC details attached to dialogue requests
+        AI::NpcProfileCache mNpcProfiles;
+
+        // Topics found in replies; kept for clients created after the topics were loaded
+        AI::TopicMatcherPtr mTopicMatcher;
+
+        // Items that actions may name; kept for clients created after the records were loaded
+        AI::ItemIndexPtr mItemIndex;
+
+        // Shared dialogue of a multiplayer server; null unless enabled
+        std::unique_ptr<AI::DialogueFanout> mFanout;
+
         // Initialization state
         bool mInitialized;
     };
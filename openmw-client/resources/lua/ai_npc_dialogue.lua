@@ -39,39 +39,56 @@ local function registerNPC(npcId)
     }
 end
 
--- Get current game state
-local function getGameState()
+-- Faction ranks last reported to the AI game state
+local knownFactionRanks = {}
+
+-- Report the player's static information to the AI game state
+local function syncPlayer()
     local player = tes3.player
     if not player then
         log("warning", "Player not found")
-        return {}
-    end
-    
-    local playerCell = player.cell
-    local cellName = playerCell and playerCell.name or "Unknown"
-    
-    local gameState = {
-        player_name = player.name,
-        player_race = player.race.name,
-        player_gender = player.female and "Female" or "Male",
-        player_class = player.class.name,
-        player_level = tostring(player.level),
-        location = cellName,
-        time_of_day = tes3.worldController.hour.value < 6 and "Night" or
-                      tes3.worldController.hour.value < 12 and "Morning" or
-                      tes3.worldController.hour.value < 18 and "Afternoon" or
-                      "Evening",
-        weather = tes3.worldController.weatherController.currentWeather.name,
-    }
+        return
+    end
+    
+    AI.gameState.setPlayer(
+        player.name,
+        player.race.name,
+        player.female and "Female" or "Male",
+        player.class.name,
+        player.level
+    )
+end
+
+-- Report faction changes since the last sync to the AI game state; with announce set,
+-- joining or leaving a faction is also told to all of its members in one broadcast
+local function syncFactions(announce)
+    local player = tes3.player
+    if not player then
+        return
+    end
     
-    -- Add faction information
-    local factions = {}
+    local seen = {}
     for faction, rank in pairs(player.factions) do
-        factions[faction.name] = tostring(rank)
+        seen[faction.name] = true
+        if knownFactionRanks[faction.name] ~= rank then
+            if announce and knownFactionRanks[faction.name] == nil then
+                AI.broadcastEvent({faction = faction.name},
+                    {type = AI.Event.PlayerJoinedFaction, faction = faction.name, rank = tostring(rank)})
+            end
+            knownFactionRanks[faction.name] = rank
+            AI.gameState.onFactionChanged(faction.name, rank)
+        end
     end
-    gameState.player_factions = table.concat(factions, ",")
     
-    return gameState
+    for name in pairs(knownFactionRanks) do
+        if not seen[name] then
+            if announce then
+                AI.broadcastEvent({faction = name}, {type = AI.Event.PlayerLeftFaction, faction = name})
+            end
+            knownFactionRanks[name] = nil
+            AI.gameState.onFactionChanged(name, -1)
+        end
+    end
 end
 
 -- Handle dialogue topic
@@ -84,33 +101,39 @@ local function handleDialogueTopic(npcId, topic)
     
     log("debug", "Handling dialogue topic for NPC " .. npcId .. ": " .. topic)
     
-    -- Get game state
-    local gameState = getGameState()
-    
-    -- Send dialogue request to AI server
+    -- Send dialogue request to AI server; the game state snapshot is attached by the engine
     local result = nil
-    AI.sendDialogue(npcId, topic, gameState, function(text, actions)
+    AI.sendDialogue(npcId, topic, nil, function(response)
+        -- Requests dropped by a rate limit have no reply to show
+        if response.isDropped then
+            log("debug", "Dialogue request dropped by rate limit")
+            return
+        end
+        
+        local text = response.text
         log("debug", "Received response from AI server: " .. text)
         
-        -- Process actions
+        -- Process actions; item IDs were already checked against the item records,
+        -- and actions naming unknown items dropped, before this callback
         local processedActions = {}
-        for i, action in ipairs(actions) do
-            local actionType = action[1]
-            local params = action[2]
+        for i = 1, response.actionCount do
+            local action = response:getAction(i)
+            local actionType = action.type
+            local params = action.params
             
-            log("debug", "Processing action: " .. actionType)
+            log("debug", "Processing action: " .. tostring(actionType))
             
-            if actionType == "EMOTE" then
+            if actionType == AI.Action.Emote then
                 -- Handle emote action
                 local emote = params.description or ""
                 processedActions[#processedActions + 1] = {
                     type = "emote",
                     text = emote,
                 }
-            elseif actionType == "GIVE_ITEM" then
+            elseif actionType == AI.Action.GiveItem then
                 -- Handle give item action
                 local itemId = params.item_id or ""
-                local count = tonumber(params.quantity) or 1
+                local count = params.quantity or 1
                 
                 -- Add item to player inventory
                 tes3.addItem({
@@ -125,10 +148,10 @@ local function handleDialogueTopic(npcId, topic)
                     item = itemId,
                     count = count,
                 }
-            elseif actionType == "TAKE_ITEM" then
+            elseif actionType == AI.Action.TakeItem then
                 -- Handle take item action
                 local itemId = params.item_id or ""
-                local count = tonumber(params.quantity) or 1
+                local count = params.quantity or 1
                 
                 -- Remove item from player inventory
                 tes3.removeItem({
@@ -143,12 +166,12 @@ local function handleDialogueTopic(npcId, topic)
                     item = itemId,
                     count = count,
                 }
-            elseif actionType == "START_BARTER" then
+            elseif actionType == AI.Action.StartBarter then
                 -- Handle start barter action
                 processedActions[#processedActions + 1] = {
                     type = "start_barter",
                 }
-            elseif actionType == "ATTACK" then
+            elseif actionType == AI.Action.Attack then
                 -- Handle attack action
                 local reason = params.reason or ""
                 
@@ -156,7 +179,7 @@ local function handleDialogueTopic(npcId, topic)
                     type = "attack",
                     reason = reason,
                 }
-            elseif actionType == "END_CONVERSATION" then
+            elseif actionType == AI.Action.EndConversation then
                 -- Handle end conversation action
                 local reason = params.reason or ""
                 
@@ -167,10 +190,22 @@ local function handleDialogueTopic(npcId, topic)
             end
         end
         
+        -- Collect topic hyperlinks, found by the engine before the callback
+        local topics = {}
+        for i = 1, response.topicCount do
+            local topic = response:getTopic(i)
+            topics[#topics + 1] = {
+                topic = topic.topic,
+                first = topic.first,
+                last = topic.last,
+            }
+        end
+        
         -- Store result
         result = {
             text = text,
             actions = processedActions,
+            topics = topics,
         }
     end)
     
@@ -182,6 +217,7 @@ local function registerEventHandlers()
     -- Register script for NPCs with the AIDialogue script
     local function onCellChanged(e)
         log("debug", "Cell changed: " .. (e.cell.name or "unnamed"))
+        AI.gameState.onCellChanged(e.cell.name or "Unknown")
         
         -- Find NPCs with AIDialogue script
         for _, ref in pairs(e.cell.actors) do
@@ -223,11 +259,41 @@ local function registerEventHandlers()
         end
     end
     
+    -- Keep the AI game state snapshot up to date
+    local function onLevelUp(e)
+        AI.gameState.onLevelUp(e.level)
+    end
+    
+    local function onWeatherChanged(e)
+        AI.gameState.onWeatherChanged(e.to.name)
+    end
+    
+    local function onMenuExit()
+        -- Faction joins and promotions happen in dialogue
+        syncFactions(true)
+    end
+    
+    local function onHourChanged()
+        AI.gameState.onHourChanged(tes3.worldController.hour.value)
+    end
+    
     -- Register event handlers
     event.register("cellChanged", onCellChanged)
     event.register("dialogue topic", onDialogue)
+    event.register("levelUp", onLevelUp)
+    event.register("weatherTransitionFinished", onWeatherChanged)
+    event.register("weatherChangedImmediate", onWeatherChanged)
+    event.register("menuExit", onMenuExit)
+    timer.start({type = timer.game, duration = 1, iterations = -1, callback = onHourChanged})
     
-    -- Initial cell scan
+    -- Initial game state and cell scan
+    syncPlayer()
+    syncFactions()
+    onHourChanged()
+    local weather = tes3.worldController.weatherController.currentWeather
+    if weather then
+        AI.gameState.onWeatherChanged(weather.name)
+    end
     if tes3.player and tes3.player.cell then
         onCellChanged({cell = tes3.player.cell})
     end